@@ -0,0 +1,208 @@
+/* bench/fleet_bench.c
+ *
+ * Benchmark kroku fizyki floty: tablica struktur jak DroneState z src/drone.c (pętla po dronach,
+ * switch po fazie, double) kontra układ SoA z jednym przejściem wektorowym (src/physics.c).
+ *   fleet_bench [-n drony] [-t kroki] [-d dt_s] [-c ładowanie_s] [-s ziarno]
+ * Obie wersje grają te same reguły: lot do progu 20%, prośba o lądowanie spełniana od razu
+ * (co 16. dron nie dostaje zgody i ginie w kolejce), ładowanie T1, start zaraz po naładowaniu.
+ * Obie wersje liczą tą samą arytmetyką (float, ładowanie odliczane w krokach), więc liczby zdarzeń
+ * i stan końcowy muszą się zgadzać dokładnie - porównujemy układ danych, nie zaokrąglenia.
+ * Wynik: czas kroku (us, p50 / p99), ns na drona, przyspieszenie i zgodność liczby zdarzeń.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+#include "../include/physics.h"
+
+#define CRITICAL 20.0f
+#define DEAD     0.0f
+#define FULL     100.0f
+#define NO_GRANT 16 // Co który dron czeka na lądowanie bez końca
+
+// Stan drona jak w src/drone.c (plus licznik ticków ładowania z pętli for w fazie ładowania).
+// Bateria i tempa we float - ta sama arytmetyka co w src/physics.c.
+typedef struct {
+    int id;
+    float current_battery;
+    int T1;
+    int T2;
+    float drain_rate_per_sec;
+    int cycles_flown;
+    int max_cycles;
+    int location;
+    int phase;
+    int kamikaze_pending;
+    float charge_rate; // %/s w trakcie ładowania
+    int charge_tick, charge_ticks;
+} DroneState;
+
+struct Events { long critical, dead, full; };
+
+static int *ev_critical, *ev_dead, *ev_full; // Listy zdarzeń wersji skalarnej (jak w SoA)
+
+// Jeden krok wszystkich dronów logiką pętli z src/drone.c
+static void aos_step(DroneState *d, int n, float dt, struct Events *tot) {
+    int nc = 0, nd = 0, nf = 0;
+    for (int i = 0; i < n; i++) {
+        DroneState *x = &d[i];
+        switch (x->phase) {
+            case TM_FLYING:
+                x->current_battery -= x->drain_rate_per_sec * dt;
+                if (x->current_battery <= DEAD) { x->current_battery = DEAD; x->phase = TM_DEAD; ev_dead[nd++] = i; }
+                else if (x->current_battery <= CRITICAL) ev_critical[nc++] = i;
+                break;
+            case TM_QUEUED:
+                x->current_battery -= x->drain_rate_per_sec * dt;
+                if (x->current_battery <= DEAD) { x->current_battery = DEAD; x->phase = TM_DEAD; ev_dead[nd++] = i; }
+                break;
+            case TM_CHARGING:
+                x->current_battery += x->charge_rate * dt;
+                if (x->current_battery > FULL) x->current_battery = FULL;
+                if (++x->charge_tick >= x->charge_ticks) {
+                    x->current_battery = FULL;
+                    x->cycles_flown++;
+                    x->phase = TM_WAIT_TAKEOFF;
+                    ev_full[nf++] = i;
+                }
+                break;
+        }
+    }
+    // Reakcja na zdarzenia (jak Operator: zgoda od razu, poza co NO_GRANT-tym dronem)
+    for (int j = 0; j < nc; j++) {
+        DroneState *x = &d[ev_critical[j]];
+        if (x->id % NO_GRANT == 0) { x->phase = TM_QUEUED; continue; }
+        x->phase = TM_CHARGING;
+        x->charge_ticks = (int)((float)x->T1 / dt + 0.5f);
+        if (x->charge_ticks < 1) x->charge_ticks = 1;
+        x->charge_tick = 0;
+        x->charge_rate = (FULL - x->current_battery) / (float)x->T1;
+    }
+    for (int j = 0; j < nf; j++) d[ev_full[j]].phase = TM_FLYING;
+    tot->critical += nc;
+    tot->dead += nd;
+    tot->full += nf;
+}
+
+static void soa_step(struct PhFleet *f, int t1, struct Events *tot) {
+    ph_step(f);
+    for (int j = 0; j < f->n_critical; j++) {
+        int i = f->critical[j];
+        if (i % NO_GRANT == 0) ph_set_phase(f, i, TM_QUEUED, 0);
+        else ph_set_phase(f, i, TM_CHARGING, (float)t1);
+    }
+    for (int j = 0; j < f->n_full; j++) ph_set_phase(f, f->full[j], TM_FLYING, 0);
+    tot->critical += f->n_critical;
+    tot->dead += f->n_dead;
+    tot->full += f->n_full;
+}
+
+static int cmp_dbl(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void summary(const char *name, double *us, int ticks, int n, double *p50_out) {
+    qsort(us, ticks, sizeof(double), cmp_dbl);
+    double sum = 0;
+    for (int i = 0; i < ticks; i++) sum += us[i];
+    double p50 = us[ticks / 2], p99 = us[(int)(ticks * 0.99)];
+    printf(" %-30s avg %9.1f us  p50 %9.1f us  p99 %9.1f us  %6.2f ns/drone\n",
+           name, sum / ticks, p50, p99, p50 * 1000.0 / n);
+    *p50_out = p50;
+}
+
+int main(int argc, char *argv[]) {
+    int n = 100000, ticks = 1000, charge_s = 20;
+    double dt = 0.1;
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:d:c:s:")) != -1) {
+        switch (opt) {
+            case 'n': n = atoi(optarg); break;
+            case 't': ticks = atoi(optarg); break;
+            case 'd': dt = atof(optarg); break;
+            case 'c': charge_s = atoi(optarg); break;
+            case 's': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n drones] [-t ticks] [-d dt_s] [-c charge_s] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (n <= 0 || ticks <= 0 || dt <= 0 || charge_s <= 0) { fprintf(stderr, "[fleet_bench] Need positive parameters.\n"); return 1; }
+
+    DroneState *aos = calloc(n, sizeof(DroneState));
+    ev_critical = malloc(n * sizeof(int));
+    ev_dead = malloc(n * sizeof(int));
+    ev_full = malloc(n * sizeof(int));
+    double *us_aos = malloc(ticks * sizeof(double)), *us_soa = malloc(ticks * sizeof(double));
+    struct PhFleet f;
+    if (!aos || !ev_critical || !ev_dead || !ev_full || !us_aos || !us_soa || ph_init(&f, n, (float)dt) == -1) {
+        perror("[fleet_bench] alloc");
+        return 1;
+    }
+
+    // Parametry jak init_drone_params (tryb "Powietrze": bateria 50-100%)
+    srand(seed);
+    for (int i = 0; i < n; i++) {
+        DroneState *x = &aos[i];
+        x->id = i;
+        x->current_battery = 50.0f + (rand() % 51);
+        x->T1 = charge_s;
+        x->T2 = (int)(2.5 * x->T1);
+        x->drain_rate_per_sec = 80.0f / (float)x->T2;
+        x->max_cycles = 3;
+        x->location = ST_OUTSIDE;
+        x->phase = TM_FLYING;
+        f.battery[i] = x->current_battery;
+        f.drain[i] = x->drain_rate_per_sec;
+        ph_set_phase(&f, i, TM_FLYING, 0);
+    }
+
+    struct Events e_aos = {0, 0, 0}, e_soa = {0, 0, 0};
+    for (int k = 0; k < ticks; k++) {
+        double t0 = mono_time();
+        aos_step(aos, n, (float)dt, &e_aos);
+        double t1 = mono_time();
+        soa_step(&f, charge_s, &e_soa);
+        double t2 = mono_time();
+        us_aos[k] = (t1 - t0) * 1e6;
+        us_soa[k] = (t2 - t1) * 1e6;
+    }
+
+    // Stan końcowy obu wersji: średnia bateria, liczba martwych i drony o innym stanie
+    double sum_aos = 0, sum_soa = 0;
+    int dead_aos = 0, dead_soa = 0, state_diff = 0;
+    for (int i = 0; i < n; i++) {
+        sum_aos += aos[i].current_battery;
+        sum_soa += f.battery[i];
+        dead_aos += aos[i].phase == TM_DEAD;
+        dead_soa += f.phase[i] == TM_DEAD;
+        state_diff += aos[i].current_battery != f.battery[i] || aos[i].phase != f.phase[i];
+    }
+
+    printf("=== fleet_bench: %d drones, %d ticks of %.3f s (charge %d s) ===\n", n, ticks, dt, charge_s);
+    double p_aos, p_soa;
+    summary("AoS per-drone (drone.c)", us_aos, ticks, n, &p_aos);
+    summary("SoA batch kernel", us_soa, ticks, n, &p_soa);
+    printf(" speedup (p50):                 %.1fx\n", p_soa > 0 ? p_aos / p_soa : 0.0);
+    printf(" events AoS  critical %ld dead %ld full %ld | avg battery %.2f, dead %d\n",
+           e_aos.critical, e_aos.dead, e_aos.full, sum_aos / n, dead_aos);
+    printf(" events SoA  critical %ld dead %ld full %ld | avg battery %.2f, dead %d\n",
+           e_soa.critical, e_soa.dead, e_soa.full, sum_soa / n, dead_soa);
+    // Ta sama arytmetyka w obu wersjach - wymagamy dokładnej zgodności
+    long diff = labs(e_aos.critical - e_soa.critical) + labs(e_aos.dead - e_soa.dead) + labs(e_aos.full - e_soa.full);
+    long total = e_aos.critical + e_aos.dead + e_aos.full;
+    int match = diff == 0 && state_diff == 0;
+    printf(" event counts / final state:    %s (events differ by %ld of %ld, %d drones in a different state)\n",
+           match ? "match" : "MISMATCH", diff, total, state_diff);
+
+    ph_free(&f);
+    free(aos); free(ev_critical); free(ev_dead); free(ev_full); free(us_aos); free(us_soa);
+    return match ? 0 : 1;
+}
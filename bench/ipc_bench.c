@@ -0,0 +1,578 @@
+/* bench/ipc_bench.c
+ *
+ * Mikrobenchmark prymitywów IPC używanych w projekcie i ich alternatyw.
+ * - RPC (jeden serwer, C klientów): kolejka SysV z filtrem typu (jak Operator) i bez filtra,
+ *   potok, eventfd, gniazda Unix
+ * - Synchronizacja (C par proces-proces): semop kontra futex
+ * - Uśpienie (C procesów): semtimedop (custom_wait) kontra clock_nanosleep
+ * Wynik: ops/s i percentyle opóźnień (us) dla każdej liczby klientów i głębokości kolejki.
+ * Wszystkie zasoby IPC są prywatne (IPC_PRIVATE) - benchmark nie koliduje z działającym rojem.
+ */
+
+// MUSI BYĆ PIERWSZE!
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+
+#define DEFAULT_OPS     20000   // Łączna liczba operacji na punkt pomiarowy (dzielona na klientów)
+#define MIN_OPS_CLIENT  20      // Minimum operacji na klienta (przy 1000 klientów)
+#define DEFAULT_SLEEP_US 1000   // Żądany czas uśpienia w testach sleep
+#define FILLER_TYPE     500     // Typ "balastu" w kolejce - nikt go nie odbiera (symuluje głębokość)
+#define MAX_LIST        16
+
+#define BK_RPC   0  // Jeden serwer obsługuje wszystkich klientów
+#define BK_PAIR  1  // Każdy klient ma własny proces-partnera
+#define BK_SLEEP 2  // Brak serwera - mierzymy samo uśpienie
+
+struct Bench {
+    const char *name;
+    int kind;
+    int uses_depth;                        // 1 = wynik zależy od głębokości kolejki
+    int fds_per_client;                    // Ile deskryptorów potrzeba na klienta (limit RLIMIT_NOFILE)
+    int (*setup)(int clients, int depth);  // 0 = OK, -1 = pomijamy punkt
+    void (*serve)(int idx);                // Pętla serwera (nie wraca; zabijany przez SIGKILL)
+    void (*op)(int id);                    // Jedna operacja klienta (pomiar czasu wokół niej)
+    void (*teardown)(int clients);
+};
+
+// --- STAN WSPÓŁDZIELONY PRZEZ FORK ---
+static int n_clients = 0;
+static long sleep_ns = DEFAULT_SLEEP_US * 1000L;
+
+static int msq = -1;          // Kolejka żądań (i odpowiedzi w trybie z filtrem typu)
+static int *reply_q = NULL;   // Kolejki odpowiedzi per klient (tryb bez filtra)
+static int req_pipe[2];
+static int (*resp_pipe)[2] = NULL;
+static int *req_fd = NULL;    // eventfd / gniazdo po stronie serwera
+static int *resp_fd = NULL;   // eventfd / gniazdo po stronie klienta
+static int *sem_ids = NULL;   // Zestaw semaforów na parę
+static int timer_sem = -1;
+
+// Para słów futex w osobnych liniach pamięci podręcznej
+struct FutexPair {
+    int req;
+    char pad1[60];
+    int resp;
+    char pad2[60];
+};
+static struct FutexPair *fpairs = NULL;
+
+// --- POMOCNICZE ---
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *xcalloc(size_t n, size_t sz) {
+    void *p = calloc(n, sz);
+    if (!p) { perror("[Bench] calloc"); exit(1); }
+    return p;
+}
+
+static int futex(int *addr, int op, int val) {
+    return (int)syscall(SYS_futex, addr, op, val, NULL, NULL, 0);
+}
+
+// Pełny zapis/odczyt (krótkie operacje na potokach/gniazdach mogą być przerwane sygnałem)
+static void xwrite(int fd, const void *buf, size_t len) {
+    while (write(fd, buf, len) == -1 && errno == EINTR);
+}
+static void xread(int fd, void *buf, size_t len) {
+    while (read(fd, buf, len) == -1 && errno == EINTR);
+}
+
+// --- KOLEJKA SYSV Z FILTREM TYPU (model Operatora: -MSG_DEAD / RESPONSE_BASE + id) ---
+
+static int msgq_setup(int clients, int depth) {
+    msq = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (msq == -1) { perror("[Bench] msgget"); return -1; }
+    // Balast bez treści (0 bajtów) - zajmuje miejsce na liście, którą kernel skanuje przy filtrze typu
+    struct { long mtype; } filler = { FILLER_TYPE };
+    for (int i = 0; i < depth; i++) {
+        if (msgsnd(msq, &filler, 0, IPC_NOWAIT) == -1) {
+            fprintf(stderr, "[Bench] queue depth %d not reachable (msgsnd: %s)\n", depth, strerror(errno));
+            msgctl(msq, IPC_RMID, NULL);
+            return -1;
+        }
+    }
+    (void)clients;
+    return 0;
+}
+
+static void msgq_serve(int idx) {
+    (void)idx;
+    struct msg_req req;
+    for (;;) {
+        if (safe_msgrcv(msq, &req, sizeof(req) - sizeof(long), -MSG_DEAD, 0) == -1) continue;
+        struct msg_resp resp = { RESPONSE_BASE + req.drone_id, 0 };
+        msgsnd(msq, &resp, sizeof(resp) - sizeof(long), 0);
+    }
+}
+
+static void msgq_op(int id) {
+    struct msg_req req = { MSG_REQ_LAND, id, 0 };
+    struct msg_resp resp;
+    msgsnd(msq, &req, sizeof(req) - sizeof(long), 0);
+    safe_msgrcv(msq, &resp, sizeof(resp) - sizeof(long), RESPONSE_BASE + id, 0);
+}
+
+static void msgq_teardown(int clients) {
+    (void)clients;
+    msgctl(msq, IPC_RMID, NULL);
+}
+
+// --- KOLEJKA SYSV BEZ FILTRA (wspólna kolejka żądań, prywatna kolejka odpowiedzi) ---
+
+static int msgq_nt_setup(int clients, int depth) {
+    (void)depth;
+    msq = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (msq == -1) { perror("[Bench] msgget"); return -1; }
+    reply_q = xcalloc(clients, sizeof(int));
+    for (int i = 0; i < clients; i++) {
+        reply_q[i] = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+        if (reply_q[i] == -1) {
+            perror("[Bench] msgget reply");
+            for (int k = 0; k < i; k++) msgctl(reply_q[k], IPC_RMID, NULL);
+            msgctl(msq, IPC_RMID, NULL);
+            free(reply_q);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void msgq_nt_serve(int idx) {
+    (void)idx;
+    struct msg_req req;
+    for (;;) {
+        if (safe_msgrcv(msq, &req, sizeof(req) - sizeof(long), 0, 0) == -1) continue;
+        struct msg_resp resp = { 1, 0 };
+        msgsnd(reply_q[req.drone_id], &resp, sizeof(resp) - sizeof(long), 0);
+    }
+}
+
+static void msgq_nt_op(int id) {
+    struct msg_req req = { MSG_REQ_LAND, id, 0 };
+    struct msg_resp resp;
+    msgsnd(msq, &req, sizeof(req) - sizeof(long), 0);
+    safe_msgrcv(reply_q[id], &resp, sizeof(resp) - sizeof(long), 0, 0);
+}
+
+static void msgq_nt_teardown(int clients) {
+    for (int i = 0; i < clients; i++) msgctl(reply_q[i], IPC_RMID, NULL);
+    msgctl(msq, IPC_RMID, NULL);
+    free(reply_q);
+    reply_q = NULL;
+}
+
+// --- POTOKI (wspólny potok żądań, zapisy <= PIPE_BUF są atomowe) ---
+
+static int pipe_setup(int clients, int depth) {
+    (void)depth;
+    if (pipe(req_pipe) == -1) { perror("[Bench] pipe"); return -1; }
+    resp_pipe = xcalloc(clients, sizeof(*resp_pipe));
+    for (int i = 0; i < clients; i++) {
+        if (pipe(resp_pipe[i]) == -1) { perror("[Bench] pipe"); return -1; }
+    }
+    return 0;
+}
+
+static void pipe_serve(int idx) {
+    (void)idx;
+    int id;
+    for (;;) {
+        if (read(req_pipe[0], &id, sizeof(id)) != sizeof(id)) continue;
+        xwrite(resp_pipe[id][1], &id, sizeof(id));
+    }
+}
+
+static void pipe_op(int id) {
+    int r;
+    xwrite(req_pipe[1], &id, sizeof(id));
+    xread(resp_pipe[id][0], &r, sizeof(r));
+}
+
+static void pipe_teardown(int clients) {
+    close(req_pipe[0]); close(req_pipe[1]);
+    for (int i = 0; i < clients; i++) { close(resp_pipe[i][0]); close(resp_pipe[i][1]); }
+    free(resp_pipe);
+    resp_pipe = NULL;
+}
+
+// --- SERWER EPOLL (eventfd i gniazda Unix) ---
+
+static void epoll_serve(int is_socket) {
+    int ep = epoll_create1(0);
+    if (ep == -1) { perror("[Bench] epoll_create1"); _exit(1); }
+    for (int i = 0; i < n_clients; i++) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, req_fd[i], &ev) == -1) { perror("[Bench] epoll_ctl"); _exit(1); }
+    }
+    struct epoll_event evs[256];
+    for (;;) {
+        int n = epoll_wait(ep, evs, 256, -1);
+        for (int k = 0; k < n; k++) {
+            int i = (int)evs[k].data.u32;
+            if (is_socket) {
+                int id;
+                xread(req_fd[i], &id, sizeof(id));
+                xwrite(req_fd[i], &id, sizeof(id)); // Odpowiedź tym samym gniazdem (dwukierunkowe)
+            } else {
+                uint64_t v;
+                xread(req_fd[i], &v, sizeof(v));
+                v = 1;
+                xwrite(resp_fd[i], &v, sizeof(v));
+            }
+        }
+    }
+}
+
+static int eventfd_setup(int clients, int depth) {
+    (void)depth;
+    req_fd = xcalloc(clients, sizeof(int));
+    resp_fd = xcalloc(clients, sizeof(int));
+    for (int i = 0; i < clients; i++) {
+        req_fd[i] = eventfd(0, 0);
+        resp_fd[i] = eventfd(0, 0);
+        if (req_fd[i] == -1 || resp_fd[i] == -1) { perror("[Bench] eventfd"); return -1; }
+    }
+    return 0;
+}
+
+static void eventfd_serve(int idx) { (void)idx; epoll_serve(0); }
+
+static void eventfd_op(int id) {
+    uint64_t v = 1;
+    xwrite(req_fd[id], &v, sizeof(v));
+    xread(resp_fd[id], &v, sizeof(v));
+}
+
+static void fds_teardown(int clients) {
+    for (int i = 0; i < clients; i++) { close(req_fd[i]); close(resp_fd[i]); }
+    free(req_fd); free(resp_fd);
+    req_fd = resp_fd = NULL;
+}
+
+static int unix_setup(int clients, int depth) {
+    (void)depth;
+    req_fd = xcalloc(clients, sizeof(int));
+    resp_fd = xcalloc(clients, sizeof(int));
+    for (int i = 0; i < clients; i++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) { perror("[Bench] socketpair"); return -1; }
+        req_fd[i] = sv[0];  // Strona serwera
+        resp_fd[i] = sv[1]; // Strona klienta
+    }
+    return 0;
+}
+
+static void unix_serve(int idx) { (void)idx; epoll_serve(1); }
+
+static void unix_op(int id) {
+    int r;
+    xwrite(resp_fd[id], &id, sizeof(id));
+    xread(resp_fd[id], &r, sizeof(r));
+}
+
+// --- SEMOP (ping-pong: semafor 0 = żądanie, semafor 1 = odpowiedź) ---
+
+static int semop_setup(int clients, int depth) {
+    (void)depth;
+    sem_ids = xcalloc(clients, sizeof(int));
+    for (int i = 0; i < clients; i++) {
+        sem_ids[i] = semget(IPC_PRIVATE, 2, IPC_CREAT | 0600); // Nowy zestaw ma wartości 0
+        if (sem_ids[i] == -1) {
+            perror("[Bench] semget");
+            for (int k = 0; k < i; k++) semctl(sem_ids[k], 0, IPC_RMID);
+            free(sem_ids);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void semop_serve(int idx) {
+    struct sembuf wait_req = {0, -1, 0};
+    struct sembuf post_resp = {1, 1, 0};
+    for (;;) {
+        safe_semop(sem_ids[idx], &wait_req, 1);
+        safe_semop(sem_ids[idx], &post_resp, 1);
+    }
+}
+
+static void semop_op(int id) {
+    struct sembuf post_req = {0, 1, 0};
+    struct sembuf wait_resp = {1, -1, 0};
+    safe_semop(sem_ids[id], &post_req, 1);
+    safe_semop(sem_ids[id], &wait_resp, 1);
+}
+
+static void semop_teardown(int clients) {
+    for (int i = 0; i < clients; i++) semctl(sem_ids[i], 0, IPC_RMID);
+    free(sem_ids);
+    sem_ids = NULL;
+}
+
+// --- FUTEX (ping-pong na słowach w pamięci dzielonej) ---
+
+static int futex_setup(int clients, int depth) {
+    (void)depth;
+    fpairs = mmap(NULL, clients * sizeof(*fpairs), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (fpairs == MAP_FAILED) { perror("[Bench] mmap"); fpairs = NULL; return -1; }
+    return 0;
+}
+
+static void futex_serve(int idx) {
+    struct FutexPair *p = &fpairs[idx];
+    for (;;) {
+        while (__atomic_exchange_n(&p->req, 0, __ATOMIC_ACQUIRE) == 0) futex(&p->req, FUTEX_WAIT, 0);
+        __atomic_store_n(&p->resp, 1, __ATOMIC_RELEASE);
+        futex(&p->resp, FUTEX_WAKE, 1);
+    }
+}
+
+static void futex_op(int id) {
+    struct FutexPair *p = &fpairs[id];
+    __atomic_store_n(&p->req, 1, __ATOMIC_RELEASE);
+    futex(&p->req, FUTEX_WAKE, 1);
+    while (__atomic_exchange_n(&p->resp, 0, __ATOMIC_ACQUIRE) == 0) futex(&p->resp, FUTEX_WAIT, 0);
+}
+
+static void futex_teardown(int clients) {
+    munmap(fpairs, clients * sizeof(*fpairs));
+    fpairs = NULL;
+}
+
+// --- UŚPIENIE: custom_wait (semtimedop) kontra clock_nanosleep ---
+
+static int semtimedop_setup(int clients, int depth) {
+    (void)clients; (void)depth;
+    timer_sem = semget(IPC_PRIVATE, SEM_COUNT, IPC_CREAT | 0600); // SEM_TIMER = 0 - zawsze timeout
+    if (timer_sem == -1) { perror("[Bench] semget"); return -1; }
+    return 0;
+}
+
+static void semtimedop_op(int id) {
+    (void)id;
+    custom_wait(timer_sem, sleep_ns / 1e9); // Dokładnie ta sama ścieżka co w dronach i Operatorze
+}
+
+static void semtimedop_teardown(int clients) {
+    (void)clients;
+    semctl(timer_sem, 0, IPC_RMID);
+}
+
+static int none_setup(int clients, int depth) { (void)clients; (void)depth; return 0; }
+static void none_teardown(int clients) { (void)clients; }
+
+static void nanosleep_op(int id) {
+    (void)id;
+    struct timespec ts = { sleep_ns / 1000000000L, sleep_ns % 1000000000L };
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR);
+}
+
+static const struct Bench benches[] = {
+    { "msgq",       BK_RPC,   1, 0, msgq_setup,       msgq_serve,    msgq_op,       msgq_teardown },
+    { "msgq_notype", BK_RPC,  0, 0, msgq_nt_setup,    msgq_nt_serve, msgq_nt_op,    msgq_nt_teardown },
+    { "pipe",       BK_RPC,   0, 2, pipe_setup,       pipe_serve,    pipe_op,       pipe_teardown },
+    { "eventfd",    BK_RPC,   0, 2, eventfd_setup,    eventfd_serve, eventfd_op,    fds_teardown },
+    { "unix",       BK_RPC,   0, 2, unix_setup,       unix_serve,    unix_op,       fds_teardown },
+    { "semop",      BK_PAIR,  0, 0, semop_setup,      semop_serve,   semop_op,      semop_teardown },
+    { "futex",      BK_PAIR,  0, 0, futex_setup,      futex_serve,   futex_op,      futex_teardown },
+    { "semtimedop", BK_SLEEP, 0, 0, semtimedop_setup, NULL,          semtimedop_op, semtimedop_teardown },
+    { "nanosleep",  BK_SLEEP, 0, 0, none_setup,       NULL,          nanosleep_op,  none_teardown },
+};
+#define N_BENCHES ((int)(sizeof(benches) / sizeof(benches[0])))
+
+// --- URUCHOMIENIE JEDNEGO PUNKTU POMIAROWEGO ---
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double pct(const uint32_t *v, long n, double p) {
+    long i = (long)(p / 100.0 * (n - 1) + 0.5);
+    return v[i] / 1000.0;
+}
+
+// Zwraca 0 = wynik wypisany, -1 = punkt pominięty
+static int run_point(const struct Bench *b, int clients, int depth, long total_ops) {
+    // Limit deskryptorów: wszystkie końcówki są tworzone przed fork
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    if ((rlim_t)(b->fds_per_client * clients + 64) > rl.rlim_cur) {
+        printf("%-12s %7d %6d   skipped (RLIMIT_NOFILE %lu too low)\n", b->name, clients, depth, (unsigned long)rl.rlim_cur);
+        return -1;
+    }
+
+    long per = total_ops / clients;
+    if (per < MIN_OPS_CLIENT) per = MIN_OPS_CLIENT;
+    long n = per * clients;
+
+    // Próbki opóźnień zapisywane przez klientów prosto do wspólnej pamięci
+    uint32_t *lat = mmap(NULL, n * sizeof(uint32_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (lat == MAP_FAILED) { perror("[Bench] mmap"); return -1; }
+
+    n_clients = clients;
+    if (b->setup(clients, depth) == -1) { munmap(lat, n * sizeof(uint32_t)); return -1; }
+
+    int n_servers = b->kind == BK_RPC ? 1 : (b->kind == BK_PAIR ? clients : 0);
+    pid_t *servers = xcalloc(n_servers > 0 ? n_servers : 1, sizeof(pid_t));
+    pid_t *cl = xcalloc(clients, sizeof(pid_t));
+    int spawned = 0, started = 0;
+
+    for (int i = 0; i < n_servers; i++) {
+        pid_t pid = fork();
+        if (pid == -1) { perror("[Bench] fork server"); goto out; }
+        if (pid == 0) { b->serve(i); _exit(0); }
+        servers[spawned++] = pid;
+    }
+
+    // Bariera startowa: klienci czekają na EOF potoku, który zamykamy po utworzeniu wszystkich
+    int gate[2];
+    if (pipe(gate) == -1) { perror("[Bench] pipe"); goto out; }
+    for (int i = 0; i < clients; i++) {
+        pid_t pid = fork();
+        if (pid == -1) { perror("[Bench] fork client"); break; }
+        if (pid == 0) {
+            close(gate[1]);
+            char c;
+            while (read(gate[0], &c, 1) == -1 && errno == EINTR);
+            uint32_t *my = lat + (long)i * per;
+            for (long k = 0; k < per; k++) {
+                uint64_t t0 = now_ns();
+                b->op(i);
+                uint64_t d = now_ns() - t0;
+                my[k] = d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+            }
+            _exit(0);
+        }
+        cl[started++] = pid;
+    }
+    close(gate[0]);
+    uint64_t t_start = now_ns();
+    close(gate[1]); // Start wszystkich klientów naraz
+    for (int i = 0; i < started; i++) waitpid(cl[i], NULL, 0);
+    double elapsed = (now_ns() - t_start) / 1e9;
+
+    if (started == clients) {
+        qsort(lat, n, sizeof(uint32_t), cmp_u32);
+        char dep[16];
+        if (b->uses_depth) snprintf(dep, sizeof(dep), "%d", depth);
+        else snprintf(dep, sizeof(dep), "-");
+        printf("%-12s %7d %6s %12.0f %9.1f %9.1f %9.1f %9.1f %10.1f\n", b->name, clients, dep, n / elapsed,
+               pct(lat, n, 50), pct(lat, n, 90), pct(lat, n, 99), pct(lat, n, 99.9), lat[n - 1] / 1000.0);
+        fflush(stdout);
+    }
+
+out:
+    for (int i = 0; i < spawned; i++) kill(servers[i], SIGKILL);
+    for (int i = 0; i < spawned; i++) waitpid(servers[i], NULL, 0);
+    b->teardown(clients);
+    free(servers);
+    free(cl);
+    munmap(lat, n * sizeof(uint32_t));
+    return started == clients ? 0 : -1;
+}
+
+// Lista liczb "1,10,100" -> tablica
+static int parse_list(const char *s, int *out, int zero_ok) {
+    int n = 0;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", s);
+    for (char *tok = strtok(buf, ","); tok && n < MAX_LIST; tok = strtok(NULL, ",")) {
+        char *end;
+        long v = strtol(tok, &end, 10);
+        if (*end != '\0' || v < (zero_ok ? 0 : 1) || v > INT_MAX) {
+            fprintf(stderr, "Invalid list value '%s'\n", tok);
+            return -1;
+        }
+        out[n++] = (int)v;
+    }
+    return n;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t test,...] [-c clients,...] [-d depth,...] [-n ops] [-s sleep_us]\n", prog);
+    fprintf(stderr, "Tests:");
+    for (int i = 0; i < N_BENCHES; i++) fprintf(stderr, " %s", benches[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char *argv[]) {
+    int clients[MAX_LIST] = {1, 10, 100, 1000};
+    int n_cl = 4;
+    int depths[MAX_LIST] = {0, 100, 1000};
+    int n_dep = 3;
+    long total_ops = DEFAULT_OPS;
+    const char *tests = NULL;
+    int ran_sleep = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:c:d:n:s:h")) != -1) {
+        switch (opt) {
+            case 't': tests = optarg; break;
+            case 'c': if ((n_cl = parse_list(optarg, clients, 0)) <= 0) return 1; break;
+            case 'd': if ((n_dep = parse_list(optarg, depths, 1)) <= 0) return 1; break;
+            case 'n': if ((total_ops = parse_int(optarg, "ops")) == -1) return 1; break;
+            case 's': { int us = parse_int(optarg, "sleep_us"); if (us == -1) return 1; sleep_ns = us * 1000L; } break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    // Do 1000 klientów potrzeba ~2000 deskryptorów - podnosimy miękki limit do twardego
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("%-12s %7s %6s %12s %9s %9s %9s %9s %10s\n", "test", "clients", "depth", "ops/s",
+           "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us");
+    for (int t = 0; t < N_BENCHES; t++) {
+        const struct Bench *b = &benches[t];
+        if (tests) {
+            // Dopasowanie całej nazwy na liście oddzielonej przecinkami
+            size_t len = strlen(b->name);
+            const char *p = tests;
+            int found = 0;
+            while ((p = strstr(p, b->name)) != NULL) {
+                if ((p == tests || p[-1] == ',') && (p[len] == '\0' || p[len] == ',')) { found = 1; break; }
+                p += len;
+            }
+            if (!found) continue;
+        }
+        if (b->kind == BK_SLEEP) ran_sleep = 1;
+        for (int c = 0; c < n_cl; c++) {
+            if (b->uses_depth) {
+                for (int d = 0; d < n_dep; d++) run_point(b, clients[c], depths[d], total_ops);
+            } else {
+                run_point(b, clients[c], 0, total_ops);
+            }
+        }
+    }
+    if (ran_sleep) printf("(sleep tests: requested %.0f us per op)\n", sleep_ns / 1000.0);
+    return 0;
+}
@@ -0,0 +1,695 @@
+/* bench/loadgen.c
+ *
+ * Generator obciążenia i chaosu dla protokołu Operatora (msg_req / msg_resp).
+ * Uruchamia prawdziwy ./operator na własnym zestawie IPC i sam odgrywa N dronów w jednym procesie:
+ * prośba o lądowanie -> zgoda -> przelot -> LANDED -> ładowanie -> prośba o start -> zgoda -> DEPARTED.
+ * - Procesy napływu próśb o lądowanie: Poisson (-a poisson -r rate), paczki (-a burst -k K -e s),
+ *   "stado" (-a herd -e s: wszystkie drony w powietrzu naraz)
+ * - Wstrzykiwanie błędów (-f dup,ghost,unknown,kill z prawdopodobieństwem -p):
+ *   dup     - zdublowana prośba (LAND / TAKEOFF)
+ *   ghost   - LANDED / DEPARTED bez zgody
+ *   unknown - MSG_DEAD dla ID spoza roju
+ *   kill    - dron "ginie od SIGKILL" w tunelu: milknie bez LANDED/DEPARTED/DEAD (jak prawdziwy)
+ * - Kontrola niezmienników przy każdej zgodzie: zgoda dla drona, który nie czeka, podwójna zgoda,
+ *   zgoda dla martwego, zły numer tunelu, przeciwne kierunki w jednym tunelu, przepełnienie hangaru.
+ *   Po fazie wygaszania: zgodność licznika aktywnych dronów Operatora z modelem.
+ * Drony tworzone przez Operatora (REPLENISH) uruchamiają ./drone w katalogu przebiegu - to dowiązanie
+ * do loadgen, który w roli "drone" tylko zgłasza ID przez potok i kończy się; dron przechodzi pod model.
+ * Klucze IPC pochodzą z katalogu przebiegu (ftok), więc generator może działać obok zwykłego roju.
+ * Rozmieszczenie Operatora (-X cpu, -Q nice=n|fifo=p|rr=p) jak w commander -p/-q, a -L k uruchamia
+ * k procesów zjadających CPU - porównanie p99 opóźnienia zgody z priorytetem Operatora i bez niego.
+ */
+
+// MUSI BYĆ PIERWSZE!
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <math.h>
+#include <limits.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+
+#define LG_FD_ENV     "LOADGEN_FD"  // Numer deskryptora potoku adopcji (dla trybu "drone")
+#define LG_SAMPLE_S   0.1           // Próbkowanie kolejki komunikatów
+#define LG_SWEEP_S    0.5           // Pełny przegląd kolejki (zgody dla dronów, które nie czekają)
+#define LG_IDLE_NS    1000000L      // Uśpienie pętli, gdy nic się nie dzieje (1 ms)
+#define LG_MAX_EXAMPLES 10          // Ile naruszeń opisywać na stderr
+
+// Stany modelowanego drona
+enum { F_NONE, F_AIR, F_WAIT_LAND, F_CROSS_IN, F_INSIDE, F_WAIT_TAKEOFF, F_CROSS_OUT, F_KILLED, F_DEAD };
+
+// Procesy napływu
+enum { AR_POISSON, AR_BURST, AR_HERD };
+static const char *const arrival_names[] = { "poisson", "burst", "herd" };
+
+// Rodzaje błędów (bity -f)
+#define FT_DUP     1
+#define FT_GHOST   2
+#define FT_UNKNOWN 4
+#define FT_KILL    8
+
+// Naruszenia niezmienników
+enum { V_UNSOLICITED, V_DUP_GRANT, V_DEAD_GRANT, V_LATE_GRANT, V_BAD_CHANNEL, V_DIR_CONFLICT, V_OVER_CAPACITY,
+       V_ADOPT_LIVE, V_ACTIVE_MISMATCH, V_OPERATOR_DIED, V_KINDS };
+static const char *const violation_names[V_KINDS] = {
+    "unsolicited_grant", "duplicate_grant", "grant_to_dead", "grant_after_death_race", "bad_channel",
+    "channel_direction_conflict", "hangar_over_capacity", "spawned_live_id", "active_count_mismatch", "operator_died"
+};
+
+struct Fake {
+    int state;
+    double t_next;    // Koniec przelotu / ładowania
+    double t_req;     // Chwila wysłania prośby
+    int channel;
+};
+
+struct LatVec { double *v; long n, cap; };
+
+// --- KONFIGURACJA ---
+static int P = 10, N = 100;
+static int arrival = AR_POISSON;
+static double rate = 50.0;       // Prośby o lądowanie / s (poisson)
+static int burst_k = 0;          // Rozmiar paczki (0 = N/2)
+static double period = 2.0;      // Odstęp paczek / stada
+static double duration = 20.0;   // Faza generowania ruchu
+static double drain_s = 5.0;     // Faza wygaszania (bez nowych próśb i błędów)
+static double charge_s = 0.5;
+static double cross_s = 0.05;
+static double patience = 10.0;   // Po tylu sekundach czekania na lądowanie dron ginie (MSG_DEAD)
+static int faults = 0;
+static double fault_p = 0.05;
+static int op_batch = 0;
+static int autoscale_max_p = 0;
+static int op_cpu = -1, op_policy = PL_POLICY_DEFAULT, op_prio = 0;
+static int op_threads = 0;       // -M: Operator wielowątkowy
+static int hogs = 0;             // Procesy obciążające CPU (-L)
+static pid_t hog_pids[64];
+
+// --- STAN ---
+static struct Fake fleet[MAX_DRONE_ID];
+static int msqid = -1, shmid = -1;
+static struct SharedState *shm = NULL;
+static pid_t op_pid = -1;
+static int adopt_fd = -1;
+static volatile sig_atomic_t stop = 0;
+static int generating = 0;       // Faza generowania (błędy tylko wtedy; wygaszanie jest czyste)
+
+static int chan_dir[CHANNELS], chan_users[CHANNELS];
+static int occupied = 0;         // Miejsca hangaru zajęte w modelu (także przez drony "zabite" w tunelu)
+
+static struct LatVec lat_land, lat_takeoff;
+static long req_land = 0, req_takeoff = 0, grants_land = 0, grants_takeoff = 0;
+static long deaths_waiting = 0, adopted = 0;
+static long fault_count[4];
+static long violations[V_KINDS];
+static int examples = 0;
+static uint64_t q_max_msgs = 0, q_max_bytes = 0;
+static double q_sum = 0; static long q_samples = 0;
+#define QS_MAX 3600
+static uint32_t q_series[QS_MAX]; // Maksymalna liczba wiadomości w kolejce w każdej sekundzie
+static int q_series_n = 0;
+static double t0;
+
+static void on_sigint(int sig) { (void)sig; stop = 1; }
+
+static double rnd() { return (rand() + 1.0) / ((double)RAND_MAX + 2.0); }
+
+static void lat_push(struct LatVec *l, double v) {
+    if (l->n == l->cap) {
+        long cap = l->cap ? l->cap * 2 : 4096;
+        double *p = realloc(l->v, cap * sizeof(double));
+        if (!p) return;
+        l->v = p; l->cap = cap;
+    }
+    l->v[l->n++] = v;
+}
+
+static int cmp_dbl(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double pct(const struct LatVec *l, double p) {
+    if (l->n == 0) return 0.0;
+    long i = (long)(p / 100.0 * (l->n - 1) + 0.5);
+    return l->v[i];
+}
+
+static void violation(int kind, int id, const char *detail) {
+    violations[kind]++;
+    if (examples++ < LG_MAX_EXAMPLES) {
+        fprintf(stderr, "[loadgen] t=%.3fs VIOLATION %s (drone %d): %s\n", mono_time() - t0, violation_names[kind], id, detail);
+    }
+}
+
+static void send_req(long type, int id) {
+    struct msg_req req = { type, id, 0 };
+    while (msgsnd(msqid, &req, sizeof(req) - sizeof(long), 0) == -1) {
+        if (errno != EINTR) { perror("[loadgen] msgsnd"); return; }
+    }
+}
+
+// Pojemność hangaru z punktu kontrolnego Operatora (zgody wychodzą dopiero po jego zapisie)
+static int allowed_capacity() {
+    uint32_t seq = __atomic_load_n(&shm->checkpoint.seq, __ATOMIC_ACQUIRE);
+    if (seq == 0) return P;
+    const struct OperatorState *s = &shm->checkpoint.slot[seq % 2];
+    return s->current_P + s->pending_removal;
+}
+
+// --- ZDARZENIA MODELU ---
+
+static void request_land(int id, double now) {
+    fleet[id].state = F_WAIT_LAND;
+    fleet[id].t_req = now;
+    send_req(MSG_REQ_LAND, id);
+    req_land++;
+    if ((faults & FT_DUP) && rnd() < fault_p) { send_req(MSG_REQ_LAND, id); fault_count[0]++; }
+}
+
+static void request_takeoff(int id, double now) {
+    fleet[id].state = F_WAIT_TAKEOFF;
+    fleet[id].t_req = now;
+    send_req(MSG_REQ_TAKEOFF, id);
+    req_takeoff++;
+    if ((faults & FT_DUP) && rnd() < fault_p) { send_req(MSG_REQ_TAKEOFF, id); fault_count[0]++; }
+}
+
+// Przelot zakończony (albo dron "zabity" w tunelu - wtedy milknie, tunel i miejsce zostają zajęte)
+static void finish_crossing(int id, double now) {
+    struct Fake *f = &fleet[id];
+    int in = f->state == F_CROSS_IN;
+    if (generating && (faults & FT_KILL) && rnd() < fault_p) { f->state = F_KILLED; fault_count[3]++; return; }
+    chan_users[f->channel]--;
+    if (chan_users[f->channel] == 0) chan_dir[f->channel] = DIR_NONE;
+    if (in) {
+        send_req(MSG_LANDED, id);
+        f->state = F_INSIDE;
+        f->t_next = now + charge_s;
+    } else {
+        send_req(MSG_DEPARTED, id);
+        occupied--;
+        f->state = F_AIR;
+    }
+}
+
+static void on_grant(int id, int channel, double now) {
+    struct Fake *f = &fleet[id];
+    char buf[96];
+    if (f->state == F_DEAD && channel >= 0 && channel < CHANNELS) {
+        // Dron zginął w kolejce, a Operator zdążył go wpuścić przed odebraniem MSG_DEAD.
+        // Wyścig samego protokołu: tunel i miejsce zostają zajęte - odwzorowujemy to w modelu.
+        snprintf(buf, sizeof(buf), "grant on channel %d arrived after MSG_DEAD", channel);
+        violation(V_LATE_GRANT, id, buf);
+        chan_dir[channel] = DIR_IN;
+        chan_users[channel]++;
+        occupied++;
+        return;
+    }
+    if (f->state == F_KILLED || f->state == F_DEAD || f->state == F_NONE) {
+        snprintf(buf, sizeof(buf), "grant on channel %d, drone state %d", channel, f->state);
+        violation(V_DEAD_GRANT, id, buf);
+        return;
+    }
+    if (f->state != F_WAIT_LAND && f->state != F_WAIT_TAKEOFF) {
+        snprintf(buf, sizeof(buf), "grant on channel %d, drone state %d", channel, f->state);
+        violation(f->state == F_AIR ? V_UNSOLICITED : V_DUP_GRANT, id, buf);
+        return;
+    }
+    if (channel < 0 || channel >= CHANNELS) {
+        snprintf(buf, sizeof(buf), "channel %d", channel);
+        violation(V_BAD_CHANNEL, id, buf);
+        return;
+    }
+    int dir = f->state == F_WAIT_LAND ? DIR_IN : DIR_OUT;
+    if (chan_users[channel] > 0 && chan_dir[channel] != dir) {
+        snprintf(buf, sizeof(buf), "channel %d has %d users in the other direction", channel, chan_users[channel]);
+        violation(V_DIR_CONFLICT, id, buf);
+    }
+    chan_dir[channel] = dir;
+    chan_users[channel]++;
+    f->channel = channel;
+    f->t_next = now + cross_s;
+    if (dir == DIR_IN) {
+        occupied++;
+        int cap = allowed_capacity();
+        if (occupied > cap) {
+            snprintf(buf, sizeof(buf), "%d drones hold slots, capacity %d", occupied, cap);
+            violation(V_OVER_CAPACITY, id, buf);
+        }
+        lat_push(&lat_land, (now - f->t_req) * 1000.0);
+        grants_land++;
+        f->state = F_CROSS_IN;
+    } else {
+        lat_push(&lat_takeoff, (now - f->t_req) * 1000.0);
+        grants_takeoff++;
+        f->state = F_CROSS_OUT;
+    }
+}
+
+// Odbiór zgód. Zgody mają typ RESPONSE_BASE + id, więc odbieramy je per dron (IPC_NOWAIT):
+// zwykle tylko czekających, a co LG_SWEEP_S wszystkich - to wyłapuje zgody, na które nikt nie czeka.
+static void collect_grants(int full, double now) {
+    struct msg_resp resp;
+    for (int id = 0; id < MAX_DRONE_ID; id++) {
+        if (!full && fleet[id].state != F_WAIT_LAND && fleet[id].state != F_WAIT_TAKEOFF) continue;
+        while (msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), RESPONSE_BASE + id, IPC_NOWAIT) != -1) {
+            on_grant(id, resp.channel_id, now);
+        }
+    }
+}
+
+// Błędy "z zewnątrz" protokołu, losowane przy każdym zdarzeniu napływu
+static void inject_faults() {
+    if ((faults & FT_GHOST) && rnd() < fault_p) {
+        int id = rand() % N;
+        if (fleet[id].state == F_AIR) { send_req(rand() % 2 ? MSG_LANDED : MSG_DEPARTED, id); fault_count[1]++; }
+    }
+    if ((faults & FT_UNKNOWN) && rnd() < fault_p && N < MAX_DRONE_ID) {
+        int id = N + rand() % (MAX_DRONE_ID - N);
+        if (fleet[id].state == F_NONE && shm->drone_pids[id] == 0) { send_req(MSG_DEAD, id); fault_count[2]++; }
+    }
+}
+
+static int pick_airborne() {
+    for (int tries = 0; tries < 16; tries++) {
+        int id = rand() % MAX_DRONE_ID;
+        if (fleet[id].state == F_AIR) return id;
+    }
+    for (int id = 0; id < MAX_DRONE_ID; id++) if (fleet[id].state == F_AIR) return id;
+    return -1;
+}
+
+// Napływ próśb o lądowanie
+static double next_arrival;
+static void arrivals(double now) {
+    while (now >= next_arrival) {
+        if (arrival == AR_POISSON) {
+            int id = pick_airborne();
+            if (id != -1) request_land(id, now);
+            inject_faults();
+            next_arrival += -log(rnd()) / rate;
+        } else if (arrival == AR_BURST) {
+            int k = burst_k > 0 ? burst_k : (N / 2 > 0 ? N / 2 : 1);
+            for (int i = 0; i < k; i++) {
+                int id = pick_airborne();
+                if (id == -1) break;
+                request_land(id, now);
+                inject_faults();
+            }
+            next_arrival += period;
+        } else {
+            // Stado: wszystkie drony w powietrzu naraz
+            for (int id = 0; id < MAX_DRONE_ID; id++) {
+                if (fleet[id].state == F_AIR) { request_land(id, now); inject_faults(); }
+            }
+            next_arrival += period;
+        }
+    }
+}
+
+// Drony utworzone przez Operatora (REPLENISH): tryb "drone" zgłasza ID przez potok
+static void adopt(double now) {
+    int id;
+    ssize_t r;
+    while ((r = read(adopt_fd, &id, sizeof(id))) == (ssize_t)sizeof(id)) {
+        if (id < 0 || id >= MAX_DRONE_ID) continue;
+        struct Fake *f = &fleet[id];
+        if (f->state != F_NONE && f->state != F_DEAD) violation(V_ADOPT_LIVE, id, "operator spawned an ID that is still alive");
+        // Operator zarezerwował miejsce przed utworzeniem procesu - dron startuje z hangaru
+        f->state = F_INSIDE;
+        f->t_next = now + charge_s;
+        occupied++;
+        adopted++;
+    }
+}
+
+static void reap() {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        if (pid == op_pid) {
+            op_pid = -1;
+            if (!stop) violation(V_OPERATOR_DIED, -1, WIFSIGNALED(status) ? "killed by signal" : "exited");
+        }
+    }
+}
+
+static void sample_queue(double now) {
+    struct msqid_ds ds;
+    if (msgctl(msqid, IPC_STAT, &ds) == -1) return;
+    if (ds.msg_qnum > q_max_msgs) q_max_msgs = ds.msg_qnum;
+    if (ds.__msg_cbytes > q_max_bytes) q_max_bytes = ds.__msg_cbytes;
+    q_sum += ds.msg_qnum;
+    q_samples++;
+    int sec = (int)(now - t0);
+    if (sec < QS_MAX) {
+        while (q_series_n <= sec) q_series[q_series_n++] = 0;
+        if (ds.msg_qnum > q_series[sec]) q_series[sec] = (uint32_t)ds.msg_qnum;
+    }
+}
+
+// --- URUCHOMIENIE OPERATORA I SPRZĄTANIE ---
+
+static pid_t launch_operator(const char *path) {
+    pid_t pid = fork();
+    if (pid == -1) { perror("[loadgen] fork"); return -1; }
+    if (pid == 0) {
+        int nul = open("/dev/null", O_WRONLY);
+        if (nul != -1) { dup2(nul, STDOUT_FILENO); close(nul); } // Logi Operatora i tak idą do operator.txt
+        char argP[16], argN[16];
+        snprintf(argP, sizeof(argP), "%d", P);
+        snprintf(argN, sizeof(argN), "%d", N);
+        execl(path, "operator", argP, argN, NULL);
+        perror("[loadgen] execl operator");
+        _exit(1);
+    }
+    return pid;
+}
+
+// Obciążenie tła: k procesów w pętli bez końca, o zwykłym priorytecie, na wszystkich CPU
+static void start_hogs() {
+    for (int i = 0; i < hogs; i++) {
+        hog_pids[i] = fork();
+        if (hog_pids[i] == -1) { perror("[loadgen] fork hog"); hogs = i; return; }
+        if (hog_pids[i] == 0) {
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            for (volatile unsigned long x = 0;; x++);
+        }
+    }
+}
+
+static void teardown() {
+    for (int i = 0; i < hogs; i++) if (hog_pids[i] > 0) { kill(hog_pids[i], SIGKILL); waitpid(hog_pids[i], NULL, 0); }
+    hogs = 0;
+    if (op_pid > 0) {
+        kill(op_pid, SIGINT);
+        double deadline = mono_time() + 3.0;
+        while (op_pid > 0 && mono_time() < deadline) {
+            if (waitpid(op_pid, NULL, WNOHANG) == op_pid) op_pid = -1;
+            else { struct timespec ts = {0, 10000000L}; nanosleep(&ts, NULL); }
+        }
+        if (op_pid > 0) { kill(op_pid, SIGKILL); waitpid(op_pid, NULL, 0); }
+        op_pid = -1;
+    }
+    while (waitpid(-1, NULL, WNOHANG) > 0);
+    int semid = semget(ipc_key(IPC_KEY_SEM), 0, 0);
+    if (semid != -1) semctl(semid, 0, IPC_RMID);
+    if (msqid != -1) msgctl(msqid, IPC_RMID, NULL);
+    if (shm) shmdt(shm);
+    if (shmid != -1) shmctl(shmid, IPC_RMID, NULL);
+}
+
+// --- RAPORT ---
+
+static void report(FILE *out, const char *report_path, double elapsed) {
+    qsort(lat_land.v, lat_land.n, sizeof(double), cmp_dbl);
+    qsort(lat_takeoff.v, lat_takeoff.n, sizeof(double), cmp_dbl);
+    long total_v = 0;
+    for (int k = 0; k < V_KINDS; k++) total_v += violations[k];
+    const struct OpStats *os = &shm->op_stats;
+
+    fprintf(out, "\n=== loadgen: %s, P=%d, N=%d, %.1fs (+%.1fs drain) ===\n", arrival_names[arrival], P, N, duration, drain_s);
+    fprintf(out, " Requests LAND / TAKEOFF:     %ld / %ld\n", req_land, req_takeoff);
+    fprintf(out, " Grants LAND / TAKEOFF:       %ld / %ld (operator sent %llu)\n", grants_land, grants_takeoff,
+            (unsigned long long)os->grants);
+    fprintf(out, " Grant throughput:            %.1f grants/s\n", (grants_land + grants_takeoff) / elapsed);
+    fprintf(out, " LAND latency (ms):           p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+            pct(&lat_land, 50), pct(&lat_land, 90), pct(&lat_land, 99), pct(&lat_land, 100));
+    fprintf(out, " TAKEOFF latency (ms):        p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+            pct(&lat_takeoff, 50), pct(&lat_takeoff, 90), pct(&lat_takeoff, 99), pct(&lat_takeoff, 100));
+    fprintf(out, " Message queue:               max %llu msgs / %llu B, avg %.1f msgs\n",
+            (unsigned long long)q_max_msgs, (unsigned long long)q_max_bytes, q_samples ? q_sum / q_samples : 0.0);
+    fprintf(out, " Deaths waiting / adopted:    %ld / %ld\n", deaths_waiting, adopted);
+    fprintf(out, " Faults dup/ghost/unknown/kill: %ld / %ld / %ld / %ld\n",
+            fault_count[0], fault_count[1], fault_count[2], fault_count[3]);
+    if (os->op_cpu >= 0 || os->op_policy || hogs)
+        fprintf(out, " Operator placement:          CPU %d, policy %d prio %d | CPU hogs %d\n",
+                os->op_cpu, os->op_policy, os->op_prio, hogs);
+    fprintf(out, " Operator:                    %s, replenish fork max %.2f ms, intake->grant max %.3f ms"
+                 " (during fork %.3f ms, %llu batches)\n", os->op_threads ? "threaded" : "single",
+            os->spawn_ms_max, os->glat_max[0], os->glat_max[1], (unsigned long long)os->glat_n[1]);
+    fprintf(out, " Invariant violations:        %ld\n", total_v);
+    for (int k = 0; k < V_KINDS; k++) if (violations[k]) fprintf(out, "   %-28s %ld\n", violation_names[k], violations[k]);
+
+    if (!report_path) return;
+    FILE *jf = fopen(report_path, "w");
+    if (!jf) { perror("[loadgen] fopen report"); return; }
+    fprintf(jf, "{\"arrival\": \"%s\", \"P\": %d, \"N\": %d, \"duration_s\": %.3f, \"drain_s\": %.3f, \"op_batch\": %d, "
+                "\"requests_land\": %ld, \"requests_takeoff\": %ld, \"grants_land\": %ld, \"grants_takeoff\": %ld, "
+                "\"operator_grants\": %llu, \"grants_per_s\": %.2f, ",
+            arrival_names[arrival], P, N, duration, drain_s, op_batch, req_land, req_takeoff, grants_land, grants_takeoff,
+            (unsigned long long)os->grants, (grants_land + grants_takeoff) / elapsed);
+    fprintf(jf, "\"land_ms\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}, "
+                "\"takeoff_ms\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}, ",
+            pct(&lat_land, 50), pct(&lat_land, 90), pct(&lat_land, 99), pct(&lat_land, 100),
+            pct(&lat_takeoff, 50), pct(&lat_takeoff, 90), pct(&lat_takeoff, 99), pct(&lat_takeoff, 100));
+    fprintf(jf, "\"queue_max_msgs\": %llu, \"queue_max_bytes\": %llu, \"queue_avg_msgs\": %.2f, \"queue_series\": [",
+            (unsigned long long)q_max_msgs, (unsigned long long)q_max_bytes, q_samples ? q_sum / q_samples : 0.0);
+    for (int i = 0; i < q_series_n; i++) fprintf(jf, "%s%u", i ? ", " : "", q_series[i]);
+    fprintf(jf, "], \"op_threads\": %d, \"spawn_ms_max\": %.3f, \"grant_lat_fork_ms_max\": %.3f",
+            os->op_threads, os->spawn_ms_max, os->glat_max[1]);
+    fprintf(jf, ", \"op_cpu\": %d, \"op_policy\": %d, \"op_prio\": %d, \"hogs\": %d", os->op_cpu, os->op_policy, os->op_prio, hogs);
+    fprintf(jf, ", \"deaths_waiting\": %ld, \"adopted\": %ld, "
+                "\"faults\": {\"dup\": %ld, \"ghost\": %ld, \"unknown\": %ld, \"kill\": %ld}, \"violations_total\": %ld, \"violations\": {",
+            deaths_waiting, adopted, fault_count[0], fault_count[1], fault_count[2], fault_count[3], total_v);
+    for (int k = 0; k < V_KINDS; k++) fprintf(jf, "%s\"%s\": %ld", k ? ", " : "", violation_names[k], violations[k]);
+    fprintf(jf, "}}\n");
+    fclose(jf);
+    fprintf(out, "[loadgen] Report written to %s\n", report_path);
+}
+
+// Tryb "drone": proces utworzony przez Operatora zgłasza swoje ID i kończy się
+static int drone_stub(int argc, char *argv[]) {
+    const char *fd_s = getenv(LG_FD_ENV);
+    if (argc < 2 || !fd_s) return 1;
+    int id = atoi(argv[1]);
+    int fd = atoi(fd_s);
+    while (write(fd, &id, sizeof(id)) == -1 && errno == EINTR);
+    return 0;
+}
+
+static int parse_faults(const char *s) {
+    int f = 0;
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", s);
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        if (strcmp(tok, "dup") == 0) f |= FT_DUP;
+        else if (strcmp(tok, "ghost") == 0) f |= FT_GHOST;
+        else if (strcmp(tok, "unknown") == 0) f |= FT_UNKNOWN;
+        else if (strcmp(tok, "kill") == 0) f |= FT_KILL;
+        else if (strcmp(tok, "all") == 0) f |= FT_DUP | FT_GHOST | FT_UNKNOWN | FT_KILL;
+        else { fprintf(stderr, "[loadgen] Unknown fault '%s'.\n", tok); return -1; }
+    }
+    return f;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-P p] [-N n] [-a poisson|burst|herd] [-r rate] [-k burst] [-e period_s]\n"
+                    "       [-d duration_s] [-g drain_s] [-c charge_s] [-x cross_s] [-S patience_s]\n"
+                    "       [-f dup,ghost,unknown,kill|all] [-p fault_prob] [-b batch] [-A max_P] [-s seed]\n"
+                    "       [-O operator] [-w run_dir] [-o report.json] [-X op_cpu] [-Q nice=n|fifo=p|rr=p] [-L hogs] [-M]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    char *name = basename(argv[0]);
+    if (strcmp(name, "drone") == 0) return drone_stub(argc, argv);
+
+    const char *op_path = "./operator";
+    const char *run_dir = "loadgen_run";
+    const char *report_path = NULL;
+    unsigned seed = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "P:N:a:r:k:e:d:g:c:x:S:f:p:b:A:s:O:w:o:X:Q:L:M")) != -1) {
+        switch (opt) {
+            case 'P': P = atoi(optarg); break;
+            case 'N': N = atoi(optarg); break;
+            case 'a':
+                if (strcmp(optarg, "poisson") == 0) arrival = AR_POISSON;
+                else if (strcmp(optarg, "burst") == 0) arrival = AR_BURST;
+                else if (strcmp(optarg, "herd") == 0) arrival = AR_HERD;
+                else { usage(argv[0]); return 1; }
+                break;
+            case 'r': rate = atof(optarg); break;
+            case 'k': burst_k = atoi(optarg); break;
+            case 'e': period = atof(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'g': drain_s = atof(optarg); break;
+            case 'c': charge_s = atof(optarg); break;
+            case 'x': cross_s = atof(optarg); break;
+            case 'S': patience = atof(optarg); break;
+            case 'f': faults = parse_faults(optarg); if (faults == -1) return 1; break;
+            case 'p': fault_p = atof(optarg); break;
+            case 'b': op_batch = atoi(optarg); break;
+            case 'A': autoscale_max_p = atoi(optarg); break;
+            case 's': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+            case 'O': op_path = optarg; break;
+            case 'w': run_dir = optarg; break;
+            case 'o': report_path = optarg; break;
+            case 'M': op_threads = 1; break;
+            case 'X': op_cpu = atoi(optarg); break;
+            case 'Q':
+                if (pl_parse_policy(optarg, &op_policy, &op_prio) == -1) { usage(argv[0]); return 1; }
+                break;
+            case 'L': hogs = atoi(optarg); if (hogs < 0 || hogs > 64) { usage(argv[0]); return 1; } break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (P <= 0 || N <= 0 || N > MAX_DRONE_ID || rate <= 0 || period <= 0) {
+        fprintf(stderr, "[loadgen] Need P > 0, 0 < N <= %d, rate > 0, period > 0.\n", MAX_DRONE_ID);
+        return 1;
+    }
+    srand(seed ? seed : (unsigned)time(NULL));
+
+    // Ścieżki bezwzględne przed przejściem do katalogu przebiegu
+    char op_abs[PATH_MAX], self[PATH_MAX], rep_abs[2 * PATH_MAX];
+    if (!realpath(op_path, op_abs)) { perror("[loadgen] operator binary"); return 1; }
+    ssize_t sl = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (sl == -1) { perror("[loadgen] readlink /proc/self/exe"); return 1; }
+    self[sl] = '\0';
+    if (report_path && report_path[0] != '/') {
+        char cwd[PATH_MAX];
+        if (getcwd(cwd, sizeof(cwd))) { snprintf(rep_abs, sizeof(rep_abs), "%s/%s", cwd, report_path); report_path = rep_abs; }
+    }
+    if (mkdir(run_dir, 0700) == -1 && errno != EEXIST) { perror("[loadgen] mkdir"); return 1; }
+    if (chdir(run_dir) == -1) { perror("[loadgen] chdir"); return 1; }
+    if (ipc_keys_from_dir(".") == -1) return 1;
+    unsetenv(SWARM_BIN_ENV); // Operator ma uruchamiać ./drone z katalogu przebiegu (dowiązanie)
+    unlink("drone");
+    if (symlink(self, "drone") == -1) { perror("[loadgen] symlink drone"); return 1; }
+
+    // Potok adopcji: koniec do zapisu dziedziczy Operator i tworzone przez niego procesy
+    int pfd[2];
+    if (pipe(pfd) == -1) { perror("[loadgen] pipe"); return 1; }
+    fcntl(pfd[0], F_SETFL, O_NONBLOCK);
+    fcntl(pfd[0], F_SETFD, FD_CLOEXEC);
+    adopt_fd = pfd[0];
+    char fd_s[16];
+    snprintf(fd_s, sizeof(fd_s), "%d", pfd[1]);
+    setenv(LG_FD_ENV, fd_s, 1);
+
+    // IPC jak u Commandera: pamięć dzielona przed startem Operatora (podpina się tylko do istniejącej)
+    if (msgget(ipc_key(IPC_KEY_MSGQ), 0) != -1 || shmget(ipc_key(IPC_KEY_SHM), 0, 0) != -1) {
+        fprintf(stderr, "[loadgen] IPC objects of %s already exist (is another loadgen using it?).\n", run_dir);
+        return 1;
+    }
+    shmid = shmget(ipc_key(IPC_KEY_SHM), sizeof(struct SharedState), IPC_CREAT | 0600);
+    if (shmid == -1) { perror("[loadgen] shmget"); return 1; }
+    shm = shmat(shmid, NULL, 0);
+    if (shm == (void *)-1) { perror("[loadgen] shmat"); shm = NULL; teardown(); return 1; }
+    memset(shm, 0, sizeof(*shm));
+    shm->config.op_batch = op_batch;
+    shm->config.autoscale_max_p = autoscale_max_p;
+    shm->config.placement = op_cpu >= 0 ? PL_OP_CPU : 0;
+    shm->config.op_cpu = op_cpu;
+    shm->config.op_policy = op_policy;
+    shm->config.op_prio = op_prio;
+    shm->config.op_threads = op_threads;
+    msqid = msgget(ipc_key(IPC_KEY_MSGQ), IPC_CREAT | 0600);
+    if (msqid == -1) { perror("[loadgen] msgget"); teardown(); return 1; }
+
+    for (int i = 0; i < N; i++) {
+        fleet[i].state = F_AIR;
+        shm->drone_pids[i] = getpid(); // "Żywy" dla Operatora (kill(pid, 0) przy odtwarzaniu)
+    }
+    for (int i = 0; i < CHANNELS; i++) chan_dir[i] = DIR_NONE;
+
+    signal(SIGINT, on_sigint);
+    signal(SIGTERM, on_sigint);
+
+    op_pid = launch_operator(op_abs);
+    if (op_pid == -1) { teardown(); return 1; }
+    // Czekamy na gotowość Operatora (pierwszy punkt kontrolny = semafory ustawione)
+    double ready_deadline = mono_time() + 5.0;
+    while (__atomic_load_n(&shm->checkpoint.seq, __ATOMIC_ACQUIRE) == 0 && mono_time() < ready_deadline && op_pid > 0) {
+        struct timespec ts = {0, 1000000L};
+        nanosleep(&ts, NULL);
+        reap();
+    }
+    if (shm->checkpoint.seq == 0) { fprintf(stderr, "[loadgen] Operator did not start.\n"); teardown(); return 1; }
+    start_hogs();
+
+    t0 = mono_time();
+    next_arrival = t0;
+    double t_gen_end = t0 + duration, t_end = t_gen_end + drain_s;
+    double last_sample = 0, last_sweep = t0;
+    fprintf(stderr, "[loadgen] %s arrivals, P=%d N=%d, faults 0x%x (p=%.3f), run dir %s\n",
+            arrival_names[arrival], P, N, faults, fault_p, run_dir);
+
+    while (!stop && op_pid > 0) {
+        double now = mono_time();
+        if (now >= t_end) break;
+        generating = now < t_gen_end;
+        if (generating) arrivals(now);
+
+        // Koniec przelotów i ładowań, cierpliwość czekających na lądowanie
+        for (int id = 0; id < MAX_DRONE_ID; id++) {
+            struct Fake *f = &fleet[id];
+            if ((f->state == F_CROSS_IN || f->state == F_CROSS_OUT) && now >= f->t_next) {
+                finish_crossing(id, now);
+            } else if (f->state == F_INSIDE && now >= f->t_next) {
+                request_takeoff(id, now);
+            } else if (f->state == F_WAIT_LAND && patience > 0 && now - f->t_req > patience) {
+                // Ostatnia szansa: zgoda mogła właśnie przyjść
+                struct msg_resp resp;
+                if (msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), RESPONSE_BASE + id, IPC_NOWAIT) != -1) {
+                    on_grant(id, resp.channel_id, now);
+                    continue;
+                }
+                send_req(MSG_DEAD, id); // Jak prawdziwy dron z pustą baterią
+                f->state = F_DEAD;
+                deaths_waiting++;
+            }
+        }
+
+        int full = now - last_sweep >= LG_SWEEP_S;
+        collect_grants(full, now);
+        if (full) last_sweep = now;
+        adopt(now);
+        reap();
+        if (now - last_sample >= LG_SAMPLE_S) { sample_queue(now); last_sample = now; }
+
+        struct timespec ts = {0, LG_IDLE_NS};
+        nanosleep(&ts, NULL);
+    }
+    double elapsed = mono_time() - t0;
+
+    // Model milknie; Operator dostaje chwilę na dobranie kolejki, potem porównanie stanu
+    struct timespec settle = {0, 500000000L};
+    nanosleep(&settle, NULL);
+    collect_grants(1, mono_time());
+    reap();
+    if (op_pid > 0) {
+        int live = 0;
+        for (int id = 0; id < MAX_DRONE_ID; id++) if (fleet[id].state != F_NONE && fleet[id].state != F_DEAD) live++;
+        uint32_t seq = __atomic_load_n(&shm->checkpoint.seq, __ATOMIC_ACQUIRE);
+        int op_active = shm->checkpoint.slot[seq % 2].current_active;
+        if (op_active != live) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "operator counts %d active, model %d", op_active, live);
+            violation(V_ACTIVE_MISMATCH, -1, buf);
+        }
+    }
+    stop = 1;
+    report(stdout, report_path, elapsed);
+    teardown();
+    free(lat_land.v);
+    free(lat_takeoff.v);
+    return 0;
+}
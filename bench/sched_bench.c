@@ -0,0 +1,338 @@
+/* bench/sched_bench.c
+ *
+ * Rdzeń planisty Operatora (src/scheduler.c) bez IPC: wydajność decyzji i sprawdzanie własności.
+ *   sched_bench [-n drony] [-p P] [-e zdarzenia] [-b partia] [-r przebiegi] [-k zdarzenia_przebiegu] [-s ziarno]
+ * Model roju gra protokół dronów: lot -> prośba o lądowanie -> (zgoda) -> LANDED -> prośba o start
+ * -> (zgoda) -> DEPARTED -> lot; drony giną w locie, w kolejce lądowania i ze zgodą (w tunelu),
+ * a Operator uzupełnia populację w hangarze (sch_take_spot). Akcje rdzenia wracają do modelu jak do dronów.
+ * 1. Wydajność: zdarzenia i zgody na sekundę przy dużym N, tryb pojedynczy (handle_one: zgoda od
+ *    razu) i partie (handle_batch: kolejki, potem przejścia planisty). Czas zawiera model roju
+ *    (stały koszt na zdarzenie).
+ * 2. Własności: -r przebiegów z losowym N, P, trybem i zmianami P (Sygnały 1 / 2, autoskaler).
+ *    Po każdym zdarzeniu sch_check oraz zgodność z modelem: zajęte miejsca = drony w tunelu do
+ *    środka, w hangarze i w tunelu na zewnątrz; użytkownicy tuneli; lustro semafora nigdy poniżej
+ *    zera i równe wolnym miejscom; zgoda tylko dla czekającego drona; po przejściu planisty żaden
+ *    dron nie czeka, gdy ma tunel i miejsce. Naruszenie = kod wyjścia 1 z ziarnem i krokiem.
+ *    Przebiegi wstrzykują też błędy protokołu: powtórzoną prośbę (LAND / TAKEOFF drona, który
+ *    czeka albo ma zgodę) i ducha (LANDED / DEPARTED bez zgody). Rdzeń ma je zignorować - bez akcji
+ *    i bez zmiany stanu, co sprawdza ta sama zgodność z modelem. Do tego prośba o start
+ *    wyprzedzająca własne LANDED - tunel zwalnia prośba, spóźnione LANDED nie zmienia niczego.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+#include "../include/scheduler.h"
+
+// Stan drona w modelu
+#define M_FLYING      0
+#define M_QUEUED_LAND 1
+#define M_GRANTED_IN  2 // W tunelu do środka (miejsce w hangarze już zajęte)
+#define M_INSIDE      3
+#define M_QUEUED_OUT  4
+#define M_GRANTED_OUT 5
+#define M_DEAD        6
+
+#define DIE_FLYING 64 // Co które zdarzenie lecącego drona to śmierć
+#define DIE_QUEUED 16 // ...czekającego w kolejce lądowania
+#define DIE_GRANTED 32 // ...drona ze zgodą (Kamikadze w tunelu, śmierć w chwili wysłania zgody)
+#define FAULT_RATE 32 // Co które zdarzenie przebiegu sprawdzającego to duplikat albo duch
+
+struct Model {
+    struct OperatorState s;
+    struct SchOut out;
+    int n;                      // Drony modelu (ID 0..n-1)
+    int batch;                  // 0 = tryb pojedynczy, inaczej zdarzeń na przejście planisty
+    int check;                  // 1 = sprawdzanie po każdym zdarzeniu
+    uint8_t st[MAX_DRONE_ID];   // M_*
+    int8_t ch[MAX_DRONE_ID];    // Tunel przydzielony w zgodzie
+    int sem;                    // Lustro semafora hangaru (suma akcji SCH_SEM)
+    int in_channel[CHANNELS];   // Drony modelu w tunelu (wg zgód)
+    long events, grants, scalings, faults;
+    char why[200];
+};
+
+static int fail(struct Model *m, const char *fmt, int a, int b) {
+    if (m->why[0] == '\0') snprintf(m->why, sizeof(m->why), fmt, a, b);
+    return -1;
+}
+
+// Akcje rdzenia wracają do dronów modelu
+static int apply(struct Model *m) {
+    int rc = 0;
+    for (int i = 0; i < m->out.n; i++) {
+        const struct SchAction *a = &m->out.a[i];
+        switch (a->kind) {
+            case SCH_GRANT_LAND:
+            case SCH_GRANT_TAKEOFF: {
+                int land = a->kind == SCH_GRANT_LAND;
+                if (m->check && m->st[a->id] != (land ? M_QUEUED_LAND : M_QUEUED_OUT))
+                    rc = fail(m, "grant for drone %d in model state %d", a->id, m->st[a->id]);
+                if (m->check && (a->ch < 0 || a->ch >= CHANNELS || m->s.chan_dir[a->ch] != (land ? DIR_IN : DIR_OUT)))
+                    rc = fail(m, "grant on channel %d with direction %d", a->ch, a->ch >= 0 && a->ch < CHANNELS ? m->s.chan_dir[a->ch] : -1);
+                if (m->check && land && m->s.current_active > m->s.target_N)
+                    rc = fail(m, "landing granted with %d active > target %d", m->s.current_active, m->s.target_N);
+                m->st[a->id] = land ? M_GRANTED_IN : M_GRANTED_OUT;
+                m->ch[a->id] = (int8_t)a->ch;
+                if (a->ch >= 0 && a->ch < CHANNELS) m->in_channel[a->ch]++;
+                m->grants++;
+                break;
+            }
+            case SCH_SEM:
+                m->sem += a->arg;
+                if (m->check && m->sem < 0) rc = fail(m, "hangar semaphore would block: %d (delta %d)", m->sem, a->arg);
+                break;
+            case SCH_BLOCKED:
+                if (m->check && m->s.current_active <= m->s.target_N)
+                    rc = fail(m, "drone %d blocked with %d active", a->id, m->s.current_active);
+                break;
+        }
+    }
+    m->out.n = 0;
+    return rc;
+}
+
+// Przejścia planisty do wyczerpania (koniec partii / zmiana P)
+static int drain(struct Model *m) {
+    int rc = 0;
+    while (sch_pass(&m->s, &m->out) > 0) rc |= apply(m);
+    return rc | apply(m);
+}
+
+// Zgodność stanu rdzenia z modelem i niezmienniki sch_check
+static int verify(struct Model *m, int drained) {
+    struct OperatorState *s = &m->s;
+    int count[M_DEAD + 1] = {0};
+    for (int i = 0; i < m->n; i++) count[m->st[i]]++;
+
+    if (sch_check(s, m->why, sizeof(m->why)) != 0) return -1;
+    int occ = count[M_GRANTED_IN] + count[M_INSIDE] + count[M_QUEUED_OUT] + count[M_GRANTED_OUT];
+    if (s->occupied != occ) return fail(m, "occupied %d, model has %d drones holding spots", s->occupied, occ);
+    if (m->sem != sch_free_slots(s)) return fail(m, "semaphore mirror %d != free slots %d", m->sem, sch_free_slots(s));
+    if (sch_queue_depth(s, 0) != count[M_QUEUED_LAND])
+        return fail(m, "landing queue %d, model %d", sch_queue_depth(s, 0), count[M_QUEUED_LAND]);
+    if (sch_queue_depth(s, 1) != count[M_QUEUED_OUT])
+        return fail(m, "takeoff queue %d, model %d", sch_queue_depth(s, 1), count[M_QUEUED_OUT]);
+    for (int c = 0; c < CHANNELS; c++) {
+        if (s->chan_users[c] != m->in_channel[c]) return fail(m, "channel %d users %d", c, s->chan_users[c]);
+    }
+    int alive = m->n - count[M_DEAD];
+    if (s->current_active != alive) return fail(m, "active %d, model alive %d", s->current_active, alive);
+    if (drained) {
+        // Po przejściach planisty nikt nie czeka, jeśli ma tunel (i miejsce w hangarze)
+        if (count[M_QUEUED_OUT] > 0 && sch_find_channel(s, DIR_OUT) != -1)
+            return fail(m, "%d takeoffs waiting with channel %d usable", count[M_QUEUED_OUT], sch_find_channel(s, DIR_OUT));
+        if (count[M_QUEUED_LAND] > 0 && sch_free_slots(s) > 0 && sch_find_channel(s, DIR_IN) != -1 &&
+            s->current_active <= s->target_N)
+            return fail(m, "%d landings waiting with %d free slots and a channel", count[M_QUEUED_LAND], sch_free_slots(s));
+    }
+    return 0;
+}
+
+static void model_init(struct Model *m, int n, int P, int batch, int check) {
+    memset(m, 0, sizeof(*m));
+    sch_init(&m->s, P, n);
+    m->n = n;
+    m->batch = batch;
+    m->check = check;
+    m->sem = P;
+    for (int i = 0; i < n; i++) m->ch[i] = -1; // Wszyscy w powietrzu (jak start Commandera)
+}
+
+// Błąd protokołu: powtórzona prośba drona, który czeka albo ma zgodę, albo LANDED / DEPARTED bez
+// zgody. Rdzeń nie może na nie odpowiedzieć żadną akcją. 0 = brak zdarzenia.
+static int fault(struct Model *m, int id) {
+    int type, expect;
+    switch (m->st[id]) {
+        case M_QUEUED_LAND: case M_GRANTED_IN: type = MSG_REQ_LAND; expect = SCH_F_DUPLICATE; break;
+        case M_QUEUED_OUT: case M_GRANTED_OUT: type = MSG_REQ_TAKEOFF; expect = SCH_F_DUPLICATE; break;
+        case M_FLYING: case M_INSIDE: type = rand() % 2 ? MSG_LANDED : MSG_DEPARTED; expect = SCH_F_NO_CHANNEL; break;
+        default: return 0;
+    }
+    int flags = sch_event(&m->s, type, id, m->batch == 0, 0.0, &m->out);
+    m->faults++;
+    m->events++;
+    if (!(flags & expect)) return fail(m, "fault type %d from drone %d not recognized", type, id);
+    if (m->out.n > 0) return fail(m, "fault from drone %d produced %d actions", id, m->out.n);
+    return 1;
+}
+
+// Prośba o start wyprzedza LANDED tego samego drona (Operator odbiera niższe typy pierwsze):
+// tunel zwalnia już prośba, spóźnione LANDED nie może niczego zmienić
+static int overtake(struct Model *m, int id) {
+    m->in_channel[m->ch[id]]--;
+    m->ch[id] = -1;
+    m->st[id] = M_QUEUED_OUT;
+    sch_event(&m->s, MSG_REQ_TAKEOFF, id, m->batch == 0, 0.0, &m->out);
+    int rc = apply(m);
+    if (sch_event(&m->s, MSG_LANDED, id, m->batch == 0, 0.0, &m->out) & SCH_F_NO_CHANNEL)
+        rc = fail(m, "late LANDED from drone %d rejected (request state %d)", id, m->s.req[id]);
+    if (m->out.n > 0) rc = fail(m, "late LANDED from drone %d produced %d actions", id, m->out.n);
+    if (m->batch == 0) rc |= drain(m);
+    m->events += 2;
+    return rc == 0 ? 1 : -1;
+}
+
+// Jedno zdarzenie losowego drona, jak handle_one / handle_batch Operatora. 0 = brak zdarzenia.
+static int event(struct Model *m) {
+    if (m->check && rand() % FAULT_RATE == 0) {
+        int rc = fault(m, rand() % m->n);
+        if (rc != 0) return rc;
+    }
+    for (int tries = 0; tries < 64; tries++) {
+        int id = rand() % m->n;
+        int type = 0;
+        switch (m->st[id]) {
+            case M_FLYING:
+                if (rand() % DIE_FLYING == 0) { type = MSG_DEAD; m->st[id] = M_DEAD; }
+                else { type = MSG_REQ_LAND; m->st[id] = M_QUEUED_LAND; }
+                break;
+            case M_QUEUED_LAND:
+                if (rand() % DIE_QUEUED == 0) { type = MSG_DEAD; m->st[id] = M_DEAD; }
+                break;
+            case M_GRANTED_IN:
+                if (m->check && rand() % FAULT_RATE == 0) return overtake(m, id);
+                if (rand() % DIE_GRANTED == 0) { type = MSG_DEAD; m->st[id] = M_DEAD; }
+                else { type = MSG_LANDED; m->st[id] = M_INSIDE; }
+                break;
+            case M_INSIDE:      type = MSG_REQ_TAKEOFF; m->st[id] = M_QUEUED_OUT; break;
+            case M_GRANTED_OUT:
+                if (rand() % DIE_GRANTED == 0) { type = MSG_DEAD; m->st[id] = M_DEAD; }
+                else { type = MSG_DEPARTED; m->st[id] = M_FLYING; }
+                break;
+            case M_DEAD: // Replenish: nowy dron w hangarze, jeśli populacja poniżej celu
+                if (m->s.current_active < m->s.target_N && sch_take_spot(&m->s, &m->out)) {
+                    m->st[id] = M_INSIDE;
+                    m->s.current_active++;
+                    return apply(m) == 0 ? 1 : -1;
+                }
+                break;
+        }
+        if (type == 0) continue;
+        if (m->ch[id] >= 0) { // LANDED / DEPARTED albo śmierć ze zgodą - dron opuszcza tunel
+            int c = m->ch[id];
+            m->in_channel[c]--;
+            m->ch[id] = -1;
+        }
+        sch_event(&m->s, type, id, m->batch == 0, 0.0, &m->out);
+        if (type == MSG_DEAD) m->s.current_active--; // Jak on_dead Operatora (slot PID zajęty)
+        int rc = apply(m);
+        // Tryb pojedynczy: po LANDED / DEPARTED / DEAD przejścia planisty do wyczerpania
+        if (m->batch == 0 && type != MSG_REQ_LAND && type != MSG_REQ_TAKEOFF) rc |= drain(m);
+        m->events++;
+        return rc == 0 ? 1 : -1;
+    }
+    return 0;
+}
+
+// Zmiana P jak Sygnał 1 / Sygnał 2 / autoskaler, potem przejścia planisty (jak następna partia)
+static int scale(struct Model *m) {
+    int removed, r = rand() % 4;
+    if (r == 0) sch_grow(&m->s, &m->out);
+    else if (r == 1) sch_shrink(&m->s, &m->out, &removed);
+    else {
+        int max_P = (m->n - 1) / 2 > 1 ? (m->n - 1) / 2 : 1;
+        sch_resize(&m->s, 1 + rand() % max_P, &m->out);
+    }
+    m->scalings++;
+    return apply(m) | drain(m);
+}
+
+// Jeden przebieg sprawdzania własności. 0 = OK, inaczej -1 i opis w m->why (krok w *step).
+static int property_run(struct Model *m, unsigned seed, int events, long *step) {
+    srand(seed);
+    int n = 4 + rand() % (MAX_DRONE_ID - 4);
+    if (rand() % 2) n = 4 + rand() % 60; // Połowa przebiegów na małym roju - częściej pełny hangar
+    int P = 1 + rand() % ((n - 1) / 2);
+    int batch = rand() % 3 == 0 ? 0 : 1 + rand() % 128;
+    model_init(m, n, P, batch, 1);
+    for (*step = 0; *step < events; (*step)++) {
+        if (rand() % 512 == 0 && scale(m) != 0) return -1;
+        int ev = event(m);
+        if (ev < 0) return -1;
+        int drained = batch == 0;
+        if (batch > 0 && (ev == 0 || m->events % batch == 0)) { // Koniec partii albo pusta kolejka
+            if (drain(m) != 0) return -1;
+            drained = 1;
+        }
+        if (verify(m, drained) != 0) return -1;
+    }
+    return 0;
+}
+
+// Pomiar: 'events' zdarzeń na roju n dronów, bez sprawdzania
+static double bench_run(struct Model *m, int n, int P, int batch, long events, unsigned seed) {
+    srand(seed);
+    model_init(m, n, P, batch, 0);
+    double t0 = mono_time();
+    int idle = 0;
+    while (m->events < events && idle < 2) {
+        int ev = event(m);
+        idle = ev == 0 ? idle + 1 : 0; // Dwa razy bez zdarzenia, także po przejściach = rój stoi
+        if (batch > 0 && (ev == 0 || m->events % batch == 0)) drain(m); // Koniec partii albo pusta kolejka
+    }
+    return mono_time() - t0;
+}
+
+static void report(const char *name, const struct Model *m, double secs) {
+    printf(" %-24s %8.2f M events/s %8.2f M grants/s %7.1f ns/event (%ld events, %ld grants)\n", name,
+           secs > 0 ? m->events / secs / 1e6 : 0.0, secs > 0 ? m->grants / secs / 1e6 : 0.0,
+           m->events ? secs * 1e9 / m->events : 0.0, m->events, m->grants);
+}
+
+int main(int argc, char *argv[]) {
+    int n = MAX_DRONE_ID - 1, P = 0, batch = 64, runs = 200, run_events = 20000;
+    long events = 5000000;
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:p:e:b:r:k:s:")) != -1) {
+        switch (opt) {
+            case 'n': n = atoi(optarg); break;
+            case 'p': P = atoi(optarg); break;
+            case 'e': events = atol(optarg); break;
+            case 'b': batch = atoi(optarg); break;
+            case 'r': runs = atoi(optarg); break;
+            case 'k': run_events = atoi(optarg); break;
+            case 's': seed = (unsigned)strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n drones] [-p P] [-e events] [-b batch] [-r runs] [-k events_per_run] [-s seed]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (P == 0) P = n / 3;
+    if (n < 3 || n >= MAX_DRONE_ID || P < 1 || 2 * P >= n || events < 0 || batch < 1 || runs < 0 || run_events < 1) {
+        fprintf(stderr, "[sched_bench] Need 3 <= N < %d, 1 <= P < N/2, batch >= 1.\n", MAX_DRONE_ID);
+        return 1;
+    }
+
+    static struct Model m; // Stan Operatora ma kilkadziesiąt KB - poza stosem
+    printf("=== sched_bench: %d drones, P %d, %ld events, batch %d ===\n", n, P, events, batch);
+    if (events > 0) {
+        double t = bench_run(&m, n, P, 0, events, seed);
+        report("single (handle_one)", &m, t);
+        t = bench_run(&m, n, P, batch, events, seed);
+        char name[32];
+        snprintf(name, sizeof(name), "batch %d (handle_batch)", batch);
+        report(name, &m, t);
+    }
+
+    if (runs == 0) return 0;
+    long checked = 0, scalings = 0, faults = 0, step;
+    for (int r = 0; r < runs; r++) {
+        if (property_run(&m, seed + r, run_events, &step) != 0) {
+            printf(" property check:          FAIL in run %d (seed %u, N %d, P %d, batch %d) at event %ld: %s\n",
+                   r, seed + r, m.n, m.s.current_P, m.batch, step, m.why);
+            return 1;
+        }
+        checked += m.events;
+        scalings += m.scalings;
+        faults += m.faults;
+    }
+    printf(" property check:          OK - %d runs, %ld events checked, %ld capacity changes, %ld duplicates / ghosts\n",
+           runs, checked, scalings, faults);
+    return 0;
+}
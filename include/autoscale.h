@@ -0,0 +1,63 @@
+#ifndef AUTOSCALE_H
+#define AUTOSCALE_H
+
+#include "common.h"
+
+// --- AUTOSKALER POJEMNOŚCI HANGARU ---
+// Regulator w pętli zamkniętej: Operator co AS_SAMPLE_S podaje próbkę (długość kolejki lądowania,
+// zajęte tunele, zajęty hangar), a przy zgodach i śmierciach - czasy oczekiwania i straty.
+// Raz na sekundę as_decide() ocenia przesuwne okno i proponuje nowe P.
+// Histereza: osobne progi wzrostu i spadku + warunek musi się utrzymać AS_HOLD ocen z rzędu.
+// Ograniczenie tempa: po każdej zmianie okno jest czyszczone i obowiązuje AS_COOLDOWN_S przerwy.
+
+#define AS_SAMPLE_S   0.25 // Odstęp próbek
+#define AS_BUCKETS    10   // Okno = AS_BUCKETS sekundowych kubełków
+#define AS_MIN_FILL   5    // Ile pełnych kubełków potrzeba do pierwszej decyzji
+#define AS_HOLD       3    // Ile ocen z rzędu musi wskazywać ten sam kierunek
+#define AS_COOLDOWN_S 10.0 // Przerwa po zmianie P
+#define AS_MAX_STEP   8    // Największy jednorazowy krok P
+
+// Progi (wzrost / spadek - przerwa między nimi to histereza)
+#define AS_GROW_DEPTH  2.0  // Średnio >= tylu dronów w kolejce lądowania
+#define AS_GROW_WAIT   3.0  // Średnie oczekiwanie na lądowanie >= (s)
+#define AS_GROW_OCC    0.85 // ...i hangar faktycznie pełny (inaczej wąskim gardłem są tunele)
+#define AS_SHRINK_DEPTH 0.2
+#define AS_SHRINK_WAIT  0.5
+#define AS_SHRINK_OCC   0.5 // Hangar w większości pusty
+
+struct AsBucket {
+    uint32_t samples;
+    uint32_t depth_sum;  // Suma długości kolejki lądowania z próbek
+    float busy_sum;      // Suma zajętości tuneli (0..1) z próbek
+    float occ_sum;       // Suma zajętości hangaru (0..1) z próbek
+    uint32_t waits;      // Zgody na lądowanie w kubełku
+    float wait_sum;      // Suma ich czasów oczekiwania (s)
+    uint32_t deaths;     // Śmierci w kolejce lądowania
+};
+
+struct Autoscaler {
+    int p_min, p_max;
+    struct AsBucket win[AS_BUCKETS];
+    int cur;             // Bieżący kubełek
+    int filled;          // Ile kubełków zawiera pełną sekundę danych
+    double t_bucket;     // Początek bieżącego kubełka
+    double t_sample;     // Ostatnia próbka
+    double t_change;     // Ostatnia zmiana P
+    int up_streak, down_streak;
+};
+
+void as_init(struct Autoscaler *as, int p_min, int p_max, double now);
+
+// Próbka stanu (wywoływana co AS_SAMPLE_S). Zwraca 1, jeśli zamknięto kubełek (czas na as_decide).
+int as_sample(struct Autoscaler *as, double now, int land_depth, double chan_util, double hangar_occ);
+
+void as_land_wait(struct Autoscaler *as, double wait_s);
+void as_death_waiting(struct Autoscaler *as);
+
+// Ocena okna. Zwraca proponowane P (== P, gdy bez zmian); podsumowanie okna trafia do *d.
+int as_decide(struct Autoscaler *as, double now, int P, struct AsDecision *d);
+
+// Zatwierdzenie zmiany (czyści okno i rozpoczyna przerwę)
+void as_changed(struct Autoscaler *as, double now);
+
+#endif
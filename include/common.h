@@ -2,6 +2,11 @@
 #define COMMON_H
 
 #include <sys/types.h>
+#include <stdint.h>
+
+#include "telemetry.h"
+#include "placement.h"
+#include "usage.h"
 
 // --- KOLORY ANSI ---
 #define C_RED     "\033[1;31m"
@@ -13,34 +18,210 @@
 #define C_RESET   "\033[0m"
 
 // --- KLUCZE IPC ---
+// Domyślne (jeden rój na maszynę). Przebieg z -R/-K dostaje własne klucze - patrz ipc_key().
 #define MSGQ_KEY 0x1234  
 #define SEM_KEY  0x5678  
 #define SHM_KEY  0x9999  
 
-// --- TYPY KOMUNIKATW ---
+// --- TYPY KOMUNIKATÓW ---
 #define MSG_REQ_LAND     1 
 #define MSG_REQ_TAKEOFF  2 
 #define MSG_LANDED       3 
 #define MSG_DEPARTED     4 
 #define MSG_DEAD         5 
+#define MSG_RESERVE      6 // Rezerwacja okna lądowania z wyprzedzeniem (arg = ms do progu krytycznego)
+#define MSG_OP_MAX MSG_RESERVE // Operator odbiera typy 1..MSG_OP_MAX (msgrcv z -MSG_OP_MAX)
 #define RESPONSE_BASE 1000 
+#define GRANT_RESYNC -2 // channel_id zamiast tunelu: Operator wznowiony po awarii (nowa epoka) - nie zgoda
+#define REQ_RESEND 1    // msg_req.arg prośby LAND / TAKEOFF: ponowienie po zmianie epoki Operatora
+
+// Wartość SIGUSR1 (SI_QUEUE) budząca Operatora do odczytu SharedState.ctl_resize.
+// Zwykły SIGUSR1 (klawisz '1') pozostaje jednorazowym podwojeniem bazy.
+#define CTL_WAKE 0x4354 // "CT"
 
 #define MAX_DRONE_ID 1024 
 
 // --- SEMAFORY (Indeksy) ---
 #define SEM_HANGAR 0  
 #define SEM_TIMER  1  
-#define SEM_COUNT  2  
+#define SEM_CHARGER 2 // Wolne ładowarki (pula niezależna od miejsc postojowych, config.chargers > 0)
+#define SEM_COUNT  3  
+
+// --- STAN OPERATORA ---
+#define CHANNELS  2    // Liczba dostępnych tuneli (bramek)
+#define DIR_NONE 0      // Tunel jest pusty / nieaktywny
+#define DIR_IN   1      // Tunel wpuszcza drony (Lądowanie)
+#define DIR_OUT  2      // Tunel wypuszcza drony (Start)
+#define CHARGE_PARTIAL 60 // Cel szybkiego ładowania częściowego (%), gdy przed bazą czekają drony
+
+// --- LOKALIZACJA DRONA ---
+#define ST_OUTSIDE 0 // Dron w powietrzu lub w kolejce przed bazą (można wybuchnąć)
+#define ST_INSIDE  1 // Dron w bazie lub w tunelu wylotowym (nie można wybuchnąć, bo zablokuje zasoby)
+#define WAITQ_CAP 1024 // Pojemność bufora cyklicznego każdej kolejki oczekujących
+#define RETRY_CAP (2 * MAX_DRONE_ID + 1) // Odpowiedzi czekające na miejsce w kolejce (zgoda + okno rezerwacji na drona)
+
+#include "reserve.h" // Kalendarz rezerwacji okien lądowania (korzysta ze stałych powyżej)
 
 // --- STRUKTURY ---
 
+// Cały stan planisty Operatora - jedna struktura, aby dało się ją zapisać jako punkt kontrolny
+struct OperatorState {
+    int chan_dir[CHANNELS];   // Kierunek ruchu w tunelu [i] (IN/OUT/NONE)
+    int chan_users[CHANNELS]; // Liczba dronów aktualnie przebywających w tunelu [i]
+    int waitq[2][WAITQ_CAP];  // Dwie kolejki: waitq[0] dla lądujących, waitq[1] dla startujących
+    int q_head[2];            // Indeks "głowy" (stąd pobieramy drony do obsłużenia)
+    int q_tail[2];            // Indeks "ogona" (tu wpisujemy nowe oczekujące drony)
+    int current_P;            // Aktualna pojemność hangaru (wartość logiczna)
+    int pending_removal;      // Liczba miejsc do usunięcia, gdy drony wylecą
+    int signal1_used;         // Boost (powiększenie bazy) możliwy tylko raz
+    int target_N;             // Docelowa liczba dronów (którą utrzymuje Operator)
+    int current_active;       // Liczba aktualnie żywych dronów (zarejestrowanych)
+    int next_drone_id;        // Pomocnicza zmienna do szukania wolnych ID
+    int occupied;             // Zajęte miejsca w hangarze (rezerwacje + drony w środku)
+    int retry_id[RETRY_CAP];  // Zgody wydane, ale odrzucone przez pełną kolejkę (EAGAIN) - FIFO
+    int retry_ch[RETRY_CAP];  // Tunel przydzielony w odłożonej zgodzie
+    int r_head, r_tail;
+    struct RsvCalendar rsv;   // Rezerwacje okien lądowania (config.rsv_lookahead_s > 0)
+    uint8_t req[MAX_DRONE_ID];    // Prośba drona w toku (SCH_RQ_*) - powtórzona prośba jest ignorowana
+    int8_t req_ch[MAX_DRONE_ID];  // Tunel wydanej zgody (LANDED / DEPARTED zwalnia właśnie jego)
+    uint8_t grant_old[MAX_DRONE_ID]; // 1 = zgoda wydana przed wznowieniem Operatora (mogła przepaść z poprzednikiem)
+};
+
+// Punkt kontrolny Operatora (podwójny bufor). Zapis idzie do slotu nieaktywnego, a dopiero
+// potem 'seq' jest zwiększane - śmierć w trakcie zapisu zostawia poprzedni, spójny slot.
+struct OpCheckpoint {
+    uint32_t seq;                 // Numer ostatniego zatwierdzonego zapisu (aktywny slot = seq % 2)
+    struct OperatorState slot[2];
+    double t_crash;               // Chwila wykrycia śmierci Operatora (mono_time, ustawia Commander)
+    int recoveries;               // Liczba udanych odtworzeń
+    double last_recovery_ms;      // Czas od wykrycia śmierci do wznowienia przydziałów
+    double max_recovery_ms;
+    uint32_t epoch;               // Epoka Operatora (+1 przy wznowieniu) - czekający dron ponawia wtedy prośbę
+};
+
+// Decyzja autoskalera (historia w OpStats)
+#define AS_LOG 32
+struct AsDecision {
+    float t;          // Sekundy od startu Operatora
+    int16_t p_from;   // P przed / po zmianie
+    int16_t p_to;
+    int16_t n_to;     // Docelowe N po zmianie
+    uint16_t deaths;  // Śmierci w kolejce lądowania w oknie
+    float depth;      // Średnia długość kolejki lądowania w oknie
+    float wait;       // Średni czas oczekiwania na lądowanie w oknie (s)
+    float util;       // Zajętość tuneli (0..1)
+    float occ;        // Zajętość hangaru (0..1)
+};
+
+// Histogramy opóźnień log2 (jak w usage.h): kubełek k = wartości z [2^(k-1), 2^k) jednostek,
+// kubełek 0 = poniżej jednej jednostki, ostatni zbiera resztę
+#define LAT_BUCKETS 24
+
+// Statystyki pętli zdarzeń Operatora (przetrwają wznowienie po awarii)
+struct OpStats {
+    uint64_t msgs;      // Obsłużone wiadomości
+    uint64_t wakeups;   // Wybudzenia z co najmniej jedną wiadomością
+    uint64_t grants;    // Wysłane zgody (LAND + TAKEOFF)
+    uint64_t busy_ns;   // Czas obsługi (od odbioru pierwszej wiadomości do wysłania zgód)
+    uint32_t max_batch; // Najwięcej wiadomości w jednym wybudzeniu
+    uint64_t grants_deferred; // Zgody odłożone, bo kolejka była pełna (EAGAIN)
+    uint32_t saturations;     // Ile razy kolejka weszła w stan nasycenia
+    uint32_t retry_max;       // Najdłuższa kolejka odłożonych zgód
+    uint64_t q_limit_bytes;   // msg_qbytes ustawione przez Operatora
+    uint64_t q_max_bytes;     // Najwięcej bajtów w kolejce (próbki IPC_STAT)
+    uint64_t q_max_msgs;      // Najwięcej wiadomości w kolejce
+    uint64_t land_waits;      // Wydane zgody na lądowanie z pomiarem czasu oczekiwania
+    double land_wait_sum;     // Suma czasów oczekiwania na lądowanie (s)
+    double land_wait_max;
+    uint32_t deaths_waiting;  // Drony, które zginęły w kolejce lądowania
+    uint32_t as_grows;        // Decyzje autoskalera
+    uint32_t as_shrinks;
+    int32_t as_p_min;         // Zakres P osiągnięty w trybie autoskalowania
+    int32_t as_p_max;
+    uint32_t as_n;            // Liczba decyzji (historia: ostatnie AS_LOG w as_log[as_n % AS_LOG])
+    struct AsDecision as_log[AS_LOG];
+    int32_t op_cpu;           // Faktyczne rozmieszczenie Operatora: rdzeń (-1 = bez przypięcia),
+    int32_t op_policy;        // polityka (PL_POLICY_*) i jej parametr po ewentualnym zastępstwie
+    int32_t op_prio;
+    int32_t op_threads;       // 1 = Operator pracuje w trybie wielowątkowym (-M)
+    double spawn_ms_max;      // Najdłuższy fork drona z Replenish (w trybie jednowątkowym blokuje zgody)
+    uint64_t glat_n[2];       // Opóźnienie odbiór -> zgoda (ms) dla partii z zgodami;
+    double glat_sum[2];       // [1] = partie obsłużone, gdy trwał fork w wątku pomocniczym
+    double glat_max[2];
+    uint64_t log_dropped;     // Bajty logów utracone przy pełnej kolejce do wątku pomocniczego
+    uint32_t rsv_requests;    // Rezerwacje okien lądowania: prośby i wyniki (RSV_*)
+    uint32_t rsv_result[3];
+    uint32_t rsv_honored;     // Zgody na lądowanie dla dronów z rezerwacją
+    uint32_t rsv_released;    // Rezerwacje zwolnione przez śmierć drona
+    uint32_t rsv_prepositions; // Tunel ustawiony na wlot przed zarezerwowanym oknem
+    uint64_t grants_dir[2];   // Decyzje planisty: [0] zgody na lądowanie, [1] na start
+    uint64_t deaths;          // Zgłoszone śmierci dronów (MSG_DEAD)
+    uint64_t spawns;          // Drony utworzone przez Replenish
+    uint64_t blocked;         // Prośby wstrzymane - populacja ponad docelowe N
+    uint64_t land_wait_hist[LAT_BUCKETS]; // Czekanie na lądowanie (ms)
+    uint64_t glat_hist[LAT_BUCKETS];      // Odbiór -> zgoda (us), obie klasy glat_n
+};
+
+// Sesje ładowania z puli ładowarek (piszą drony, atomowo)
+struct ChargeStats {
+    uint32_t sessions;      // Zakończone sesje ładowania
+    uint32_t partial;       // Z tego przerwane na celu częściowym (CHARGE_PARTIAL)
+    uint32_t queued;        // Sesje poprzedzone czekaniem na ładowarkę
+    uint64_t wait_ms_sum;   // Czekanie na miejscu postojowym na ładowarkę
+    uint64_t wait_ms_max;
+    uint64_t charge_ms_sum; // Czas pod ładowarką
+    uint64_t level_sum;     // Suma poziomów baterii na odłączeniu (%)
+};
+
+// Konfiguracja przebiegu ustalana przez Commandera (czytana przez Drony i Operatora)
+struct SwarmConfig {
+    unsigned int seed; // Ziarno RNG dla początkowych baterii (0 = losowe, zależne od czasu)
+    int op_batch;      // Ile wiadomości Operator odbiera na wybudzenie (1 = po jednej, 0 = domyślnie)
+    int trace;         // 1 = procesy zapisują spany do TRACE_FILE
+    int autoscale_max_p; // >0 = Operator sam dobiera P (do tej wartości), 0 = tylko sygnały
+    int charge_s;      // Czas ładowania drona (s), 0 = domyślny
+    int placement;     // PL_* - rozmieszczenie na CPU (0 = decyduje jądro)
+    int op_cpu;        // Rdzeń Operatora (gdy PL_OP_CPU)
+    int op_policy;     // PL_POLICY_* Operatora i jej parametr (nice / priorytet RT)
+    int op_prio;
+    uint64_t drone_cpus[PL_CPU_WORDS]; // CPU dronów (gdy PL_DRONES)
+    int sample_ms;     // Odstęp próbek szeregu czasowego Operatora (0 = wyłączone)
+    int sample_fmt;    // TS_CSV / TS_BIN
+    int op_threads;    // 1 = Operator z wątkami odbioru i pomocniczym (-M)
+    int rsv_lookahead_s; // >0 = drony rezerwują okno lądowania tyle sekund przed progiem krytycznym
+    int chargers;      // >0 = pula ładowarek niezależna od miejsc postojowych P (0 = każde miejsce ładuje)
+    int charge_power;  // Budżet mocy: tyle ładowarek naraz pracuje z pełną mocą (0 = wszystkie)
+};
+
+// Sesja roju: Commander, który go nadzoruje, i jego gniazdo sterujące. Commander dołączający
+// (-a) znajduje tu wszystko, czego potrzebuje - bez sygnałów do roju i bez pytania procesów.
+#define SESSION_DIR_MAX 512
+struct SessionInfo {
+    pid_t commander_pid;           // Nadzorca roju (rodzic Operatora i dronów)
+    int detached;                  // 1 = bez terminala (-D albo utrata terminala)
+    double t_start;                // Start symulacji (mono_time)
+    char dir[SESSION_DIR_MAX];     // Katalog roboczy sesji (logi, raporty, względne ścieżki)
+    char ctl_path[108];            // Gniazdo sterujące względem 'dir' ("" = wyłączone)
+};
+
 struct SharedState {
     pid_t drone_pids[MAX_DRONE_ID];
+    struct SwarmConfig config;
+    struct OpCheckpoint checkpoint;
+    struct OpStats op_stats;
+    pid_t swarm_pgid;  // Grupa procesów roju - sprzątanie przebiegu po awarii Commandera
+    struct TelemetrySlot telemetry[MAX_DRONE_ID]; // Stan dronów (slot = ID, pisze tylko dron)
+    int32_t ctl_resize; // Zlecona zmiana P (suma z gniazda sterującego), Operator zeruje ją atomowo
+    struct UsageClass usage[USAGE_CLASSES]; // Zużycie zasobów zakończonych procesów (USAGE_*)
+    int32_t charge_target; // Cel ładowania z puli (%): Operator obniża go, gdy przed bazą jest kolejka
+    struct ChargeStats charge;
+    struct SessionInfo session; // Commander sesji - do dołączania (commander -a)
 };
 
 struct msg_req {
     long mtype;   
     int drone_id; 
+    int arg;      // Parametr wiadomości (MSG_RESERVE: ms do progu krytycznego, prośby: REQ_RESEND), inaczej 0
 };
 
 struct msg_resp {
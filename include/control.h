@@ -0,0 +1,69 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+#include <sys/select.h>
+
+#include "common.h"
+
+// --- GNIAZDO STERUJĄCE COMMANDERA (Unix, protokół liniowy) ---
+// Jedna komenda na linię (lub kilka rozdzielonych ';'), na każdą komendę jedna linia odpowiedzi
+// "OK ..." albo "ERR ...". Wszystkie pełne linie odczytane z klienta za jednym razem tworzą
+// partię: zmiany P są sumowane w jedno zlecenie, cele ataków - w jeden zbiór bez powtórzeń.
+//   grow [k] | shrink [k]          - zmiana P o k (domyślnie 1)
+//   attack 3,7,10-20               - lista i zakresy ID
+//   attack random <k>              - k losowych aktywnych dronów
+//   attack fraction <f>            - ułamek aktywnego roju (0.0 - 1.0)
+//   attack where <warunek> [and <warunek> ...]
+//          warunek bez spacji: battery>50, battery<=20, cycles>=2, phase=charging, inside, outside
+//   stats                          - migawka: P, N, aktywne drony, fazy floty, statystyki Operatora
+//   signal 1 | signal 2            - Sygnał 1 / Sygnał 2 do Operatora (jak klawisze '1' i '2')
+//   report [plik]                  - raport w trakcie przebiegu (JSON; domyślnie plik -o albo report.json)
+//   stop                           - koniec sesji: zamknięcie roju, raport, sprzątanie IPC
+//   help
+
+#define CTL_SOCKET      "commander.sock"
+#define CTL_MAX_CLIENTS 8
+#define CTL_BUF         4096 // Bufor linii klienta (niepełna linia czeka na resztę)
+#define CTL_MAX_CMDS    256  // Komend w jednej partii
+#define CTL_REPLY       384  // Najdłuższa linia odpowiedzi (stats)
+#define CTL_OUT_MAX     (1024 * 1024) // Limit niewysłanych odpowiedzi klienta (więcej = klient nie odbiera, rozłączamy)
+
+// Partia komend jednego klienta - zbierana przez ctl_parse, wykonywana jednym przejściem
+struct CtlBatch {
+    int resize;                     // Suma grow/shrink
+    uint8_t target[MAX_DRONE_ID];   // Zbiór celów ataku
+    int n_targets;
+    int n_cmds;
+    int overflow;                   // Komendy ponad CTL_MAX_CMDS - każda dostaje "ERR batch too large"
+    int stats;                      // Liczba komend 'stats' (odpowiedź budowana po wykonaniu)
+    int signal[2];                  // Komendy 'signal 1' / 'signal 2'
+    int report;                     // 1 + indeks komendy 'report' (0 = brak; odpowiedź po wykonaniu)
+    char report_path[256];          // Plik raportu ("" = domyślny)
+    int stop;                       // Komenda 'stop'
+    char reply[CTL_MAX_CMDS][CTL_REPLY]; // Odpowiedzi w kolejności komend (puste = uzupełnia wywołujący)
+};
+
+// Gniazdo nasłuchujące pod 'path' (stary plik gniazda jest usuwany). 0 = OK.
+int ctl_open(const char *path);
+// 'wfds' dostaje klientów z niewysłanymi odpowiedziami (czekamy na gotowość do zapisu)
+void ctl_fdset(fd_set *fds, fd_set *wfds, int *maxfd);
+
+// Obsługa gotowych deskryptorów: przyjęcie klientów, dosłanie odpowiedzi, odczyt danych. Dla każdej
+// porcji pełnych linii wywoływany jest callback (klient, tekst tych linii zakończony '\0', jego długość).
+typedef void (*ctl_batch_fn)(int client, char *lines, int len);
+void ctl_service(fd_set *fds, fd_set *wfds, ctl_batch_fn fn);
+
+// Odpowiedź do klienta bez blokowania: czego gniazdo nie przyjmie (EAGAIN), czeka w buforze klienta
+// do gotowości zapisu. Rozłączony klient albo ponad CTL_OUT_MAX zaległych bajtów = rozłączenie.
+void ctl_send(int client, const char *text);
+
+// Rozbiór partii. 'alive' = drony z żywym procesem (ID -> 1), 'slots' = telemetria do predykatów.
+void ctl_parse(char *lines, int len, const uint8_t *alive, const struct TelemetrySlot *slots, struct CtlBatch *b);
+
+void ctl_close(void);
+
+// Strona klienta: połączenie z gniazdem sterującym (Commander dołączający do sesji). fd lub -1.
+int ctl_connect(const char *path);
+
+#endif
@@ -6,14 +6,50 @@
 #include <sys/sem.h>
 #include <sys/msg.h>
 
-// Wrappery odporne na sygnay (EINTR)
+// Wrappery odporne na sygnały (EINTR)
 int safe_semop(int semid, struct sembuf *sops, size_t nsops);
 ssize_t safe_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg);
 
+// Odbiór z terminem (deadline = mono_time() w sekundach). Blokuje do nadejścia wiadomości
+// albo do terminu - bez odpytywania. -1 z errno: ETIMEDOUT (termin minął), EINTR (inny sygnał).
+// Używa zegara POSIX (SIGALRM) - proces nie może mieć własnej obsługi SIGALRM ani wątku, który
+// odblokowuje SIGALRM, a sam nie woła timed_msgrcv (Operator -M budzi wątek odbioru innym sygnałem).
+ssize_t timed_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, double deadline);
+
 // Funkcja czasu (zamiast usleep)
 void custom_wait(int semid, double seconds);
 
+// Czas monotoniczny w sekundach (do harmonogramów i pomiarów)
+double mono_time(void);
+
+// Tworzenie procesu jako "rodzeństwa" (rodzicem zostaje rodzic wywołującego, czyli Commander).
+// Dzięki temu Commander nadzoruje i zbiera również drony tworzone przez Operatora.
+pid_t fork_sibling(void);
+
 // Funkcje pomocnicze
 int parse_int(const char *str, const char *name);
 
+// --- PRZESTRZEŃ NAZW PRZEBIEGU ---
+// Klucze IPC przebiegu wędrują do Operatora i dronów w otoczeniu (SWARM_IPC_KEYS="msgq,sem,shm"),
+// a katalog z programami w SWARM_BIN_DIR (przebieg pracuje w swoim katalogu wyjściowym).
+// Bez tych zmiennych obowiązują stałe z common.h i ./program - jak dotąd.
+#define SWARM_KEYS_ENV "SWARM_IPC_KEYS"
+#define SWARM_BIN_ENV  "SWARM_BIN_DIR"
+
+enum { IPC_KEY_MSGQ, IPC_KEY_SEM, IPC_KEY_SHM };
+
+key_t ipc_key(int which);
+
+// Ustawienie kluczy bieżącego procesu i eksport do otoczenia (dla procesów potomnych). 0 = OK.
+int ipc_keys_set(key_t msgq, key_t sem, key_t shm);
+
+// Klucze z ftok(katalog) - po jednym identyfikatorze projektu na obiekt. 0 = OK.
+int ipc_keys_from_dir(const char *dir);
+
+// Usunięcie obiektów IPC o bieżących kluczach (jeśli istnieją). Zwraca liczbę usuniętych.
+int ipc_remove_all(void);
+
+// Ścieżka do programu roju: SWARM_BIN_DIR/name albo ./name
+const char *swarm_bin(const char *name, char *buf, size_t len);
+
 #endif
\ No newline at end of file
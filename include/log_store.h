@@ -0,0 +1,82 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "common.h"
+
+// --- WSPÓLNY MAGAZYN LOGÓW DRONÓW ---
+// Jeden plik zamiast drone_<pid>.txt dla każdego procesu.
+// Układ pliku: [nagłówek + indeks segmentów][segment 0][segment 1]...
+// Każde wcielenie drona (ID + generacja) dopisuje do własnego łańcucha segmentów,
+// więc zapis nie wymaga blokad, a odczyt historii jednego drona to przejście po indeksie.
+
+#define LOG_STORE_FILE  "swarm_log.bin"
+#define LS_MAGIC        0x474c5753u  // "SWLG"
+#define LS_VERSION      1
+#define LS_SEG_SIZE     (8 * 1024)   // Rozmiar segmentu (wielokrotność strony)
+#define LS_MAX_SEGMENTS 131072       // Plik rzadki (sparse) - zajmuje tylko zapisane segmenty
+
+// Wpis indeksu - jeden na segment
+struct LogSegment {
+    int32_t drone_id;   // Właściciel segmentu (-1 = nieprzydzielony)
+    uint32_t generation; // Numer wcielenia ID (ID są recyklingowane przez Operatora)
+    int32_t pid;        // PID procesu piszącego
+    int32_t next;       // Następny segment tego samego wcielenia (-1 = koniec łańcucha)
+    int32_t prev_gen;   // Pierwszy segment poprzedniego wcielenia tego ID (-1 = brak)
+    uint32_t used;      // Liczba zapisanych bajtów (publikowana po zapisie rekordu)
+    int64_t t_start_ns; // Czas pierwszego rekordu (CLOCK_REALTIME)
+};
+
+struct LogStoreHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seg_size;
+    uint32_t max_segments;
+    uint32_t next_segment;  // Licznik przydziału segmentów (atomowy)
+    uint32_t dropped;       // Rekordy odrzucone z braku miejsca
+    uint64_t data_offset;   // Początek pierwszego segmentu w pliku
+    uint32_t generation[MAX_DRONE_ID]; // Licznik wcieleń każdego ID
+    int32_t last_head[MAX_DRONE_ID];   // Pierwszy segment najnowszego wcielenia ID (-1 = brak)
+    struct LogSegment index[LS_MAX_SEGMENTS];
+};
+
+// Nagłówek rekordu w segmencie; po nim 'len' bajtów tekstu, wyrównanie do 8
+struct LogRecord {
+    int64_t ts_ns;
+    uint32_t len;
+    uint32_t pad;
+};
+
+// Uchwyt procesu piszącego
+struct LogStore {
+    int fd;
+    struct LogStoreHeader *hdr; // Zmapowany nagłówek (wspólny dla wszystkich procesów)
+    char *seg;                  // Zmapowany bieżący segment (NULL = brak)
+    int seg_idx;                // Indeks bieżącego segmentu
+    int first_seg;              // Pierwszy segment tego wcielenia
+    int drone_id;
+    uint32_t generation;
+};
+
+// Usunięcie magazynu z poprzedniego przebiegu (Commander na starcie)
+void ls_reset(const char *path);
+
+// Otwarcie (utworzenie, jeśli brak) magazynu i rejestracja nowego wcielenia drona. 0 = OK, -1 = błąd.
+int ls_open(struct LogStore *ls, const char *path, int drone_id);
+
+// Dopisanie rekordu tekstowego. Bez blokad i bez fsync.
+void ls_append(struct LogStore *ls, const char *text, size_t len);
+
+void ls_close(struct LogStore *ls);
+
+// Mapowanie całego magazynu tylko do odczytu (narzędzia). Zwraca nagłówek lub NULL.
+struct LogStoreHeader *ls_map_readonly(const char *path, size_t *map_len);
+
+// Adres danych segmentu w zmapowanym (tylko do odczytu) pliku
+static inline const char *ls_segment_data(const struct LogStoreHeader *hdr, int seg) {
+    return (const char *)hdr + hdr->data_offset + (uint64_t)seg * hdr->seg_size;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <stdint.h>
+
+// --- FIZYKA FLOTY W UKŁADZIE STRUCT-OF-ARRAYS ---
+// Stan wielu dronów jednego procesu (symulacja w procesie, generator obciążenia) jako osobne,
+// wyrównane tablice zamiast tablicy DroneState. Krok ph_step to jedno przejście bez rozgałęzień
+// po wszystkich dronach (wektoryzowane przez kompilator) plus zwięzłe listy indeksów dronów,
+// które w tym kroku przekroczyły próg: krytyczny (prośba o lądowanie), śmierć, koniec ładowania.
+// Semantyka jak w src/drone.c: lot i oczekiwanie w kolejce zużywają baterię w tempie 80% / T2,
+// ładowanie rozkłada brakujący ładunek równo na T1 i kończy się baterią 100%. Krok ma stałą
+// długość dt, a koniec ładowania liczony jest w krokach (jak pętla ładowania drona), nie zegarem.
+
+#define PH_ALIGN    64  // Wyrównanie tablic (linia pamięci podręcznej / wektor AVX-512)
+#define PH_LANES    16  // Pojemność zaokrąglana do wielokrotności - pętla bez końcówki skalarnej
+#define PH_FULL     100.0f
+#define PH_CRITICAL 20.0f
+#define PH_DEAD     0.0f
+
+// Zdarzenia kroku (bity w ev[i])
+#define PH_EV_CRITICAL 1
+#define PH_EV_DEAD     2
+#define PH_EV_FULL     4
+
+struct PhFleet {
+    int n;             // Liczba dronów (indeksy 0..n-1)
+    int cap;           // Rozmiar tablic (wielokrotność PH_LANES)
+    float *battery;    // %
+    float *rate;       // Zmiana baterii na sekundę: < 0 lot/kolejka, > 0 ładowanie, 0 = stan zamrożony
+    float *drain;      // Zużycie w locie (%/s) - przywracane po starcie
+    int32_t *charge_end; // Krok końca ładowania; INT32_MAX poza ładowaniem
+    uint8_t *phase;    // TM_* (zmienia tylko ph_set_phase / obsługa zdarzeń)
+    uint16_t *cycles;  // Ukończone cykle
+    uint8_t *ev;       // Bity zdarzeń ostatniego kroku
+    float dt;          // Długość kroku (s)
+    int32_t tick;      // Wykonane kroki (czas symulacji = tick * dt)
+    // Listy zdarzeń ostatniego kroku
+    int32_t *critical, *dead, *full;
+    int n_critical, n_dead, n_full;
+};
+
+// Alokacja n dronów w locie, krok dt sekund (baterie i tempo ustawia wywołujący). 0 = OK.
+int ph_init(struct PhFleet *f, int n, float dt);
+void ph_free(struct PhFleet *f);
+
+// Zmiana fazy drona i jego tempa: FLYING / QUEUED - zużycie, CHARGING - ładowanie przez t1 sekund
+// (zaokrąglone do pełnych kroków), pozostałe - stan zamrożony. Wywołania między krokami.
+int32_t ph_ticks(const struct PhFleet *f, float t1);
+void ph_set_phase(struct PhFleet *f, int i, int phase, float t1);
+
+// Jeden krok o dt sekund. Wypełnia listy critical / dead / full; drony z 'dead' przechodzą
+// w TM_DEAD, drony z 'full' mają baterię 100% i fazę TM_WAIT_TAKEOFF (cykl zaliczony).
+void ph_step(struct PhFleet *f);
+
+#endif
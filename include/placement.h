@@ -0,0 +1,42 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- ROZMIESZCZENIE NA CPU I PRIORYTET ---
+// Commander zapisuje życzenia w SwarmConfig (pamięć dzielona), a każdy proces stosuje je do
+// siebie przy starcie: Operator - rdzeń i politykę szeregowania, dron - zbiór CPU.
+// Brak uprawnień (EPERM) nie przerywa pracy: FIFO/RR spada do nice, nice do domyślnego.
+
+#define PL_CPU_WORDS 16 // Maska do 1024 CPU
+
+// Flagi SwarmConfig.placement (0 = brak życzeń, jak dotąd)
+#define PL_OP_CPU  1 // Operator przypięty do op_cpu
+#define PL_DRONES  2 // Drony ograniczone do drone_cpus
+#define PL_SPREAD  4 // ...i rozłożone: dron dostaje jeden CPU z maski (ID modulo liczba CPU)
+
+// Polityka Operatora (SwarmConfig.op_policy)
+#define PL_POLICY_DEFAULT 0
+#define PL_POLICY_NICE    1 // op_prio = wartość nice (-20..19)
+#define PL_POLICY_FIFO    2 // op_prio = priorytet czasu rzeczywistego (1..99)
+#define PL_POLICY_RR      3
+
+// Lista CPU "0-3,6" -> maska. Zwraca liczbę CPU lub -1 przy błędzie składni.
+int pl_parse_cpus(const char *s, uint64_t *mask);
+
+// Polityka "nice=-5", "fifo=10", "rr=10". 0 = OK, -1 = błąd.
+int pl_parse_policy(const char *s, int *policy, int *prio);
+
+int pl_mask_count(const uint64_t *mask);
+// Maska CPU dostępnych dla procesu (sched_getaffinity)
+int pl_mask_online(uint64_t *mask);
+void pl_mask_format(const uint64_t *mask, char *buf, size_t len);
+
+// Zastosowanie do bieżącego procesu. Zwracają 0 lub -1; opis wyniku (także zastosowanego
+// zastępstwa) trafia do 'msg'. *applied_policy/prio = to, co faktycznie obowiązuje.
+int pl_pin_cpu(int cpu, char *msg, size_t len);
+int pl_set_policy(int policy, int prio, int *applied_policy, int *applied_prio, char *msg, size_t len);
+int pl_apply_drone(int placement, const uint64_t *mask, int id, char *msg, size_t len);
+
+#endif
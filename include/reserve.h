@@ -0,0 +1,64 @@
+#ifndef RESERVE_H
+#define RESERVE_H
+
+#include <stdint.h>
+
+// Dołączany przez common.h po stałych CHANNELS / MAX_DRONE_ID / RESPONSE_BASE (kalendarz jest
+// częścią OperatorState) - w plikach .c wystarczy common.h.
+
+// --- KALENDARZ REZERWACJI OKIEN LĄDOWANIA ---
+// Dron z wyprzedzeniem (config.rsv_lookahead_s) zgłasza MSG_RESERVE z przewidywanym czasem do
+// progu krytycznego. Operator szuka w kalendarzu sekundowych slotów okna, w którym zarezerwowane
+// wloty nie przekroczą RSV_PER_SLOT, a zarezerwowane postoje w hangarze - pojemności P przez cały
+// czas postoju. Okno w slocie progu = potwierdzenie, wcześniejsze = kontrpropozycja (dron ląduje
+// z zapasem baterii), brak okna = odmowa (dron prosi o lądowanie jak dotąd, przy progu).
+// Kalendarz jest częścią OperatorState (punkt kontrolny), sloty numerowane bezwzględnie od
+// mono_time() - CLOCK_MONOTONIC jest wspólny dla procesów, więc wznowiony Operator go kontynuuje.
+
+#define RSV_SLOT_S   1.0      // Długość slotu (s)
+#define RSV_SLOTS    256      // Horyzont kalendarza (sloty)
+#define RSV_PER_SLOT CHANNELS // Najwięcej zarezerwowanych wlotów zaczynających się w jednym slocie
+#define RSV_CHARGE_DEFAULT 20 // Domyślny czas ładowania (CONST_CHARGE_TIME drona), gdy charge_s = 0
+#define RSV_CROSSING 2        // Przelot przez tunel (CROSSING_TIME drona)
+
+// Wynik rezerwacji
+#define RSV_CONFIRMED 0
+#define RSV_COUNTERED 1
+#define RSV_REJECTED  2
+
+// Odpowiedź Operatora: mtype = RSV_RESPONSE_BASE + id, channel_id = początek okna za tyle ms
+// od wysłania odpowiedzi (RSV_NO_WINDOW = odmowa). Inny typ niż zgody - dron nie pomyli ich.
+#define RSV_RESPONSE_BASE (RESPONSE_BASE + MAX_DRONE_ID)
+#define RSV_NO_WINDOW -1
+
+struct RsvCalendar {
+    int32_t base;                 // Numer bezwzględny najstarszego slotu w pierścieniu (0 = nieużywany)
+    int32_t hold;                 // Postój w hangarze jednej rezerwacji (sloty)
+    uint16_t occ[RSV_SLOTS];      // Zarezerwowane miejsca w hangarze w slocie (indeks = numer % RSV_SLOTS)
+    uint16_t starts[RSV_SLOTS];   // Zarezerwowane wloty zaczynające się w slocie
+    int32_t booked[MAX_DRONE_ID]; // Slot początku okna drona (0 = brak rezerwacji)
+};
+
+// Początek kalendarza (hold_s - czas od wlotu do zwolnienia miejsca w hangarze)
+void rsv_init(struct RsvCalendar *c, int hold_s, double now);
+
+// Przesunięcie kalendarza do bieżącego slotu (sloty minione są czyszczone)
+void rsv_advance(struct RsvCalendar *c, double now);
+
+// Rezerwacja okna dla drona 'id' najpóźniej w slocie now + eta_s, przy pojemności 'cap'.
+// Zwraca RSV_*; dla potwierdzenia i kontrpropozycji *start = początek okna (mono_time).
+int rsv_book(struct RsvCalendar *c, int id, double now, double eta_s, int cap, double *start);
+
+// Zwolnienie przyszłej części rezerwacji (śmierć drona, nowa rezerwacja w miejsce starej)
+void rsv_release(struct RsvCalendar *c, int id, double now);
+
+// Zakończenie rezerwacji przy zgodzie na lądowanie - postój zostaje w kalendarzu jako prognoza
+// zajętości. Zwraca 1, jeśli dron miał rezerwację.
+int rsv_clear(struct RsvCalendar *c, int id);
+
+int rsv_has(const struct RsvCalendar *c, int id);
+
+// Zarezerwowane wloty w najbliższych 'slots' slotach (0 = tylko bieżący)
+int rsv_due(const struct RsvCalendar *c, double now, int slots);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "common.h"
+
+// --- SZEREG CZASOWY OPERATORA (planowanie pojemności) ---
+// Co zadany odstęp Operator zapisuje migawkę: zajętość hangaru, długu Shrink, kolejek, tuneli
+// i populacji oraz przyrosty zdarzeń od poprzedniej próbki. Próbka powstaje w pętli zdarzeń
+// z pól stanu Operatora (jeden GETVAL semafora) - ścieżka zgód jest nietknięta.
+// Zapis buforowany: jeden write() na pełny bufor albo co sekundę. Następca po awarii dopisuje.
+// Format CSV (samples.csv) albo binarny (samples.bin: TsHeader + rekordy TsSample);
+// ./tsdump zamienia plik binarny na CSV lub drukuje podsumowanie.
+
+#define TS_FILE_CSV "samples.csv"
+#define TS_FILE_BIN "samples.bin"
+#define TS_MAGIC    0x53545753u // "SWTS"
+#define TS_VERSION  1
+#define TS_MIN_MS   10          // Najkrótszy odstęp próbek
+#define TS_BUF      256         // Próbek w buforze przed zapisem
+
+#define TS_NONE 0
+#define TS_CSV  1
+#define TS_BIN  2
+
+// Przyrosty zdarzeń od poprzedniej próbki (indeks w TsSample.d)
+enum {
+    TS_REQ_LAND,    // Prośby o lądowanie
+    TS_REQ_TAKEOFF, // Prośby o start
+    TS_LANDED,      // Zgłoszenia LANDED
+    TS_DEPARTED,    // Zgłoszenia DEPARTED
+    TS_DEAD,        // Zgłoszenia śmierci
+    TS_GRANTS,      // Wysłane zgody (LAND + TAKEOFF)
+    TS_DEFERRED,    // Zgody odłożone przez pełną kolejkę
+    TS_SPAWNED,     // Drony z Replenish
+    TS_DELTAS
+};
+
+extern const char *const ts_delta_names[TS_DELTAS];
+
+struct TsHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size; // sizeof(struct TsSample) - czytnik odrzuca obcy układ
+    uint32_t interval_ms;
+    uint32_t channels;
+    double t0;            // Czas uniksowy otwarcia pliku
+};
+
+struct TsSample {
+    double t;                       // Czas uniksowy (wspólny dla Operatora i jego następcy)
+    uint16_t P;                     // Pojemność logiczna
+    uint16_t occupied;              // Zajęte miejsca (rezerwacje + drony w środku)
+    uint16_t free_slots;            // Wartość semafora hangaru
+    uint16_t pending_removal;       // Dług Shrink (miejsca do rozebrania po wylotach)
+    uint16_t q_land;                // Czekający na lądowanie (bez zamazanych martwych)
+    uint16_t q_takeoff;
+    uint16_t active;                // current_active / target_N
+    uint16_t target_N;
+    uint8_t chan_dir[CHANNELS];     // DIR_*
+    uint16_t chan_users[CHANNELS];
+    uint32_t d[TS_DELTAS];
+};
+
+// Otwarcie pliku (append: następca po awarii dopisuje; nagłówek tylko do pustego pliku). 0 = OK.
+int ts_open(int format, int interval_ms);
+void ts_write(const struct TsSample *s);
+void ts_flush(void);
+void ts_close(void);
+
+// Wiersz CSV (wspólny dla Operatora i ./tsdump)
+void ts_csv_header(FILE *f);
+void ts_csv_row(FILE *f, const struct TsSample *s);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+// --- AKCJE SCENARIUSZA ---
+#define SC_GROW          1 // Sygnał 1 do Operatora
+#define SC_SHRINK        2 // Sygnał 2 do Operatora
+#define SC_ATTACK        3 // Sygnał 3 do dronów o podanych ID
+#define SC_ATTACK_RANDOM 4 // Sygnał 3 do K losowych aktywnych dronów
+#define SC_KILL_FRACTION 5 // Sygnał 3 do ułamka aktywnego roju (0.0 - 1.0)
+#define SC_WAIT          6 // Odczekanie zadanej liczby sekund
+
+// Pojedynczy krok osi czasu
+struct ScenarioStep {
+    int action;   // SC_*
+    double value; // Sekundy (WAIT), liczba dronów (ATTACK_RANDOM) lub ułamek (KILL_FRACTION)
+    int *ids;     // Lista celów dla SC_ATTACK
+    int n_ids;
+    int line;     // Numer linii w pliku (do komunikatów)
+};
+
+// Wczytany scenariusz
+struct Scenario {
+    unsigned int seed;          // Ziarno RNG (dyrektywa "seed"), 0 = brak
+    struct ScenarioStep *steps;
+    int n_steps;
+};
+
+// Wczytanie pliku scenariusza. Zwraca 0 przy sukcesie, -1 przy błędzie (komunikat na stderr).
+int scenario_load(const char *path, struct Scenario *sc);
+void scenario_free(struct Scenario *sc);
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+
+// --- RDZEŃ PLANISTY OPERATORA ---
+// Kolejki oczekujących, tunele, pojemność hangaru i skalowanie P jako czyste funkcje na
+// struct OperatorState: bez IPC, logów i zmiennych globalnych. Zdarzenie wchodzi (sch_event,
+// sch_pass, zmiany P), decyzje wychodzą jako lista akcji w struct SchOut - Operator wykonuje je
+// (msgsnd zgód, semop semafora hangaru, logi), a bench/sched_bench mierzy i sprawdza je bez roju.
+// Wolne miejsca w hangarze wynikają ze stanu (P + pending_removal - occupied); semafor
+// SEM_HANGAR jest tylko ich lustrem dla reszty systemu.
+
+// Akcje
+#define SCH_GRANT_LAND    0 // Zgoda na lądowanie: id, ch; arg = 1, jeśli dron miał rezerwację okna
+#define SCH_GRANT_TAKEOFF 1 // Zgoda na start: id, ch
+#define SCH_SEM           2 // Zmiana semafora hangaru o arg
+#define SCH_DISMANTLED    3 // Miejsce zdemontowane po wylocie (spłata pending_removal), arg = pozostało
+#define SCH_BLOCKED       4 // Prośba drona id wstrzymana - populacja ponad docelowe N
+#define SCH_REGRANT       5 // Ponowne wysłanie zgody sprzed wznowienia: id, ch; arg = MSG_REQ_* (zasoby bez zmian)
+
+// Najwięcej akcji jednego wywołania (zgoda na start + zgoda na lądowanie + semafor w sch_pass)
+#define SCH_OUT_CAP 8
+
+struct SchAction {
+    int16_t kind; // SCH_*
+    int16_t ch;   // Tunel zgody
+    int32_t id;   // Dron
+    int32_t arg;
+};
+
+struct SchOut {
+    int n;
+    struct SchAction a[SCH_OUT_CAP];
+};
+
+// Prośba drona w toku (OperatorState.req). Prośba w kierunku, w którym dron już czeka albo ma
+// zgodę, jest duplikatem; LANDED / DEPARTED bez zgody w tym kierunku to duch.
+#define SCH_RQ_NONE          0
+#define SCH_RQ_LAND          1 // W kolejce lądowania
+#define SCH_RQ_LAND_GRANT    2 // Zgoda na lądowanie wydana, czekamy na LANDED
+#define SCH_RQ_TAKEOFF       3 // W kolejce startu
+#define SCH_RQ_TAKEOFF_GRANT 4 // Zgoda na start wydana, czekamy na DEPARTED
+
+// Flagi wyniku sch_event
+#define SCH_F_WAS_QUEUED 1 // MSG_DEAD: dron czekał w kolejce lądowania
+#define SCH_F_RSV_FREED  2 // MSG_DEAD: zwolniono jego rezerwację okna
+#define SCH_F_NO_CHANNEL 4 // MSG_LANDED / MSG_DEPARTED bez zgody w tym kierunku (tunel i miejsce bez zmian)
+#define SCH_F_DUPLICATE  8 // MSG_REQ_*: dron już czeka albo ma zgodę - prośba zignorowana
+#define SCH_F_GRANT_FREED 16 // MSG_DEAD: dron miał zgodę - jego tunel i miejsce wróciły do puli
+
+// Wynik zmian pojemności sygnałami
+#define SCH_OK      0
+#define SCH_IGNORED 1 // Sygnał 1 już użyty / P = 1
+#define SCH_DENIED  2 // Podwojenie N przekroczyłoby MAX_DRONE_ID
+
+// Początkowy stan: P miejsc, docelowe N, tunele i kolejki puste
+void sch_init(struct OperatorState *s, int P, int N);
+
+// Zdarzenie drona (mtype MSG_REQ_LAND..MSG_DEAD). immediate = 1: prośba dostaje zgodę od razu,
+// jeśli może (tryb bez partii); immediate = 0: prośby trafiają do kolejek, zgody wydaje dopiero
+// sch_pass. Po LANDED / DEPARTED / DEAD przejście planisty zleca wywołujący. 'now' - czas kalendarza
+// rezerwacji. Zwraca SCH_F_*.
+int sch_event(struct OperatorState *s, int type, int id, int immediate, double now, struct SchOut *out);
+
+// Prośba ponowiona przez drona po zmianie epoki (REQ_RESEND): zgoda w tym kierunku wydana przed
+// wznowieniem (grant_old) nie dotarła - SCH_REGRANT na tym samym tunelu. Inaczej jak sch_event.
+int sch_resend(struct OperatorState *s, int type, int id, int immediate, double now, struct SchOut *out);
+
+// Wznowienie Operatora: wydane zgody oznaczamy jako niepewne (grant_old). Zwraca ich liczbę.
+int sch_recover(struct OperatorState *s);
+
+// Jedno przejście planisty: najwyżej jeden start i jedno lądowanie. Zwraca liczbę zgód.
+int sch_pass(struct OperatorState *s, struct SchOut *out);
+
+// Kolejki (0 = lądowanie, 1 = start). sch_enqueue: 0 = OK, -1 = kolejka pełna.
+int sch_enqueue(struct OperatorState *s, int type, int id);
+int sch_dequeue(struct OperatorState *s, int type);
+// Dron znika: zamazanie w obu kolejkach i koniec jego prośby; 1 = czekał na lądowanie.
+// Tunelu i miejsca ze zgody nie oddaje - śmierć drona rozlicza sch_event(MSG_DEAD).
+int sch_remove(struct OperatorState *s, int id);
+int sch_queue_depth(const struct OperatorState *s, int type);
+
+int sch_find_channel(const struct OperatorState *s, int dir);
+int sch_free_slots(const struct OperatorState *s);
+
+// Miejsce w hangarze dla drona tworzonego w bazie (1 = zajęte) i jego zwrot po nieudanym fork
+int sch_take_spot(struct OperatorState *s, struct SchOut *out);
+void sch_return_spot(struct OperatorState *s, struct SchOut *out);
+
+// Skalowanie: Sygnał 1 (podwojenie P i N), Sygnał 2 (połowa; *removed = miejsca usunięte od razu),
+// dowolne P (autoskaler, gniazdo sterujące). sch_resize zwraca 1, gdy wzrosło docelowe N.
+int sch_grow(struct OperatorState *s, struct SchOut *out);
+int sch_shrink(struct OperatorState *s, struct SchOut *out, int *removed);
+int sch_resize(struct OperatorState *s, int new_P, struct SchOut *out);
+
+// Sprawdzenie niezmienników stanu. 0 = spójny; inaczej opis pierwszego naruszenia w 'why'.
+int sch_check(const struct OperatorState *s, char *why, size_t len);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdint.h>
+
+// --- KOLEJKA SPSC (jeden producent, jeden konsument, bez blokad) ---
+// Bufor cykliczny elementów stałego rozmiaru; pojemność to potęga dwójki. Producent pisze tylko
+// 'head', konsument tylko 'tail' - każdy w osobnej linii pamięci podręcznej.
+// Usypianie konsumenta: SpscWaker (eventfd) wspólny dla wszystkich kolejek, które konsument
+// obsługuje. Producent płaci wywołaniem systemowym tylko wtedy, gdy konsument naprawdę śpi.
+
+struct SpscWaker {
+    int efd;
+    int waiting; // 1 = konsument zgłosił sen (atomowo)
+};
+
+struct Spsc {
+    _Alignas(64) uint32_t head; // Następny slot do zapisu (producent)
+    _Alignas(64) uint32_t tail; // Następny slot do odczytu (konsument)
+    _Alignas(64) uint32_t mask;
+    uint32_t esize;
+    char *buf;
+    struct SpscWaker *waker;    // Budzony po każdym push (NULL = konsument nie śpi)
+};
+
+int spsc_waker_init(struct SpscWaker *w);
+void spsc_waker_close(struct SpscWaker *w);
+// Wybudzenie konsumenta niezależnie od kolejek (np. koniec pracy)
+void spsc_waker_kick(struct SpscWaker *w);
+// Wybudzenie tylko wtedy, gdy konsument zgłosił sen (jedno write() na jeden sen)
+void spsc_wake(struct SpscWaker *w);
+
+// Sen konsumenta: spsc_arm, sprawdzenie wszystkich kolejek, spsc_sleep tylko gdy puste.
+// Kolejność (zgłoszenie snu przed sprawdzeniem) wyklucza zgubione wybudzenie.
+void spsc_arm(struct SpscWaker *w);
+void spsc_disarm(struct SpscWaker *w);
+// Sen do wybudzenia, sygnału lub chwili 'deadline' (mono_time). Zwraca 1 = wybudzony.
+int spsc_sleep(struct SpscWaker *w, double deadline);
+
+// cap zaokrąglane w górę do potęgi dwójki. 0 = OK.
+int spsc_init(struct Spsc *q, uint32_t cap, uint32_t esize, struct SpscWaker *w);
+void spsc_free(struct Spsc *q);
+int spsc_push(struct Spsc *q, const void *e); // 0 = OK, -1 = pełna
+int spsc_pop(struct Spsc *q, void *e);        // 1 = pobrano, 0 = pusta
+int spsc_empty(struct Spsc *q);
+uint32_t spsc_len(struct Spsc *q);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <sys/types.h>
+#include <signal.h>
+
+// --- NADZORCA PROCESÓW (pidfd + epoll) ---
+// Commander trzyma pidfd dla Operatora i każdego drona. Zakończenie procesu budzi epoll
+// natychmiast, a sygnały idą przez pidfd_send_signal - recykling PID nie może trafić w obcy proces.
+
+#define SUP_OPERATOR 0
+#define SUP_DRONE    1
+#define SUP_KINDS    2
+
+#define SUP_MAX_CHILDREN 4096 // Limit równocześnie nadzorowanych procesów
+
+struct SupChild {
+    pid_t pid;
+    int pidfd;       // -1 = wpis wolny
+    int kind;        // SUP_OPERATOR / SUP_DRONE
+    int drone_id;    // Logiczne ID (-1 dla Operatora)
+    double t_start;  // Czas rejestracji (mono_time)
+};
+
+// Statystyki zakończeń dla klasy procesów
+struct SupKindStats {
+    int started;
+    int exited;       // Wszystkie zakończenia
+    int exit_zero;    // exit(0)
+    int exit_error;   // exit(!=0)
+    int signaled;     // Zabite sygnałem
+    int by_signal[NSIG]; // Rozbicie zabójstw według numeru sygnału
+    double life_sum;  // Suma czasów życia (s)
+    double life_max;
+};
+
+// Callback wywoływany po zebraniu (reap) procesu
+typedef void (*sup_exit_cb)(const struct SupChild *child, int code, int status);
+
+int sup_init(void);
+int sup_fd(void); // Deskryptor epoll (do select/poll w pętli głównej)
+
+// Rejestracja procesu potomnego. Zwraca uchwyt (>= 0) lub -1 (np. to nie nasze dziecko).
+int sup_watch(pid_t pid, int kind, int drone_id);
+
+// Uchwyt drona o danym ID (-1 = nie nadzorowany)
+int sup_find_drone(int drone_id);
+pid_t sup_pid(int handle);
+
+// Sygnał przez pidfd. 0 = OK, -1 = błąd (errno ESRCH gdy proces już nie żyje).
+int sup_signal(int handle, int sig);
+
+// Sygnał z wartością (jak sigqueue: si_code = SI_QUEUE, si_value.sival_int = value)
+int sup_signal_value(int handle, int sig, int value);
+
+// Obsługa zdarzeń: czeka do timeout_ms (0 = nie czeka). Zwraca liczbę zebranych procesów.
+int sup_poll(int timeout_ms, sup_exit_cb cb);
+
+// Zebranie zakończonych dzieci spoza nadzoru (np. dron z Replenish - CLONE_PARENT, więc nasze
+// dziecko - który zginął, zanim trafił do sup_watch). Nadzorowanych nie dotyka. Zwraca liczbę zebranych.
+int sup_reap_untracked(void);
+
+// Czekanie na zakończenie wszystkich procesów z limitem czasu. Zwraca liczbę pozostałych.
+int sup_drain(double timeout_s, sup_exit_cb cb);
+
+int sup_alive(int kind);
+const struct SupKindStats *sup_stats(int kind);
+
+// Zapis zakończeń per proces (CSV) - historia zbierana przez cały przebieg
+int sup_write_csv(const char *path);
+
+// pidfd procesu spoza nadzoru (np. Commandera sesji przy dołączaniu): czytelny po jego śmierci.
+// Nie rejestruje niczego i niczego nie zbiera. -1 = błąd (ESRCH - proces nie żyje).
+int sup_pidfd(pid_t pid);
+
+void sup_close(void);
+
+#endif
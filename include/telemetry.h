@@ -0,0 +1,77 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// --- TELEMETRIA DRONÓW (pamięć dzielona, seqlock) ---
+// Każde ID drona ma w SharedState własny slot wielkości linii pamięci podręcznej - zapisy
+// sąsiednich dronów nie unieważniają sobie nawzajem linii. Slot pisze tylko jego dron
+// (kolejne wcielenie przejmuje go po śmierci poprzedniego), czytać może każdy bez blokad:
+// licznik seq jest nieparzysty w trakcie zapisu, a czytelnik ponawia kopię, gdy seq się zmienił.
+
+#define TM_CACHELINE 64
+#define TM_READ_TRIES 64 // Po tylu nieudanych próbach slot uznajemy za nieczytelny (pisarz zginął w trakcie)
+
+// Faza cyklu życia
+enum {
+    TM_EMPTY,        // Slot nieużywany
+    TM_FLYING,       // Lot swobodny
+    TM_QUEUED,       // Czeka na zgodę na lądowanie
+    TM_CROSS_IN,     // Przelot przez tunel do bazy
+    TM_CHARGING,     // Ładowanie w hangarze
+    TM_WAIT_TAKEOFF, // Czeka w hangarze na zgodę na start
+    TM_CROSS_OUT,    // Przelot przez tunel na zewnątrz
+    TM_DEAD,         // Wcielenie zakończone (następne nadpisze slot)
+    TM_PARKED,       // Na miejscu postojowym, czeka na wolną ładowarkę (pula ładowarek)
+    TM_PHASES
+};
+
+extern const char *const tm_phase_names[TM_PHASES];
+
+struct TelemetrySlot {
+    uint32_t seq;          // Licznik seqlocka (nieparzysty = zapis w toku)
+    int32_t pid;           // Bieżące wcielenie
+    float battery;         // %
+    int8_t location;       // ST_INSIDE / ST_OUTSIDE
+    int8_t phase;          // TM_*
+    int8_t kamikaze_pending;
+    int8_t pad;
+    int16_t cycles_flown;
+    int16_t max_cycles;
+    uint32_t generation;   // Kolejne wcielenia tego ID (rośnie przy każdym tm_attach)
+    double t_update;       // mono_time() ostatniego zapisu
+} __attribute__((aligned(TM_CACHELINE)));
+
+// Dane slotu bez licznika - to, co widzi czytelnik
+struct TelemetryView {
+    pid_t pid;
+    float battery;
+    int location, phase, kamikaze_pending, cycles_flown, max_cycles;
+    uint32_t generation;
+    double t_update;
+};
+
+// Zajęcie slotu przez nowe wcielenie (naprawia licznik po pisarzu zabitym w trakcie zapisu)
+void tm_attach(struct TelemetrySlot *s, pid_t pid, int max_cycles);
+
+// Zapis stanu (jeden pisarz na slot). Wywołujący chroni zapis przed własnymi sygnałami.
+void tm_publish(struct TelemetrySlot *s, float battery, int location, int phase,
+                int kamikaze_pending, int cycles_flown, double now);
+
+// Spójna kopia slotu. 0 = OK, -1 = zapis trwa zbyt długo (pisarz zginął w jego trakcie).
+int tm_read(const struct TelemetrySlot *s, struct TelemetryView *v);
+
+// Podsumowanie floty w jednym przejściu po slotach
+struct FleetSummary {
+    int alive;                 // Sloty z żywym wcieleniem (faza inna niż EMPTY/DEAD)
+    int by_phase[TM_PHASES];
+    int inside, kamikaze;
+    int torn;                  // Sloty, których nie dało się odczytać
+    float battery_min, battery_avg;
+    double oldest_update_s;    // Najstarsza aktualizacja wśród żywych (wiek w s)
+};
+
+void tm_fleet(const struct TelemetrySlot *slots, int n, double now, struct FleetSummary *fs);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// --- ŚLEDZENIE GORĄCYCH ŚCIEŻEK (spany begin/end) ---
+// Każdy proces (Commander, Operator, dron) dostaje własny bufor cykliczny w pliku mapowanym
+// w pamięci. Zapis to jedno fetch_add i cztery przypisania - bez blokad i bez wywołań systemowych.
+// Domyślnie wyłączone: makra TRACE_* kosztują wtedy jedno sprawdzenie flagi.
+// Narzędzie ./tracedump scala bufory do formatu Chrome/Perfetto (JSON).
+
+#define TRACE_FILE        "swarm_trace.bin"
+#define TRACE_MAGIC       0x43525453u // "STRC"
+#define TRACE_VERSION     1
+#define TRACE_MAX_RINGS   4096        // Limit procesów w jednym przebiegu (wcielenia dronów się sumują)
+#define TRACE_RING_EVENTS 8192        // Potęga dwójki - indeks to head & (N - 1)
+
+// Nazwy spanów (indeks w trace_names)
+enum {
+    TR_MSG_RECV,     // Odbiór wiadomości z kolejki
+    TR_SCHED_PASS,   // Przejście planisty Operatora
+    TR_GRANT_SEND,   // Wysłanie zgód (msgsnd)
+    TR_CROSSING,     // Przelot drona przez tunel
+    TR_CHARGING,     // Ładowanie w hangarze
+    TR_LOG_FLUSH,    // Zapis logów (plik Operatora / magazyn dronów)
+    TR_WAIT_GRANT,   // Dron czeka na zgodę Operatora
+    TR_SUP_POLL,     // Commander zbiera zakończone procesy
+    TR_SCENARIO,     // Commander wykonuje krok scenariusza
+    TR_NAMES
+};
+
+extern const char *const trace_names[TR_NAMES];
+
+struct TraceEvent {
+    uint64_t ts_ns;  // CLOCK_MONOTONIC - wspólny zegar wszystkich procesów
+    uint16_t name;   // TR_*
+    uint8_t ph;      // 'B' (początek), 'E' (koniec), 'i' (zdarzenie chwilowe)
+    uint8_t pad;
+    int32_t arg;     // Dodatkowa wartość (np. numer tunelu, liczba wiadomości)
+};
+
+struct TraceRing {
+    int32_t pid;     // 0 = bufor przydzielony, ale jeszcze nie opisany
+    int32_t id;      // ID drona (-1 dla Commandera i Operatora)
+    char role[16];   // "commander" / "operator" / "drone"
+    uint64_t head;   // Licznik zapisanych zdarzeń (rośnie bez końca; nadpisujemy najstarsze)
+    struct TraceEvent ev[TRACE_RING_EVENTS];
+};
+
+struct TraceHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t max_rings;
+    uint32_t ring_events;
+    uint32_t next_ring;     // Licznik przydziału buforów (atomowy)
+    uint32_t dropped_rings; // Procesy, dla których zabrakło bufora
+    uint64_t ring_stride;   // Odstęp między buforami w pliku (wielokrotność strony)
+    uint64_t data_offset;   // Początek pierwszego bufora
+};
+
+extern int trace_on;
+
+#define TRACE_BEGIN(n)    do { if (__builtin_expect(trace_on, 0)) trace_emit((n), 'B', 0); } while (0)
+#define TRACE_END(n, a)   do { if (__builtin_expect(trace_on, 0)) trace_emit((n), 'E', (a)); } while (0)
+#define TRACE_MARK(n, a)  do { if (__builtin_expect(trace_on, 0)) trace_emit((n), 'i', (a)); } while (0)
+
+// Utworzenie pustego pliku śladu (Commander na starcie z -T). 0 = OK, -1 = błąd.
+int trace_create(const char *path);
+
+// Przydział bufora dla bieżącego procesu i włączenie śledzenia. 0 = OK, -1 = błąd.
+int trace_open(const char *path, const char *role, int id);
+
+// Zapis zdarzenia (bezpieczny w handlerze sygnału - slot rezerwowany atomowo)
+void trace_emit(int name, char ph, int arg);
+
+void trace_close(void);
+
+// Mapowanie całego pliku tylko do odczytu (tracedump). Zwraca nagłówek lub NULL.
+struct TraceHeader *trace_map_readonly(const char *path, size_t *map_len);
+
+static inline const struct TraceRing *trace_ring(const struct TraceHeader *h, uint32_t i) {
+    return (const struct TraceRing *)((const char *)h + h->data_offset + (uint64_t)i * h->ring_stride);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <stdint.h>
+
+// --- ZUŻYCIE ZASOBÓW PROCESÓW ROJU ---
+// Operator i każdy dron przy wyjściu (atexit) dopisują swoje getrusage i liczniki wywołań
+// systemowych z /proc/self/io do sum swojej klasy w pamięci dzielonej. Rozkłady są trzymane
+// jako histogramy log2, więc pamięć nie rośnie z liczbą wcieleń dronów. Procesy zabite
+// sygnałem nie docierają do atexit - raport podaje, ilu zakończeń brakuje w sumach.
+
+#define USAGE_OPERATOR 0
+#define USAGE_DRONE    1
+#define USAGE_CLASSES  2
+#define USAGE_BUCKETS  32 // Kubełek k: wartości z przedziału [2^(k-1), 2^k)
+
+struct UsageClass {
+    uint32_t n;              // Zapisane procesy
+    uint32_t io_missing;     // Procesy bez /proc/self/io (liczniki syscr/syscw nieznane)
+    uint64_t utime_us;       // Sumy
+    uint64_t stime_us;
+    uint64_t nvcsw;          // Przełączenia dobrowolne (sen, blokada)
+    uint64_t nivcsw;         // Wywłaszczenia
+    uint64_t minflt, majflt;
+    uint64_t syscr, syscw;   // Wywołania read/write-podobne (/proc/self/io)
+    uint64_t maxrss_kb;      // Suma szczytowych RSS
+    uint64_t cpu_us_max;     // Maksima na proces
+    uint64_t csw_max;
+    uint64_t rss_kb_max;
+    uint32_t cpu_hist[USAGE_BUCKETS]; // us CPU (user + sys) na proces
+    uint32_t csw_hist[USAGE_BUCKETS]; // Przełączenia kontekstu (oba rodzaje) na proces
+    uint32_t rss_hist[USAGE_BUCKETS]; // Szczytowy RSS (KB) na proces
+};
+
+// Pomiar bieżącego procesu (getrusage RUSAGE_SELF + /proc/self/io) dodany do klasy.
+// Bezpieczne przy równoczesnym wyjściu wielu procesów (operacje atomowe).
+void usage_record(struct UsageClass *c);
+
+// Rejestracja usage_record(c) w atexit - wywołanie raz, po podłączeniu pamięci dzielonej
+void usage_at_exit(struct UsageClass *c);
+
+// Zapis od razu i wyłączenie zapisu w atexit - przed shmdt pamięci z klasą
+void usage_detach(void);
+
+// Oszacowanie percentyla z histogramu: górna granica kubełka, nie większa niż znane maksimum
+uint64_t usage_pct(const uint32_t *hist, uint32_t n, double p, uint64_t max);
+
+#endif
@@ -0,0 +1,342 @@
+/* src/analyze.c
+ *
+ * Analiza logów po przebiegu (post-mortem).
+ * Mapuje swarm_log.bin oraz operator.txt, parsuje je równolegle (wątki = rdzenie)
+ * i odtwarza cykl życia każdego wcielenia drona:
+ *   Lot -> Kolejka -> Przelot IN -> Ładowanie -> Oczekiwanie na start -> Przelot OUT -> ... -> Śmierć
+ * Wynik: CSV per dron (-c) oraz rozkłady zbiorcze w JSON (stdout lub -j).
+ */
+
+// MUSI BYĆ PIERWSZE! (memmem)
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/common.h"
+#include "../include/log_store.h"
+
+// --- FAZY CYKLU ŻYCIA ---
+#define PH_NONE      0
+#define PH_FLIGHT    1 // Lot swobodny
+#define PH_QUEUE     2 // Oczekiwanie na zgodę na lądowanie
+#define PH_CROSS     3 // Przelot przez tunel (IN lub OUT)
+#define PH_CHARGE    4 // Ładowanie w hangarze
+#define PH_TAKEOFF_Q 5 // Oczekiwanie na zgodę na start
+#define PH_COUNT     6
+
+// --- PRZYCZYNY ŚMIERCI ---
+#define CAUSE_ALIVE    0 // Dron przeżył do końca przebiegu
+#define CAUSE_BATTERY  1 // Bateria padła w locie
+#define CAUSE_WAITING  2 // Bateria padła w kolejce do lądowania
+#define CAUSE_AGE      3 // Limit cykli (złomowanie)
+#define CAUSE_KAMIKAZE 4 // Rozkaz ataku (Sygnał 3)
+#define CAUSE_COUNT    5
+
+static const char *cause_names[CAUSE_COUNT] = { "alive", "battery", "waiting", "age", "kamikaze" };
+
+// Wynik dla jednego wcielenia drona
+struct Lifecycle {
+    int id;
+    uint32_t generation;
+    int pid;
+    int64_t t_begin_ns, t_end_ns;
+    double phase_s[PH_COUNT]; // Łączny czas w każdej fazie
+    int queue_visits;         // Ile razy czekał na lądowanie
+    int cycles;               // Ukończone cykle ładowania
+    int cause;
+};
+
+// Wektor czasów pojedynczych wizyt w kolejce (do percentyli)
+struct DVec { double *v; size_t n, cap; };
+
+static void dvec_push(struct DVec *d, double x) {
+    if (d->n == d->cap) {
+        d->cap = d->cap ? d->cap * 2 : 256;
+        d->v = realloc(d->v, d->cap * sizeof(double));
+        if (!d->v) { perror("realloc"); exit(1); }
+    }
+    d->v[d->n++] = x;
+}
+
+// Liczniki z operator.txt
+struct OpCounts { long landings, takeoffs, deaths, spawns, blocked, lines; };
+
+// --- STAN WSPÓŁDZIELONY PRZEZ WĄTKI ---
+static const struct LogStoreHeader *store = NULL;
+static int *heads = NULL;                 // Pierwszy segment każdego wcielenia
+static int n_heads = 0;
+static struct Lifecycle *results = NULL;
+static int next_job = 0;                  // Kolejne wcielenie do przetworzenia (atomowo)
+
+static const char *op_data = NULL;        // Zmapowany operator.txt
+static size_t op_len = 0;
+
+struct Worker {
+    pthread_t tid;
+    int index, count;
+    struct DVec queue_waits;   // Czasy oczekiwania na lądowanie (s)
+    struct DVec takeoff_waits; // Czasy oczekiwania na start (s)
+    struct OpCounts op;        // Wynik dla fragmentu operator.txt
+};
+
+// Przejście do nowej fazy: doliczenie czasu poprzedniej
+static void enter_phase(struct Lifecycle *lc, struct Worker *w, int *phase, int64_t *since, int next, int64_t ts) {
+    if (*phase != PH_NONE) {
+        double dt = (ts - *since) / 1e9;
+        lc->phase_s[*phase] += dt;
+        if (*phase == PH_QUEUE) dvec_push(&w->queue_waits, dt);
+        if (*phase == PH_TAKEOFF_Q) dvec_push(&w->takeoff_waits, dt);
+    }
+    *phase = next;
+    *since = ts;
+}
+
+// Odtworzenie cyklu życia z łańcucha segmentów jednego wcielenia
+static void parse_lifecycle(int head, struct Lifecycle *lc, struct Worker *w) {
+    memset(lc, 0, sizeof(*lc));
+    lc->id = store->index[head].drone_id;
+    lc->generation = store->index[head].generation;
+    lc->pid = store->index[head].pid;
+    lc->cause = CAUSE_ALIVE;
+
+    int phase = PH_NONE;
+    int64_t since = 0;
+    int last_hint = CAUSE_BATTERY; // Ostatnia wskazówka co do przyczyny śmierci
+
+    for (int seg = head; seg != -1; seg = store->index[seg].next) {
+        uint32_t used = store->index[seg].used;
+        const char *data = ls_segment_data(store, seg);
+        uint32_t off = 0;
+        while (off + sizeof(struct LogRecord) <= used) {
+            struct LogRecord r;
+            memcpy(&r, data + off, sizeof(r));
+            const char *txt = data + off + sizeof(r);
+            size_t len = r.len;
+            off += (sizeof(r) + r.len + 7) & ~7u;
+
+            if (lc->t_begin_ns == 0) lc->t_begin_ns = r.ts_ns;
+            lc->t_end_ns = r.ts_ns;
+
+            // Rekordy nie są zakończone zerem - memmem ogranicza przeszukiwanie do długości
+            if (memmem(txt, len, "Flying...", 9)) enter_phase(lc, w, &phase, &since, PH_FLIGHT, r.ts_ns);
+            else if (memmem(txt, len, "Requesting LANDING", 18)) {
+                enter_phase(lc, w, &phase, &since, PH_QUEUE, r.ts_ns);
+                lc->queue_visits++;
+            }
+            else if (memmem(txt, len, "Crossing channel", 16)) enter_phase(lc, w, &phase, &since, PH_CROSS, r.ts_ns);
+            else if (memmem(txt, len, "Charging...", 11)) enter_phase(lc, w, &phase, &since, PH_CHARGE, r.ts_ns);
+            else if (memmem(txt, len, "Requesting TAKEOFF", 18)) enter_phase(lc, w, &phase, &since, PH_TAKEOFF_Q, r.ts_ns);
+            else if (memmem(txt, len, "Back in the air", 15)) enter_phase(lc, w, &phase, &since, PH_FLIGHT, r.ts_ns);
+            else if (memmem(txt, len, "Cycle ", 6) && memmem(txt, len, "completed", 9)) lc->cycles++;
+            else if (memmem(txt, len, "Died waiting", 12)) last_hint = CAUSE_WAITING;
+            else if (memmem(txt, len, "RETIRING", 8)) last_hint = CAUSE_AGE;
+            else if (memmem(txt, len, "KAMIKAZE ORDER RECEIVED", 23)) last_hint = CAUSE_KAMIKAZE;
+            else if (memmem(txt, len, "RIP", 3)) {
+                enter_phase(lc, w, &phase, &since, PH_NONE, r.ts_ns);
+                lc->cause = last_hint;
+            }
+        }
+    }
+    // Dron żywy na końcu przebiegu - domykamy bieżącą fazę na ostatnim rekordzie
+    if (phase != PH_NONE) enter_phase(lc, w, &phase, &since, PH_NONE, lc->t_end_ns);
+}
+
+// Zliczanie zdarzeń w fragmencie operator.txt [begin, end) - granice na końcach linii
+static void parse_operator_chunk(const char *begin, const char *end, struct OpCounts *c) {
+    const char *p = begin;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        if (memmem(p, len, "GRANT LAND", 10)) c->landings++;
+        if (memmem(p, len, "GRANT TAKEOFF", 13)) c->takeoffs++;
+        if (memmem(p, len, "RIP", 3)) c->deaths++;
+        if (memmem(p, len, "REPLENISH", 9)) c->spawns++;
+        if (memmem(p, len, "BLOCKED", 7)) c->blocked++;
+        c->lines++;
+        p += len + 1;
+    }
+}
+
+// Wyrównanie granicy fragmentu do początku następnej linii
+static size_t align_to_line(size_t pos) {
+    if (pos == 0 || pos >= op_len) return pos >= op_len ? op_len : 0;
+    const char *nl = memchr(op_data + pos, '\n', op_len - pos);
+    return nl ? (size_t)(nl - op_data) + 1 : op_len;
+}
+
+static void *worker_main(void *arg) {
+    struct Worker *w = arg;
+    // 1. Fragment operator.txt przypisany statycznie
+    if (op_data) {
+        size_t b = align_to_line(op_len * w->index / w->count);
+        size_t e = align_to_line(op_len * (w->index + 1) / w->count);
+        if (b < e) parse_operator_chunk(op_data + b, op_data + e, &w->op);
+    }
+    // 2. Wcielenia dronów pobierane dynamicznie (nierówne długości łańcuchów)
+    for (;;) {
+        int job = __atomic_fetch_add(&next_job, 1, __ATOMIC_RELAXED);
+        if (job >= n_heads) break;
+        parse_lifecycle(heads[job], &results[job], w);
+    }
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Rozkład: min, mediana, p90, p99, max, średnia
+static void print_dist(FILE *out, const char *name, struct DVec *d, int last) {
+    if (d->n == 0) {
+        fprintf(out, "  \"%s\": {\"count\": 0}%s\n", name, last ? "" : ",");
+        return;
+    }
+    qsort(d->v, d->n, sizeof(double), cmp_double);
+    double sum = 0;
+    for (size_t i = 0; i < d->n; i++) sum += d->v[i];
+    fprintf(out, "  \"%s\": {\"count\": %zu, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+                 "\"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f}%s\n",
+            name, d->n, d->v[0], d->v[d->n / 2], d->v[(size_t)(d->n * 0.9)],
+            d->v[(size_t)(d->n * 0.99)], d->v[d->n - 1], sum / d->n, last ? "" : ",");
+}
+
+// Dołączenie wektora 'src' do 'dst'
+static void dvec_merge(struct DVec *dst, struct DVec *src) {
+    for (size_t i = 0; i < src->n; i++) dvec_push(dst, src->v[i]);
+    free(src->v);
+}
+
+int main(int argc, char *argv[]) {
+    const char *store_path = LOG_STORE_FILE;
+    const char *op_path = "operator.txt";
+    const char *csv_path = NULL;
+    const char *json_path = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:c:j:t:")) != -1) {
+        switch (opt) {
+            case 'f': store_path = optarg; break;
+            case 'o': op_path = optarg; break;
+            case 'c': csv_path = optarg; break;
+            case 'j': json_path = optarg; break;
+            case 't': threads = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-f swarm_log.bin] [-o operator.txt] [-c per_drone.csv] [-j summary.json] [-t threads]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+
+    size_t store_len = 0;
+    store = ls_map_readonly(store_path, &store_len);
+    if (!store) return 1;
+
+    // operator.txt jest opcjonalny (np. przebieg z samym magazynem)
+    int fd = open(op_path, O_RDONLY);
+    if (fd != -1) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            op_len = st.st_size;
+            op_data = mmap(NULL, op_len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (op_data == MAP_FAILED) { perror("mmap operator.txt"); op_data = NULL; op_len = 0; }
+            else madvise((void *)op_data, op_len, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    // Lista wcieleń: dla każdego ID przechodzimy po generacjach (od najnowszej)
+    uint32_t used_segs = store->next_segment < store->max_segments ? store->next_segment : store->max_segments;
+    heads = malloc(sizeof(int) * (used_segs + 1));
+    if (!heads) { perror("malloc"); return 1; }
+    for (int id = 0; id < MAX_DRONE_ID; id++) {
+        for (int h = store->last_head[id]; h != -1; h = store->index[h].prev_gen) heads[n_heads++] = h;
+    }
+    results = calloc(n_heads ? n_heads : 1, sizeof(struct Lifecycle));
+    struct Worker *workers = calloc(threads, sizeof(struct Worker));
+    if (!results || !workers) { perror("calloc"); return 1; }
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].index = i;
+        workers[i].count = threads;
+        if (pthread_create(&workers[i].tid, NULL, worker_main, &workers[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    struct DVec queue_waits = {0}, takeoff_waits = {0};
+    struct OpCounts op = {0};
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].tid, NULL);
+        dvec_merge(&queue_waits, &workers[i].queue_waits);
+        dvec_merge(&takeoff_waits, &workers[i].takeoff_waits);
+        op.landings += workers[i].op.landings;
+        op.takeoffs += workers[i].op.takeoffs;
+        op.deaths += workers[i].op.deaths;
+        op.spawns += workers[i].op.spawns;
+        op.blocked += workers[i].op.blocked;
+        op.lines += workers[i].op.lines;
+    }
+
+    // --- CSV PER DRON ---
+    if (csv_path) {
+        FILE *csv = fopen(csv_path, "w");
+        if (!csv) { perror("fopen csv"); return 1; }
+        fprintf(csv, "id,generation,pid,lifetime_s,flight_s,queue_s,queue_visits,crossing_s,charge_s,takeoff_wait_s,cycles,cause\n");
+        for (int i = 0; i < n_heads; i++) {
+            struct Lifecycle *lc = &results[i];
+            fprintf(csv, "%d,%u,%d,%.3f,%.3f,%.3f,%d,%.3f,%.3f,%.3f,%d,%s\n",
+                    lc->id, lc->generation, lc->pid, (lc->t_end_ns - lc->t_begin_ns) / 1e9,
+                    lc->phase_s[PH_FLIGHT], lc->phase_s[PH_QUEUE], lc->queue_visits,
+                    lc->phase_s[PH_CROSS], lc->phase_s[PH_CHARGE], lc->phase_s[PH_TAKEOFF_Q],
+                    lc->cycles, cause_names[lc->cause]);
+        }
+        fclose(csv);
+    }
+
+    // --- ROZKŁADY ZBIORCZE (JSON) ---
+    struct DVec lifetimes = {0}, cycles = {0}, charge = {0};
+    long causes[CAUSE_COUNT] = {0};
+    for (int i = 0; i < n_heads; i++) {
+        struct Lifecycle *lc = &results[i];
+        dvec_push(&lifetimes, (lc->t_end_ns - lc->t_begin_ns) / 1e9);
+        dvec_push(&cycles, lc->cycles);
+        dvec_push(&charge, lc->phase_s[PH_CHARGE]);
+        causes[lc->cause]++;
+    }
+
+    FILE *out = stdout;
+    if (json_path) {
+        out = fopen(json_path, "w");
+        if (!out) { perror("fopen json"); return 1; }
+    }
+    fprintf(out, "{\n  \"incarnations\": %d,\n  \"threads\": %d,\n", n_heads, threads);
+    fprintf(out, "  \"operator\": {\"lines\": %ld, \"landings\": %ld, \"takeoffs\": %ld, \"deaths\": %ld, "
+                 "\"spawns\": %ld, \"blocked\": %ld},\n",
+            op.lines, op.landings, op.takeoffs, op.deaths, op.spawns, op.blocked);
+    fprintf(out, "  \"causes\": {");
+    for (int c = 0; c < CAUSE_COUNT; c++) fprintf(out, "\"%s\": %ld%s", cause_names[c], causes[c], c + 1 < CAUSE_COUNT ? ", " : "");
+    fprintf(out, "},\n");
+    print_dist(out, "queue_wait_s", &queue_waits, 0);
+    print_dist(out, "takeoff_wait_s", &takeoff_waits, 0);
+    print_dist(out, "charge_time_s", &charge, 0);
+    print_dist(out, "charge_cycles", &cycles, 0);
+    print_dist(out, "lifetime_s", &lifetimes, 1);
+    fprintf(out, "}\n");
+    if (out != stdout) fclose(out);
+
+    free(queue_waits.v); free(takeoff_waits.v);
+    free(lifetimes.v); free(cycles.v); free(charge.v);
+    free(results); free(heads); free(workers);
+    if (op_data) munmap((void *)op_data, op_len);
+    munmap((void *)store, store_len);
+    return 0;
+}
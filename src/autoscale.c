@@ -0,0 +1,89 @@
+/* src/autoscale.c
+ *
+ * Autoskaler pojemności hangaru: przesuwne okno metryk Operatora -> decyzja o zmianie P.
+ * Moduł nie dotyka IPC - samą zmianę (semafor, pending_removal, target_N) wykonuje Operator.
+ */
+
+#include <string.h>
+
+#include "../include/autoscale.h"
+
+void as_init(struct Autoscaler *as, int p_min, int p_max, double now) {
+    memset(as, 0, sizeof(*as));
+    as->p_min = p_min;
+    as->p_max = p_max;
+    as->t_bucket = now;
+    as->t_sample = now;
+    as->t_change = now;
+}
+
+int as_sample(struct Autoscaler *as, double now, int land_depth, double chan_util, double hangar_occ) {
+    struct AsBucket *b = &as->win[as->cur];
+    b->samples++;
+    b->depth_sum += (uint32_t)land_depth;
+    b->busy_sum += (float)chan_util;
+    b->occ_sum += (float)hangar_occ;
+    as->t_sample = now;
+
+    if (now - as->t_bucket < 1.0) return 0;
+    // Zamknięcie kubełka i wyczyszczenie najstarszego (staje się bieżącym)
+    as->t_bucket = now;
+    as->cur = (as->cur + 1) % AS_BUCKETS;
+    memset(&as->win[as->cur], 0, sizeof(struct AsBucket));
+    if (as->filled < AS_BUCKETS - 1) as->filled++;
+    return 1;
+}
+
+void as_land_wait(struct Autoscaler *as, double wait_s) {
+    as->win[as->cur].waits++;
+    as->win[as->cur].wait_sum += (float)wait_s;
+}
+
+void as_death_waiting(struct Autoscaler *as) { as->win[as->cur].deaths++; }
+
+int as_decide(struct Autoscaler *as, double now, int P, struct AsDecision *d) {
+    // Podsumowanie okna (bez bieżącego, niepełnego kubełka)
+    uint32_t samples = 0, depth = 0, waits = 0, deaths = 0;
+    double busy = 0, occ = 0, wait = 0;
+    for (int k = 1; k <= as->filled; k++) {
+        const struct AsBucket *b = &as->win[(as->cur - k + AS_BUCKETS) % AS_BUCKETS];
+        samples += b->samples; depth += b->depth_sum; busy += b->busy_sum; occ += b->occ_sum;
+        waits += b->waits; wait += b->wait_sum; deaths += b->deaths;
+    }
+    memset(d, 0, sizeof(*d));
+    d->p_from = d->p_to = (int16_t)P;
+    d->deaths = (uint16_t)deaths;
+    if (samples > 0) {
+        d->depth = (float)depth / samples;
+        d->util = (float)(busy / samples);
+        d->occ = (float)(occ / samples);
+    }
+    if (waits > 0) d->wait = (float)(wait / waits);
+
+    if (as->filled < AS_MIN_FILL || now - as->t_change < AS_COOLDOWN_S) return P;
+
+    // Presja: kolejka rośnie / drony czekają długo / giną w kolejce - ale tylko gdy brakuje miejsc.
+    // Przy pustawym hangarze i zapchanych tunelach większe P nic nie da.
+    int up = (deaths > 0 || d->depth >= AS_GROW_DEPTH || d->wait >= AS_GROW_WAIT) && d->occ >= AS_GROW_OCC;
+    int down = deaths == 0 && d->depth <= AS_SHRINK_DEPTH && d->wait <= AS_SHRINK_WAIT && d->occ <= AS_SHRINK_OCC;
+
+    as->up_streak = up ? as->up_streak + 1 : 0;
+    as->down_streak = down ? as->down_streak + 1 : 0;
+
+    int target = P;
+    if (as->up_streak >= AS_HOLD && P < as->p_max) {
+        int step = P / 2 > 1 ? P / 2 : 1;                 // Wzrost o połowę...
+        if (step > AS_MAX_STEP) step = AS_MAX_STEP;
+        target = P + step < as->p_max ? P + step : as->p_max;
+    } else if (as->down_streak >= AS_HOLD && P > as->p_min) {
+        int step = P / 4 > 1 ? P / 4 : 1;                 // ...spadek ostrożniej, o ćwierć
+        if (step > AS_MAX_STEP) step = AS_MAX_STEP;
+        target = P - step > as->p_min ? P - step : as->p_min;
+    }
+    d->p_to = (int16_t)target;
+    return target;
+}
+
+void as_changed(struct Autoscaler *as, double now) {
+    as_init(as, as->p_min, as->p_max, now); // Stare metryki opisują poprzednie P
+}
@@ -1,125 +1,888 @@
 /* src/commander.c
-*
-* Modu3 Dowdcy (G3wny proces).
-* Odpowiada za:
-* - Walidacje danych wejociowych (P < N/2)
-* - Inicjalizacje struktur IPC
-* - Uruchomienie Operatora i pocz1tkowych Dronw
-* - Interfejs u?ytkownika (komendy 1, 2, 3)
-* - Generowanie raportu koncowego
-*/
-
-
-#include <stdio.h>      // Biblioteka standardowa wejcia/wyjcia (printf, fopen, itp.)
+ *
+ * Modu3 Dowódcy (G3ówny proces).
+ * Odpowiada za:
+ * - Walidacje danych wejociowych (P < N/2)
+ * - Inicjalizacje struktur IPC
+ * - Uruchomienie Operatora i pocz1tkowych Dronów
+ * - Interfejs u?ytkownika (komendy 1, 2, 3)
+ * - Generowanie raportu koncowego
+ */
+
+
+#include <stdio.h>      // Biblioteka standardowa wejścia/wyjścia (printf, fopen, itp.)
 #include <stdlib.h>     // Biblioteka standardowa (malloc, exit, atoi, strtol)
 #include <unistd.h>     // Standardowe funkcje systemowe POSIX (fork, pipe, read, write, sleep)
-#include <signal.h>     // Obsuga sygnaw (signal, kill, SIGINT, SIGUSR1)
+#include <signal.h>     // Obsługa sygnałów (signal, kill, SIGINT, SIGUSR1)
 #include <sys/wait.h>   // Funkcje do oczekiwania na procesy potomne (waitpid)
-#include <sys/select.h> // Funkcja select do monitorowania deskryptorw plikw (nieblokujce wejcie)
-#include <sys/shm.h>    // Funkcje pamici dzielonej Systemu V (shmget, shmat, shmctl)
-#include <sys/resource.h> // Funkcje do zarzdzania limitami zasobw (getrlimit)
+#include <sys/select.h> // Funkcja select do monitorowania deskryptorów plików (nieblokujące wejście)
+#include <sys/shm.h>    // Funkcje pamięci dzielonej Systemu V (shmget, shmat, shmctl)
+#include <sys/resource.h> // Funkcje do zarządzania limitami zasobów (getrlimit)
+#include <sys/stat.h>   // mkdir (katalog przebiegu)
 #include <string.h>     // Funkcje do operacji na stringach (memset, strstr, snprintf)
-#include <stdarg.h>     // Obsuga zmiennej liczby argumentw funkcji (va_list)
+#include <stdarg.h>     // Obsługa zmiennej liczby argumentów funkcji (va_list)
 #include <time.h>       // Funkcje czasu (time, strftime)
-#include <errno.h>      // Obsuga bdw systemowych (zmienna errno)
+#include <errno.h>      // Obsługa błędów systemowych (zmienna errno)
 #include <limits.h>	// Potrzebne do INT_MAX
 #include <sys/ipc.h>	// flagi IPC (IPC_CREAT, IPC_NOWAIT)
-#include <sys/msg.h>	// Kolejki komunikatw (msgget, msgrcv, msgsnd)
+#include <sys/msg.h>	// Kolejki komunikatów (msgget, msgrcv, msgsnd)
+#include <fcntl.h>      // open, fcntl (sesja odłączona)
+#include <sys/socket.h> // send, shutdown (klient gniazda sterującego przy -a)
 
-#include "common.h"     // Wasny plik nagwkowy ze wsplnymi definicjami (struktury, stae)
+#include "common.h"     // Własny plik nagłówkowy ze wspólnymi definicjami (struktury, stałe)
 
 #include "../include/common.h"
 #include "../include/ipc_wrapper.h"
+#include "../include/scenario.h"
+#include "../include/log_store.h"
+#include "../include/supervisor.h"
+#include "../include/trace.h"
+#include "../include/control.h"
+#include "../include/sampler.h"
+
+#define SHUTDOWN_DRAIN_S 5.0 // Ile sekund czekamy na zakończenie roju po SIGINT, zanim użyjemy SIGKILL
+#define OP_MAX_RESTARTS  5   // Limit wznowień Operatora po awarii (potem zatrzymujemy symulację)
 
 // --- ZMIENNE GLOBALNE ---
 static pid_t op_pid = -1; // Zmienna do przechowywania ID procesu (PID) Operatora
-static int N_val = 0;     // Przechowuje docelow liczb dronw
-// volatile sig_atomic_t zapewnia bezpieczny dostp do zmiennej w handlerze sygnau
-static volatile sig_atomic_t stop_requested = 0; // Flaga sterujca ptl gwn (0=dziaaj, 1=stop)
-static struct SharedState *shared_mem = NULL;    // Wskanik do struktury w pamici dzielonej
-static int shmid = -1;    // Identyfikator segmentu pamici dzielonej
+static int op_handle = -1; // Uchwyt Operatora w nadzorcy (pidfd)
+static pid_t swarm_pgid = -1; // Grupa procesów roju (Operator + wszystkie drony)
+static int shutting_down = 0; // 1 = trwa zamykanie (śmierć Operatora jest oczekiwana)
+static int N_val = 0;     // Przechowuje docelową liczbę dronów
+// volatile sig_atomic_t zapewnia bezpieczny dostęp do zmiennej w handlerze sygnału
+static volatile sig_atomic_t stop_requested = 0; // Flaga sterująca pętlą główną (0=działaj, 1=stop)
+static struct SharedState *shared_mem = NULL;    // Wskaźnik do struktury w pamięci dzielonej
+static int shmid = -1;    // Identyfikator segmentu pamięci dzielonej
 
-// Handler sygnau SIGINT (reakcja na Ctrl+C)
+// Tryb bezobsługowy (scenariusz z pliku zamiast klawiatury)
+static struct Scenario scenario;     // Wczytana oś czasu akcji
+static int scenario_mode = 0;        // 1 = sterowanie z pliku, stdin ignorowany
+static int sc_next = 0;              // Indeks następnego kroku do wykonania
+static double sc_due = 0.0;          // Czas (monotoniczny), o którym wykonujemy następny krok
+static const char *report_path = NULL; // Plik raportu JSON (NULL = brak)
+static int P_val = 0;                // Początkowa pojemność hangaru (do raportu)
+static double start_time = 0.0;      // Start symulacji (do raportu)
+static int op_restart_pending = 0;   // 1 = Operator padł, uruchamiamy następcę w trybie odtwarzania
+static int op_restarts = 0;          // Liczba wznowień Operatora
+static int await_target = 0;         // 1 = po klawiszu '3' następna linia wejścia to ID celu
+static struct CtlBatch ctl_batch;    // Bieżąca partia z gniazda sterującego
+static int detached = 0;             // 1 = sesja bez terminala (-D albo SIGHUP): stdin nieczytany, ekran do /dev/null
+static volatile sig_atomic_t hup_received = 0; // Terminal zniknął - przechodzimy w tryb odłączony
+
+// Handler sygnału SIGINT (reakcja na Ctrl+C)
 void sigint_handler(int sig) {
-    (void)sig;          // Rzutowanie na void, aby unikn ostrzeenia kompilatora o nieuywanym parametrze
-    stop_requested = 1; // Ustawienie flagi zatrzymania, co spowoduje wyjcie z ptli while w main
+    (void)sig;          // Rzutowanie na void, aby uniknąć ostrzeżenia kompilatora o nieużywanym parametrze
+    stop_requested = 1; // Ustawienie flagi zatrzymania, co spowoduje wyjście z pętli while w main
+}
+
+// Utrata terminala (zamknięte okno, zerwane SSH) nie może porzucić roju bez nadzoru
+void sighup_handler(int sig) {
+    (void)sig;
+    hup_received = 1;
 }
 
-// Wrapper logowania - funkcja pomocnicza do wypisywania logw na ekran i do pliku
+// Wrapper logowania - funkcja pomocnicza do wypisywania logów na ekran i do pliku
 void cmd_log(const char *format, ...) {
-    va_list args;       // Deklaracja listy argumentw dla funkcji o zmiennej liczbie parametrw
-    va_start(args, format); // Inicjalizacja listy argumentw
-    vprintf(format, args);  // Wypisanie sformatowanego tekstu na standardowe wyjcie (konsol)
-    va_end(args);       // Zakoczenie pracy z list argumentw
+    va_list args;       // Deklaracja listy argumentów dla funkcji o zmiennej liczbie parametrów
+    va_start(args, format); // Inicjalizacja listy argumentów
+    vprintf(format, args);  // Wypisanie sformatowanego tekstu na standardowe wyjście (konsolę)
+    va_end(args);       // Zakończenie pracy z listą argumentów
 
-    FILE *f = fopen("commander.txt", "a"); // Otwarcie pliku logw w trybie "append" (dopisywanie na kocu)
-    if (f) {            // Sprawdzenie, czy plik otworzy si poprawnie
+    FILE *f = fopen("commander.txt", "a"); // Otwarcie pliku logów w trybie "append" (dopisywanie na końcu)
+    if (f) {            // Sprawdzenie, czy plik otworzył się poprawnie
         time_t now = time(NULL); // Pobranie aktualnego czasu systemowego
-        struct tm *t = localtime(&now); // Konwersja czasu na struktur lokaln (godziny, minuty...)
+        struct tm *t = localtime(&now); // Konwersja czasu na strukturę lokalną (godziny, minuty...)
         char timebuf[32]; // Bufor na sformatowany czas
         strftime(timebuf, sizeof(timebuf), "%H:%M:%S", t); // Formatowanie czasu do stringa "HH:MM:SS"
         fprintf(f, "[%s] ", timebuf); // Zapisanie znacznika czasu do pliku
-        va_start(args, format); // Ponowna inicjalizacja listy argumentw (trzeba to zrobi dla kadego uycia)
-        vfprintf(f, format, args); // Zapisanie waciwej treci logu do pliku
-        va_end(args);   // Sprztanie po licie argumentw
-        fclose(f);      // Zamknicie pliku, aby zapisa zmiany na dysku
+        va_start(args, format); // Ponowna inicjalizacja listy argumentów (trzeba to zrobić dla każdego użycia)
+        vfprintf(f, format, args); // Zapisanie właściwej treści logu do pliku
+        va_end(args);   // Sprzątanie po liście argumentów
+        fclose(f);      // Zamknięcie pliku, aby zapisać zmiany na dysku
     }
 }
 
-// Generowanie statystyk na podstawie logw operatora
-void generate_report() {
-    FILE *f = fopen("operator.txt", "r"); // Otwarcie pliku z logami operatora w trybie do odczytu
-    if (!f) {           // Jeli plik nie istnieje lub nie mona go otworzy
-        cmd_log(C_RED "\n[Commander] Could not open operator.txt for reporting." C_RESET "\n");
-        return;         // Przerwij funkcj raportowania
-    }
+static const char *usage_names[USAGE_CLASSES] = {"operator", "drone"};
 
-    // Inicjalizacja licznikw statystyk
-    int landings = 0;
-    int takeoffs = 0;
-    int deaths = 0;
-    int spawns = 0;
-    int blocked = 0;
-    
-    char line[512]; // Bufor na pojedyncz lini z pliku
-    // Ptla czytajca plik linia po linii, dopki fgets nie zwrci NULL (koniec pliku)
-    while (fgets(line, sizeof(line), f)) {
-        // strstr sprawdza, czy dany podcig wystpuje w linii. Jeli tak, inkrementujemy licznik.
-        if (strstr(line, "GRANT LAND")) landings++;
-        if (strstr(line, "GRANT TAKEOFF")) takeoffs++;
-        if (strstr(line, "RIP")) deaths++;
-        if (strstr(line, "REPLENISH")) spawns++;
-        if (strstr(line, "BLOCKED")) blocked++;
-    }
-    fclose(f); // Zamknicie pliku po odczycie
-
-    // Wypisanie sformatowanego raportu kocowego przy uyciu funkcji cmd_log
+// Sekcja zużycia zasobów jednej klasy procesów (sumy z atexit w pamięci dzielonej)
+static void report_usage(const char *title, const struct UsageClass *c, int started) {
+    uint32_t n = c->n;
+    uint64_t cpu_us = c->utime_us + c->stime_us;
+    cmd_log(" %-29s%u recorded / %d started", title, n, started);
+    if (started > (int)n) cmd_log(" (%d killed or still running - not counted)", started - (int)n);
+    cmd_log("\n");
+    if (n == 0) return;
+    cmd_log("   CPU user / sys:            %.3fs / %.3fs (avg %.1f ms/process)\n",
+            c->utime_us / 1e6, c->stime_us / 1e6, cpu_us / 1000.0 / n);
+    cmd_log("   CPU per process (ms):      p50 <=%.1f p90 <=%.1f max %.1f\n", usage_pct(c->cpu_hist, n, 50, c->cpu_us_max) / 1000.0,
+            usage_pct(c->cpu_hist, n, 90, c->cpu_us_max) / 1000.0, c->cpu_us_max / 1000.0);
+    cmd_log("   ctx switches vol / invol:  %llu / %llu (p90 <=%llu, max %llu per process)\n",
+            (unsigned long long)c->nvcsw, (unsigned long long)c->nivcsw,
+            (unsigned long long)usage_pct(c->csw_hist, n, 90, c->csw_max), (unsigned long long)c->csw_max);
+    cmd_log("   peak RSS (KB):             avg %llu p50 <=%llu max %llu\n", (unsigned long long)(c->maxrss_kb / n),
+            (unsigned long long)usage_pct(c->rss_hist, n, 50, c->rss_kb_max), (unsigned long long)c->rss_kb_max);
+    cmd_log("   page faults minor / major: %llu / %llu\n", (unsigned long long)c->minflt, (unsigned long long)c->majflt);
+    cmd_log("   read / write syscalls:     %llu / %llu", (unsigned long long)c->syscr, (unsigned long long)c->syscw);
+    if (c->io_missing) cmd_log(" (%u processes without /proc/self/io)", c->io_missing);
+    cmd_log("\n");
+}
+
+// Generowanie statystyk z liczników Operatora w pamięci dzielonej (OpStats). Log operator.txt
+// nie jest źródłem sum: w trybie -M pełna kolejka logów gubi tekst, a liczniki są zawsze pełne.
+int generate_report(int final) {
+    const struct OpStats *os = shared_mem ? &shared_mem->op_stats : NULL;
+    unsigned long long landings = os ? os->grants_dir[0] : 0;
+    unsigned long long takeoffs = os ? os->grants_dir[1] : 0;
+    unsigned long long deaths = os ? os->deaths : 0;
+    unsigned long long spawns = os ? os->spawns : 0;
+    unsigned long long blocked = os ? os->blocked : 0;
+
+    // Wypisanie sformatowanego raportu końcowego przy użyciu funkcji cmd_log
     cmd_log(C_YELLOW "\n");
     cmd_log("========================================\n");
-    cmd_log("       FINAL SIMULATION REPORT          \n");
+    cmd_log(final ? "       FINAL SIMULATION REPORT          \n" : "        LIVE SIMULATION REPORT          \n");
     cmd_log("========================================\n");
-    cmd_log(" Total Landings Granted:      %d\n", landings);
-    cmd_log(" Total Takeoffs Granted:      %d\n", takeoffs);
-    cmd_log(" Total Drone Deaths (RIP):    %d\n", deaths);
-    cmd_log(" New Drones Spawned:          %d\n", spawns);
-    cmd_log(" Entry Denials (Blocked):     %d\n", blocked);
+    cmd_log(" Total Landings Granted:      %llu\n", landings);
+    cmd_log(" Total Takeoffs Granted:      %llu\n", takeoffs);
+    cmd_log(" Total Drone Deaths (RIP):    %llu\n", deaths);
+    cmd_log(" New Drones Spawned:          %llu\n", spawns);
+    cmd_log(" Entry Denials (Blocked):     %llu\n", blocked);
+    cmd_log("----------------------------------------\n");
+    const struct SupKindStats *ds = sup_stats(SUP_DRONE);
+    cmd_log(" Drone Processes Reaped:      %d/%d\n", ds->exited, ds->started);
+    cmd_log("   clean exit / error / sig:  %d / %d / %d\n", ds->exit_zero, ds->exit_error, ds->signaled);
+    cmd_log("   avg / max lifetime:        %.1fs / %.1fs\n", ds->exited ? ds->life_sum / ds->exited : 0.0, ds->life_max);
+    double op_avg_batch = (os && os->wakeups) ? (double)os->msgs / os->wakeups : 0.0;
+    double op_us_per_msg = (os && os->msgs) ? os->busy_ns / 1000.0 / os->msgs : 0.0;
+    if (os) {
+        cmd_log(" Operator Messages:           %llu\n", (unsigned long long)os->msgs);
+        cmd_log("   avg / max batch:           %.1f / %u\n", op_avg_batch, os->max_batch);
+        cmd_log("   handling cost:             %.2f us/msg\n", op_us_per_msg);
+        cmd_log(" Message Queue:               max %llu msgs / %llu B (limit %llu B)\n",
+                (unsigned long long)os->q_max_msgs, (unsigned long long)os->q_max_bytes, (unsigned long long)os->q_limit_bytes);
+        cmd_log("   saturations / deferred:    %u / %llu (max backlog %u)\n",
+                os->saturations, (unsigned long long)os->grants_deferred, os->retry_max);
+        cmd_log(" Landing Wait:                avg %.2fs / max %.2fs (%llu grants)\n",
+                os->land_waits ? os->land_wait_sum / os->land_waits : 0.0, os->land_wait_max,
+                (unsigned long long)os->land_waits);
+        cmd_log("   deaths while queued:       %u\n", os->deaths_waiting);
+        if (os->op_threads || os->spawn_ms_max > 0) {
+            cmd_log(" Operator Threads:            %s, replenish fork max %.2f ms\n",
+                    os->op_threads ? "intake / scheduler / aux" : "single", os->spawn_ms_max);
+            cmd_log("   intake->grant (ms):        avg %.3f max %.3f (%llu batches)",
+                    os->glat_n[0] ? os->glat_sum[0] / os->glat_n[0] : 0.0, os->glat_max[0], (unsigned long long)os->glat_n[0]);
+            if (os->glat_n[1])
+                cmd_log(" | during fork: avg %.3f max %.3f (%llu)", os->glat_sum[1] / os->glat_n[1], os->glat_max[1],
+                        (unsigned long long)os->glat_n[1]);
+            cmd_log("\n");
+            if (os->log_dropped) cmd_log("   log bytes dropped:         %llu\n", (unsigned long long)os->log_dropped);
+        }
+        if (shared_mem->config.placement || shared_mem->config.op_policy) {
+            static const char *pol_names[] = {"default", "nice", "SCHED_FIFO", "SCHED_RR"};
+            char cpus[64] = "any";
+            if (shared_mem->config.placement & PL_DRONES) pl_mask_format(shared_mem->config.drone_cpus, cpus, sizeof(cpus));
+            cmd_log(" Operator Placement:          CPU %d, %s %d | drones: %s%s\n", os->op_cpu,
+                    pol_names[os->op_policy & 3], os->op_prio, cpus,
+                    (shared_mem->config.placement & PL_SPREAD) && (shared_mem->config.placement & PL_DRONES) ? " (spread)" : "");
+        }
+    }
+    // Zużycie zasobów: procesy dopisują się przy wyjściu, Commander mierzy siebie (bez zebranych dzieci)
+    struct rusage self_ru;
+    getrusage(RUSAGE_SELF, &self_ru);
+    double self_cpu = self_ru.ru_utime.tv_sec + self_ru.ru_utime.tv_usec / 1e6 + self_ru.ru_stime.tv_sec + self_ru.ru_stime.tv_usec / 1e6;
+    if (shared_mem) {
+        cmd_log("----------------------------------------\n");
+        report_usage("Resource Usage (operator):", &shared_mem->usage[USAGE_OPERATOR], sup_stats(SUP_OPERATOR)->started);
+        report_usage("Resource Usage (drones):", &shared_mem->usage[USAGE_DRONE], ds->started);
+        cmd_log(" Resource Usage (commander):  CPU %.3fs, ctx switches %ld / %ld, peak RSS %ld KB\n",
+                self_cpu, self_ru.ru_nvcsw, self_ru.ru_nivcsw, self_ru.ru_maxrss);
+    }
+    double duration = mono_time() - start_time;
+    double landings_h = duration > 0 ? landings * 3600.0 / duration : 0.0;
+    const struct ChargeStats *cs = shared_mem ? &shared_mem->charge : NULL;
+    if (cs && shared_mem->config.chargers > 0) {
+        int power = shared_mem->config.charge_power > 0 ? shared_mem->config.charge_power : shared_mem->config.chargers;
+        cmd_log("----------------------------------------\n");
+        cmd_log(" Charger Pool:                %d chargers (power for %d) / P %d parking\n",
+                shared_mem->config.chargers, power, P_val);
+        cmd_log("   landings/h / deaths:       %.1f / %llu\n", landings_h, deaths);
+        cmd_log("   sessions / partial:        %u / %u (avg unplug level %.1f%%)\n", cs->sessions, cs->partial,
+                cs->sessions ? (double)cs->level_sum / cs->sessions : 0.0);
+        cmd_log("   charger wait:              avg %.2fs / max %.2fs (%u sessions queued)\n",
+                cs->sessions ? cs->wait_ms_sum / 1000.0 / cs->sessions : 0.0, cs->wait_ms_max / 1000.0, cs->queued);
+        cmd_log("   time on charger:           avg %.2fs\n", cs->sessions ? cs->charge_ms_sum / 1000.0 / cs->sessions : 0.0);
+    }
+    if (os && shared_mem->config.rsv_lookahead_s > 0) {
+        cmd_log("----------------------------------------\n");
+        cmd_log(" Landing Reservations:        %u requests (look-ahead %d s)\n", os->rsv_requests, shared_mem->config.rsv_lookahead_s);
+        cmd_log("   confirmed / counter / no:  %u / %u / %u\n", os->rsv_result[RSV_CONFIRMED], os->rsv_result[RSV_COUNTERED],
+                os->rsv_result[RSV_REJECTED]);
+        cmd_log("   honored / released:        %u / %u, channel pre-positioned %u times\n",
+                os->rsv_honored, os->rsv_released, os->rsv_prepositions);
+    }
+    if (os && shared_mem->config.autoscale_max_p > 0) {
+        cmd_log("----------------------------------------\n");
+        cmd_log(" Autoscaler:                  %u grows / %u shrinks, P range %d..%d\n",
+                os->as_grows, os->as_shrinks, os->as_p_min, os->as_p_max);
+        uint32_t first = os->as_n > AS_LOG ? os->as_n - AS_LOG : 0;
+        for (uint32_t i = first; i < os->as_n; i++) {
+            const struct AsDecision *d = &os->as_log[i % AS_LOG];
+            cmd_log("   t=%6.1fs P %d -> %d (N %d): queue %.1f, wait %.2fs, deaths %u, ch %.0f%%, hangar %.0f%%\n",
+                    d->t, d->p_from, d->p_to, d->n_to, d->depth, d->wait, d->deaths, d->util * 100.0, d->occ * 100.0);
+        }
+    }
+    const struct OpCheckpoint *cp = shared_mem ? &shared_mem->checkpoint : NULL;
+    if (cp && cp->recoveries > 0) {
+        cmd_log("----------------------------------------\n");
+        cmd_log(" Operator Recoveries:         %d\n", cp->recoveries);
+        cmd_log("   last / max recovery:       %.1fms / %.1fms\n", cp->last_recovery_ms, cp->max_recovery_ms);
+    }
     cmd_log("========================================" C_RESET "\n");
+
+    // Raport strukturalny (JSON) - do porównywania przebiegów między buildami
+    if (report_path) {
+        FILE *jf = fopen(report_path, "w");
+        if (!jf) { perror("[Commander] fopen report"); return -1; }
+        fprintf(jf, "{\"P\": %d, \"N\": %d, \"seed\": %u, \"charge_s\": %d, \"sample_ms\": %d, \"duration_s\": %.3f, "
+                    "\"landings\": %llu, \"takeoffs\": %llu, \"deaths\": %llu, \"spawns\": %llu, \"blocked\": %llu, "
+                    "\"landings_per_min\": %.2f, \"drone_exits\": %d, \"drone_exit_errors\": %d, \"drone_signaled\": %d, "
+                    "\"operator_recoveries\": %d, \"recovery_ms_max\": %.3f, "
+                    "\"op_batch\": %d, \"op_msgs\": %llu, \"op_avg_batch\": %.2f, \"op_max_batch\": %u, \"op_us_per_msg\": %.3f, "
+                    "\"queue_limit_bytes\": %llu, \"queue_max_bytes\": %llu, \"queue_max_msgs\": %llu, "
+                    "\"queue_saturations\": %u, \"grants_deferred\": %llu, "
+                    "\"land_wait_avg_s\": %.3f, \"land_wait_max_s\": %.3f, \"deaths_waiting\": %u, "
+                    "\"autoscale_max_p\": %d, \"as_grows\": %u, \"as_shrinks\": %u, \"as_p_min\": %d, \"as_p_max\": %d, "
+                    "\"op_cpu\": %d, \"op_policy\": %d, \"op_prio\": %d, "
+                    "\"op_threads\": %d, \"spawn_ms_max\": %.3f, \"grant_lat_ms_avg\": %.3f, \"grant_lat_ms_max\": %.3f, "
+                    "\"grant_lat_fork_ms_avg\": %.3f, \"grant_lat_fork_ms_max\": %.3f, \"log_dropped\": %llu, "
+                    "\"rsv_lookahead_s\": %d, \"rsv_requests\": %u, \"rsv_confirmed\": %u, \"rsv_countered\": %u, "
+                    "\"rsv_rejected\": %u, \"rsv_honored\": %u, \"rsv_released\": %u, \"rsv_prepositions\": %u, "
+                    "\"chargers\": %d, \"charge_power\": %d, \"landings_per_hour\": %.1f, \"charge_sessions\": %u, "
+                    "\"charge_partial\": %u, \"charge_wait_avg_s\": %.3f, \"charge_wait_max_s\": %.3f, \"charge_time_avg_s\": %.3f, ",
+                P_val, N_val, shared_mem ? shared_mem->config.seed : 0, shared_mem ? shared_mem->config.charge_s : 0,
+                shared_mem ? shared_mem->config.sample_ms : 0, duration,
+                landings, takeoffs, deaths, spawns, blocked,
+                duration > 0 ? landings * 60.0 / duration : 0.0,
+                ds->exited, ds->exit_error, ds->signaled,
+                cp ? cp->recoveries : 0, cp ? cp->max_recovery_ms : 0.0,
+                shared_mem ? shared_mem->config.op_batch : 0, os ? (unsigned long long)os->msgs : 0ULL,
+                op_avg_batch, os ? os->max_batch : 0u, op_us_per_msg,
+                os ? (unsigned long long)os->q_limit_bytes : 0ULL, os ? (unsigned long long)os->q_max_bytes : 0ULL,
+                os ? (unsigned long long)os->q_max_msgs : 0ULL, os ? os->saturations : 0u,
+                os ? (unsigned long long)os->grants_deferred : 0ULL,
+                (os && os->land_waits) ? os->land_wait_sum / os->land_waits : 0.0, os ? os->land_wait_max : 0.0,
+                os ? os->deaths_waiting : 0u, shared_mem ? shared_mem->config.autoscale_max_p : 0,
+                os ? os->as_grows : 0u, os ? os->as_shrinks : 0u, os ? os->as_p_min : 0, os ? os->as_p_max : 0,
+                os ? os->op_cpu : -1, os ? os->op_policy : 0, os ? os->op_prio : 0,
+                os ? os->op_threads : 0, os ? os->spawn_ms_max : 0.0,
+                os && os->glat_n[0] ? os->glat_sum[0] / os->glat_n[0] : 0.0, os ? os->glat_max[0] : 0.0,
+                os && os->glat_n[1] ? os->glat_sum[1] / os->glat_n[1] : 0.0, os ? os->glat_max[1] : 0.0,
+                os ? (unsigned long long)os->log_dropped : 0ULL,
+                shared_mem ? shared_mem->config.rsv_lookahead_s : 0, os ? os->rsv_requests : 0u,
+                os ? os->rsv_result[RSV_CONFIRMED] : 0u, os ? os->rsv_result[RSV_COUNTERED] : 0u,
+                os ? os->rsv_result[RSV_REJECTED] : 0u, os ? os->rsv_honored : 0u, os ? os->rsv_released : 0u,
+                os ? os->rsv_prepositions : 0u,
+                shared_mem ? shared_mem->config.chargers : 0, shared_mem ? shared_mem->config.charge_power : 0, landings_h,
+                cs ? cs->sessions : 0u, cs ? cs->partial : 0u,
+                cs && cs->sessions ? cs->wait_ms_sum / 1000.0 / cs->sessions : 0.0, cs ? cs->wait_ms_max / 1000.0 : 0.0,
+                cs && cs->sessions ? cs->charge_ms_sum / 1000.0 / cs->sessions : 0.0);
+        // Zużycie zasobów jako płaskie pola usage_<klasa>_* (sweep zbiera tylko liczby z najwyższego poziomu)
+        for (int k = 0; shared_mem && k < USAGE_CLASSES; k++) {
+            const struct UsageClass *c = &shared_mem->usage[k];
+            const char *u = usage_names[k];
+            fprintf(jf, "\"usage_%s_n\": %u, \"usage_%s_cpu_user_s\": %.3f, \"usage_%s_cpu_sys_s\": %.3f, "
+                        "\"usage_%s_cpu_ms_p50\": %.3f, \"usage_%s_cpu_ms_p90\": %.3f, \"usage_%s_cpu_ms_max\": %.3f, "
+                        "\"usage_%s_vcsw\": %llu, \"usage_%s_ivcsw\": %llu, \"usage_%s_rss_kb_avg\": %llu, \"usage_%s_rss_kb_max\": %llu, "
+                        "\"usage_%s_minflt\": %llu, \"usage_%s_majflt\": %llu, \"usage_%s_syscr\": %llu, \"usage_%s_syscw\": %llu, ",
+                    u, c->n, u, c->utime_us / 1e6, u, c->stime_us / 1e6,
+                    u, usage_pct(c->cpu_hist, c->n, 50, c->cpu_us_max) / 1000.0, u, usage_pct(c->cpu_hist, c->n, 90, c->cpu_us_max) / 1000.0, u, c->cpu_us_max / 1000.0,
+                    u, (unsigned long long)c->nvcsw, u, (unsigned long long)c->nivcsw,
+                    u, c->n ? (unsigned long long)(c->maxrss_kb / c->n) : 0ULL, u, (unsigned long long)c->rss_kb_max,
+                    u, (unsigned long long)c->minflt, u, (unsigned long long)c->majflt,
+                    u, (unsigned long long)c->syscr, u, (unsigned long long)c->syscw);
+        }
+        fprintf(jf, "\"usage_commander_cpu_s\": %.3f, \"usage_commander_rss_kb\": %ld, \"as_decisions\": [", self_cpu, self_ru.ru_maxrss);
+        if (os) {
+            uint32_t first = os->as_n > AS_LOG ? os->as_n - AS_LOG : 0;
+            for (uint32_t i = first; i < os->as_n; i++) {
+                const struct AsDecision *d = &os->as_log[i % AS_LOG];
+                fprintf(jf, "%s{\"t\": %.1f, \"p_from\": %d, \"p_to\": %d, \"n_to\": %d, \"queue\": %.2f, \"wait_s\": %.3f, "
+                            "\"deaths\": %u, \"channel_util\": %.3f, \"hangar_occ\": %.3f}",
+                        i > first ? ", " : "", d->t, d->p_from, d->p_to, d->n_to, d->depth, d->wait, d->deaths, d->util, d->occ);
+            }
+        }
+        fprintf(jf, "]}\n");
+        fclose(jf);
+        cmd_log("[Commander] Report written to %s\n", report_path);
+    }
+    return 0;
+}
+
+// --- NADZÓR PROCESÓW ---
+
+// Reakcja na zakończenie procesu potomnego (wywoływana przez nadzorcę po zebraniu)
+void on_child_exit(const struct SupChild *c, int code, int status) {
+    if (c->kind == SUP_OPERATOR) {
+        op_handle = -1;
+        if (!shutting_down) {
+            cmd_log(C_RED "[Commander] Operator died unexpectedly! (%s %d)" C_RESET "\n",
+                    code == CLD_EXITED ? "exit" : "signal", status);
+            // Kolejka, semafory i punkt kontrolny w pamięci dzielonej przetrwały - wznawiamy Operatora
+            if (op_restarts < OP_MAX_RESTARTS && shared_mem != NULL) {
+                shared_mem->checkpoint.t_crash = mono_time();
+                op_restart_pending = 1;
+            } else {
+                stop_requested = 1; // Wymuszenie zatrzymania symulacji
+            }
+        }
+    }
+}
+
+// Uruchomienie Operatora (recover=1: następca wznawia pracę z punktu kontrolnego)
+pid_t launch_operator(int P, int N, int recover) {
+    pid_t pid = fork(); // Utworzenie nowego procesu (dziecka)
+    if (pid == -1) { perror("fork operator"); return -1; } // Błąd fork
+    if (pid == 0) { // Kod wykonywany tylko w procesie dziecka (Operator)
+        // Operator zakłada grupę procesów roju (drony do niej dołączą).
+        // Następca dołącza do istniejącej grupy, jeśli żyje w niej jeszcze jakiś dron.
+        if (swarm_pgid <= 0 || setpgid(0, swarm_pgid) == -1) setpgid(0, 0);
+        char argP[16], argN[16];
+        snprintf(argP, sizeof(argP), "%d", P); // Konwersja P na string
+        snprintf(argN, sizeof(argN), "%d", N); // Konwersja N na string
+        // execl podmienia obraz procesu na program "operator". Przekazujemy argumenty.
+        char path[PATH_MAX];
+        swarm_bin("operator", path, sizeof(path));
+        if (recover) execl(path, "operator", "-r", argP, argN, NULL);
+        else execl(path, "operator", argP, argN, NULL);
+        perror("execl operator"); // To wykona się tylko, jeśli execl zawiedzie
+        exit(1); // Zabicie procesu dziecka w przypadku błędu
+    }
+    // setpgid również u rodzica - eliminuje wyścig z dronami dołączającymi do grupy
+    if (swarm_pgid <= 0 || setpgid(pid, swarm_pgid) == -1) setpgid(pid, pid);
+    pid_t pg = getpgid(pid);
+    if (pg > 0) swarm_pgid = pg;
+    op_handle = sup_watch(pid, SUP_OPERATOR, -1);
+    return pid;
+}
+
+// Wznowienie Operatora po awarii (wywoływane z pętli głównej, poza callbackiem nadzorcy)
+void restart_operator() {
+    op_restart_pending = 0;
+    op_restarts++;
+    cmd_log(C_YELLOW "[Commander] Restarting Operator from checkpoint (%d/%d)..." C_RESET "\n", op_restarts, OP_MAX_RESTARTS);
+    op_pid = launch_operator(P_val, N_val, 1);
+    if (op_pid == -1) stop_requested = 1;
+}
+
+// Rejestracja w nadzorcy dronów, które pojawiły się w pamięci dzielonej (Replenish Operatora).
+// Drony Operatora są naszymi dziećmi (fork_sibling), więc ich PID nie może być użyty ponownie
+// przed zebraniem - sup_watch odrzuci każdy PID, który nie jest naszym dzieckiem.
+void sync_children() {
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        pid_t pid = shared_mem->drone_pids[i];
+        if (pid <= 0) continue;
+        int h = sup_find_drone(i);
+        if (h != -1 && sup_pid(h) == pid) continue;
+        sup_watch(pid, SUP_DRONE, i);
+    }
+}
+
+// --- KOMENDY STERUJĄCE (wspólne dla klawiatury i scenariusza) ---
+
+// Sygnał 1 - rozkaz powiększenia bazy
+void cmd_grow() {
+    cmd_log(C_MAGENTA "[Commander] Sending SIGUSR1 (Grow)..." C_RESET "\n");
+    // Wysłanie sygnału SIGUSR1 do Operatora (rozkaz ekspansji) przez pidfd
+    if (sup_signal(op_handle, SIGUSR1) == -1) perror("pidfd_send_signal USR1");
+}
+
+// Sygnał 2 - rozkaz zmniejszenia bazy
+void cmd_shrink() {
+    cmd_log(C_MAGENTA "[Commander] Sending SIGUSR2 (Shrink)..." C_RESET "\n");
+    // Wysłanie sygnału SIGUSR2 do Operatora (rozkaz redukcji) przez pidfd
+    if (sup_signal(op_handle, SIGUSR2) == -1) perror("pidfd_send_signal USR2");
+}
+
+// Sygnał 3 - atak na drona o danym logicznym ID
+void cmd_attack(int target_id) {
+    if (target_id < 0 || target_id >= MAX_DRONE_ID) return;
+    sync_children(); // Dron mógł właśnie powstać (Replenish) - rejestrujemy go przed celowaniem
+    // Uchwyt pidfd drona: sygnał trafi w ten konkretny proces, nawet jeśli PID z pamięci jest nieaktualny
+    int h = sup_find_drone(target_id);
+    if (h != -1) {
+        cmd_log(C_RED "[Commander] Targeting Drone %d (PID %d). Sending SIGUSR1..." C_RESET "\n", target_id, sup_pid(h));
+        // Wysłanie sygnału SIGUSR1 bezpośrednio do drona (rozkaz kamikaze)
+        if (sup_signal(h, SIGUSR1) == -1) perror("pidfd_send_signal USR1 drone");
+    } else {
+        cmd_log("[Commander] Drone %d not active.\n", target_id);
+    }
+}
+
+// Stan floty ze slotów telemetrii (jedno przejście, bez wiadomości do dronów) - także przy dołączaniu
+static void fleet_line(char *out, size_t len) {
+    struct FleetSummary fs;
+    tm_fleet(shared_mem->telemetry, MAX_DRONE_ID, mono_time(), &fs);
+    snprintf(out, len, "Fleet: %d alive, %d inside | flying %d, queued %d, in %d, parked %d, charging %d, "
+             "wait_takeoff %d, out %d | battery min %.1f%% avg %.1f%% | kamikaze %d | oldest update %.1fs",
+             fs.alive, fs.inside, fs.by_phase[TM_FLYING], fs.by_phase[TM_QUEUED], fs.by_phase[TM_CROSS_IN],
+             fs.by_phase[TM_PARKED], fs.by_phase[TM_CHARGING], fs.by_phase[TM_WAIT_TAKEOFF], fs.by_phase[TM_CROSS_OUT],
+             fs.battery_min, fs.battery_avg, fs.kamikaze, fs.oldest_update_s);
+}
+
+// Klawisz '4' - podgląd floty
+void cmd_fleet() {
+    char line[CTL_REPLY];
+    fleet_line(line, sizeof(line));
+    cmd_log(C_BLUE "[Commander] %s" C_RESET "\n", line);
+}
+
+// Zmiana P o 'delta' (gniazdo sterujące): zlecenie w pamięci dzielonej + wybudzenie Operatora.
+// Zlecenia się sumują, więc sklejenie dwóch sygnałów przez jądro niczego nie gubi.
+void cmd_resize(int delta) {
+    __atomic_fetch_add(&shared_mem->ctl_resize, delta, __ATOMIC_SEQ_CST);
+    if (sup_signal_value(op_handle, SIGUSR1, CTL_WAKE) == -1) perror("pidfd_send_signal resize");
+}
+
+// Migawka stanu do odpowiedzi 'stats' (stan Operatora z ostatniego punktu kontrolnego)
+void ctl_stats(char *out, size_t len) {
+    const struct OpCheckpoint *cp = &shared_mem->checkpoint;
+    uint32_t seq = __atomic_load_n(&cp->seq, __ATOMIC_ACQUIRE);
+    const struct OperatorState *os = &cp->slot[seq % 2];
+    const struct OpStats *ops = &shared_mem->op_stats;
+    struct FleetSummary fs;
+    tm_fleet(shared_mem->telemetry, MAX_DRONE_ID, mono_time(), &fs);
+    snprintf(out, len, "OK stats t=%.1f P=%d N=%d active=%d occupied=%d pending_removal=%d "
+             "queue_land=%d queue_takeoff=%d alive=%d inside=%d flying=%d queued=%d charging=%d "
+             "battery_min=%.1f battery_avg=%.1f msgs=%llu grants=%llu land_wait_avg=%.3f deaths_waiting=%u",
+             mono_time() - start_time, seq ? os->current_P : P_val, seq ? os->target_N : N_val,
+             seq ? os->current_active : 0, seq ? os->occupied : 0, seq ? os->pending_removal : 0,
+             seq ? (os->q_tail[0] - os->q_head[0] + WAITQ_CAP) % WAITQ_CAP : 0,
+             seq ? (os->q_tail[1] - os->q_head[1] + WAITQ_CAP) % WAITQ_CAP : 0,
+             fs.alive, fs.inside, fs.by_phase[TM_FLYING], fs.by_phase[TM_QUEUED], fs.by_phase[TM_CHARGING],
+             fs.battery_min, fs.battery_avg, (unsigned long long)ops->msgs, (unsigned long long)ops->grants,
+             ops->land_waits ? ops->land_wait_sum / ops->land_waits : 0.0, ops->deaths_waiting);
+}
+
+// Raport na żądanie ('report'): rój pracuje dalej, JSON trafia do 'path' (względnie do katalogu sesji)
+static void ctl_report(char *reply, size_t len, const char *path) {
+    const char *saved = report_path;
+    if (path[0]) report_path = path;
+    else if (!report_path) report_path = "report.json";
+    char dir[SESSION_DIR_MAX + 1] = "";
+    if (report_path[0] != '/' && getcwd(dir, SESSION_DIR_MAX)) strcat(dir, "/");
+    if (generate_report(0) == 0)
+        snprintf(reply, len, "OK report %s%s", dir, report_path);
+    else
+        snprintf(reply, len, "ERR report: cannot write '%.200s'", report_path);
+    report_path = saved;
+}
+
+// Partia komend z gniazda sterującego: rozbiór całej partii, potem jedno wykonanie -
+// jedna zmiana P (suma) i jeden sygnał na drona (cele bez powtórzeń)
+void on_ctl_batch(int client, char *lines, int len) {
+    struct CtlBatch *b = &ctl_batch;
+    sync_children(); // Drony z Replenish muszą być znane, zanim policzymy cele
+    uint8_t alive[MAX_DRONE_ID];
+    for (int i = 0; i < MAX_DRONE_ID; i++) alive[i] = shared_mem->drone_pids[i] > 0;
+    ctl_parse(lines, len, alive, shared_mem->telemetry, b);
+
+    if (b->resize != 0) cmd_resize(b->resize);
+    int sent = 0;
+    for (int i = 0; i < MAX_DRONE_ID && b->n_targets > 0; i++) {
+        if (!b->target[i]) continue;
+        int h = sup_find_drone(i);
+        if (h != -1 && sup_signal(h, SIGUSR1) == 0) sent++;
+    }
+    if (b->resize != 0 || b->n_targets > 0)
+        cmd_log(C_MAGENTA "[Commander] Control batch: %d commands, resize %+d, attacked %d/%d drones." C_RESET "\n",
+                b->n_cmds, b->resize, sent, b->n_targets);
+    if (b->signal[0]) cmd_grow();
+    if (b->signal[1]) cmd_shrink();
+    if (b->report) ctl_report(b->reply[b->report - 1], sizeof(b->reply[0]), b->report_path);
+    if (b->stop) {
+        cmd_log(C_MAGENTA "[Commander] Stop requested over the control socket." C_RESET "\n");
+        stop_requested = 1;
+    }
+
+    // Odpowiedzi w kolejności komend, wysłane jednym zapisem
+    static char out[CTL_MAX_CMDS * (CTL_REPLY + 1)];
+    size_t off = 0;
+    for (int k = 0; k < b->n_cmds + b->overflow; k++) {
+        const char *r = "ERR batch too large"; // Komendy ponad CTL_MAX_CMDS (zawsze ostatnie w partii)
+        if (k < b->n_cmds) {
+            if (b->reply[k][0] == '\0') ctl_stats(b->reply[k], sizeof(b->reply[k]));
+            r = b->reply[k];
+        }
+        if (off + strlen(r) + 2 > sizeof(out)) { ctl_send(client, out); off = 0; }
+        off += snprintf(out + off, sizeof(out) - off, "%s\n", r);
+    }
+    if (off > 0) ctl_send(client, out);
+}
+
+// Atak na 'count' losowych aktywnych dronów (losowanie bez powtórzeń, Fisher-Yates)
+void cmd_attack_random(int count) {
+    int active[MAX_DRONE_ID];
+    int n = 0;
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        if (shared_mem->drone_pids[i] > 0) active[n++] = i;
+    }
+    if (count > n) count = n;
+    for (int k = 0; k < count; k++) {
+        int j = k + rand() % (n - k);
+        int tmp = active[k]; active[k] = active[j]; active[j] = tmp;
+        cmd_attack(active[k]);
+    }
+}
+
+// Wykonanie kroków scenariusza, których czas już nadszedł
+void scenario_tick() {
+    double now = mono_time();
+    while (sc_next < scenario.n_steps && now >= sc_due) {
+        struct ScenarioStep *st = &scenario.steps[sc_next++];
+        TRACE_BEGIN(TR_SCENARIO);
+        switch (st->action) {
+            case SC_GROW:   cmd_grow(); break;
+            case SC_SHRINK: cmd_shrink(); break;
+            case SC_ATTACK:
+                for (int i = 0; i < st->n_ids; i++) cmd_attack(st->ids[i]);
+                break;
+            case SC_ATTACK_RANDOM:
+                cmd_attack_random((int)st->value);
+                break;
+            case SC_KILL_FRACTION:
+                {
+                    int alive = 0;
+                    for (int i = 0; i < MAX_DRONE_ID; i++) if (shared_mem->drone_pids[i] > 0) alive++;
+                    int count = (int)(alive * st->value + 0.5);
+                    cmd_log(C_RED "[Commander] Scenario: attacking %d of %d active drones." C_RESET "\n", count, alive);
+                    cmd_attack_random(count);
+                }
+                break;
+            case SC_WAIT:
+                sc_due = now + st->value; // Kolejne kroki dopiero po upływie czasu
+                break;
+        }
+        TRACE_END(TR_SCENARIO, st->action);
+    }
+    // Koniec osi czasu = koniec symulacji
+    if (sc_next >= scenario.n_steps && now >= sc_due) {
+        cmd_log(C_BLUE "[Commander] Scenario finished." C_RESET "\n");
+        stop_requested = 1;
+    }
+}
+
+// --- SESJA ODŁĄCZONA ---
+
+// Przejście w tryb odłączony: stdin i ekran na /dev/null, błędy (perror) do commander.txt.
+// Rój, nadzór pidfd i gniazdo sterujące działają dalej; sterowanie przejmuje commander -a.
+static void go_detached(void) {
+    fflush(stdout);
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd != -1) {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        if (null_fd > STDERR_FILENO) close(null_fd);
+    }
+    int log_fd = open("commander.txt", O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log_fd != -1) {
+        dup2(log_fd, STDERR_FILENO);
+        close(log_fd);
+    }
+    detached = 1;
+    await_target = 0;
+    if (shared_mem) shared_mem->session.detached = 1;
+}
+
+// --- DOŁĄCZANIE DO SESJI (-a) ---
+// Commander bez własnego roju: segment pamięci tylko do odczytu (zapis skończyłby się SIGSEGV,
+// więc rojowi nic nie grozi), pidfd Commandera sesji (jego koniec budzi select) i klient gniazda
+// sterującego. Nic nie jest uruchamiane ani sygnalizowane - dołączenie i odłączenie są natychmiastowe.
+
+static int attach_send(int sock, const char *text) {
+    if (sock == -1) {
+        printf(C_YELLOW "[Attach] The session has no control socket - only '4' and 'q' work." C_RESET "\n");
+        return -1;
+    }
+    size_t len = strlen(text), off = 0;
+    while (off < len) {
+        ssize_t n = send(sock, text + off, len - off, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) { perror("[Attach] send"); return -1; }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+// Jedna linia z klawiatury: klawisze jak w Commanderze, reszta idzie wprost do gniazda
+static void attach_line(char *line, int sock) {
+    size_t n = strlen(line);
+    while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r' || line[n - 1] == ' ')) line[--n] = '\0';
+    char cmd[CTL_BUF];
+    int target_id;
+    if (await_target) {
+        await_target = 0;
+        if (sscanf(line, "%d", &target_id) == 1) {
+            snprintf(cmd, sizeof(cmd), "attack %d\n", target_id);
+            attach_send(sock, cmd);
+        }
+        return;
+    }
+    if (n == 0) return;
+    if (strcmp(line, "q") == 0 || strcmp(line, "detach") == 0) {
+        stop_requested = 1;
+    } else if (line[0] == '1') {
+        attach_send(sock, "signal 1\n");
+    } else if (line[0] == '2') {
+        attach_send(sock, "signal 2\n");
+    } else if (line[0] == '4') {
+        char fleet[CTL_REPLY];
+        fleet_line(fleet, sizeof(fleet));
+        printf(C_BLUE "[Attach] %s" C_RESET "\n", fleet);
+    } else if (line[0] == '3') {
+        if (sscanf(line + 1, "%d", &target_id) == 1) {
+            snprintf(cmd, sizeof(cmd), "attack %d\n", target_id);
+            attach_send(sock, cmd);
+        } else {
+            printf("\n" C_RED "[Attach] ENTER TARGET DRONE ID: " C_RESET);
+            await_target = 1;
+        }
+    } else {
+        snprintf(cmd, sizeof(cmd), "%s\n", line);
+        attach_send(sock, cmd);
+    }
+    fflush(stdout);
+}
+
+// sock_given: -U podane przy dołączaniu (sock_path NULL = bez gniazda, tylko podgląd)
+static int attach_session(int sock_given, const char *sock_path) {
+    int id = shmget(ipc_key(IPC_KEY_SHM), 0, 0);
+    if (id == -1) {
+        if (errno == ENOENT) fprintf(stderr, C_RED "Error: no swarm is running with these IPC keys.\n" C_RESET);
+        else perror("shmget");
+        return 1;
+    }
+    shared_mem = (struct SharedState *)shmat(id, NULL, SHM_RDONLY);
+    if (shared_mem == (void *)-1) { perror("shmat"); return 1; }
+    const struct SessionInfo *si = &shared_mem->session;
+    int pfd = sup_pidfd(si->commander_pid);
+    if (pfd == -1) {
+        fprintf(stderr, C_RED "Error: the commander of this swarm (PID %d) is gone - clean up with sweep.\n" C_RESET,
+                si->commander_pid);
+        shmdt(shared_mem);
+        return 1;
+    }
+
+    int sock = -1;
+    if (sock_given) {
+        if (sock_path) sock = ctl_connect(sock_path);
+    } else if (si->ctl_path[0]) {
+        // Ścieżka gniazda jest względna wobec katalogu sesji
+        if (si->ctl_path[0] != '/' && chdir(si->dir) == -1) perror("chdir session dir");
+        else sock = ctl_connect(si->ctl_path);
+    }
+
+    printf(C_GREEN "[Attach] Session PID %d%s, up %.0fs, dir %s" C_RESET "\n", si->commander_pid,
+           si->detached ? " (detached)" : "", mono_time() - si->t_start, si->dir);
+    printf(C_BLUE "[Attach] Keys: '1'=Grow, '2'=Shrink, '3'=Attack, '4'=Fleet, 'q' or Ctrl+C=Detach; "
+           "other lines go to the control socket (stats, report [file], stop, help)" C_RESET "\n");
+    if (sock != -1) {
+        attach_send(sock, "stats\n");
+    } else {
+        char fleet[CTL_REPLY];
+        fleet_line(fleet, sizeof(fleet));
+        printf(C_BLUE "[Attach] %s" C_RESET "\n", fleet);
+    }
+
+    signal(SIGINT, sigint_handler); // Ctrl+C odłącza - rój pracuje dalej
+    int stdin_open = 1, ended = 0;
+    while (!stop_requested) {
+        if (!stdin_open && sock == -1) break; // Wejście zamknięte, odpowiedzi odebrane
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(pfd, &fds);
+        int maxfd = pfd;
+        if (stdin_open) FD_SET(STDIN_FILENO, &fds);
+        if (sock != -1) {
+            FD_SET(sock, &fds);
+            if (sock > maxfd) maxfd = sock;
+        }
+        if (select(maxfd + 1, &fds, NULL, NULL, NULL) == -1) {
+            if (errno == EINTR) continue;
+            perror("select");
+            break;
+        }
+        if (sock != -1 && FD_ISSET(sock, &fds)) {
+            char buf[CTL_BUF];
+            ssize_t n = read(sock, buf, sizeof(buf));
+            if (n > 0) {
+                fwrite(buf, 1, (size_t)n, stdout);
+                fflush(stdout);
+            } else if (n == 0 || errno != EINTR) {
+                if (stdin_open) printf(C_YELLOW "[Attach] Control socket closed by the session." C_RESET "\n");
+                close(sock);
+                sock = -1;
+            }
+        }
+        if (FD_ISSET(pfd, &fds)) {
+            printf(C_YELLOW "[Attach] Session ended." C_RESET "\n");
+            ended = 1;
+            break;
+        }
+        if (stdin_open && FD_ISSET(STDIN_FILENO, &fds)) {
+            char buf[CTL_BUF];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf) - 1);
+            if (n <= 0) {
+                // Koniec wejścia (np. komendy z potoku): odbieramy odpowiedzi i kończymy
+                stdin_open = 0;
+                if (sock != -1) shutdown(sock, SHUT_WR);
+                continue;
+            }
+            buf[n] = '\0';
+            char *save;
+            for (char *line = strtok_r(buf, "\n", &save); line && !stop_requested; line = strtok_r(NULL, "\n", &save))
+                attach_line(line, sock);
+        }
+    }
+    if (sock != -1) close(sock);
+    close(pfd);
+    shmdt(shared_mem);
+    if (!ended) printf(C_BLUE "[Attach] Detached - the swarm keeps running." C_RESET "\n");
+    return 0;
 }
 
 int main(int argc, char *argv[]) {
-    // Sprawdzenie liczby argumentw wywoania programu
-    if (argc < 3) {
-        fprintf(stderr, "Usage: %s <P> <N>\n", argv[0]); // Wypisanie instrukcji uycia na wyjcie bdw
-        return 1;       // Zakoczenie programu z kodem bdu
+    // Sprawdzenie liczby argumentów wywołania programu
+    // Opcje: -s <plik> (scenariusz bez TTY), -o <plik> (raport JSON),
+    //        -b <K> (ile wiadomości Operator obsługuje na wybudzenie; 1 = po jednej),
+    //        -T (śledzenie spanów wszystkich procesów do TRACE_FILE),
+    //        -A <max_P> (Operator sam dobiera P w zakresie 1..max_P na podstawie obciążenia),
+    //        -C <s> (czas ładowania drona), -R <katalog> (przebieg pracuje w katalogu: logi, raport, ślad),
+    //        -K <klucz> (własne klucze IPC: klucz, klucz+1, klucz+2; bez -K przy -R - ftok(katalog)),
+    //        -U <ścieżka> (gniazdo sterujące, domyślnie CTL_SOCKET w katalogu przebiegu; "-" = wyłączone),
+    //        -p <cpu> (Operator na własnym rdzeniu; drony domyślnie na pozostałych),
+    //        -d <cpu>|spread[:cpu] (zbiór CPU dronów; spread = każdy dron na jednym CPU zbioru),
+    //        -q nice=<n>|fifo=<prio>|rr=<prio> (priorytet Operatora; bez uprawnień - zastępstwo),
+    //        -i <ms>[:csv|:bin] (szereg czasowy Operatora do samples.csv / samples.bin),
+    //        -M (Operator wielowątkowy: odbiór / planista / fork i logi w osobnych wątkach)
+    //        -D (sesja odłączona: rój pracuje dalej bez terminala, sterowanie przez commander -a)
+    // Dołączenie do działającej sesji: commander -a [-R katalog] [-K klucz] [-U gniazdo|-]
+    const char *scenario_path = NULL;
+    int op_batch = 0;
+    int tracing = 0;
+    int autoscale_max_p = 0;
+    int charge_s = 0;
+    const char *run_dir = NULL;
+    long key_base = 0;
+    const char *ctl_path = CTL_SOCKET;
+    int op_cpu = -1, op_policy = PL_POLICY_DEFAULT, op_prio = 0, placement = 0;
+    uint64_t drone_cpus[PL_CPU_WORDS] = {0};
+    int sample_ms = 0, sample_fmt = TS_CSV;
+    int op_threads = 0;
+    int rsv_lookahead_s = 0;
+    int chargers = 0, charge_power = 0;
+    int detach_session = 0, attach = 0, ctl_given = 0;
+    const char *key_arg = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:o:b:TA:C:R:K:U:p:d:q:i:ML:H:Da")) != -1) {
+        switch (opt) {
+            case 's': scenario_path = optarg; break;
+            case 'o': report_path = optarg; break;
+            case 'b': op_batch = parse_int(optarg, "batch"); if (op_batch == -1) return 1; break;
+            case 'T': tracing = 1; break;
+            case 'A': autoscale_max_p = parse_int(optarg, "max_P"); if (autoscale_max_p <= 0) return 1; break;
+            case 'C': charge_s = parse_int(optarg, "charge_s"); if (charge_s <= 0) return 1; break;
+            case 'R': run_dir = optarg; break;
+            case 'p': {
+                char *end;
+                op_cpu = (int)strtol(optarg, &end, 10);
+                if (end == optarg || *end || op_cpu < 0 || op_cpu >= PL_CPU_WORDS * 64) { fprintf(stderr, "Error: invalid operator CPU.\n"); return 1; }
+                placement |= PL_OP_CPU;
+                break;
+            }
+            case 'd': {
+                const char *list = optarg;
+                if (strncmp(list, "spread", 6) == 0) {
+                    placement |= PL_SPREAD;
+                    list = list[6] == ':' ? list + 7 : NULL;
+                }
+                if (list && pl_parse_cpus(list, drone_cpus) == -1) { fprintf(stderr, "Error: invalid drone CPU list '%s'.\n", list); return 1; }
+                if (list) placement |= PL_DRONES;
+                break;
+            }
+            case 'q':
+                if (pl_parse_policy(optarg, &op_policy, &op_prio) == -1) {
+                    fprintf(stderr, "Error: invalid policy '%s' (nice=-20..19, fifo=1..99, rr=1..99).\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'i': {
+                char *end;
+                sample_ms = (int)strtol(optarg, &end, 10);
+                if (*end == ':' && strcmp(end + 1, "bin") == 0) sample_fmt = TS_BIN;
+                else if (*end == ':' && strcmp(end + 1, "csv") == 0) sample_fmt = TS_CSV;
+                else if (*end != '\0') end = optarg;
+                if (end == optarg || sample_ms < TS_MIN_MS) {
+                    fprintf(stderr, "Error: invalid sample interval '%s' (ms >= %d, optional :csv or :bin).\n", optarg, TS_MIN_MS);
+                    return 1;
+                }
+                break;
+            }
+            case 'M': op_threads = 1; break;
+            case 'D': detach_session = 1; break;
+            case 'a': attach = 1; break;
+            case 'H': {
+                char *end;
+                chargers = (int)strtol(optarg, &end, 10);
+                if (*end == ':') charge_power = (int)strtol(end + 1, &end, 10);
+                if (*end != '\0' || chargers <= 0 || charge_power < 0 || charge_power > chargers) {
+                    fprintf(stderr, "Error: invalid charger pool '%s' (chargers[:power], 0 < power <= chargers).\n", optarg);
+                    return 1;
+                }
+                break;
+            }
+            case 'L':
+                rsv_lookahead_s = parse_int(optarg, "lookahead_s");
+                if (rsv_lookahead_s <= 0 || rsv_lookahead_s > RSV_SLOTS / 2) {
+                    fprintf(stderr, "Error: reservation look-ahead must be 1..%d s.\n", RSV_SLOTS / 2);
+                    return 1;
+                }
+                break;
+            case 'U': ctl_path = strcmp(optarg, "-") == 0 ? NULL : optarg; ctl_given = 1; break;
+            case 'K':
+                key_base = strtol(optarg, NULL, 0);
+                key_arg = optarg;
+                if (key_base <= 0 || key_base > INT_MAX - 2) { fprintf(stderr, "Error: invalid key_base.\n"); return 1; }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s <P> <N> [-s scenario_file] [-o report.json] [-b batch] [-T] [-A max_P] [-C charge_s] [-R run_dir] [-K key_base] [-U socket|-] [-p op_cpu] [-d cpus|spread[:cpus]] [-q nice=n|fifo=p|rr=p] [-i ms[:bin]] [-M] [-L lookahead_s] [-H chargers[:power]] [-D]\n"
+                                "       %s -a [-R run_dir] [-K key_base] [-U socket|-]\n", argv[0], argv[0]);
+                return 1;
+        }
     }
 
-    // 1. Walidacja czy to w ogle liczby (strtol)
-    int P = parse_int(argv[1], "P"); // Parsowanie pierwszego argumentu (pojemno hangaru)
-    int N = parse_int(argv[2], "N"); // Parsowanie drugiego argumentu (liczba dronw)
-    if (P == -1 || N == -1) return 1; // Jeli parsowanie si nie uda, koczymy
+    // Dołączenie do działającej sesji - bez P i N, bez tworzenia czegokolwiek
+    if (attach) {
+        if (key_base > 0) {
+            if (ipc_keys_set((key_t)key_base, (key_t)(key_base + 1), (key_t)(key_base + 2)) == -1) return 1;
+        } else if (run_dir) {
+            if (ipc_keys_from_dir(run_dir) == -1) return 1;
+        }
+        return attach_session(ctl_given, ctl_path);
+    }
+
+    if (argc - optind < 2) {
+        fprintf(stderr, "Usage: %s <P> <N> [-s scenario_file] [-o report.json] [-b batch] [-T] [-A max_P] [-C charge_s] [-R run_dir] [-K key_base] [-U socket|-] [-p op_cpu] [-d cpus|spread[:cpus]] [-q nice=n|fifo=p|rr=p] [-i ms[:bin]] [-M] [-L lookahead_s] [-H chargers[:power]] [-D]\n"
+                        "       %s -a [-R run_dir] [-K key_base] [-U socket|-]\n", argv[0], argv[0]); // Wypisanie instrukcji użycia na wyjście błędów
+        return 1;       // Zakończenie programu z kodem błędu
+    }
+
+    // 1. Walidacja czy to w ogóle liczby (strtol)
+    int P = parse_int(argv[optind], "P"); // Parsowanie pierwszego argumentu (pojemność hangaru)
+    int N = parse_int(argv[optind + 1], "N"); // Parsowanie drugiego argumentu (liczba dronów)
+    if (P == -1 || N == -1) return 1; // Jeśli parsowanie się nie uda, kończymy
 
     // --- WALIDACJA DANYCH ---
-    if (P <= 0 || N <= 0) { // Sprawdzenie czy wartoci s dodatnie
+    if (P <= 0 || N <= 0) { // Sprawdzenie czy wartości są dodatnie
         fprintf(stderr, "Error: P and N must be positive integers.\n");
         return 1;
     }
@@ -129,56 +892,188 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    // Walidacja limitw pamieci wsp3dzielonej w kontekcie tablicy PID-w
+    // Walidacja limitów pamieci wspó3dzielonej w kontekście tablicy PID-ów
     if (N > MAX_DRONE_ID) {
         fprintf(stderr, C_RED "Error: N exceeds MAX_DRONE_ID (%d).\n" C_RESET, MAX_DRONE_ID);
         return 1;
     }
 
-    // Walidacja limitw systemowych (ulimit)
-    struct rlimit limit; // Struktura przechowujca limity zasobw
-    if (getrlimit(RLIMIT_NPROC, &limit) == 0) { // Pobranie limitu liczby procesw dla uytkownika
+    // Autoskaler utrzymuje P < N/2, więc przy dużym P podniesie N do 2P + 1
+    int max_N = (autoscale_max_p > 0 && 2 * autoscale_max_p + 1 > N) ? 2 * autoscale_max_p + 1 : N;
+    if (max_N > MAX_DRONE_ID) {
+        fprintf(stderr, C_RED "Error: max_P=%d would need N=%d > MAX_DRONE_ID (%d).\n" C_RESET, autoscale_max_p, max_N, MAX_DRONE_ID);
+        return 1;
+    }
+
+    // Walidacja limitów systemowych (ulimit)
+    struct rlimit limit; // Struktura przechowująca limity zasobów
+    if (getrlimit(RLIMIT_NPROC, &limit) == 0) { // Pobranie limitu liczby procesów dla użytkownika
         // Liczymy potrzebne procesy: N (drony) + 1 (operator) + 1 (commander - my) + zapas na system
-        int needed = N + 5; 
-        if (needed > (int)limit.rlim_cur) { // Jeli potrzebujemy wicej ni system pozwala
+        int needed = max_N + 5; 
+        if (needed > (int)limit.rlim_cur) { // Jeśli potrzebujemy więcej niż system pozwala
             fprintf(stderr, C_RED "Error: Requested N=%d exceeds system process limit.\n", N);
             fprintf(stderr, "Your limit is %lu. Try a smaller N.\n" C_RESET, (unsigned long)limit.rlim_cur);
             return 1;
         }
     }
 
-    N_val = N; // Przypisanie liczby dronw do zmiennej globalnej
+    // Rozmieszczenie na CPU: bez jawnego zbioru drony dostają wszystko poza rdzeniem Operatora
+    if (placement) {
+        uint64_t online[PL_CPU_WORDS];
+        int n_online = pl_mask_online(online);
+        if ((placement & PL_OP_CPU) && n_online > 0 && !(online[op_cpu / 64] & (1ULL << (op_cpu % 64)))) {
+            fprintf(stderr, C_RED "Error: operator CPU %d is not available to this process.\n" C_RESET, op_cpu);
+            return 1;
+        }
+        if (!(placement & PL_DRONES)) {
+            memcpy(drone_cpus, online, sizeof(drone_cpus));
+            if (placement & PL_OP_CPU) drone_cpus[op_cpu / 64] &= ~(1ULL << (op_cpu % 64));
+            if (pl_mask_count(drone_cpus) > 0) placement |= PL_DRONES;
+            else fprintf(stderr, C_YELLOW "Warning: only CPU %d available - drones share it with the operator.\n" C_RESET, op_cpu);
+        } else {
+            for (int w = 0; w < PL_CPU_WORDS; w++) drone_cpus[w] &= online[w];
+            if (pl_mask_count(drone_cpus) == 0) { fprintf(stderr, C_RED "Error: none of the drone CPUs is available.\n" C_RESET); return 1; }
+            if ((placement & PL_OP_CPU) && (drone_cpus[op_cpu / 64] & (1ULL << (op_cpu % 64))))
+                fprintf(stderr, C_YELLOW "Warning: drone CPU set includes the operator CPU %d.\n" C_RESET, op_cpu);
+        }
+    }
+
+    N_val = N; // Przypisanie liczby dronów do zmiennej globalnej
+    P_val = P;
+
+    int report_given = report_path != NULL; // -o podane wprost (a nie domyślny raport scenariusza)
+
+    // Wczytanie scenariusza przed startem czegokolwiek (błąd składni = brak symulacji)
+    if (scenario_path) {
+        if (scenario_load(scenario_path, &scenario) == -1) return 1;
+        scenario_mode = 1;
+        if (!report_path) report_path = "report.json"; // Tryb bezobsługowy zawsze zostawia raport
+    }
+
+    // Przestrzeń nazw przebiegu: własny katalog roboczy i własne klucze IPC.
+    // Kilka roju na jednej maszynie nie dzieli wtedy ani plików, ani kolejki/semaforów/pamięci.
+    int namespaced = run_dir != NULL || key_base > 0;
+    if (run_dir) {
+        if (mkdir(run_dir, 0755) == -1 && errno != EEXIST) { perror("mkdir run_dir"); return 1; }
+        // Programy roju zostają tam, gdzie Commander (chyba że wywołujący wskazał inaczej)
+        char exe[PATH_MAX];
+        ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        if (!getenv(SWARM_BIN_ENV) && len > 0) {
+            exe[len] = '\0';
+            char *slash = strrchr(exe, '/');
+            if (slash) *slash = '\0';
+            setenv(SWARM_BIN_ENV, exe, 1);
+        }
+        // Ścieżka raportu podana przez użytkownika jest względna wobec miejsca wywołania
+        static char report_abs[2 * PATH_MAX];
+        char cwd[PATH_MAX];
+        if (report_given && report_path[0] != '/' && getcwd(cwd, sizeof(cwd))) {
+            snprintf(report_abs, sizeof(report_abs), "%s/%s", cwd, report_path);
+            report_path = report_abs;
+        }
+        if (chdir(run_dir) == -1) { perror("chdir run_dir"); return 1; }
+    }
+    if (key_base > 0) {
+        if (ipc_keys_set((key_t)key_base, (key_t)(key_base + 1), (key_t)(key_base + 2)) == -1) return 1;
+    } else if (run_dir) {
+        if (ipc_keys_from_dir(".") == -1) return 1;
+    }
+
+    // Sesja odłączona (-D): Commander przechodzi do nowej sesji, zanim powstanie cokolwiek z roju -
+    // Operator i drony są jego dziećmi jak zwykle (nadzór pidfd, wznawianie Operatora). Rodzic czeka
+    // tylko na gotowość roju i oddaje terminal; błędy startu widać jeszcze na ekranie.
+    int ready_fd = -1;
+    if (detach_session) {
+        int rp[2];
+        if (pipe(rp) == -1) { perror("pipe"); return 1; }
+        // Drony i Operator nie mogą odziedziczyć końca do zapisu - inaczej rodzic nie zobaczy EOF
+        fcntl(rp[0], F_SETFD, FD_CLOEXEC);
+        fcntl(rp[1], F_SETFD, FD_CLOEXEC);
+        pid_t pid = fork();
+        if (pid == -1) { perror("fork session"); return 1; }
+        if (pid > 0) {
+            close(rp[1]);
+            char c;
+            ssize_t r;
+            while ((r = read(rp[0], &c, 1)) == -1 && errno == EINTR);
+            if (r != 1) { fprintf(stderr, C_RED "Error: detached session failed to start (see commander.txt of the run).\n" C_RESET); return 1; }
+            printf(C_GREEN "[Commander] Swarm running as detached session (PID %d)." C_RESET "\n", pid);
+            printf("[Commander] Attach with: %s -a%s%s%s%s\n", argv[0], run_dir ? " -R " : "", run_dir ? run_dir : "",
+                   key_arg ? " -K " : "", key_arg ? key_arg : "");
+            return 0;
+        }
+        close(rp[0]);
+        ready_fd = rp[1];
+        if (setsid() == -1) perror("setsid");
+    }
     
-    // Wyczyszczenie pliku logw commandera na starcie (otwarcie w trybie "w" kasuje zawarto)
+    // Wyczyszczenie pliku logów commandera na starcie (otwarcie w trybie "w" kasuje zawartość)
     FILE *f = fopen("commander.txt", "w"); if(f) fclose(f);
+    // Nowy przebieg = nowy magazyn logów dronów (pierwszy dron utworzy plik)
+    ls_reset(LOG_STORE_FILE);
 
     // Utworzenie Pamieci Dzielonej (do mapowania ID -> PID)
-    // shmget tworzy segment pamici. IPC_CREAT - utwrz jeli nie ma. 0600 - prawa rw dla waciciela.
-    shmid = shmget(SHM_KEY, sizeof(struct SharedState), IPC_CREAT | 0600);
-    if (shmid == -1) { perror("shmget"); return 1; } // Obsuga bdu utworzenia pamici
+    // shmget tworzy segment pamięci. IPC_CREAT - utwórz jeśli nie ma. 0600 - prawa rw dla właściciela.
+    // Przebieg z własnymi kluczami nie może przejąć cudzego roju - klucz zajęty to błąd
+    shmid = shmget(ipc_key(IPC_KEY_SHM), sizeof(struct SharedState), IPC_CREAT | (namespaced ? IPC_EXCL : 0) | 0600);
+    if (shmid == -1 && errno == EEXIST) {
+        fprintf(stderr, C_RED "Error: IPC keys of this run are already in use (another swarm or a crashed run).\n" C_RESET);
+        return 1;
+    }
+    if (shmid == -1) { perror("shmget"); return 1; } // Obsługa błędu utworzenia pamięci
     
-    // shmat docza segment pamici do przestrzeni adresowej tego procesu
+    // shmat dołącza segment pamięci do przestrzeni adresowej tego procesu
     shared_mem = (struct SharedState *)shmat(shmid, NULL, 0);
-    if (shared_mem == (void *)-1) { perror("shmat"); return 1; } // Obsuga bdu doczenia
-    memset(shared_mem, 0, sizeof(struct SharedState)); // Wyzerowanie caej struktury w pamici dzielonej
+    if (shared_mem == (void *)-1) { perror("shmat"); return 1; } // Obsługa błędu dołączenia
+    memset(shared_mem, 0, sizeof(struct SharedState)); // Wyzerowanie całej struktury w pamięci dzielonej
+    shared_mem->config.seed = scenario.seed; // Ziarno dla dronów (0 = losowe)
+    shared_mem->config.op_batch = op_batch;  // 0 = domyślny rozmiar partii Operatora
+    shared_mem->config.autoscale_max_p = autoscale_max_p; // 0 = P zmieniają tylko sygnały
+    shared_mem->config.charge_s = charge_s; // 0 = CONST_CHARGE_TIME drona
+    shared_mem->config.placement = placement;
+    shared_mem->config.sample_ms = sample_ms;
+    shared_mem->config.sample_fmt = sample_fmt;
+    shared_mem->config.op_threads = op_threads;
+    shared_mem->config.rsv_lookahead_s = rsv_lookahead_s;
+    shared_mem->config.chargers = chargers;
+    shared_mem->config.charge_power = charge_power;
+    shared_mem->config.op_cpu = op_cpu;
+    shared_mem->config.op_policy = op_policy;
+    shared_mem->config.op_prio = op_prio;
+    memcpy(shared_mem->config.drone_cpus, drone_cpus, sizeof(drone_cpus));
+    shared_mem->session.commander_pid = getpid();
+    if (!getcwd(shared_mem->session.dir, sizeof(shared_mem->session.dir))) shared_mem->session.dir[0] = '\0';
+    // Plik śladu musi istnieć, zanim pierwszy proces roju zechce w nim pisać
+    if (tracing && trace_create(TRACE_FILE) == 0) {
+        shared_mem->config.trace = 1;
+        trace_open(TRACE_FILE, "commander", -1);
+    }
+    srand(scenario.seed ? scenario.seed : (unsigned int)time(NULL)); // Losowanie celów ataku
     
     cmd_log(C_BLUE "[Commander] Shared Memory created." C_RESET "\n");
 
-    // Rejestracja obsugi sygnau SIGINT (Ctrl+C), aby wywoa funkcj sigint_handler
+    // Rejestracja obsługi sygnału SIGINT (Ctrl+C), aby wywołać funkcję sigint_handler
     signal(SIGINT, sigint_handler);
+    signal(SIGTERM, sigint_handler); // kill <PID sesji> = zwykłe zamknięcie ze sprzątaniem
+    signal(SIGHUP, sighup_handler);
 
-    // Uruchomienie Operatora
-    op_pid = fork(); // Utworzenie nowego procesu (dziecka)
-    if (op_pid == -1) { perror("fork operator"); return 1; } // Bd fork
-    if (op_pid == 0) { // Kod wykonywany tylko w procesie dziecka (Operator)
-        char argP[16], argN[16];
-        snprintf(argP, sizeof(argP), "%d", P); // Konwersja P na string
-        snprintf(argN, sizeof(argN), "%d", N); // Konwersja N na string
-        // execl podmienia obraz procesu na program "operator". Przekazujemy argumenty.
-        execl("./operator", "operator", argP, argN, NULL);
-        perror("execl operator"); // To wykona si tylko, jeli execl zawiedzie
-        exit(1); // Zabicie procesu dziecka w przypadku bdu
+    if (sup_init() == -1) { shmctl(shmid, IPC_RMID, NULL); return 1; }
+    // Gniazdo sterujące (skrypty, panele) - błąd nie przerywa symulacji, zostaje klawiatura
+    if (ctl_path && ctl_open(ctl_path) == 0) {
+        cmd_log(C_BLUE "[Commander] Control socket: %s" C_RESET "\n", ctl_path);
+        snprintf(shared_mem->session.ctl_path, sizeof(shared_mem->session.ctl_path), "%s", ctl_path);
+    } else if (detach_session) {
+        cmd_log(C_YELLOW "[Commander] Detached session without control socket - attach is read-only, stop it with SIGTERM." C_RESET "\n");
     }
+
+    // Sesja odłączona: Operator i drony dziedziczą deskryptory, więc terminal oddajemy przed fork -
+    // inaczej pisałyby na niego (i trzymały otwarty potok wywołującego) przez całą sesję
+    if (ready_fd != -1) go_detached();
+
+    // Uruchomienie Operatora
+    op_pid = launch_operator(P, N, 0);
+    if (op_pid == -1) return 1;
+    shared_mem->swarm_pgid = swarm_pgid; // Dla narzędzi sprzątających po przebiegu (sweep)
     
     cmd_log(C_YELLOW "[Commander] Waiting for Operator to initialize IPC...\n" C_RESET);
     
@@ -186,30 +1081,30 @@ int main(int argc, char *argv[]) {
     int operator_ready = 0;
 
     while (!operator_ready && !stop_requested) {
-        // Prbujemy pobra ID kolejki BEZ flagi IPC_CREAT.
-        // Jeli kolejka nie istnieje, msgget zwrci -1 i errno = ENOENT.
-        int check_msqid = msgget(MSGQ_KEY, 0);
+        // Próbujemy pobrać ID kolejki BEZ flagi IPC_CREAT.
+        // Jeśli kolejka nie istnieje, msgget zwróci -1 i errno = ENOENT.
+        int check_msqid = msgget(ipc_key(IPC_KEY_MSGQ), 0);
 
         if (check_msqid != -1) {
             operator_ready = 1; // Kolejka istnieje.
         } else {
             if (errno == ENOENT) {
-                // Kolejka jeszcze nie istnieje. Czekamy 10ms i prbujemy znowu.
+                // Kolejka jeszcze nie istnieje. Czekamy 10ms i próbujemy znowu.
                 struct timeval tv;
                 tv.tv_sec = 0;
                 tv.tv_usec = 10000; // 10000 us = 10ms
                 select(0, NULL, NULL, NULL, &tv);
                 
-                // Timeout po 2 sekundach (200 * 10ms), eby nie zawiesi si na zawsze
+                // Timeout po 2 sekundach (200 * 10ms), żeby nie zawiesić się na zawsze
                 if (attempts > 200) {
                     fprintf(stderr, C_RED "[Commander] CRITICAL: Operator failed to start IPC (Timeout).\n" C_RESET);
                     kill(op_pid, SIGKILL); // Zabijamy operatora
-                    // Sprztamy pami ktr sami stworzylimy
+                    // Sprzątamy pamięć którą sami stworzyliśmy
                     shmctl(shmid, IPC_RMID, NULL);
                     return 1;
                 }
             } else {
-                // Inny bd krytyczny
+                // Inny błąd krytyczny
                 perror("[Commander] msgget check failed");
                 kill(op_pid, SIGKILL);
                 return 1;
@@ -219,104 +1114,152 @@ int main(int argc, char *argv[]) {
     
     cmd_log(C_BLUE "[Commander] Operator ready. Launching drones...\n" C_RESET);
 
-    // Uruchomienie pocz1tkowych Dronw (Start z powietrza: arg "0")
+    // Uruchomienie pocz1tkowych Dronów (Start z powietrza: arg "0")
     for (int i = 0; i < N; ++i) {
         pid_t pid = fork(); // Utworzenie procesu dla drona
-        if (pid == -1) { perror("fork drone"); break; } // Bd fork
+        if (pid == -1) { perror("fork drone"); break; } // Błąd fork
         if (pid == 0) { // Kod wykonywany w procesie drona
+            setpgid(0, swarm_pgid); // Dołączenie do grupy roju (wspólne zamykanie)
             char idstr[16];
             snprintf(idstr, sizeof(idstr), "%d", i); // Konwersja ID drona na string
             // execl uruchamia program "drone". "0" oznacza start w trybie "powietrze".
-            execl("./drone", "drone", idstr, "0", NULL);
-            perror("execl drone"); // Jeli execl zawiedzie
+            char path[PATH_MAX];
+            execl(swarm_bin("drone", path, sizeof(path)), "drone", idstr, "0", NULL);
+            perror("execl drone"); // Jeśli execl zawiedzie
             exit(1);
         }
-        // Zapisanie PID-u drona w pamici dzielonej (tylko w procesie rodzica - Commandera)
+        setpgid(pid, swarm_pgid);
+        sup_watch(pid, SUP_DRONE, i); // pidfd: natychmiastowe powiadomienie o śmierci drona
+        // Zapisanie PID-u drona w pamięci dzielonej (tylko w procesie rodzica - Commandera)
         if (i < MAX_DRONE_ID) shared_mem->drone_pids[i] = pid;
     }
 
     cmd_log(C_GREEN "[Commander] Launched P=%d, N=%d. Monitoring..." C_RESET "\n", P, N);
-    cmd_log(C_BLUE "[Commander] Commands: '1'=Grow, '2'=Shrink, '3'=Attack, Ctrl+C=Exit" C_RESET "\n");
+    if (scenario_mode) {
+        cmd_log(C_BLUE "[Commander] Headless mode: %d scenario steps, seed %u." C_RESET "\n", scenario.n_steps, scenario.seed);
+    }
+    if (detach_session) {
+        cmd_log(C_BLUE "[Commander] Detached session PID %d: attach with 'commander -a', stop with 'stop' or SIGTERM." C_RESET "\n", getpid());
+    } else if (!scenario_mode) {
+        cmd_log(C_BLUE "[Commander] Commands: '1'=Grow, '2'=Shrink, '3'=Attack, '4'=Fleet, Ctrl+C=Exit" C_RESET "\n");
+    }
+    start_time = mono_time();
+    sc_due = start_time;
+    shared_mem->session.t_start = start_time;
+    if (ready_fd != -1) {
+        // Rój działa - rodzic może oddać terminal
+        if (write(ready_fd, "1", 1) != 1) perror("write ready");
+        close(ready_fd);
+    }
 
-    // G3wna petla steruj1ca (Non-blocking input)
-    // Ptla dziaa dopki flaga stop_requested (ustawiana przez Ctrl+C) wynosi 0
+    // G3ówna petla steruj1ca (Non-blocking input)
+    // Pętla działa dopóki flaga stop_requested (ustawiana przez Ctrl+C) wynosi 0
     while (!stop_requested) {
-        fd_set fds;             // Zbir deskryptorw plikw do monitorowania
+        fd_set fds;             // Zbiór deskryptorów plików do monitorowania
         FD_ZERO(&fds);          // Wyzerowanie zbioru
-        FD_SET(STDIN_FILENO, &fds); // Dodanie standardowego wejcia (klawiatury) do zbioru
-        struct timeval tv = {1, 0}; // Ustawienie czasu oczekiwania (timeout) na 1 sekund
+        FD_SET(sup_fd(), &fds); // Deskryptor epoll nadzorcy - budzi nas śmierć dowolnego procesu roju
+        // W trybie scenariusza nie czytamy klawiatury (brak TTY, np. uruchomienie z crona/CI)
+        if (!scenario_mode && !detached) FD_SET(STDIN_FILENO, &fds); // Dodanie standardowego wejścia (klawiatury) do zbioru
+        struct timeval tv = {1, 0}; // Ustawienie czasu oczekiwania (timeout) na 1 sekundę
+        if (scenario_mode) {
+            // Budzimy się dokładnie na następny krok osi czasu (nie później niż za 1 s)
+            double left = sc_due - mono_time();
+            if (left < 0) left = 0;
+            if (left < 1.0) { tv.tv_sec = 0; tv.tv_usec = (suseconds_t)(left * 1e6); }
+        }
         
-        // select sprawdza, czy na wejciu s dane. Nie blokuje programu na stae (wraca po timeout).
-        int ret = select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv);
+        // select sprawdza, czy na wejściu są dane. Nie blokuje programu na stałe (wraca po timeout).
+        int maxfd = sup_fd() > STDIN_FILENO ? sup_fd() : STDIN_FILENO;
+        fd_set wfds;            // Klienci gniazda sterującego z niewysłanymi odpowiedziami
+        FD_ZERO(&wfds);
+        ctl_fdset(&fds, &wfds, &maxfd);
+        int ret = select(maxfd + 1, &fds, &wfds, NULL, &tv);
+
+        // Zebranie wszystkich zakończonych procesów naraz (nie jednego na sekundę)
+        if (ret > 0 && FD_ISSET(sup_fd(), &fds)) {
+            TRACE_BEGIN(TR_SUP_POLL);
+            int reaped = sup_poll(0, on_child_exit);
+            TRACE_END(TR_SUP_POLL, reaped);
+        }
+        if (hup_received && !detached) {
+            go_detached();
+            cmd_log(C_YELLOW "[Commander] Terminal lost - session detached (PID %d), the swarm keeps running. "
+                    "Attach with 'commander -a'." C_RESET "\n", getpid());
+        }
+        if (op_restart_pending && !stop_requested) restart_operator();
+        sync_children();
+        // Po rejestracji: zombie spoza pamięci dzielonej (dron Operatora, którego PID nie trafił do
+        // tablicy przed jego śmiercią) nie czekają do końca przebiegu
+        int strays = sup_reap_untracked();
+        if (strays > 0) cmd_log(C_YELLOW "[Commander] Reaped %d untracked child process(es)." C_RESET "\n", strays);
+
+        if (scenario_mode) scenario_tick();
+        if (ret > 0) ctl_service(&fds, &wfds, on_ctl_batch);
         
-        // Jeli select zwrci warto > 0 i nasze wejcie jest aktywne
+        // Jeśli select zwrócił wartość > 0 i nasze wejście jest aktywne
         if (ret > 0 && FD_ISSET(STDIN_FILENO, &fds)) {
             char buffer[128];
             // Odczyt danych z klawiatury do bufora
-            int n = read(STDIN_FILENO, buffer, sizeof(buffer));
-            if (n > 0) {
-                if (buffer[0] == '1') { // Klawisz '1' - powikszenie roju
-                    cmd_log(C_MAGENTA "[Commander] Sending SIGUSR1 (Grow)..." C_RESET "\n");
-                    // Wysanie sygnau SIGUSR1 do Operatora (rozkaz ekspansji)
-                    if (kill(op_pid, SIGUSR1) == -1) perror("kill USR1");
+            int n = read(STDIN_FILENO, buffer, sizeof(buffer) - 1);
+            if (n > 0) buffer[n] = '\0';
+            if (n > 0 && await_target) {
+                // Linia po klawiszu '3' - ID celu (bez blokującego scanf, pętla monitorująca działa dalej)
+                await_target = 0;
+                int target_id;
+                if (sscanf(buffer, "%d", &target_id) == 1) cmd_attack(target_id);
+            }
+            else if (n > 0) {
+                if (buffer[0] == '1') { // Klawisz '1' - powiększenie roju
+                    cmd_grow();
                 } 
                 else if (buffer[0] == '2') { // Klawisz '2' - zmniejszenie roju
-                    cmd_log(C_MAGENTA "[Commander] Sending SIGUSR2 (Shrink)..." C_RESET "\n");
-                    // Wysanie sygnau SIGUSR2 do Operatora (rozkaz redukcji)
-                    if (kill(op_pid, SIGUSR2) == -1) perror("kill USR2");
+                    cmd_shrink();
+                }
+                else if (buffer[0] == '4') { // Klawisz '4' - podgląd floty
+                    cmd_fleet();
                 }
                 else if (buffer[0] == '3') { // Klawisz '3' - zniszczenie konkretnego drona
-                    printf("\n" C_RED "[Commander] ENTER TARGET DRONE ID: " C_RESET);
-                    int target_id = -1;
-                    // Pobranie ID drona od uytkownika
-                    if (scanf("%d", &target_id) == 1) {
-                        if (target_id >= 0 && target_id < MAX_DRONE_ID) {
-                            // Pobranie PID drona z pamici dzielonej na podstawie logicznego ID
-                            pid_t target_pid = shared_mem->drone_pids[target_id];
-                            if (target_pid > 0) { // Jeli PID jest prawidowy (dron yje)
-                                cmd_log(C_RED "[Commander] Targeting Drone %d (PID %d). Sending SIGUSR1..." C_RESET "\n", target_id, target_pid);
-                                // Wysanie sygnau SIGUSR1 bezporednio do drona (rozkaz kamikaze)
-                                if (kill(target_pid, SIGUSR1) == -1) perror("kill USR1 drone");
-                            } else {
-                                cmd_log("[Commander] Drone %d not active.\n", target_id);
-                            }
-                        }
+                    int target_id;
+                    if (sscanf(buffer + 1, "%d", &target_id) == 1) { // "3 17" - ID w tej samej linii
+                        cmd_attack(target_id);
+                    } else {
+                        printf("\n" C_RED "[Commander] ENTER TARGET DRONE ID: " C_RESET);
+                        fflush(stdout);
+                        await_target = 1;
                     }
-                    while (getchar() != '\n'); // Wyczyszczenie bufora wejcia z nadmiarowych znakw (np. enter)
                 }
             }
         }
 
-        // Sprawdzenie czy operator ?yje
-        int status;
-        // waitpid z flag WNOHANG sprawdza stan dzieci bez blokowania programu
-        pid_t res = waitpid(-1, &status, WNOHANG);
-        if (res > 0) { // Jeli jaki proces potomny zakoczy dziaanie
-            if (res == op_pid) { // Jeli tym procesem by Operator (awaria krytyczna)
-                cmd_log(C_RED "[Commander] Operator died unexpectedly!" C_RESET "\n");
-                stop_requested = 1; // Wymuszenie zatrzymania symulacji
-            }
-        }
     }
 
     // --- CLEANUP ---
     cmd_log("\n[Commander] Stopping...\n");
 
-    // Ptla wysyajca sygna zakoczenia do wszystkich aktywnych dronw
-    for(int i=0; i<MAX_DRONE_ID; i++) {
-        if (shared_mem->drone_pids[i] > 0) kill(shared_mem->drone_pids[i], SIGINT);
-    }
+    shutting_down = 1;
+    sync_children();
 
-    // Wysanie sygnau zakoczenia (SIGINT) do Operatora, jeli yje
-    if (op_pid > 0) kill(op_pid, SIGINT);
-        
-    // Czekanie a proces Operatora zakoczy sprztanie swoich zasobw
-    waitpid(op_pid, NULL, 0);
+    // Jeden sygnał do całej grupy roju zamiast pętli po 1024 slotach
+    if (swarm_pgid > 0 && kill(-swarm_pgid, SIGINT) == -1 && errno != ESRCH) perror("kill swarm group");
+
+    // Ograniczone czasowo czekanie na zakończenie (Operator sprząta IPC, drony kończą pętle)
+    int left = sup_drain(SHUTDOWN_DRAIN_S, on_child_exit);
+    if (left > 0) {
+        cmd_log(C_RED "[Commander] %d processes still alive after %.0fs. Sending SIGKILL." C_RESET "\n", left, SHUTDOWN_DRAIN_S);
+        kill(-swarm_pgid, SIGKILL);
+        sup_drain(1.0, on_child_exit);
+    }
+    while (waitpid(-1, NULL, WNOHANG) > 0); // Dzieci spoza nadzoru (np. nieudany exec)
+    sup_write_csv("children.csv");
 
-    generate_report(); // Wygenerowanie raportu kocowego z logw
+    generate_report(1); // Wygenerowanie raportu końcowego z logów
 
-    shmdt(shared_mem); // Odczenie segmentu pamici dzielonej od procesu
-    shmctl(shmid, IPC_RMID, NULL); // Oznaczenie segmentu pamici dzielonej do usunicia przez system
+    scenario_free(&scenario);
+    ctl_close();
+    sup_close();
+    shmdt(shared_mem); // Odłączenie segmentu pamięci dzielonej od procesu
+    shmctl(shmid, IPC_RMID, NULL); // Oznaczenie segmentu pamięci dzielonej do usunięcia przez system
+    ipc_remove_all(); // Kolejka i semafory, jeśli Operator zginął, zanim je usunął
     cmd_log("[Commander] Cleanup complete. Bye.\n");
-    return 0; // Wyjcie z programu z kodem sukcesu
+    return 0; // Wyjście z programu z kodem sukcesu
 }
\ No newline at end of file
@@ -0,0 +1,409 @@
+/* src/control.c
+ *
+ * Gniazdo sterujące Commandera: nieblokujący serwer Unix (select w pętli głównej), klient
+ * (commander -a) i rozbiór partii komend. Moduł nie wysyła sygnałów - wykonanie partii należy do Commandera.
+ */
+
+// MUSI BYĆ PIERWSZE! (accept4)
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../include/control.h"
+
+struct CtlClient {
+    int fd;           // -1 = wolne miejsce
+    char buf[CTL_BUF];
+    int len;
+    char *out;        // Odpowiedzi, których gniazdo jeszcze nie przyjęło (EAGAIN) - czekają na gotowość do zapisu
+    size_t out_len, out_cap;
+    int closing;      // Klient zamknął swoją stronę - rozłączamy po wysłaniu reszty odpowiedzi
+};
+
+static int listen_fd = -1;
+static char sock_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static struct CtlClient clients[CTL_MAX_CLIENTS];
+
+int ctl_open(const char *path) {
+    for (int i = 0; i < CTL_MAX_CLIENTS; i++) clients[i].fd = -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) { fprintf(stderr, "[Control] Socket path too long.\n"); return -1; }
+    strcpy(addr.sun_path, path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) { perror("[Control] socket"); return -1; }
+    unlink(path); // Pozostałość po przebiegu, który nie posprzątał
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listen_fd, CTL_MAX_CLIENTS) == -1) {
+        perror("[Control] bind/listen");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    strcpy(sock_path, path);
+    return 0;
+}
+
+void ctl_fdset(fd_set *fds, fd_set *wfds, int *maxfd) {
+    if (listen_fd == -1) return;
+    FD_SET(listen_fd, fds);
+    if (listen_fd > *maxfd) *maxfd = listen_fd;
+    for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+        if (clients[i].fd == -1) continue;
+        if (!clients[i].closing) FD_SET(clients[i].fd, fds);
+        if (clients[i].out_len > 0) FD_SET(clients[i].fd, wfds);
+        if (clients[i].fd > *maxfd) *maxfd = clients[i].fd;
+    }
+}
+
+static void drop_client(int i) {
+    close(clients[i].fd);
+    clients[i].fd = -1;
+    clients[i].len = 0;
+    free(clients[i].out);
+    clients[i].out = NULL;
+    clients[i].out_len = clients[i].out_cap = 0;
+    clients[i].closing = 0;
+}
+
+// Wysłanie bez czekania. Zwraca liczbę przyjętych bajtów albo -1, gdy klient zniknął.
+static ssize_t send_some(int fd, const char *text, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        // MSG_NOSIGNAL: klient, który zamknął gniazdo, nie może zabić Commandera przez SIGPIPE
+        ssize_t n = send(fd, text + off, len - off, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) break; // Bufor gniazda pełny
+        if (n <= 0) return -1;
+        off += (size_t)n;
+    }
+    return (ssize_t)off;
+}
+
+// Dosłanie zaległych odpowiedzi (gniazdo gotowe do zapisu). 0 = klient nadal połączony.
+static int flush_out(int i) {
+    struct CtlClient *c = &clients[i];
+    ssize_t n = send_some(c->fd, c->out, c->out_len);
+    if (n == -1) { drop_client(i); return -1; }
+    memmove(c->out, c->out + n, c->out_len - (size_t)n);
+    c->out_len -= (size_t)n;
+    if (c->out_len == 0 && c->closing) { drop_client(i); return -1; }
+    return 0;
+}
+
+void ctl_service(fd_set *fds, fd_set *wfds, ctl_batch_fn fn) {
+    if (listen_fd == -1) return;
+    if (FD_ISSET(listen_fd, fds)) {
+        int fd;
+        while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+            int i = 0;
+            while (i < CTL_MAX_CLIENTS && clients[i].fd != -1) i++;
+            if (i == CTL_MAX_CLIENTS) {
+                const char *busy = "ERR too many clients\n";
+                if (send(fd, busy, strlen(busy), MSG_NOSIGNAL) < 0) { /* Klient i tak jest rozłączany */ }
+                close(fd);
+                continue;
+            }
+            clients[i].fd = fd;
+            clients[i].len = 0;
+        }
+    }
+    for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+        struct CtlClient *c = &clients[i];
+        if (c->fd != -1 && c->out_len > 0 && FD_ISSET(c->fd, wfds) && flush_out(i) == -1) continue;
+        if (c->fd == -1 || c->closing || !FD_ISSET(c->fd, fds)) continue;
+        // Wszystko, co klient zdążył przysłać - pełne linie tworzą jedną partię
+        ssize_t n;
+        int closed = 0;
+        while ((n = read(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len)) > 0) {
+            c->len += (int)n;
+            if (c->len == (int)sizeof(c->buf) - 1) break; // Bufor pełny - obsłużymy i doczytamy
+        }
+        if (n == 0 || (n == -1 && errno != EAGAIN && errno != EINTR)) closed = 1;
+
+        int end = c->len;
+        while (end > 0 && c->buf[end - 1] != '\n') end--;
+        if (end == 0 && c->len == (int)sizeof(c->buf) - 1) end = c->len; // Linia dłuższa niż bufor
+        if (end == 0 && closed && c->len > 0) end = c->len;              // Ostatnia linia bez '\n'
+        if (end > 0) {
+            char lines[CTL_BUF];
+            memcpy(lines, c->buf, end);
+            lines[end] = '\0';
+            memmove(c->buf, c->buf + end, c->len - end);
+            c->len -= end;
+            fn(i, lines, end);
+        }
+        if (closed) {
+            // Odpowiedzi czekające w buforze wyjściowym jeszcze wyślemy (klient mógł zamknąć tylko zapis)
+            if (c->fd != -1 && c->out_len > 0) c->closing = 1;
+            else if (c->fd != -1) drop_client(i);
+        }
+    }
+}
+
+void ctl_send(int client, const char *text) {
+    if (client < 0 || client >= CTL_MAX_CLIENTS || clients[client].fd == -1) return;
+    struct CtlClient *c = &clients[client];
+    size_t len = strlen(text), off = 0;
+    if (c->out_len == 0) { // Bez zaległości - prosto do gniazda (kolejność odpowiedzi zachowana)
+        ssize_t n = send_some(c->fd, text, len);
+        if (n == -1) { drop_client(client); return; }
+        off = (size_t)n;
+    }
+    if (off == len) return;
+    // Reszta czeka na gotowość gniazda do zapisu (select w pętli Commandera). Klient, który nie
+    // odbiera wcale, nie może jednak zająć dowolnie dużo pamięci.
+    size_t need = c->out_len + (len - off);
+    if (need > CTL_OUT_MAX) { drop_client(client); return; }
+    if (need > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : CTL_BUF;
+        while (cap < need) cap *= 2;
+        char *p = realloc(c->out, cap);
+        if (!p) { drop_client(client); return; }
+        c->out = p;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, text + off, len - off);
+    c->out_len = need;
+}
+
+void ctl_close(void) {
+    for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+        if (clients[i].fd == -1) continue;
+        if (clients[i].out_len > 0) send_some(clients[i].fd, clients[i].out, clients[i].out_len); // Ostatnia próba
+        drop_client(i);
+    }
+    if (listen_fd != -1) {
+        close(listen_fd);
+        unlink(sock_path);
+        listen_fd = -1;
+    }
+}
+
+int ctl_connect(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) { fprintf(stderr, "[Control] Socket path too long.\n"); return -1; }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) { perror("[Control] socket"); return -1; }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        perror("[Control] connect");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// --- ROZBIÓR KOMEND ---
+
+static void add_target(struct CtlBatch *b, int id) {
+    if (id < 0 || id >= MAX_DRONE_ID || b->target[id]) return;
+    b->target[id] = 1;
+    b->n_targets++;
+}
+
+// Warunek predykatu: "battery>50", "cycles>=2", "phase=charging", "inside", "outside"
+static int match_cond(const char *cond, const struct TelemetryView *v, int *bad) {
+    if (strcasecmp(cond, "inside") == 0) return v->location == ST_INSIDE;
+    if (strcasecmp(cond, "outside") == 0) return v->location == ST_OUTSIDE;
+    if (strncasecmp(cond, "phase=", 6) == 0) {
+        for (int p = 0; p < TM_PHASES; p++) if (strcasecmp(cond + 6, tm_phase_names[p]) == 0) return v->phase == p;
+        *bad = 1;
+        return 0;
+    }
+    double field;
+    const char *rest;
+    if (strncasecmp(cond, "battery", 7) == 0) { field = v->battery; rest = cond + 7; }
+    else if (strncasecmp(cond, "cycles", 6) == 0) { field = v->cycles_flown; rest = cond + 6; }
+    else { *bad = 1; return 0; }
+
+    int op; // 0: <, 1: <=, 2: >, 3: >=, 4: =
+    if (rest[0] == '<') op = rest[1] == '=' ? 1 : 0;
+    else if (rest[0] == '>') op = rest[1] == '=' ? 3 : 2;
+    else if (rest[0] == '=') op = 4;
+    else { *bad = 1; return 0; }
+    rest += (op == 1 || op == 3 || (op == 4 && rest[1] == '=')) ? 2 : 1;
+    char *end;
+    double val = strtod(rest, &end);
+    if (end == rest || *end != '\0') { *bad = 1; return 0; }
+    switch (op) {
+        case 0: return field < val;
+        case 1: return field <= val;
+        case 2: return field > val;
+        case 3: return field >= val;
+        default: return field == val;
+    }
+}
+
+// Wybór k losowych aktywnych dronów spoza bieżącego zbioru (Fisher-Yates na liście kandydatów)
+static int pick_random(struct CtlBatch *b, const uint8_t *alive, int k) {
+    int cand[MAX_DRONE_ID], n = 0;
+    for (int i = 0; i < MAX_DRONE_ID; i++) if (alive[i] && !b->target[i]) cand[n++] = i;
+    if (k > n) k = n;
+    for (int j = 0; j < k; j++) {
+        int r = j + rand() % (n - j);
+        int tmp = cand[j]; cand[j] = cand[r]; cand[r] = tmp;
+        add_target(b, cand[j]);
+    }
+    return k;
+}
+
+static void parse_attack(char *args, const uint8_t *alive, const struct TelemetrySlot *slots,
+                         struct CtlBatch *b, char *reply, size_t rlen) {
+    char *save;
+    char *tok = strtok_r(args, " \t", &save);
+    if (!tok) { snprintf(reply, rlen, "ERR attack: missing targets"); return; }
+    int before = b->n_targets;
+
+    if (strcasecmp(tok, "random") == 0 || strcasecmp(tok, "fraction") == 0) {
+        char *arg = strtok_r(NULL, " \t", &save);
+        char *end = NULL;
+        int k;
+        if (tok[0] == 'r' || tok[0] == 'R') {
+            // Liczba dronów: tylko całkowita ("2.7" i "abc" to błąd, nie obcięcie)
+            long v = arg ? strtol(arg, &end, 10) : -1;
+            if (!arg || end == arg || *end != '\0' || v < 0 || v > MAX_DRONE_ID) {
+                snprintf(reply, rlen, "ERR attack %s: bad value", tok);
+                return;
+            }
+            k = (int)v;
+        } else {
+            // Ułamek 0.0 - 1.0 (zapis !(v >= 0 && v <= 1) odrzuca też NaN)
+            double v = arg ? strtod(arg, &end) : -1;
+            if (!arg || end == arg || *end != '\0' || !(v >= 0.0 && v <= 1.0)) {
+                snprintf(reply, rlen, "ERR attack %s: bad value", tok);
+                return;
+            }
+            int active = 0;
+            for (int i = 0; i < MAX_DRONE_ID; i++) active += alive[i];
+            k = (int)(v * active + 0.5);
+        }
+        if (strtok_r(NULL, " \t", &save)) { snprintf(reply, rlen, "ERR attack %s: unexpected argument", tok); return; }
+        pick_random(b, alive, k);
+    } else if (strcasecmp(tok, "where") == 0) {
+        char *conds[16];
+        int nc = 0;
+        for (char *c = strtok_r(NULL, " \t", &save); c; c = strtok_r(NULL, " \t", &save)) {
+            if (strcasecmp(c, "and") == 0) continue;
+            if (nc == 16) { snprintf(reply, rlen, "ERR attack where: too many conditions"); return; }
+            conds[nc++] = c;
+        }
+        if (nc == 0) { snprintf(reply, rlen, "ERR attack where: missing condition"); return; }
+        // Sprawdzenie składni na pustym widoku - błąd ma nie zależeć od tego, czy ktoś żyje
+        struct TelemetryView probe;
+        memset(&probe, 0, sizeof(probe));
+        for (int k = 0; k < nc; k++) {
+            int bad = 0;
+            match_cond(conds[k], &probe, &bad);
+            if (bad) { snprintf(reply, rlen, "ERR attack where: bad condition '%.60s'", conds[k]); return; }
+        }
+        // Jedno przejście po slotach telemetrii
+        for (int i = 0; i < MAX_DRONE_ID; i++) {
+            if (!alive[i]) continue;
+            struct TelemetryView v;
+            if (tm_read(&slots[i], &v) == -1 || v.phase <= TM_EMPTY || v.phase == TM_DEAD) continue;
+            int ok = 1, bad = 0;
+            for (int k = 0; k < nc && ok; k++) ok = match_cond(conds[k], &v, &bad);
+            if (ok) add_target(b, i);
+        }
+    } else {
+        // Lista ID i zakresów: "3,7,10-20" (także rozdzielone spacjami).
+        // Błąd w dowolnym elemencie odrzuca całą komendę - cele dodane wcześniej są wycofywane.
+        int added[MAX_DRONE_ID], n_added = 0;
+        for (; tok; tok = strtok_r(NULL, " \t", &save)) {
+            char *s2, *part;
+            for (part = strtok_r(tok, ",", &s2); part; part = strtok_r(NULL, ",", &s2)) {
+                char *end;
+                long a = strtol(part, &end, 10), z = a;
+                if (*end == '-') z = strtol(end + 1, &end, 10);
+                if (end == part || *end != '\0' || a < 0 || z < a || z >= MAX_DRONE_ID) {
+                    for (int k = 0; k < n_added; k++) b->target[added[k]] = 0;
+                    b->n_targets -= n_added;
+                    snprintf(reply, rlen, "ERR attack: bad id or range '%.40s'", part);
+                    return;
+                }
+                for (long id = a; id <= z; id++) {
+                    if (!alive[id] || b->target[id]) continue;
+                    add_target(b, (int)id);
+                    added[n_added++] = (int)id;
+                }
+            }
+        }
+    }
+    snprintf(reply, rlen, "OK attack %d targets", b->n_targets - before);
+}
+
+static void parse_one(char *cmd, const uint8_t *alive, const struct TelemetrySlot *slots, struct CtlBatch *b) {
+    while (*cmd == ' ' || *cmd == '\t' || *cmd == '\r') cmd++;
+    char *hash = strchr(cmd, '#');
+    if (hash) *hash = '\0';
+    int n = (int)strlen(cmd);
+    while (n > 0 && (cmd[n - 1] == ' ' || cmd[n - 1] == '\t' || cmd[n - 1] == '\r')) cmd[--n] = '\0';
+    if (n == 0) return; // Pusta linia / komentarz - bez odpowiedzi
+    if (b->n_cmds == CTL_MAX_CMDS) { b->overflow++; return; } // Odpowiedź "ERR batch too large" (po pozostałych)
+    char *reply = b->reply[b->n_cmds];
+    size_t rlen = sizeof(b->reply[0]);
+    b->n_cmds++;
+    reply[0] = '\0';
+
+    char *args = cmd;
+    while (*args && *args != ' ' && *args != '\t') args++;
+    if (*args) *args++ = '\0';
+
+    if (strcasecmp(cmd, "grow") == 0 || strcasecmp(cmd, "shrink") == 0) {
+        int k = 1;
+        if (*args) {
+            char *end;
+            long v = strtol(args, &end, 10);
+            while (*end == ' ') end++;
+            if (*end != '\0' || v <= 0 || v > MAX_DRONE_ID) { snprintf(reply, rlen, "ERR %s: bad amount", cmd); return; }
+            k = (int)v;
+        }
+        b->resize += (cmd[0] == 'g' || cmd[0] == 'G') ? k : -k;
+        snprintf(reply, rlen, "OK %s %d", cmd, k);
+    } else if (strcasecmp(cmd, "attack") == 0) {
+        parse_attack(args, alive, slots, b, reply, rlen);
+    } else if (strcasecmp(cmd, "stats") == 0) {
+        b->stats++; // Odpowiedź wypełnia Commander (migawka po wykonaniu partii)
+    } else if (strcasecmp(cmd, "signal") == 0) {
+        if (strcmp(args, "1") != 0 && strcmp(args, "2") != 0) { snprintf(reply, rlen, "ERR signal: expected 1 or 2"); return; }
+        b->signal[args[0] - '1']++;
+        snprintf(reply, rlen, "OK signal %s", args);
+    } else if (strcasecmp(cmd, "report") == 0) {
+        if (strlen(args) >= sizeof(b->report_path)) { snprintf(reply, rlen, "ERR report: path too long"); return; }
+        strcpy(b->report_path, args);
+        b->report = b->n_cmds; // Indeks tej komendy + 1 (n_cmds już zwiększone)
+    } else if (strcasecmp(cmd, "stop") == 0) {
+        b->stop = 1;
+        snprintf(reply, rlen, "OK stopping");
+    } else if (strcasecmp(cmd, "help") == 0) {
+        snprintf(reply, rlen, "OK commands: grow [k], shrink [k], attack <ids|random k|fraction f|where cond...>, stats, "
+                 "signal 1|2, report [file], stop");
+    } else {
+        snprintf(reply, rlen, "ERR unknown command '%.40s'", cmd);
+    }
+}
+
+void ctl_parse(char *lines, int len, const uint8_t *alive, const struct TelemetrySlot *slots, struct CtlBatch *b) {
+    memset(b, 0, sizeof(*b));
+    char *p = lines, *end = lines + len;
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+        if (nl) *nl = '\0';
+        char *save;
+        for (char *cmd = strtok_r(p, ";", &save); cmd; cmd = strtok_r(NULL, ";", &save)) parse_one(cmd, alive, slots, b);
+        if (!nl) break;
+        p = nl + 1;
+    }
+}
@@ -1,57 +1,61 @@
 /* src/drone.c
  *
- * Modu Drona (Symulacja procesu potomnego).
- * Realizuje cykl ycia: Lot -> Kolejka -> Ldowanie -> adowanie -> Start.
- * Obsuguje: Zuycie baterii, Starzenie si (cykle), Sygna Kamikadze.
+ * Moduł Drona (Symulacja procesu potomnego).
+ * Realizuje cykl życia: Lot -> Kolejka -> Lądowanie -> Ładowanie -> Start.
+ * Obsługuje: Zużycie baterii, Starzenie się (cykle), Sygnał Kamikadze.
  */
 
-#include <stdio.h>      // Standardowe wejcie/wyjcie (printf, fopen)
+#include <stdio.h>      // Standardowe wejście/wyjście (printf, fopen)
 #include <stdlib.h>     // Biblioteka standardowa (exit, atoi, rand, srand)
 #include <unistd.h>     // Funkcje systemowe (usleep, sleep, getpid)
-#include <signal.h>     // Obsuga sygnaw (signal, SIGUSR1)
-#include <errno.h>      // Obsuga bdw (zmienna errno, EINTR, ENOMSG)
-#include <time.h>       // Funkcje czasu (time, localtime - do logw i seedowania random)
-#include <stdarg.h>     // Obsuga zmiennej liczby argumentw (va_list)
+#include <signal.h>     // Obsługa sygnałów (signal, SIGUSR1)
+#include <errno.h>      // Obsługa błędów (zmienna errno, EINTR, ENOMSG)
+#include <time.h>       // Funkcje czasu (time, localtime - do logów i seedowania random)
+#include <stdarg.h>     // Obsługa zmiennej liczby argumentów (va_list)
 #include <sys/ipc.h>    // Flagi IPC
-#include <sys/msg.h>    // Kolejki komunikatw (msgsnd, msgrcv)
+#include <sys/msg.h>    // Kolejki komunikatów (msgsnd, msgrcv)
+#include <sys/shm.h>    // Pamięć dzielona (konfiguracja przebiegu)
+#include <sys/sem.h>    // Semafor puli ładowarek (semop z SEM_UNDO)
 
-#include "common.h"     // Wsplne definicje (klucze IPC, typy wiadomoci)
+#include "common.h"     // Wspólne definicje (klucze IPC, typy wiadomości)
 
 #include "../include/common.h"
 #include "../include/ipc_wrapper.h"
+#include "../include/log_store.h"
+#include "../include/trace.h"
 
 // --- PARAMETRY SYMULACJI ---
 #define BATTERY_FULL 100
-#define BATTERY_CRITICAL 20 // Prg, poniej ktrego dron prosi o ldowanie
-#define BATTERY_DEAD 0      // mier baterii
+#define BATTERY_CRITICAL 20 // Próg, poniżej którego dron prosi o lądowanie
+#define BATTERY_DEAD 0      // Śmierć baterii
+#define TAKEOFF_TIMEOUT 60  // Ostrzeżenie, gdy zgoda na start nie przychodzi tak długo (s)
 #define TICK_US 100000      // Krok symulacji (100ms) - co tyle czasu aktualizujemy stan baterii
-#define CONST_CHARGE_TIME 20 // Czas adowania (s) - stay czas spdzony w hangarze
+#define CONST_CHARGE_TIME 20 // Czas ładowania (s) - stały czas spędzony w hangarze
 #define CROSSING_TIME 2     // Czas przelotu przez tunel (s) - symulacja fizycznego ruchu
-#define LIFE_LIMIT 3        // Po ilu cyklach dron idzie na zom (symulacja zuycia sprztu)
-
-// --- STANY LOKALIZACJI ---
-// Potrzebne do handlera sygnau Kamikadze, aby wiedzie czy mona bezpiecznie umrze
-#define ST_OUTSIDE 0 // Dron w powietrzu lub w kolejce przed baz (mona wybuchn)
-#define ST_INSIDE  1 // Dron w bazie lub w tunelu wylotowym (nie mona wybuchn, bo zablokuje zasoby)
+#define LIFE_LIMIT 3        // Po ilu cyklach dron idzie na złom (symulacja zużycia sprzętu)
 
 // --- ZMIENNE GLOBALNE ---
-static int msqid = -1; // ID kolejki komunikatw
+static int msqid = -1; // ID kolejki komunikatów
 static int semid = -1;
-static volatile sig_atomic_t keep_running = 1; // Flaga ptli gwnej (reakcja na Ctrl+C)
-static char log_filename[64]; // Nazwa pliku logw (unikalna dla PID)
+static volatile sig_atomic_t keep_running = 1; // Flaga pętli głównej (reakcja na Ctrl+C)
+static struct LogStore log_store; // Wspólny magazyn logów roju (segmenty tego drona)
+static struct TelemetrySlot *tm_slot = NULL; // Slot telemetrii tego ID w pamięci dzielonej
+static struct SharedState *shm = NULL; // Pamięć dzielona (NULL = niedostępna)
+static int rsv_lookahead_s = 0; // >0 = rezerwacja okna lądowania tyle sekund przed progiem krytycznym
 
-// Stan wewntrzny drona - struktura trzymajca wszystkie parametry yciowe
+// Stan wewnętrzny drona - struktura trzymająca wszystkie parametry życiowe
 typedef struct {
     int id;                 // Logiczne ID drona (nadane przez Commandera/Operatora)
-    double current_battery; // Bateria (typ double dla pynnego odejmowania uamkw %)
-    int T1;                 // Czas w bazie (adowanie)
-    int T2;                 // Max czas lotu (pojemno baku)
+    double current_battery; // Bateria (typ double dla płynnego odejmowania ułamków %)
+    int T1;                 // Czas w bazie (ładowanie)
+    int T2;                 // Max czas lotu (pojemność baku)
     double drain_rate_per_sec; // Jak szybko spada bateria (wyliczane z T2)
-    int cycles_flown;       // Licznik wykonanych przelotw (Start-Ldowanie)
-    int max_cycles;         // Limit cykli ycia
+    int cycles_flown;       // Licznik wykonanych przelotów (Start-Lądowanie)
+    int max_cycles;         // Limit cykli życia
     
-    volatile int location;         // Gdzie jestem? (volatile, bo zmieniane w main, czytane w handlerze)
-    volatile int kamikaze_pending; // Flaga opnionej mierci (ustawiana w handlerze)
+    volatile int location;         // Gdzie jestem? ST_* (volatile, bo zmieniane w main, czytane w handlerze)
+    volatile int phase;            // Faza cyklu życia (TM_*) - do telemetrii
+    volatile int kamikaze_pending; // Flaga opóźnionej śmierci (ustawiana w handlerze)
 } DroneState;
 
 static DroneState drone; // Instancja stanu dla tego procesu
@@ -66,30 +70,53 @@ void dlog(const char *format, ...) {
     vprintf(format, args); // Wypisanie na ekran konsoli (stdout)
     va_end(args);
 
-    FILE *f = fopen(log_filename, "a"); // Otwarcie pliku w trybie dopisywania
-    if (f) {
-        time_t now = time(NULL);
-        struct tm *t = localtime(&now);
-        char timebuf[32];
-        strftime(timebuf, sizeof(timebuf), "%H:%M:%S", t); // Dodanie znacznika czasu
-        fprintf(f, "[%s] ", timebuf);
-        va_start(args, format);
-        vfprintf(f, format, args); // Zapisanie treci do pliku
-        va_end(args);
-        fclose(f);
-    }
+    // Zapis do magazynu (znacznik czasu dodaje ls_append). Blokujemy SIGUSR1 na czas
+    // zapisu, bo handler Kamikadze też loguje - dwa zapisy naraz nadpisałyby segment.
+    char buf[512];
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) return;
+    if (len >= (int)sizeof(buf)) len = sizeof(buf) - 1;
+
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &block, &old);
+    TRACE_BEGIN(TR_LOG_FLUSH);
+    ls_append(&log_store, buf, (size_t)len);
+    TRACE_END(TR_LOG_FLUSH, len);
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+// Publikacja stanu w slocie telemetrii (opcjonalnie ze zmianą fazy, -1 = bez zmiany).
+// Handler Kamikadze też publikuje - blokujemy SIGUSR1, żeby nie zagnieździć dwóch zapisów seqlocka.
+void tm_update(int phase) {
+    if (phase >= 0) drone.phase = phase;
+    if (!tm_slot) return;
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &block, &old);
+    tm_publish(tm_slot, (float)drone.current_battery, drone.location, drone.phase,
+               drone.kamikaze_pending, drone.cycles_flown, mono_time());
+    sigprocmask(SIG_SETMASK, &old, NULL);
 }
 
-// Wysanie komunikatu do Operatora
-// Uatwia wysyanie standardowej struktury msg_req
-int send_msg(long type, int drone_id) {
+// Wysłanie komunikatu do Operatora
+// Ułatwia wysyłanie standardowej struktury msg_req
+int send_msg_arg(long type, int drone_id, int arg) {
     struct msg_req req;
-    req.mtype = type;       // Typ wiadomoci (REQ_LAND, REQ_TAKEOFF, DEAD, itd.)
+    req.mtype = type;       // Typ wiadomości (REQ_LAND, REQ_TAKEOFF, DEAD, itd.)
     req.drone_id = drone_id; // ID nadawcy
-    // msgsnd wysya wiadomo do kolejki. Odejmujemy sizeof(long) od rozmiaru.
-    if (msgsnd(msqid, &req, sizeof(req) - sizeof(long), 0) == -1) {
+    req.arg = arg;          // Parametr (MSG_RESERVE: ms do progu krytycznego)
+    // msgsnd wysyła wiadomość do kolejki. Odejmujemy sizeof(long) od rozmiaru.
+    int rc;
+    // EINTR (np. rozkaz ataku w trakcie pełnej kolejki) - ponawiamy, wiadomość nie mogła zginąć
+    while ((rc = msgsnd(msqid, &req, sizeof(req) - sizeof(long), 0)) == -1 && errno == EINTR && keep_running);
+    if (rc == -1) {
 	if (errno == EINVAL || errno == EIDRM) {
-            // EIDRM = Identifier removed (kolejka usunita)
+            // EIDRM = Identifier removed (kolejka usunięta)
             // EINVAL = Invalid argument (kolejka nie istnieje)
             if (!keep_running) return -1;
 	}
@@ -99,28 +126,141 @@ int send_msg(long type, int drone_id) {
     return 0;
 }
 
-// Procedura mierci (koniec procesu)
-// Wywoywana gdy bateria padnie, dron si zuyje lub dostanie rozkaz Kamikadze
+int send_msg(long type, int drone_id) { return send_msg_arg(type, drone_id, 0); }
+
+// Epoka Operatora (rośnie przy każdym wznowieniu po awarii)
+uint32_t op_epoch() { return shm != NULL ? __atomic_load_n(&shm->checkpoint.epoch, __ATOMIC_ACQUIRE) : 0; }
+
+// Zamiast zgody przyszło GRANT_RESYNC: Operator wznowiony po awarii. Prośbę wysłaną w starszej
+// epoce poprzednik mógł pobrać i zginąć przed zapisem stanu - ponawiamy ją (Operator pomija
+// duplikaty). GRANT_RESYNC z epoki, w której prośbę już wysłaliśmy, jest nieaktualne.
+// Zwraca 1, jeśli wiadomość nie była zgodą.
+int resync(const struct msg_resp *resp, long type, uint32_t *epoch) {
+    if (resp->channel_id != GRANT_RESYNC) return 0;
+    uint32_t now = op_epoch();
+    if (now == *epoch) return 1;
+    *epoch = now;
+    dlog(C_YELLOW "[Drone %d] Operator recovered - repeating %s request." C_RESET "\n",
+         drone.id, type == MSG_REQ_LAND ? "LANDING" : "TAKEOFF");
+    send_msg_arg(type, drone.id, REQ_RESEND);
+    return 1;
+}
+
+// Rezerwacja okna lądowania (rsv_lookahead_s > 0), wołana co tick lotu.
+// *state: 0 = jeszcze nie zgłoszona, 1 = czeka na odpowiedź, 2 = rozstrzygnięta w tym cyklu.
+// Uzgodnione okno trafia do *land_at (mono_time) - dron prosi o lądowanie na jego początku.
+void reserve_step(int *state, double *land_at) {
+    struct msg_resp resp;
+    long type = RSV_RESPONSE_BASE + drone.id;
+    double eta = (drone.current_battery - BATTERY_CRITICAL) / drone.drain_rate_per_sec;
+    if (*state == 0 && eta <= rsv_lookahead_s) {
+        // Odpowiedź spóźniona z poprzedniego cyklu (albo poprzedniego wcielenia tego ID) - wyrzucamy
+        while (msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), type, IPC_NOWAIT) != -1);
+        *state = send_msg_arg(MSG_RESERVE, drone.id, (int)(eta * 1000.0)) == 0 ? 1 : 2;
+        return;
+    }
+    if (*state != 1 || msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), type, IPC_NOWAIT) == -1) return;
+    *state = 2;
+    if (resp.channel_id == RSV_NO_WINDOW) {
+        // Hangar zajęty aż do progu - stajemy w kolejce od razu, z zapasem baterii na czekanie
+        dlog(C_YELLOW "[Drone %d] No landing window - queueing now (critical in %.1fs)." C_RESET "\n", drone.id, eta);
+        *land_at = mono_time();
+        return;
+    }
+    *land_at = mono_time() + resp.channel_id / 1000.0;
+    dlog(C_CYAN "[Drone %d] Landing window booked in %.1fs (critical in %.1fs)." C_RESET "\n", drone.id,
+         resp.channel_id / 1000.0, eta);
+}
+
+// Ładowanie z puli ładowarek (config.chargers > 0). Dron stoi na miejscu postojowym (semafor hangaru
+// trzyma Operator) i czeka na ładowarkę z SEM_CHARGER - z SEM_UNDO, więc ładowarka wraca do puli
+// także po śmierci drona. Budżet mocy: charge_power ładowarek naraz z pełną mocą (od progu krytycznego
+// do 100% w T1), przy większej liczbie aktywnych moc dzieli się po równo. Cel ładowania czytany co
+// tick z charge_target - przy kolejce przed bazą Operator obniża go do CHARGE_PARTIAL.
+void charge_from_pool() {
+    int chargers = shm->config.chargers;
+    double power = shm->config.charge_power > 0 ? shm->config.charge_power : chargers;
+    double full_rate = (BATTERY_FULL - BATTERY_CRITICAL) / (double)drone.T1; // %/s przy pełnej mocy
+
+    // Kolejka do ładowarek w hangarze (kolejność wybudzeń ustala jądro)
+    double t0 = mono_time();
+    if (semctl(semid, SEM_CHARGER, GETVAL) == 0) {
+        tm_update(TM_PARKED);
+        dlog(C_YELLOW "[Drone %d] Parked - waiting for a free charger." C_RESET "\n", drone.id);
+    }
+    struct sembuf take = {SEM_CHARGER, -1, SEM_UNDO};
+    int rc;
+    while ((rc = semop(semid, &take, 1)) == -1 && errno == EINTR && keep_running && !drone.kamikaze_pending);
+    if (rc == -1) {
+        if (errno != EINTR) perror("[Drone] semop charger failed");
+        else if (drone.kamikaze_pending) dlog(C_RED "[Drone %d] Left the charger queue due to KAMIKAZE order." C_RESET "\n", drone.id);
+        return;
+    }
+    double t_plug = mono_time();
+    tm_update(TM_CHARGING);
+
+    int target = BATTERY_FULL, active = 1;
+    for (int i = 0; keep_running; i++) {
+        if (drone.kamikaze_pending) {
+            dlog(C_RED "[Drone %d] Charging ABORTED due to KAMIKAZE order." C_RESET "\n", drone.id);
+            break;
+        }
+        target = __atomic_load_n(&shm->charge_target, __ATOMIC_RELAXED);
+        if (target <= BATTERY_CRITICAL || target > BATTERY_FULL) target = BATTERY_FULL;
+        if (drone.current_battery >= target) break;
+
+        custom_wait(semid, 0.1);
+        int free_ch = semctl(semid, SEM_CHARGER, GETVAL);
+        active = free_ch >= 0 && chargers - free_ch > 0 ? chargers - free_ch : 1;
+        double share = active > power ? power / active : 1.0;
+        drone.current_battery += full_rate * share * (TICK_US / 1000000.0);
+        if (drone.current_battery > BATTERY_FULL) drone.current_battery = BATTERY_FULL;
+        tm_update(-1);
+        if (i % 10 == 0) dlog("[Drone %d] Charging: %.1f%% (target %d%%, %d/%d chargers active, %.0f%% power)\n",
+                              drone.id, drone.current_battery, target, active, chargers, share * 100.0);
+    }
+    struct sembuf give = {SEM_CHARGER, 1, SEM_UNDO};
+    if (semop(semid, &give, 1) == -1) perror("[Drone] semop charger release failed");
+
+    double t_end = mono_time();
+    uint64_t wait_ms = (uint64_t)((t_plug - t0) * 1000.0);
+    struct ChargeStats *cs = &shm->charge;
+    __atomic_add_fetch(&cs->sessions, 1, __ATOMIC_RELAXED);
+    if (target < BATTERY_FULL && drone.current_battery < BATTERY_FULL) __atomic_add_fetch(&cs->partial, 1, __ATOMIC_RELAXED);
+    if (wait_ms > 0) __atomic_add_fetch(&cs->queued, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cs->wait_ms_sum, wait_ms, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cs->charge_ms_sum, (uint64_t)((t_end - t_plug) * 1000.0), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&cs->level_sum, (uint64_t)drone.current_battery, __ATOMIC_RELAXED);
+    uint64_t cur = __atomic_load_n(&cs->wait_ms_max, __ATOMIC_RELAXED);
+    while (wait_ms > cur && !__atomic_compare_exchange_n(&cs->wait_ms_max, &cur, wait_ms, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    dlog(C_GREEN "[Drone %d] Unplugged at %.1f%% after %.1fs (waited %.1fs for a charger)." C_RESET "\n",
+         drone.id, drone.current_battery, t_end - t_plug, t_plug - t0);
+}
+
+// Procedura śmierci (koniec procesu)
+// Wywoływana gdy bateria padnie, dron się zużyje lub dostanie rozkaz Kamikadze
 void drone_die() {
-    // 1. Najpierw informujemy Operatora, eby zwolni nasze zasoby (ID w pamici, sloty)
+    // Slot oznaczony jako martwy, zanim Operator dostanie wiadomość (i stworzy następcę z tym ID)
+    tm_update(TM_DEAD);
+    // 1. Najpierw informujemy Operatora, żeby zwolnił nasze zasoby (ID w pamięci, sloty)
     send_msg(MSG_DEAD, drone.id);
-    // 2. Logujemy ostatnie sowa
+    // 2. Logujemy ostatnie słowa
     dlog(C_RED "[Drone %d] RIP (Self-destruct/Battery/Age)." C_RESET "\n", drone.id);
-    // 3. Koczymy proces systemowy. System operacyjny posprzta pami RAM.
+    // 3. Kończymy proces systemowy. System operacyjny posprząta pamięć RAM.
     exit(0);
 }
 
-// --- OBSUGA SYGNAW ---
+// --- OBSŁUGA SYGNAŁÓW ---
 
-// Handler Ctrl+C (SIGINT) - bezpieczne wyjcie z ptli while
+// Handler Ctrl+C (SIGINT) - bezpieczne wyjście z pętli while
 void sigint_handler(int sig) { (void)sig; keep_running = 0; }
 
-// Handler Sygnau 3 (SIGUSR1 - Atak Kamikadze / Snajper)
-// Ten kod wykonuje si asynchronicznie (przerywa main) w momencie otrzymania sygnau
+// Handler Sygnału 3 (SIGUSR1 - Atak Kamikadze / Snajper)
+// Ten kod wykonuje się asynchronicznie (przerywa main) w momencie otrzymania sygnału
 void sigusr1_handler(int sig) {
     (void)sig;
     
-    // 1. Ochrona: Jeli bateria niska, ignoruj rozkaz (symulacja awarii systemu)
+    // 1. Ochrona: Jeśli bateria niska, ignoruj rozkaz (symulacja awarii systemu)
     if (drone.current_battery < BATTERY_CRITICAL) {
         dlog(C_YELLOW "\n[Drone %d] Kamikaze order IGNORED. Battery too low (%.1f%%)." C_RESET "\n", drone.id, drone.current_battery);
         return;
@@ -128,25 +268,46 @@ void sigusr1_handler(int sig) {
 
     dlog(C_RED "\n[Drone %d] !!! KAMIKAZE ORDER RECEIVED !!! Battery: %.1f%%" C_RESET "\n", drone.id, drone.current_battery);
 
-    // 2. Decyzja w zalenoci od lokalizacji - KLUCZOWE DLA ZASOBW
+    // 2. Decyzja w zależności od lokalizacji - KLUCZOWE DLA ZASOBÓW
     if (drone.location == ST_OUTSIDE) {
-        // Jeli jestem na zewntrz, mog umrze od razu, nikogo nie blokuj.
+        // Jeśli jestem na zewnątrz, mogę umrzeć od razu, nikogo nie blokuję.
         dlog(C_RED "[Drone %d] Location: OUTSIDE. Dying immediately." C_RESET "\n", drone.id);
-        drone_die(); // Wywouje exit(0)
+        drone_die(); // Wywołuje exit(0)
     } else {
-        // Jeli jestem w rodku (zajmuj semafor) lub w tunelu, NIE MOG umrze teraz.
-        // Zablokowabym semafor na zawsze (deadlock).
+        // Jeśli jestem w środku (zajmuję semafor) lub w tunelu, NIE MOGĘ umrzeć teraz.
+        // Zablokowałbym semafor na zawsze (deadlock).
         dlog(C_RED "[Drone %d] Location: INSIDE BASE. Will die after exit." C_RESET "\n", drone.id);
-        // Ustawiam flag - sprawdz j w main() po wylocie z bazy.
+        // Ustawiam flagę - sprawdzę ją w main() po wylocie z bazy.
         drone.kamikaze_pending = 1; 
+        tm_update(-1);
     }
 }
 
-// Inicjalizacja parametrw drona na starcie
-void init_drone_params(DroneState *d, int id, int start_mode) {
-    // Inicjalizacja generatora losowego (unikalna dla kadego procesu dziki XOR z PID)
-    // Samo time(NULL) daoby ten sam seed dla wszystkich dronw startujcych w tej samej sekundzie.
-    srand(time(NULL) ^ getpid());
+// Podłączenie pamięci dzielonej: konfiguracja przebiegu i slot telemetrii tego ID.
+// Same zera w konfiguracji (i brak telemetrii) = pamięć niedostępna.
+struct SwarmConfig attach_shared(int id) {
+    struct SwarmConfig cfg = {0};
+    int shmid = shmget(ipc_key(IPC_KEY_SHM), sizeof(struct SharedState), 0600);
+    if (shmid == -1) return cfg;
+    struct SharedState *sh = (struct SharedState *)shmat(shmid, NULL, 0);
+    if (sh == (void *)-1) return cfg;
+    cfg = sh->config;
+    // Mapowanie zostaje do końca procesu (slot telemetrii); znika razem z procesem
+    if (id >= 0 && id < MAX_DRONE_ID) {
+        tm_slot = &sh->telemetry[id];
+        shm = sh;
+        usage_at_exit(&sh->usage[USAGE_DRONE]); // Zużycie zasobów zapisywane przy każdym exit()
+    } else shmdt(sh);
+    return cfg;
+}
+
+// Inicjalizacja parametrów drona na starcie
+void init_drone_params(DroneState *d, int id, int start_mode, unsigned int seed, int charge_s) {
+    // Inicjalizacja generatora losowego (unikalna dla każdego procesu dzięki XOR z PID)
+    // Samo time(NULL) dałoby ten sam seed dla wszystkich dronów startujących w tej samej sekundzie.
+    // Przy stałym ziarnie (scenariusz) bateria zależy tylko od seed i ID - powtarzalne przebiegi.
+    if (seed != 0) srand(seed ^ ((unsigned int)id * 2654435761u));
+    else srand(time(NULL) ^ getpid());
 
     d->id = id;
 
@@ -155,14 +316,14 @@ void init_drone_params(DroneState *d, int id, int start_mode) {
         d->current_battery = BATTERY_FULL;
     } else {
         // Tryb "Powietrze" (Start symulacji): Losowa bateria 50-100%
-        // To desynchronizuje rj, eby wszyscy nie chcieli ldowa w tej samej chwili.
+        // To desynchronizuje rój, żeby wszyscy nie chcieli lądować w tej samej chwili.
         d->current_battery = 50.0 + (rand() % 51);
     }
 
-    d->T1 = CONST_CHARGE_TIME; // Czas adowania (20s)
-    d->T2 = (int)(2.5 * d->T1); // Pojemno baku (czas lotu) zaley od czasu adowania
-    // Wyliczamy, ile % baterii traci na sekund, eby rozadowa si w czasie T2
-    // Uywamy double dla precyzji.
+    d->T1 = charge_s > 0 ? charge_s : CONST_CHARGE_TIME; // Czas ładowania (domyślnie 20s)
+    d->T2 = (int)(2.5 * d->T1); // Pojemność baku (czas lotu) zależy od czasu ładowania
+    // Wyliczamy, ile % baterii tracić na sekundę, żeby rozładować się w czasie T2
+    // Używamy double dla precyzji.
     d->drain_rate_per_sec = 80.0 / (double)d->T2; 
     d->cycles_flown = 0;
     d->max_cycles = LIFE_LIMIT; 
@@ -174,185 +335,240 @@ void init_drone_params(DroneState *d, int id, int start_mode) {
 }
 
 // --- MAIN LOOP ---
-// Gwna ptla ycia procesu
+// Główna pętla życia procesu
 
 int main(int argc, char *argv[]) {
-    // Sprawdzenie argumentw przekazanych przez execl (ID, Tryb)
+    // Sprawdzenie argumentów przekazanych przez execl (ID, Tryb)
     if (argc < 3) return 1;
     int id = atoi(argv[1]);
     int start_mode = atoi(argv[2]); // 0=Start w powietrzu, 1=Start w bazie (Respawn)
     
-    // Ustawienie nazwy pliku logw unikalnej dla PID (np. drone_1234.txt)
-    snprintf(log_filename, sizeof(log_filename), "drone_%d.txt", getpid());
-    FILE *f = fopen(log_filename, "w"); if (f) fclose(f); // Wyczyszczenie pliku
+    // Rejestracja nowego wcielenia drona we wspólnym magazynie logów (zamiast drone_<pid>.txt)
+    if (ls_open(&log_store, LOG_STORE_FILE, id) == -1) {
+        fprintf(stderr, "[Drone %d] Log store unavailable, logging to stdout only.\n", id);
+    }
 
-    // Rejestracja handlerw sygnaw
+    struct SwarmConfig cfg = attach_shared(id);
+    rsv_lookahead_s = cfg.rsv_lookahead_s;
+    if (cfg.trace) trace_open(TRACE_FILE, "drone", id);
+    // Zbiór CPU dronów (Commander -d): ograniczenie albo rozłożenie po rdzeniach
+    char pl_msg[128];
+    if (pl_apply_drone(cfg.placement, cfg.drone_cpus, id, pl_msg, sizeof(pl_msg)) == -1)
+        fprintf(stderr, "[Drone %d] %s\n", id, pl_msg);
+
+    // Rejestracja handlerów sygnałów
     signal(SIGINT, sigint_handler);   // Ctrl+C
     signal(SIGUSR1, sigusr1_handler); // Komenda ataku
 
-    // Podczenie do istniejcej kolejki komunikatw (stworzonej przez Operatora)
-    // Brak flagi IPC_CREAT, bo dron nie jest wacicielem kolejki.
-    msqid = msgget(MSGQ_KEY, 0600);
+    // Podłączenie do istniejącej kolejki komunikatów (stworzonej przez Operatora)
+    // Brak flagi IPC_CREAT, bo dron nie jest właścicielem kolejki.
+    msqid = msgget(ipc_key(IPC_KEY_MSGQ), 0600);
     if (msqid == -1) { perror("msgget"); return 1; }
 
-    // Pobranie ID semaforw (stworzonych przez Operatora)
-    semid = semget(SEM_KEY, 0, 0); 
+    // Pobranie ID semaforów (stworzonych przez Operatora)
+    semid = semget(ipc_key(IPC_KEY_SEM), 0, 0); 
     if (semid == -1) { perror("semget drone"); return 1; }
 
     // Zainicjowanie struktury stanu drona
-    init_drone_params(&drone, id, start_mode);
+    init_drone_params(&drone, id, start_mode, cfg.seed, cfg.charge_s);
     
-    struct msg_resp resp; // Struktura na odbir odpowiedzi od Operatora
+    struct msg_resp resp; // Struktura na odbiór odpowiedzi od Operatora
 
-    // Ustawienie pocztkowego stanu lokalizacji (dla handlera Kamikadze)
+    // Ustawienie początkowego stanu lokalizacji (dla handlera Kamikadze)
     if (start_mode == 1) drone.location = ST_INSIDE;
     else drone.location = ST_OUTSIDE;
+    if (tm_slot) tm_attach(tm_slot, getpid(), drone.max_cycles);
+    tm_update(start_mode == 1 ? TM_WAIT_TAKEOFF : TM_FLYING);
 
     dlog(C_GREEN "[Drone %d] Ready (PID %d). Mode: %s. Battery: %.1f%%" C_RESET "\n", 
          id, getpid(), start_mode ? "BASE" : "AIR", drone.current_battery);
 
-    // Jeli dron rodzi si w bazie (start_mode=1), pomijamy faz lotu i idziemy do startu
+    // Jeśli dron rodzi się w bazie (start_mode=1), pomijamy fazę lotu i idziemy do startu
     if (start_mode == 1) {
         dlog(C_BLUE "[Drone %d] Created inside BASE. Preparing for immediate TAKEOFF." C_RESET "\n", id);
-        goto start_from_base; // Skok do etykiety na dole ptli
+        goto start_from_base; // Skok do etykiety na dole pętli
     }
 
-    // Nieskoczona ptla symulacyjna (Cykl ycia)
+    // Nieskończona pętla symulacyjna (Cykl Życia)
     while (keep_running) {
         // --- ETAP 1: LOT SWOBODNY ---
         drone.location = ST_OUTSIDE; 
+        tm_update(TM_FLYING);
         dlog(C_CYAN "[Drone %d] Flying... (Bat: %.1f%%)" C_RESET "\n", id, drone.current_battery);
         
-        // Ptla symulujca zuycie baterii w locie
-        while (drone.current_battery > BATTERY_CRITICAL && keep_running) {
-            custom_wait(semid, 0.1); // pimy 100ms (symulacja czasu)
-            // Odejmujemy odpowiedni cz baterii
+        // Pętla symulująca zużycie baterii w locie - do progu krytycznego albo do zarezerwowanego okna
+        int rsv_state = 0;
+        double land_at = 0.0;
+        while (drone.current_battery > BATTERY_CRITICAL && (land_at == 0.0 || mono_time() < land_at) && keep_running) {
+            custom_wait(semid, 0.1); // Śpimy 100ms (symulacja czasu)
+            // Odejmujemy odpowiednią część baterii
             drone.current_battery -= (drone.drain_rate_per_sec * (TICK_US / 1000000.0));
+            tm_update(-1);
             
-            // Sprawdzenie czy bateria nie pada w locie
+            // Sprawdzenie czy bateria nie padła w locie
             if (drone.current_battery <= BATTERY_DEAD) {
                 drone.current_battery = 0.0;
                 drone_die(); // Koniec procesu
             }
+            if (rsv_lookahead_s > 0) reserve_step(&rsv_state, &land_at);
         }
         if (!keep_running) break;
         
-        // --- ETAP 2: OCZEKIWANIE NA LDOWANIE ---
-        // Osignito prg krytyczny (20%). Prosimy o ldowanie.
+        // --- ETAP 2: OCZEKIWANIE NA LĄDOWANIE ---
+        // Osiągnięto próg krytyczny (20%). Prosimy o lądowanie.
         dlog(C_YELLOW "[Drone %d] Requesting LANDING (Bat: %.1f%%)" C_RESET "\n", id, drone.current_battery);
-        if (send_msg(MSG_REQ_LAND, id) == -1) break; // Wysyamy prob typ 1
+        tm_update(TM_QUEUED);
+        uint32_t req_epoch = op_epoch(); // Przed wysłaniem - wznowienie w międzyczasie też ponowi prośbę
+        if (send_msg(MSG_REQ_LAND, id) == -1) break; // Wysyłamy prośbę typ 1
 
         int channel = -1;
         int granted = 0;
+        TRACE_BEGIN(TR_WAIT_GRANT);
         
-        // Ptla oczekiwania na zgod (wiszenie w powietrzu / kolejce)
+        // Pętla oczekiwania na zgodę (wiszenie w powietrzu / kolejce)
+        // Śpimy w msgrcv aż do zgody albo do chwili, w której bateria spadnie do zera -
+        // bez cyklicznych pobudek. Zużycie baterii liczymy z faktycznie przeczekanego czasu.
+        double t_wait = mono_time();
+        double deadline = t_wait + (drone.current_battery - BATTERY_DEAD) / drone.drain_rate_per_sec;
         while (!granted && keep_running) {
-            // Odbieramy wiadomo TYLKO do nas (typ = RESPONSE_BASE + id)
-            // Uywamy IPC_NOWAIT (nieblokujco), aby mc traci bateri podczas czekania!
-            ssize_t r = safe_msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), RESPONSE_BASE + id, IPC_NOWAIT);
-            
+            // Odbieramy wiadomość TYLKO do nas (typ = RESPONSE_BASE + id)
+            ssize_t r = timed_msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), RESPONSE_BASE + id, deadline);
+            int err = errno;
+
+            // Czekając w kolejce, nadal tracimy paliwo!
+            double now = mono_time();
+            drone.current_battery -= drone.drain_rate_per_sec * (now - t_wait);
+            t_wait = now;
+
             if (r != -1) {
-                // Otrzymano zgod!
+                if (resync(&resp, MSG_REQ_LAND, &req_epoch)) continue; // Operator wznowiony - czekamy dalej
+                // Otrzymano zgodę!
                 granted = 1;
                 channel = resp.channel_id; // Zapisujemy przydzielony tunel
-            } else {
-                // Brak wiadomoci (Operator zajty lub brak miejsc)
-                if (errno == ENOMSG) {
-                    // Czekajc w kolejce, nadal tracimy paliwo!
-                    custom_wait(semid, 0.1);
-                    drone.current_battery -= (drone.drain_rate_per_sec * (TICK_US / 1000000.0));
-                    
-                    // Jeli Operator nie zdy nas wpuci, spadamy.
-                    if (drone.current_battery <= BATTERY_DEAD) {
-                        dlog(C_RED "[Drone %d] Died waiting for landing." C_RESET "\n", id);
-                        drone_die();
-                    }
-                } else {
-                    if (errno != EINTR) perror("[Drone] msgrcv failed"); 
-                    break;
-                }
+            } else if (err == ETIMEDOUT) {
+                // Operator nie zdążył nas wpuścić - spadamy.
+                drone.current_battery = BATTERY_DEAD;
+                dlog(C_RED "[Drone %d] Died waiting for landing." C_RESET "\n", id);
+                drone_die();
+            } else if (err != EINTR) {
+                // EINTR = sygnał (atak / Ctrl+C) - pętla sprawdzi keep_running
+                errno = err;
+                perror("[Drone] msgrcv failed");
+                break;
             }
         }
+        TRACE_END(TR_WAIT_GRANT, channel);
         if (!keep_running) break;
 
         // --- ETAP 3: WLOT DO BAZY ---
+        tm_update(TM_CROSS_IN);
         dlog(C_CYAN "[Drone %d] Crossing channel %d IN..." C_RESET "\n", id, channel);
+        TRACE_BEGIN(TR_CROSSING);
         custom_wait(semid, (double)CROSSING_TIME); // Symulacja fizycznego przelotu przez tunel (1s)
+        TRACE_END(TR_CROSSING, channel);
         
         drone.location = ST_INSIDE; // Zmieniamy status (ochrona przed Kamikadze)
-        send_msg(MSG_LANDED, id);   // Informujemy Operatora: zwolnilimy tunel, zajlimy hangar
-
-        // --- ETAP 4: ADOWANIE ---
-        dlog(C_GREEN "[Drone %d] Charging..." C_RESET "\n", id);
-
-        // Obliczamy ile tickw trwa adowanie (np. 20s / 0.1s = 200 tickw)
-        int charge_ticks = (drone.T1 * 1000000) / TICK_US;
-        // Obliczamy ile brakuje do pena
-        double missing_charge = 100.0 - drone.current_battery;
-
-        // Rozkadamy ten brakujcy adunek rwnomiernie na czas T1
-        double charge_per_tick = (missing_charge / (double)drone.T1) * (TICK_US / 1000000.0);
+        send_msg(MSG_LANDED, id);   // Informujemy Operatora: zwolniliśmy tunel, zajęliśmy hangar
+
+        // --- ETAP 4: ŁADOWANIE ---
+        TRACE_BEGIN(TR_CHARGING);
+        if (shm != NULL && shm->config.chargers > 0) {
+            charge_from_pool(); // Miejsce postojowe i ładowarka to osobne zasoby
+        } else {
+            tm_update(TM_CHARGING);
+            dlog(C_GREEN "[Drone %d] Charging..." C_RESET "\n", id);
+
+            // Obliczamy ile ticków trwa ładowanie (np. 20s / 0.1s = 200 ticków)
+            int charge_ticks = (drone.T1 * 1000000) / TICK_US;
+            // Obliczamy ile brakuje do pełna
+            double missing_charge = 100.0 - drone.current_battery;
+
+            // Rozkładamy ten brakujący ładunek równomiernie na czas T1
+            double charge_per_tick = (missing_charge / (double)drone.T1) * (TICK_US / 1000000.0);
         
-        // Ptla adowania
-        for (int i = 0; i < charge_ticks && keep_running; i++) {
-            // Sprawdzenie flagi opnionej mierci (Kamikadze)
-            if (drone.kamikaze_pending) {
-                dlog(C_RED "[Drone %d] Charging ABORTED due to KAMIKAZE order." C_RESET "\n", id);
-                break; // Przerywamy adowanie, aby szybciej wylecie i wybuchn
-            }
+            // Pętla ładowania
+            for (int i = 0; i < charge_ticks && keep_running; i++) {
+                // Sprawdzenie flagi opóźnionej śmierci (Kamikadze)
+                if (drone.kamikaze_pending) {
+                    dlog(C_RED "[Drone %d] Charging ABORTED due to KAMIKAZE order." C_RESET "\n", id);
+                    break; // Przerywamy ładowanie, aby szybciej wylecieć i wybuchnąć
+                }
             
-            custom_wait(semid, 0.1); // Czas pynie
+                custom_wait(semid, 0.1); // Czas płynie
             
-            drone.current_battery += charge_per_tick; // Bateria ronie
-            if (drone.current_battery > 100.0) drone.current_battery = 100.0;
+                drone.current_battery += charge_per_tick; // Bateria rośnie
+                if (drone.current_battery > 100.0) drone.current_battery = 100.0;
+                tm_update(-1);
             
-            // Loguj postp co 1 sekund (co 10 tickw), eby nie zamieca logw
-            if (i % 10 == 0) dlog("[Drone %d] Charging: %.1f%%\n", id, drone.current_battery);
-        }
+                // Loguj postęp co 1 sekundę (co 10 ticków), żeby nie zaśmiecać logów
+                if (i % 10 == 0) dlog("[Drone %d] Charging: %.1f%%\n", id, drone.current_battery);
+            }
         
-        // Jeli nie byo przerwania, uznajemy bateri za pen
-        if (!drone.kamikaze_pending) drone.current_battery = BATTERY_FULL;
+            // Jeśli nie było przerwania, uznajemy baterię za pełną
+            if (!drone.kamikaze_pending) drone.current_battery = BATTERY_FULL;
+        }
+        TRACE_END(TR_CHARGING, drone.cycles_flown + 1);
         
-        // Inkrementacja licznika cykli ycia
+        // Inkrementacja licznika cykli życia
         drone.cycles_flown++;
         dlog("[Drone %d] Maintenance Log: Cycle %d/%d completed.\n", 
                id, drone.cycles_flown, drone.max_cycles);
 
-start_from_base: // Etykieta dla dronw startujcych w trybie "Baza"
+start_from_base: // Etykieta dla dronów startujących w trybie "Baza"
         // --- ETAP 5: START ---
-        drone.location = ST_INSIDE; // Upewnienie si co do lokalizacji
+        drone.location = ST_INSIDE; // Upewnienie się co do lokalizacji
+        tm_update(TM_WAIT_TAKEOFF);
         dlog("[Drone %d] Requesting TAKEOFF.\n", id);
         
-        if (send_msg(MSG_REQ_TAKEOFF, id) == -1) break; // Proba o start (typ 2)
-
-        // Czekanie na zgod - tutaj BLOKUJCO (0 flag).
-        // W bazie bateria nie spada drastycznie, a dron jest bezpieczny, wic moe spa.
-        if (safe_msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), RESPONSE_BASE + id, 0) == -1) {
-             if (errno != EINTR) perror("[Drone] msgrcv blocking failed");
-             break;
+        req_epoch = op_epoch();
+        if (send_msg(MSG_REQ_TAKEOFF, id) == -1) break; // Prośba o start (typ 2)
+
+        // Czekanie na zgodę - blokująco, ale z terminem.
+        // W bazie bateria nie spada, dron jest bezpieczny i może spać. Termin służy tylko do
+        // ostrzeżenia o zawieszonym Operatorze - prośbę ponawiamy wyłącznie po zmianie epoki
+        // (GRANT_RESYNC), bo tylko wtedy mogła przepaść; inaczej groziłaby podwójną zgodą.
+        TRACE_BEGIN(TR_WAIT_GRANT);
+        double takeoff_deadline = mono_time() + TAKEOFF_TIMEOUT;
+        ssize_t tr;
+        while (((tr = timed_msgrcv(msqid, &resp, sizeof(resp) - sizeof(long), RESPONSE_BASE + id, takeoff_deadline)) == -1 && keep_running) ||
+               (tr != -1 && resync(&resp, MSG_REQ_TAKEOFF, &req_epoch))) {
+            if (tr != -1) continue;
+            if (errno == ETIMEDOUT) {
+                dlog(C_YELLOW "[Drone %d] No TAKEOFF grant after %d s - still waiting." C_RESET "\n", id, TAKEOFF_TIMEOUT);
+                takeoff_deadline = mono_time() + TAKEOFF_TIMEOUT;
+            } else if (errno != EINTR) {
+                perror("[Drone] msgrcv blocking failed");
+                break;
+            }
         }
-        channel = resp.channel_id; // Otrzymano numer tunelu wyjciowego
+        if (tr == -1) break;
+        TRACE_END(TR_WAIT_GRANT, resp.channel_id);
+        channel = resp.channel_id; // Otrzymano numer tunelu wyjściowego
 
         // --- ETAP 6: WYLOT ---
+        tm_update(TM_CROSS_OUT);
         dlog(C_CYAN "[Drone %d] Crossing channel %d OUT..." C_RESET "\n", id, channel);
+        TRACE_BEGIN(TR_CROSSING);
         custom_wait(semid, (double)CROSSING_TIME); // Symulacja przelotu (1s)
+        TRACE_END(TR_CROSSING, channel);
 
-        send_msg(MSG_DEPARTED, id); // Informujemy Operatora: zwolnilimy tunel i hangar
-        drone.location = ST_OUTSIDE; // Jestemy na zewntrz (podatni na Kamikadze)
+        send_msg(MSG_DEPARTED, id); // Informujemy Operatora: zwolniliśmy tunel i hangar
+        drone.location = ST_OUTSIDE; // Jesteśmy na zewnątrz (podatni na Kamikadze)
+        tm_update(TM_FLYING);
         
         dlog(C_CYAN "[Drone %d] Back in the air." C_RESET "\n", id);
         
         // --- ETAP 7: EWENTUALNY ZGON ---
-        // Sprawdzenie czy mamy "zalegy" rozkaz samobjstwa
+        // Sprawdzenie czy mamy "zaległy" rozkaz samobójstwa
         if (drone.kamikaze_pending) {
             dlog(C_RED "[Drone %d] Mission complete. Detonating outside base." C_RESET "\n", id);
-            drone_die(); // Wybuchamy bezpiecznie poza baz
+            drone_die(); // Wybuchamy bezpiecznie poza bazą
         }
         
         // Sprawdzenie czy dron nie jest za stary (limit cykli)
         if (drone.cycles_flown >= drone.max_cycles) {
             dlog(C_YELLOW "[Drone %d] RETIRING: Wear limit reached (%d cycles). Goodbye." C_RESET "\n", id, drone.cycles_flown);
-            drone_die(); // Zomowanie (Replenish stworzy nowego)
+            drone_die(); // Złomowanie (Replenish stworzy nowego)
         }
     }
     return 0; // Koniec main
@@ -0,0 +1,91 @@
+/* src/fleet.c
+ *
+ * Podgląd floty na żywo ze slotów telemetrii w pamięci dzielonej (bez wiadomości do dronów).
+ *   fleet [-w sekundy] [-a] [-K klucz]
+ *   -w  odświeżanie co podany czas (domyślnie jeden odczyt)
+ *   -a  także sloty martwych wcieleń
+ *   -K  klucze IPC przebiegu (jak commander -K); bez -K - SWARM_IPC_KEYS albo domyślne
+ * Dron zabity SIGKILL nie zdąży oznaczyć slotu - taki wpis jest pokazywany jako "lost".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/shm.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+
+static volatile sig_atomic_t keep_running = 1;
+
+void sigint_handler(int sig) { (void)sig; keep_running = 0; }
+
+void print_fleet(const struct SharedState *sh, int all) {
+    double now = mono_time();
+    int lost = 0, torn = 0;
+    printf("%5s %8s %4s %-12s %7s %-7s %7s %3s %7s\n", "ID", "PID", "GEN", "PHASE", "BAT%", "WHERE", "CYCLES", "KMZ", "AGE_S");
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        struct TelemetryView v;
+        if (tm_read(&sh->telemetry[i], &v) == -1) { torn++; continue; }
+        if (v.phase <= TM_EMPTY || v.phase >= TM_PHASES) continue;
+        int dead = v.phase == TM_DEAD;
+        int gone = !dead && kill(v.pid, 0) == -1 && errno == ESRCH;
+        lost += gone;
+        if ((dead || gone) && !all) continue;
+        printf("%5d %8d %4u %-12s %7.1f %-7s %3d/%-3d %3s %7.1f\n", i, (int)v.pid, v.generation,
+               gone ? "lost" : tm_phase_names[v.phase], v.battery, v.location == ST_INSIDE ? "inside" : "outside",
+               v.cycles_flown, v.max_cycles, v.kamikaze_pending ? "yes" : "-", now - v.t_update);
+    }
+
+    struct FleetSummary fs;
+    tm_fleet(sh->telemetry, MAX_DRONE_ID, now, &fs);
+    printf("alive %d (lost %d) | inside %d | flying %d, queued %d, in %d, parked %d, charging %d, wait_takeoff %d, out %d"
+           " | battery min %.1f avg %.1f | torn %d\n",
+           fs.alive - lost, lost, fs.inside, fs.by_phase[TM_FLYING], fs.by_phase[TM_QUEUED], fs.by_phase[TM_CROSS_IN],
+           fs.by_phase[TM_PARKED], fs.by_phase[TM_CHARGING], fs.by_phase[TM_WAIT_TAKEOFF], fs.by_phase[TM_CROSS_OUT],
+           fs.battery_min, fs.battery_avg, torn);
+}
+
+int main(int argc, char *argv[]) {
+    double interval = 0;
+    int all = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "w:aK:")) != -1) {
+        switch (opt) {
+            case 'w': interval = strtod(optarg, NULL); break;
+            case 'a': all = 1; break;
+            case 'K': {
+                long base = strtol(optarg, NULL, 0);
+                if (base <= 0) { fprintf(stderr, "Error: invalid key_base.\n"); return 1; }
+                ipc_keys_set((key_t)base, (key_t)(base + 1), (key_t)(base + 2));
+                break;
+            }
+            default:
+                fprintf(stderr, "Usage: %s [-w seconds] [-a] [-K key_base]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    int shmid = shmget(ipc_key(IPC_KEY_SHM), sizeof(struct SharedState), 0);
+    if (shmid == -1) { perror("[fleet] shmget (is the swarm running?)"); return 1; }
+    const struct SharedState *sh = shmat(shmid, NULL, SHM_RDONLY);
+    if (sh == (void *)-1) { perror("[fleet] shmat"); return 1; }
+
+    signal(SIGINT, sigint_handler);
+    do {
+        if (interval > 0) printf("\033[H\033[2J"); // Tryb odświeżania: czyszczenie ekranu
+        print_fleet(sh, all);
+        fflush(stdout);
+        if (interval > 0) {
+            struct timespec ts = {(time_t)interval, (long)((interval - (time_t)interval) * 1e9)};
+            nanosleep(&ts, NULL);
+        }
+    } while (interval > 0 && keep_running);
+
+    shmdt(sh);
+    return 0;
+}
@@ -1,8 +1,9 @@
-// MUSI BY PIERWSZE!
+// MUSI BYĆ PIERWSZE!
 #define _GNU_SOURCE 
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
@@ -10,12 +11,16 @@
 #include <sys/ipc.h>
 #include <sys/sem.h>
 #include <sys/msg.h>
+#include <sys/shm.h>
 #include <limits.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/syscall.h>
 
 #include "../include/common.h"
 #include "../include/ipc_wrapper.h"
 
-// --- Implementacja Wrapperw ---
+// --- Implementacja Wrapperów ---
 
 int safe_semop(int semid, struct sembuf *sops, size_t nsops) {
     int res;
@@ -33,6 +38,69 @@ ssize_t safe_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg
     return res;
 }
 
+// --- ODBIÓR Z TERMINEM ---
+// msgrcv nie ma wersji z timeoutem. Zegar POSIX (timer_create) przerywa blokujący msgrcv
+// sygnałem SIGALRM w chwili terminu. msgrcv nigdy nie jest wznawiany po handlerze (zwraca EINTR).
+// Po terminie zegar strzela dalej co RCV_TIMER_REPEAT_NS - jeśli pierwszy sygnał trafi tuż przed
+// wejściem do msgrcv, następny i tak go przerwie.
+
+#define RCV_TIMER_REPEAT_NS 10000000L // 10 ms
+
+static timer_t rcv_timer;
+static int rcv_timer_state = 0; // 0 = nieutworzony, 1 = gotowy, -1 = niedostępny
+
+static void rcv_timer_handler(int sig) { (void)sig; } // Sam fakt przerwania wystarcza
+
+static int rcv_timer_init(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = rcv_timer_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0; // Bez SA_RESTART
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo = SIGALRM;
+    if (sigaction(SIGALRM, &sa, NULL) == -1 || timer_create(CLOCK_MONOTONIC, &sev, &rcv_timer) == -1) {
+        perror("[IPC] timed_msgrcv timer");
+        return -1;
+    }
+    return 1;
+}
+
+ssize_t timed_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, double deadline) {
+    ssize_t r = msgrcv(msqid, msgp, msgsz, msgtyp, IPC_NOWAIT);
+    if (r != -1 || errno != ENOMSG) return r; // Wiadomość już czeka (lub prawdziwy błąd)
+    if (mono_time() >= deadline) { errno = ETIMEDOUT; return -1; }
+
+    if (rcv_timer_state == 0) rcv_timer_state = rcv_timer_init();
+    if (rcv_timer_state == -1) {
+        // Awaryjnie: odpytywanie co 10 ms (zachowanie sprzed zegara)
+        struct timespec ts = {0, RCV_TIMER_REPEAT_NS};
+        while ((r = msgrcv(msqid, msgp, msgsz, msgtyp, IPC_NOWAIT)) == -1 && errno == ENOMSG) {
+            if (mono_time() >= deadline) { errno = ETIMEDOUT; return -1; }
+            if (nanosleep(&ts, NULL) == -1) return -1; // EINTR dla wywołującego
+        }
+        return r;
+    }
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = (time_t)deadline;
+    its.it_value.tv_nsec = (long)((deadline - (double)its.it_value.tv_sec) * 1e9);
+    its.it_interval.tv_nsec = RCV_TIMER_REPEAT_NS;
+    timer_settime(rcv_timer, TIMER_ABSTIME, &its, NULL);
+
+    r = msgrcv(msqid, msgp, msgsz, msgtyp, 0);
+    int saved = errno;
+
+    memset(&its, 0, sizeof(its));
+    timer_settime(rcv_timer, 0, &its, NULL); // Rozbrojenie
+    if (r == -1 && saved == EINTR && mono_time() >= deadline) saved = ETIMEDOUT;
+    errno = saved;
+    return r;
+}
+
 void custom_wait(int semid, double seconds) {
     struct timespec ts;
     ts.tv_sec = (time_t)seconds;
@@ -40,10 +108,77 @@ void custom_wait(int semid, double seconds) {
 
     struct sembuf op = {SEM_TIMER, -1, 0};
     
-    // Uywa semtimedop (dostpne dziki _GNU_SOURCE na grze pliku)
+    // Używa semtimedop (dostępne dzięki _GNU_SOURCE na górze pliku)
     semtimedop(semid, &op, 1, &ts);
 }
 
+double mono_time(void) {
+    struct timespec ts;
+    // CLOCK_MONOTONIC nie cofa się przy zmianie zegara systemowego
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+pid_t fork_sibling(void) {
+    // Surowe clone z CLONE_PARENT zachowuje się jak fork(), ale dziecko podpina się pod naszego rodzica.
+    // Sygnał zakończenia (SIGCHLD) trafia wtedy do Commandera, który trzyma pidfd dziecka.
+    pid_t pid = (pid_t)syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, NULL, NULL, 0);
+    if (pid == -1 && errno == EINVAL) return fork(); // Np. rodzicem jest init - zwykły fork
+    return pid;
+}
+
+// --- KLUCZE IPC PRZEBIEGU ---
+
+static key_t keys[3] = { MSGQ_KEY, SEM_KEY, SHM_KEY };
+static int keys_loaded = 0;
+
+key_t ipc_key(int which) {
+    if (!keys_loaded) {
+        keys_loaded = 1;
+        const char *env = getenv(SWARM_KEYS_ENV);
+        unsigned int q, s, m;
+        if (env && sscanf(env, "%x,%x,%x", &q, &s, &m) == 3) {
+            keys[IPC_KEY_MSGQ] = (key_t)q;
+            keys[IPC_KEY_SEM] = (key_t)s;
+            keys[IPC_KEY_SHM] = (key_t)m;
+        }
+    }
+    return keys[which];
+}
+
+int ipc_keys_set(key_t msgq, key_t sem, key_t shm) {
+    keys[IPC_KEY_MSGQ] = msgq;
+    keys[IPC_KEY_SEM] = sem;
+    keys[IPC_KEY_SHM] = shm;
+    keys_loaded = 1;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%x,%x,%x", (unsigned int)msgq, (unsigned int)sem, (unsigned int)shm);
+    if (setenv(SWARM_KEYS_ENV, buf, 1) == -1) { perror("[IPC] setenv"); return -1; }
+    return 0;
+}
+
+int ipc_keys_from_dir(const char *dir) {
+    key_t q = ftok(dir, 'Q'), s = ftok(dir, 'S'), m = ftok(dir, 'M');
+    if (q == -1 || s == -1 || m == -1) { perror("[IPC] ftok"); return -1; }
+    return ipc_keys_set(q, s, m);
+}
+
+int ipc_remove_all(void) {
+    int removed = 0;
+    int id;
+    if ((id = msgget(ipc_key(IPC_KEY_MSGQ), 0)) != -1 && msgctl(id, IPC_RMID, NULL) == 0) removed++;
+    if ((id = semget(ipc_key(IPC_KEY_SEM), 0, 0)) != -1 && semctl(id, 0, IPC_RMID) == 0) removed++;
+    if ((id = shmget(ipc_key(IPC_KEY_SHM), 0, 0)) != -1 && shmctl(id, IPC_RMID, NULL) == 0) removed++;
+    return removed;
+}
+
+const char *swarm_bin(const char *name, char *buf, size_t len) {
+    const char *dir = getenv(SWARM_BIN_ENV);
+    if (dir && dir[0]) snprintf(buf, len, "%s/%s", dir, name);
+    else snprintf(buf, len, "./%s", name);
+    return buf;
+}
+
 int parse_int(const char *str, const char *name) {
     char *endptr;
     errno = 0;
@@ -0,0 +1,186 @@
+/* src/log_store.c
+ *
+ * Wspólny magazyn logów dronów (plik mapowany w pamięci, segmenty per dron).
+ * Przydział segmentów i generacji odbywa się operacjami atomowymi na nagłówku
+ * współdzielonym przez mmap, więc tysiące dronów piszą bez blokad i bez fsync.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "../include/common.h"
+#include "../include/log_store.h"
+
+// Rozmiar nagłówka zaokrąglony do strony (segmenty muszą być wyrównane dla mmap)
+static uint64_t header_size() {
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t sz = sizeof(struct LogStoreHeader);
+    return (sz + page - 1) / page * page;
+}
+
+static int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void ls_reset(const char *path) {
+    if (unlink(path) == -1 && errno != ENOENT) perror("[LogStore] unlink");
+}
+
+// Inicjalizacja pustego pliku (wywoływana pod blokadą flock)
+static int init_file(int fd) {
+    uint64_t hsz = header_size();
+    off_t total = (off_t)(hsz + (uint64_t)LS_SEG_SIZE * LS_MAX_SEGMENTS);
+    if (ftruncate(fd, total) == -1) { perror("[LogStore] ftruncate"); return -1; }
+
+    struct LogStoreHeader *h = mmap(NULL, hsz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (h == MAP_FAILED) { perror("[LogStore] mmap init"); return -1; }
+    // Plik po ftruncate jest wyzerowany - ustawiamy tylko pola różne od zera
+    h->version = LS_VERSION;
+    h->seg_size = LS_SEG_SIZE;
+    h->max_segments = LS_MAX_SEGMENTS;
+    h->data_offset = hsz;
+    for (int i = 0; i < MAX_DRONE_ID; i++) h->last_head[i] = -1;
+    for (int i = 0; i < LS_MAX_SEGMENTS; i++) {
+        h->index[i].drone_id = -1;
+        h->index[i].next = -1;
+        h->index[i].prev_gen = -1;
+    }
+    // Magic na końcu - czytelnicy widzą plik dopiero po pełnej inicjalizacji
+    __atomic_store_n(&h->magic, LS_MAGIC, __ATOMIC_RELEASE);
+    munmap(h, hsz);
+    return 0;
+}
+
+int ls_open(struct LogStore *ls, const char *path, int drone_id) {
+    memset(ls, 0, sizeof(*ls));
+    ls->fd = -1;
+    ls->seg_idx = -1;
+    ls->first_seg = -1;
+    if (drone_id < 0 || drone_id >= MAX_DRONE_ID) return -1;
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd == -1) { perror("[LogStore] open"); return -1; }
+
+    // Pierwszy proces inicjalizuje plik; pozostali czekają na flock
+    if (flock(fd, LOCK_EX) == -1) { perror("[LogStore] flock"); close(fd); return -1; }
+    struct stat st;
+    int rc = 0;
+    if (fstat(fd, &st) == -1) rc = -1;
+    else if (st.st_size == 0) rc = init_file(fd);
+    flock(fd, LOCK_UN);
+    if (rc == -1) { close(fd); return -1; }
+
+    uint64_t hsz = header_size();
+    struct LogStoreHeader *h = mmap(NULL, hsz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (h == MAP_FAILED) { perror("[LogStore] mmap"); close(fd); return -1; }
+    if (h->magic != LS_MAGIC || h->version != LS_VERSION) {
+        fprintf(stderr, "[LogStore] %s: bad header.\n", path);
+        munmap(h, hsz); close(fd);
+        return -1;
+    }
+
+    ls->fd = fd;
+    ls->hdr = h;
+    ls->drone_id = drone_id;
+    ls->generation = __atomic_fetch_add(&h->generation[drone_id], 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// Przydział nowego segmentu i dołączenie go do łańcucha bieżącego wcielenia
+static int claim_segment(struct LogStore *ls) {
+    struct LogStoreHeader *h = ls->hdr;
+    uint32_t idx = __atomic_fetch_add(&h->next_segment, 1, __ATOMIC_RELAXED);
+    if (idx >= h->max_segments) return -1; // Magazyn pełny
+
+    struct LogSegment *s = &h->index[idx];
+    s->generation = ls->generation;
+    s->pid = getpid();
+    s->t_start_ns = now_ns();
+    s->used = 0;
+    s->next = -1;
+    s->prev_gen = -1;
+
+    char *seg = mmap(NULL, h->seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, ls->fd,
+                     (off_t)(h->data_offset + (uint64_t)idx * h->seg_size));
+    if (seg == MAP_FAILED) { perror("[LogStore] mmap segment"); return -1; }
+
+    if (ls->seg_idx == -1) {
+        // Pierwszy segment wcielenia - wpinamy go na początek listy generacji tego ID
+        s->prev_gen = __atomic_exchange_n(&h->last_head[ls->drone_id], (int32_t)idx, __ATOMIC_ACQ_REL);
+        ls->first_seg = idx;
+    } else {
+        h->index[ls->seg_idx].next = (int32_t)idx;
+        munmap(ls->seg, h->seg_size);
+    }
+    // drone_id ustawiamy na końcu - od tej chwili segment jest widoczny w indeksie
+    __atomic_store_n(&s->drone_id, ls->drone_id, __ATOMIC_RELEASE);
+
+    ls->seg = seg;
+    ls->seg_idx = idx;
+    return 0;
+}
+
+void ls_append(struct LogStore *ls, const char *text, size_t len) {
+    if (!ls->hdr) return;
+    struct LogStoreHeader *h = ls->hdr;
+    size_t rec = (sizeof(struct LogRecord) + len + 7) & ~(size_t)7;
+    if (rec > h->seg_size) {
+        len = h->seg_size - sizeof(struct LogRecord); // Rekord dłuższy niż segment - przycinamy
+        rec = h->seg_size;
+    }
+
+    if (ls->seg_idx == -1 || h->index[ls->seg_idx].used + rec > h->seg_size) {
+        if (claim_segment(ls) == -1) {
+            __atomic_fetch_add(&h->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    struct LogSegment *s = &h->index[ls->seg_idx];
+    char *dst = ls->seg + s->used;
+    struct LogRecord r = { now_ns(), (uint32_t)len, 0 };
+    memcpy(dst, &r, sizeof(r));
+    memcpy(dst + sizeof(r), text, len);
+    // Publikacja: czytelnik widzi rekord dopiero, gdy 'used' obejmuje całość
+    __atomic_store_n(&s->used, s->used + (uint32_t)rec, __ATOMIC_RELEASE);
+}
+
+void ls_close(struct LogStore *ls) {
+    if (ls->seg) munmap(ls->seg, ls->hdr->seg_size);
+    if (ls->hdr) munmap(ls->hdr, header_size());
+    if (ls->fd != -1) close(ls->fd);
+    ls->seg = NULL;
+    ls->hdr = NULL;
+    ls->fd = -1;
+}
+
+struct LogStoreHeader *ls_map_readonly(const char *path, size_t *map_len) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) { perror("[LogStore] open"); return NULL; }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct LogStoreHeader)) {
+        fprintf(stderr, "[LogStore] %s: file too small.\n", path);
+        close(fd);
+        return NULL;
+    }
+    struct LogStoreHeader *h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // Mapowanie pozostaje ważne po zamknięciu deskryptora
+    if (h == MAP_FAILED) { perror("[LogStore] mmap"); return NULL; }
+    if (h->magic != LS_MAGIC || h->version != LS_VERSION) {
+        fprintf(stderr, "[LogStore] %s: bad header.\n", path);
+        munmap(h, st.st_size);
+        return NULL;
+    }
+    *map_len = st.st_size;
+    return h;
+}
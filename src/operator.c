@@ -1,81 +1,199 @@
 /* src/operator.c
  *
- * Modu Operatora (Zarzdca Bazy).
+ * Moduł Operatora (Zarządca Bazy).
  * Odpowiada za:
- * - Zarzdzanie semaforem (limit miejsc P)
- * - Obsug kolejek FIFO (start/ldowanie)
- * - Dynamiczne skalowanie (Sygnay 1 i 2)
- * - Monitorowanie stanu roju (spawn nowych dronw)
+ * - Zarządzanie semaforem (limit miejsc P)
+ * - Obsługę kolejek FIFO (start/lądowanie)
+ * - Dynamiczne skalowanie (Sygnały 1 i 2)
+ * - Monitorowanie stanu roju (spawn nowych dronów)
  */
 
-#include <stdio.h>      // Standardowe wejcie/wyjcie (printf, fopen)
+#include <stdio.h>      // Standardowe wejście/wyjście (printf, fopen)
 #include <stdlib.h>     // Biblioteka standardowa (exit, atoi, rand)
-#include <string.h>     // Operacje na cigach znakw (memset)
+#include <string.h>     // Operacje na ciągach znaków (memset)
 #include <unistd.h>     // Funkcje systemowe POSIX (fork, exec, sleep)
-#include <signal.h>     // Obsuga sygnaw (signal, SIGUSR1, SIGCHLD)
-#include <errno.h>      // Zmienna globalna errno do obsugi bdw
-#include <time.h>       // Funkcje czasu (time, localtime - do logw)
-#include <stdarg.h>     // Obsuga zmiennej liczby argumentw (va_list do logowania)
+#include <signal.h>     // Obsługa sygnałów (signal, SIGUSR1, SIGCHLD)
+#include <errno.h>      // Zmienna globalna errno do obsługi błędów
+#include <time.h>       // Funkcje czasu (time, localtime - do logów)
+#include <stdarg.h>     // Obsługa zmiennej liczby argumentów (va_list do logowania)
 #include <sys/wait.h>   // Funkcje oczekiwania na procesy (waitpid)
 #include <sys/ipc.h>    // flagi IPC (IPC_CREAT, IPC_NOWAIT)
-#include <sys/msg.h>    // Kolejki komunikatw (msgget, msgrcv, msgsnd)
+#include <sys/msg.h>    // Kolejki komunikatów (msgget, msgrcv, msgsnd)
 #include <sys/sem.h>    // Semafory (semget, semop, semctl)
-#include <sys/shm.h>    // Pami dzielona (shmget, shmat)
-#include <sys/types.h>  // Definicje typw systemowych (pid_t, key_t)
+#include <sys/shm.h>    // Pamięć dzielona (shmget, shmat)
+#include <sys/types.h>  // Definicje typów systemowych (pid_t, key_t)
+#include <limits.h>     // PATH_MAX
+#include <sys/resource.h> // setpriority (drony nie dziedziczą nice Operatora)
+#include <pthread.h>      // Tryb wielowątkowy (-M): wątki odbioru i pomocniczy
 
-#include "common.h"     // Wsplne definicje (klucze IPC, struktury wiadomoci)
+#include "common.h"     // Wspólne definicje (klucze IPC, struktury wiadomości)
 
 #include "../include/common.h"
 #include "../include/ipc_wrapper.h"
+#include "../include/trace.h"
+#include "../include/autoscale.h"
+#include "../include/sampler.h"
+#include "../include/spsc.h"
+#include "../include/scheduler.h"
 
 // --- KONFIGURACJA ---
-#define CHANNELS 2      // Liczba dostpnych tuneli (bramek)
-#define DIR_NONE 0      // Tunel jest pusty / nieaktywny
-#define DIR_IN   1      // Tunel wpuszcza drony (Ldowanie)
-#define DIR_OUT  2      // Tunel wypuszcza drony (Start)
-#define CHECK_INTERVAL 5 // Co ile sekund sprawdza stan roju (czy nie trzeba doda nowych dronw)
-
-// Stan tuneli - Operator musi pamita, co si dzieje w kadym tunelu
-int chan_dir[CHANNELS];   // Kierunek ruchu w tunelu [i] (IN/OUT/NONE)
-int chan_users[CHANNELS]; // Liczba dronw aktualnie przebywajcych w tunelu [i]
-
-// Kolejki oczekujcych (0=Ldowanie, 1=Start)
-// Uywamy bufora cyklicznego, aby efektywnie zarzdza kolejk FIFO bez przesuwania pamici
-#define WAITQ_CAP 1024
-int waitq[2][WAITQ_CAP];  // Dwie kolejki: waitq[0] dla ldujcych, waitq[1] dla startujcych
-int q_head[2] = {0, 0};   // Indeks "gowy" (std pobieramy drony do obsuenia)
-int q_tail[2] = {0, 0};   // Indeks "ogona" (tu wpisujemy nowe oczekujce drony)
+#define CHECK_INTERVAL 5 // Co ile sekund sprawdzać stan roju (czy nie trzeba dodać nowych dronów)
+#define OP_BATCH_DEFAULT 64  // Domyślnie: tyle wiadomości odbieramy na jedno wybudzenie
+#define OP_BATCH_MAX 1024    // Górny limit partii (i bufora zgód)
+#define LOG_BUF_SIZE (64 * 1024) // Bufor logów partii - jeden zapis do pliku na wybudzenie
+#define OP_IDLE_WAIT 0.25    // Najdłuższy sen w pustej kolejce (s) - przeglądy i próbki kolejki
+#define OP_RETRY_WAIT 0.05   // Sen, gdy czekają odroczone zgody
+#define QUEUE_MSGS_PER_DRONE 6   // Zapas kolejki: prośba + zgoda + LANDED/DEPARTED + DEAD + rezerwacja z odpowiedzią
+
+// Stan planisty (tunele, kolejki FIFO na buforze cyklicznym, pojemność bazy).
+// Cały w jednej strukturze - po każdej zmianie trafia do punktu kontrolnego w pamięci dzielonej.
+static struct OperatorState st;
+static struct SchOut so; // Akcje rdzenia planisty - wykonuje je apply_actions()
 
 // --- ZMIENNE GLOBALNE ---
-static int msqid = -1;    // ID kolejki komunikatw (IPC)
-static int semid = -1;    // ID zestawu semaforw (IPC) - kontroluje miejsca w hangarze
-static int shmid = -1;    // ID pamici dzielonej (IPC) - przechowuje PID-y dronw
-static struct SharedState *shared_mem = NULL; // Wskanik do podczonej pamici dzielonej
-// Zmienna sterujca ptl gwn. 'volatile' oznacza, e moe si zmieni z zewntrz (przez sygna)
+static int msqid = -1;    // ID kolejki komunikatów (IPC)
+static int semid = -1;    // ID zestawu semaforów (IPC) - kontroluje miejsca w hangarze
+static int shmid = -1;    // ID pamięci dzielonej (IPC) - przechowuje PID-y dronów
+static struct SharedState *shared_mem = NULL; // Wskaźnik do podłączonej pamięci dzielonej
+// Zmienna sterująca pętlą główną. 'volatile' oznacza, że może się zmienić z zewnątrz (przez sygnał)
 static volatile sig_atomic_t keep_running = 1;
 
-// Flagi sygnaw (Async-safe)
-// Ustawiane w handlerach, sprawdzane w ptli gwnej. Zapobiega to wycigom i bdom w funkcjach I/O.
+// Flagi sygnałów (Async-safe)
+// Ustawiane w handlerach, sprawdzane w pętli głównej. Zapobiega to wyścigom i błędom w funkcjach I/O.
 static volatile sig_atomic_t flag_sig1 = 0; 
-static volatile sig_atomic_t flag_sig2 = 0; 
+static volatile sig_atomic_t flag_sig2 = 0;
+static volatile sig_atomic_t flag_ctl = 0;  // Zlecenie zmiany P z gniazda sterującego Commandera
+
+// Autoskaler (config.autoscale_max_p > 0). Okno metryk nie trafia do punktu kontrolnego -
+// następca po awarii zbiera je od nowa.
+static int autoscale = 0;
+static struct Autoscaler as;
+static double t_op_start = 0.0;
+static double land_t[MAX_DRONE_ID]; // Chwila prośby o lądowanie (0 = brak pomiaru) 
+
+// Rezerwacje okien lądowania (config.rsv_lookahead_s > 0). Kalendarz jest w st.rsv.
+static int reserving = 0;
+
+// Tryb partii: logi i zgody są zbierane i wysyłane razem na końcu wybudzenia
+static int batching = 0;
+static char log_buf[LOG_BUF_SIZE];
+static size_t log_len = 0;
+static struct msg_resp grant_buf[OP_BATCH_MAX];
+static int grant_n = 0;
 
-// Stan bazy
-static int current_P = 0;        // Aktualna pojemno hangaru (warto logiczna)
-static int pending_removal = 0;  // Liczba miejsc do usunicia, gdy drony wylec (Dug Techniczny przy skalowaniu w d)
-static int signal1_used = 0;     // Zabezpieczenie: Boost (powikszenie bazy) moliwy tylko raz
+// Szereg czasowy: liczniki zdarzeń od ostatniej próbki (TS_REQ_LAND..TS_DEAD = MSG_REQ_LAND..MSG_DEAD)
+static int sampling = 0;
+static double ts_interval = 0.0;
+static uint32_t ts_ev[TS_DELTAS];
+static uint64_t ts_last_grants = 0, ts_last_deferred = 0;
 
-static volatile int target_N = 0; // Docelowa liczba dronw (ktr utrzymuje Operator)
-static int current_active = 0;    // Liczba aktualnie ywych dronw (zarejestrowanych)
-static int next_drone_id = 0;     // Pomocnicza zmienna do szukania wolnych ID
+// --- TRYB WIELOWĄTKOWY (-M) ---
+// Wątek odbioru opróżnia kolejkę IPC do q_intake. Wątek główny (planista) jako jedyny posiada
+// stan kolejek, tuneli i pojemności oraz wysyła zgody. Wątek pomocniczy wykonuje fork/exec
+// dronów z Replenish i zapisuje logi (plik + terminal). Między wątkami tylko kolejki SPSC.
+#define INTAKE_CAP (MAX_DRONE_ID * QUEUE_MSGS_PER_DRONE * 2)
+// Przerwanie msgrcv wątku odbioru przy zamykaniu. Nie SIGALRM - ten należy do zegara timed_msgrcv
+// (zegar procesu: jego sygnał mógłby trafić do wątku odbioru, a sigaction nadpisałby obsługę).
+#define INTAKE_SIGNAL (SIGRTMIN + 1)
+#define LOG_CHUNK 4092
+#define LOG_TO_FILE    0
+#define LOG_TO_CONSOLE 1
+struct OpMsg { struct msg_req req; double t_in; }; // t_in = chwila odbioru przez wątek odbioru
+struct SpawnReq { int id; };
+struct SpawnRes { int id; pid_t pid; double fork_ms; };
+struct LogChunk { uint16_t kind; uint16_t len; char text[LOG_CHUNK]; };
+
+static int threaded = 0;
+static int threads_stop = 0, intake_done = 0; // Atomowo
+static struct SpscWaker w_sched, w_aux, w_intake;
+// Okno odbioru: wątek odbioru wyprzedza ostatni punkt kontrolny najwyżej o jedną partię (-b K).
+// Reszta czeka w kolejce IPC, która przeżywa awarię Operatora - tracimy co najwyżej K wiadomości,
+// tak jak w trybie partii bez -M.
+static uint64_t intake_taken = 0;     // Wiadomości przekazane do q_intake (wątek odbioru)
+static uint64_t intake_popped = 0;    // Wiadomości pobrane z q_intake (planista)
+static uint64_t intake_committed = 0; // intake_popped z chwili ostatniego punktu kontrolnego (atomowo)
+static uint32_t intake_window = 1;
+static struct Spsc q_intake;   // odbiór -> planista
+static struct Spsc q_spawn;    // planista -> pomocniczy (ID do utworzenia)
+static struct Spsc q_spawned;  // pomocniczy -> planista (wynik fork)
+static struct Spsc q_log;      // planista -> pomocniczy (tekst logów)
+static pthread_t t_intake, t_aux;
+static uint8_t spawn_pending[MAX_DRONE_ID]; // ID zarezerwowane dla trwającego fork
+static int spawns_inflight = 0;
+static char con_buf[LOG_BUF_SIZE]; // Tekst na terminal (bez znacznika czasu), jak vprintf w olog
+static size_t con_len = 0;
+static char spawn_path[PATH_MAX];
+
+void checkpoint_commit();
+int process_queues();
+int drain_queues();
+void size_message_queue(int target_N);
+void send_grant(int id, int channel);
+void send_response(long mtype, int value);
+
+// Zapis zebranych logów partii jednym wywołaniem (zamiast fopen/fclose na każdą linię)
+void log_push(int kind, const char *text, size_t len);
+
+void flush_log() {
+    if (threaded) {
+        // Planista nie pisze do pliku ani na terminal - tekst przejmuje wątek pomocniczy
+        log_push(LOG_TO_FILE, log_buf, log_len);
+        log_push(LOG_TO_CONSOLE, con_buf, con_len);
+        log_len = con_len = 0;
+        return;
+    }
+    if (log_len == 0) return;
+    TRACE_BEGIN(TR_LOG_FLUSH);
+    FILE *f = fopen("operator.txt", "a");
+    if (f) {
+        fwrite(log_buf, 1, log_len, f);
+        fclose(f);
+    }
+    TRACE_END(TR_LOG_FLUSH, (int)log_len);
+    log_len = 0;
+}
 
 // --- LOGOWANIE ---
-// Funkcja zapisujca logi do pliku operator.txt z dat i godzin
+// Funkcja zapisująca logi do pliku operator.txt z datą i godziną
 void olog(const char *format, ...) {
-    va_list args;           // Lista argumentw dla funkcji o zmiennej liczbie parametrw
+    va_list args;           // Lista argumentów dla funkcji o zmiennej liczbie parametrów
+    if (threaded) {
+        // Tryb -M: linia trafia do buforów planisty (plik ze znacznikiem czasu, terminal bez)
+        char line[512];
+        va_start(args, format);
+        int n = vsnprintf(line, sizeof(line), format, args);
+        va_end(args);
+        if (n <= 0) return;
+        if ((size_t)n >= sizeof(line)) n = sizeof(line) - 1;
+        if (log_len + n + 16 > sizeof(log_buf) || con_len + n > sizeof(con_buf)) flush_log();
+        time_t now = time(NULL);
+        struct tm tmv;
+        localtime_r(&now, &tmv);
+        log_len += strftime(log_buf + log_len, sizeof(log_buf) - log_len, "[%H:%M:%S] ", &tmv);
+        memcpy(log_buf + log_len, line, n);
+        log_len += n;
+        memcpy(con_buf + con_len, line, n);
+        con_len += n;
+        return;
+    }
     va_start(args, format); // Inicjalizacja listy
-    vprintf(format, args);  // Wypisanie na konsol
+    vprintf(format, args);  // Wypisanie na konsolę
     va_end(args);           // Czyszczenie
 
+    if (batching) {
+        // W partii dopisujemy do bufora w pamięci; plik dostaje całość w flush_log()
+        if (log_len + 512 > sizeof(log_buf)) flush_log();
+        time_t now = time(NULL);
+        struct tm *t = localtime(&now);
+        log_len += strftime(log_buf + log_len, sizeof(log_buf) - log_len, "[%H:%M:%S] ", t);
+        va_start(args, format);
+        int n = vsnprintf(log_buf + log_len, sizeof(log_buf) - log_len, format, args);
+        va_end(args);
+        if (n > 0) log_len += ((size_t)n < sizeof(log_buf) - log_len) ? (size_t)n : sizeof(log_buf) - log_len - 1;
+        return;
+    }
+
+    TRACE_BEGIN(TR_LOG_FLUSH);
     FILE *f = fopen("operator.txt", "a"); // Otwarcie pliku w trybie dopisywania ("append")
     if (f) {
         time_t now = time(NULL);        // Pobranie czasu
@@ -83,326 +201,1034 @@ void olog(const char *format, ...) {
         char timebuf[32];
         strftime(timebuf, sizeof(timebuf), "%H:%M:%S", t); // Formatowanie godziny
         fprintf(f, "[%s] ", timebuf);   // Zapis znacznika czasu
-        va_start(args, format);         // Ponowne pobranie argumentw dla pliku
-        vfprintf(f, format, args);      // Zapis treci logu
+        va_start(args, format);         // Ponowne pobranie argumentów dla pliku
+        vfprintf(f, format, args);      // Zapis treści logu
         va_end(args);
-        fclose(f);                      // Zamknicie pliku
+        fclose(f);                      // Zamknięcie pliku
     }
+    TRACE_END(TR_LOG_FLUSH, 0);
 }
 
-// --- HANDLERY SYGNAW ---
-// Handlery s minimalistyczne - ustawiaj tylko flag. Caa cika praca dzieje si w main().
-void sigusr1_handler(int sig) { (void)sig; flag_sig1 = 1; } // Reakcja na sygna "1" (Grow)
-void sigusr2_handler(int sig) { (void)sig; flag_sig2 = 1; } // Reakcja na sygna "2" (Shrink)
+// --- HANDLERY SYGNAŁÓW ---
+// Handlery są minimalistyczne - ustawiają tylko flagę. Cała ciężka praca dzieje się w main().
+// Reakcja na sygnał "1" (Grow). SIGUSR1 z wartością CTL_WAKE to zlecenie z gniazda sterującego.
+void sigusr1_handler(int sig, siginfo_t *info, void *uctx) {
+    (void)sig; (void)uctx;
+    if (info->si_code == SI_QUEUE && info->si_value.sival_int == CTL_WAKE) flag_ctl = 1;
+    else flag_sig1 = 1;
+}
+void sigusr2_handler(int sig) { (void)sig; flag_sig2 = 1; } // Reakcja na sygnał "2" (Shrink)
 
-// Handler SIGCHLD - zapobiega powstawaniu procesw Zombie
+// Handler SIGCHLD - zapobiega powstawaniu procesów Zombie
 void sigchld_handler(int sig) {
     (void)sig;
-    int saved_errno = errno; // Zapisujemy errno, bo waitpid moe je zmieni, co zepsuoby logik w main
-    // waitpid z WNOHANG sprzta wszystkie martwe dzieci bez blokowania programu
+    int saved_errno = errno; // Zapisujemy errno, bo waitpid może je zmienić, co zepsułoby logikę w main
+    // waitpid z WNOHANG sprząta wszystkie martwe dzieci bez blokowania programu
     while (waitpid(-1, NULL, WNOHANG) > 0); 
     errno = saved_errno;     // Przywracamy errno
 }
 
-// Handler SIGINT (Ctrl+C) - bezpieczne zatrzymanie ptli
+// Handler SIGINT (Ctrl+C) - bezpieczne zatrzymanie pętli
 void cleanup(int sig) { (void)sig; keep_running = 0; }
 
-// --- OBSUGA KOLEJEK (Circular Buffer) ---
-// Dodanie drona do kolejki oczekujcych
-void enqueue(int type, int id) {
-    // Obliczamy nowy indeks ogona (modulo zapewnia cykliczno - powrt do 0 po osigniciu koca tablicy)
-    int next = (q_tail[type] + 1) % WAITQ_CAP;
-    if (next == q_head[type]) return; // Jeli ogon dogoni gow -> kolejka jest pena, odrzucamy
-    waitq[type][q_tail[type]] = id;   // Zapisanie ID drona
-    q_tail[type] = next;              // Przesunicie ogona
-}
-
-// Pobranie drona z kolejki
-int dequeue(int type) {
-    // Dopki kolejka nie jest pusta (gowa != ogon)
-    while (q_head[type] != q_tail[type]) {
-        int id = waitq[type][q_head[type]]; // Pobranie ID spod gowy
-        q_head[type] = (q_head[type] + 1) % WAITQ_CAP; // Przesunicie gowy
-        if (id != -1) return id; // Zwr ID jeli dron jest "ywy" (nie ma flagi -1)
-    }
-    return -1; // Kolejka pusta
-}
-
-// Usuwanie martwego drona z kolejki (Lazy Deletion)
-void remove_dead(int id) {
-    for (int t = 0; t < 2; t++) { // Sprawdzamy obie kolejki (Start/Ldowanie)
-        int i = q_head[t];
-        while (i != q_tail[t]) { // Przegldamy ca zajt cz bufora
-            // Jeli znajdziemy ID martwego drona, zamazujemy go "-1"
-            // Funkcja dequeue pominie te wartoci. To szybsze ni przesuwanie caej tablicy.
-            if (waitq[t][i] == id) waitq[t][i] = -1;
-            i = (i + 1) % WAITQ_CAP;
-        }
-    }
+// Pomiar czasu oczekiwania na lądowanie (od prośby do zgody)
+void note_land_request(int id) {
+    if (id >= 0 && id < MAX_DRONE_ID) land_t[id] = mono_time();
 }
 
-// --- ZARZDZANIE SEMAFOREM (MIEJSCA W BAZIE) ---
+// Kubełek histogramu opóźnień (LAT_BUCKETS): liczba bitów części całkowitej, ostatni zbiera resztę
+static int lat_bucket(double v) {
+    uint64_t x = v > 0 ? (uint64_t)v : 0;
+    int k = 0;
+    while (x > 0 && k < LAT_BUCKETS - 1) { x >>= 1; k++; }
+    return k;
+}
 
-// Prba zajcia miejsca w hangarze (operacja P / -1)
-int reserve_hangar_spot() {
-    // Struktura operacji: semafor nr 0, odejmij 1, flaga IPC_NOWAIT
-    struct sembuf op = {0, -1, IPC_NOWAIT};
-    // semop wykonuje operacj. Jeli semafor == 0, IPC_NOWAIT sprawia, e funkcja wraca z bdem EAGAIN
-    if (safe_semop(semid, &op, 1) == -1) {
-        if (errno != EAGAIN) { // Inny bd ni "brak miejsc" jest krytyczny
-            perror("[Operator] semop reserve failed");
-        }
-        return 0; // Fail - brak miejsc
+void note_land_grant(int id, int rsv_honored) {
+    if (rsv_honored && shared_mem != NULL) shared_mem->op_stats.rsv_honored++;
+    if (id < 0 || id >= MAX_DRONE_ID || land_t[id] == 0.0) return;
+    double w = mono_time() - land_t[id];
+    land_t[id] = 0.0;
+    if (autoscale) as_land_wait(&as, w);
+    if (shared_mem != NULL) {
+        struct OpStats *os = &shared_mem->op_stats;
+        os->land_waits++;
+        os->land_wait_sum += w;
+        if (w > os->land_wait_max) os->land_wait_max = w;
+        os->land_wait_hist[lat_bucket(w * 1000.0)]++;
     }
-    return 1; // Success - miejsce zarezerwowane
 }
 
-// Zwolnienie miejsca z obsug "Pending Removal" (Sygna 2)
-void free_hangar_spot() {
-    // Czy Commander kaza zmniejszy baz i mamy dug techniczny?
-    if (pending_removal > 0) {
-        // Zamiast oddawa miejsce, niszczymy je (spacamy dug)
-        // Dron wylecia, miejsce si zwolnio, ale my NIE zwikszamy semafora.
-        pending_removal--;
-        olog(C_MAGENTA "[Operator] Platform dismantled after departure. Pending: %d" C_RESET "\n", pending_removal);
-    } else {
-        // Normalne zwolnienie: semafor nr 0, dodaj 1 (+1)
-        struct sembuf op = {0, 1, 0};
-        if (safe_semop(semid, &op, 1) == -1) {
-            perror("[Operator] semop free failed");
+// --- SEMAFOR HANGARU (LUSTRO STANU RDZENIA) ---
+
+// Zmiana semafora o 'delta'. Rdzeń zmniejsza go tylko przy wolnych miejscach, więc IPC_NOWAIT
+// nie powinno trafić na zero - błąd oznacza rozjazd lustra ze stanem.
+void hangar_semop(int delta) {
+    struct sembuf op = {SEM_HANGAR, (short)delta, delta < 0 ? IPC_NOWAIT : 0};
+    if (safe_semop(semid, &op, 1) == -1) perror("[Operator] semop hangar failed");
+}
+
+// Wykonanie akcji rdzenia planisty (zgody, semafor, logi) w kolejności ich powstania
+void apply_actions() {
+    for (int i = 0; i < so.n; i++) {
+        const struct SchAction *a = &so.a[i];
+        switch (a->kind) {
+            case SCH_GRANT_LAND:
+                send_grant(a->id, a->ch);
+                note_land_grant(a->id, a->arg);
+                if (shared_mem != NULL) shared_mem->op_stats.grants_dir[0]++;
+                olog(C_GREEN "[Operator] GRANT LAND %d via Ch %d" C_RESET "\n", a->id, a->ch);
+                break;
+            case SCH_GRANT_TAKEOFF:
+                send_grant(a->id, a->ch);
+                if (shared_mem != NULL) shared_mem->op_stats.grants_dir[1]++;
+                olog(C_GREEN "[Operator] GRANT TAKEOFF drone %d via Channel %d" C_RESET "\n", a->id, a->ch);
+                break;
+            case SCH_REGRANT: // Zgoda poprzednika, która nie dotarła - ta sama, już policzona w statystykach
+                send_response(RESPONSE_BASE + a->id, a->ch);
+                olog(C_GREEN "[Operator] RESEND GRANT %s drone %d via Channel %d (issued before recovery)" C_RESET "\n",
+                     a->arg == MSG_REQ_LAND ? "LAND" : "TAKEOFF", a->id, a->ch);
+                break;
+            case SCH_SEM:
+                hangar_semop(a->arg);
+                break;
+            case SCH_DISMANTLED: // Dron wyleciał, ale miejsce nie wraca do puli (spłata długu Sygnału 2)
+                olog(C_MAGENTA "[Operator] Platform dismantled after departure. Pending: %d" C_RESET "\n", a->arg);
+                break;
+            case SCH_BLOCKED:
+                olog(C_RED "[Operator] BLOCKED %d" C_RESET "\n", a->id);
+                if (shared_mem != NULL) shared_mem->op_stats.blocked++;
+                break;
         }
     }
+    so.n = 0;
 }
 
-// Pobranie aktualnej wartoci semafora (liczby wolnych miejsc) bez zmieniania go
-int get_hangar_free_slots() {
-    // GETVAL to komenda "odczytaj warto"
-    int val = semctl(semid, 0, GETVAL);
-    if (val == -1) perror("[Operator] semctl GETVAL failed");
-    return val;
+// Miejsce dla drona tworzonego w bazie (1 = zajęte) i jego zwrot, gdy drona jednak nie będzie
+int reserve_hangar_spot() {
+    int ok = sch_take_spot(&st, &so);
+    apply_actions();
+    return ok;
+}
+
+void rollback_hangar_spot() {
+    sch_return_spot(&st, &so);
+    apply_actions();
 }
 
 // --- DYNAMICZNE SKALOWANIE ---
 
-// Funkcja obsugujca rozkaz '1' - powikszenie bazy
+// Funkcja obsługująca rozkaz '1' - powiększenie bazy
 void increase_base_capacity() {
-    if (signal1_used) { // Zabezpieczenie przed wielokrotnym uyciem
+    int res = sch_grow(&st, &so);
+    apply_actions();
+    if (res == SCH_IGNORED) { // Zabezpieczenie przed wielokrotnym użyciem
         olog(C_YELLOW "[Operator] Signal 1 IGNORED (One-time use only)." C_RESET "\n");
+    } else if (res == SCH_DENIED) { // Podwojenie populacji nie zmieści się w tablicy PID
+        olog(C_RED "[Operator] Signal 1 DENIED: Doubling population (%d -> %d) exceeds system limit (%d)." C_RESET "\n",
+             st.target_N, st.target_N * 2, MAX_DRONE_ID);
+    } else {
+        olog(C_BLUE "[Operator] !!! BASE EXPANDED !!! New P=%d, New Target N=%d" C_RESET "\n", st.current_P, st.target_N);
+        drain_queues();
+    }
+}
+
+// Funkcja obsługująca rozkaz '2' - pomniejszenie bazy (zajęte miejsca znikają po wylocie dronów)
+void decrease_base_capacity() {
+    int removed;
+    int res = sch_shrink(&st, &so, &removed);
+    apply_actions();
+    if (res == SCH_IGNORED) { // Nie możemy zejść do 0 miejsc
+        olog(C_YELLOW "[Operator] Signal 2 IGNORED (Minimum P=1 reached)." C_RESET "\n");
         return;
     }
-    
-    // Obliczamy, ile dronw mielibymy po powikszeniu
-    int potential_new_N = target_N * 2;
+    olog(C_MAGENTA "[Operator] !!! BASE SHRINKING !!! New P=%d, Target N=%d. Removed now: %d, Pending: %d" C_RESET "\n",
+         st.current_P, st.target_N, removed, st.pending_removal);
+}
+
+// Zmiana P o dowolny krok (autoskaler, gniazdo sterujące). Wzrost docelowego N poszerza kolejkę.
+void resize_base(int new_P) {
+    int grew_N = sch_resize(&st, new_P, &so);
+    apply_actions();
+    if (grew_N) size_message_queue(st.target_N);
+    drain_queues();
+}
+
+// Zlecenie z gniazda sterującego: P zmienia się o sumę zleceń od ostatniego odczytu
+void apply_ctl_resize() {
+    if (shared_mem == NULL) return;
+    int delta = __atomic_exchange_n(&shared_mem->ctl_resize, 0, __ATOMIC_SEQ_CST);
+    if (delta == 0) return;
+    int max_P = (MAX_DRONE_ID - 1) / 2; // P < N/2 przy N <= MAX_DRONE_ID
+    int new_P = st.current_P + delta;
+    if (new_P < 1) new_P = 1;
+    if (new_P > max_P) new_P = max_P;
+    int old_P = st.current_P;
+    resize_base(new_P);
+    if (autoscale) as_changed(&as, mono_time()); // Stare okno autoskalera opisuje poprzednie P
+    olog(C_BLUE "[Operator] CONTROL RESIZE P %d -> %d (requested %+d, N %d). Pending: %d" C_RESET "\n",
+         old_P, st.current_P, delta, st.target_N, st.pending_removal);
+}
 
-    // Sprawdzamy czy nie przekroczymy limitu tablicy w pamici dzielonej
-    if (potential_new_N > MAX_DRONE_ID) {
-        olog(C_RED "[Operator] Signal 1 DENIED: Doubling population (%d -> %d) exceeds system limit (%d)." C_RESET "\n", 
-             target_N, potential_new_N, MAX_DRONE_ID);
-        return; // Przerywamy! Nie zmieniamy semafora ani N.
+// Rozmieszczenie Operatora (Commander -p/-q): własny rdzeń i wyższy priorytet, żeby
+// pojedynczy punkt serializacji nie czekał w kolejce planisty za setkami dronów
+void apply_placement(const struct SwarmConfig *cfg, struct OpStats *os) {
+    char msg[160];
+    os->op_cpu = -1;
+    if (cfg->placement & PL_OP_CPU) {
+        int ok = pl_pin_cpu(cfg->op_cpu, msg, sizeof(msg)) == 0;
+        if (ok) os->op_cpu = cfg->op_cpu;
+        olog("%s[Operator] Placement: %s." C_RESET "\n", ok ? C_BLUE : C_YELLOW, msg);
+    }
+    if (cfg->op_policy != PL_POLICY_DEFAULT) {
+        int pol, prio;
+        int ok = pl_set_policy(cfg->op_policy, cfg->op_prio, &pol, &prio, msg, sizeof(msg)) == 0 && pol == cfg->op_policy;
+        os->op_policy = pol;
+        os->op_prio = prio;
+        olog("%s[Operator] Scheduling: %s." C_RESET "\n", ok ? C_BLUE : C_YELLOW, msg);
     }
+}
+
+// Obieg autoskalera: próbka stanu, a po zamknięciu sekundowego kubełka - ocena okna
+void autoscale_tick(double now) {
+    int busy = 0;
+    for (int i = 0; i < CHANNELS; i++) if (st.chan_users[i] > 0) busy++;
+    double occ = st.current_P > 0 ? (double)st.occupied / st.current_P : 0.0;
+    if (!as_sample(&as, now, sch_queue_depth(&st, 0), (double)busy / CHANNELS, occ)) return;
 
-    int added_slots = current_P; // Chcemy podwoi, wic dodajemy drugie tyle miejsc
-    current_P *= 2;
-    target_N *= 2;
-    signal1_used = 1;
+    struct AsDecision d;
+    int P = as_decide(&as, now, st.current_P, &d);
+    if (P == st.current_P) return;
 
-    // Fizyczne zwikszenie semafora o 'added_slots' (operacja V o wartoci > 1)
-    struct sembuf op = {0, added_slots, 0};
-    if (safe_semop(semid, &op, 1) == -1) { 
-        perror("[Operator] semop increase failed");
+    resize_base(P);
+    as_changed(&as, now);
+    d.t = (float)(now - t_op_start);
+    d.n_to = (int16_t)st.target_N;
+    olog(C_BLUE "[Operator] AUTOSCALE %s P %d -> %d (N %d). Window: queue %.1f, wait %.2fs, deaths %u, channels %.0f%%, hangar %.0f%%. Pending: %d" C_RESET "\n",
+         P > d.p_from ? "GROW" : "SHRINK", d.p_from, P, st.target_N, d.depth, d.wait, d.deaths,
+         d.util * 100.0, d.occ * 100.0, st.pending_removal);
+    if (shared_mem != NULL) {
+        struct OpStats *os = &shared_mem->op_stats;
+        if (P > d.p_from) os->as_grows++; else os->as_shrinks++;
+        if (P < os->as_p_min) os->as_p_min = P;
+        if (P > os->as_p_max) os->as_p_max = P;
+        os->as_log[os->as_n % AS_LOG] = d;
+        os->as_n++;
     }
-    
-    olog(C_BLUE "[Operator] !!! BASE EXPANDED !!! New P=%d, New Target N=%d" C_RESET "\n", current_P, target_N);
+    checkpoint_commit();
 }
 
-// Funkcja obsugujca rozkaz '2' - pomniejszenie bazy
-void decrease_base_capacity() {
-    if (current_P <= 1) { // Nie moemy zej do 0 miejsc
-        olog(C_YELLOW "[Operator] Signal 2 IGNORED (Minimum P=1 reached)." C_RESET "\n");
+// --- KOLEJKA KOMUNIKATÓW: ROZMIAR I NASYCENIE ---
+
+// Ustawienie msg_qbytes tak, by zmieścić ruch roju o docelowym N (z zapasem na podwojenie sygnałem 1).
+// msg_qbytes liczy tylko treść wiadomości (bez mtype) - tyle, ile podajemy w msgsnd.
+// Bez CAP_SYS_RESOURCE limit to kernel.msgmnb - wtedy bierzemy tyle, ile wolno.
+void size_message_queue(int target_N) {
+    struct msqid_ds ds;
+    if (msgctl(msqid, IPC_STAT, &ds) == -1) { perror("[Operator] msgctl IPC_STAT"); return; }
+    unsigned long drones = 2UL * target_N < MAX_DRONE_ID ? 2UL * target_N : MAX_DRONE_ID;
+    unsigned long want = drones * QUEUE_MSGS_PER_DRONE * (sizeof(struct msg_resp) - sizeof(long));
+    if (want > ds.msg_qbytes) {
+        unsigned long old = ds.msg_qbytes;
+        ds.msg_qbytes = want;
+        if (msgctl(msqid, IPC_SET, &ds) == -1) {
+            // Próba z limitem systemowym (podniesienie do msgmnb nie wymaga uprawnień)
+            FILE *f = fopen("/proc/sys/kernel/msgmnb", "r");
+            unsigned long mnb = 0;
+            if (f) { if (fscanf(f, "%lu", &mnb) != 1) mnb = 0; fclose(f); }
+            ds.msg_qbytes = mnb > old ? mnb : old;
+            if (ds.msg_qbytes > old && msgctl(msqid, IPC_SET, &ds) == -1) ds.msg_qbytes = old;
+            olog(C_YELLOW "[Operator] Queue limit %lu B below wanted %lu B (no CAP_SYS_RESOURCE). Grants will be deferred when full." C_RESET "\n",
+                 (unsigned long)ds.msg_qbytes, want);
+        } else {
+            olog("[Operator] Queue limit raised %lu -> %lu B.\n", old, want);
+        }
+    }
+    if (shared_mem != NULL) shared_mem->op_stats.q_limit_bytes = ds.msg_qbytes;
+}
+
+// Próbka zajętości kolejki (IPC_STAT) do statystyk
+void sample_queue() {
+    struct msqid_ds ds;
+    if (shared_mem == NULL || msgctl(msqid, IPC_STAT, &ds) == -1) return;
+    struct OpStats *os = &shared_mem->op_stats;
+    if (ds.__msg_cbytes > os->q_max_bytes) os->q_max_bytes = ds.__msg_cbytes;
+    if (ds.msg_qnum > os->q_max_msgs) os->q_max_msgs = ds.msg_qnum;
+}
+
+// Próbka szeregu czasowego (pętla zdarzeń, między partiami)
+void take_sample() {
+    struct TsSample s;
+    memset(&s, 0, sizeof(s));
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    s.t = ts.tv_sec + ts.tv_nsec / 1e9;
+    int free_slots = sch_free_slots(&st);
+    s.P = (uint16_t)st.current_P;
+    s.occupied = (uint16_t)st.occupied;
+    s.free_slots = (uint16_t)(free_slots > 0 ? free_slots : 0);
+    s.pending_removal = (uint16_t)st.pending_removal;
+    s.q_land = (uint16_t)sch_queue_depth(&st, 0);
+    s.q_takeoff = (uint16_t)sch_queue_depth(&st, 1);
+    s.active = (uint16_t)(st.current_active > 0 ? st.current_active : 0);
+    s.target_N = (uint16_t)st.target_N;
+    for (int i = 0; i < CHANNELS; i++) { s.chan_dir[i] = (uint8_t)st.chan_dir[i]; s.chan_users[i] = (uint16_t)st.chan_users[i]; }
+    memcpy(s.d, ts_ev, sizeof(s.d));
+    memset(ts_ev, 0, sizeof(ts_ev));
+    if (shared_mem != NULL) {
+        const struct OpStats *os = &shared_mem->op_stats;
+        s.d[TS_GRANTS] = (uint32_t)(os->grants - ts_last_grants);
+        s.d[TS_DEFERRED] = (uint32_t)(os->grants_deferred - ts_last_deferred);
+        ts_last_grants = os->grants;
+        ts_last_deferred = os->grants_deferred;
+    }
+    ts_write(&s);
+}
+
+int retry_len() { return (st.r_tail - st.r_head + RETRY_CAP) % RETRY_CAP; }
+
+// Zgoda do kolejki odłożonych (kolejka komunikatów pełna)
+void defer_grant(const struct msg_resp *resp) {
+    if (retry_len() == 0) {
+        olog(C_RED "[Operator] QUEUE SATURATED - deferring grants." C_RESET "\n");
+        if (shared_mem != NULL) shared_mem->op_stats.saturations++;
+        sample_queue();
+    }
+    int next = (st.r_tail + 1) % RETRY_CAP;
+    if (next == st.r_head) { // Nie powinno się zdarzyć - najwyżej jedna zgoda na drona
+        olog(C_RED "[Operator] ERROR: retry queue full, grant for %ld lost!" C_RESET "\n", resp->mtype - RESPONSE_BASE);
         return;
     }
+    st.retry_id[st.r_tail] = (int)(resp->mtype - RESPONSE_BASE);
+    st.retry_ch[st.r_tail] = resp->channel_id;
+    st.r_tail = next;
+    if (shared_mem != NULL) {
+        shared_mem->op_stats.grants_deferred++;
+        if ((uint32_t)retry_len() > shared_mem->op_stats.retry_max) shared_mem->op_stats.retry_max = retry_len();
+    }
+}
 
-    int remove_cnt = current_P / 2; // Ile miejsc chcemy usun (poowa)
-    current_P -= remove_cnt;
-    target_N /= 2;
-    if (target_N < 1) target_N = 1;
+// Nieblokujące wysłanie zgody. Pełna kolejka = zgoda czeka w kolejce odłożonych (kolejność zachowana).
+// Blokujący msgsnd zakleszczyłby rój: drony wiszą w msgsnd z LANDED/DEPARTED, które ją opróżniają.
+void post_grant(const struct msg_resp *resp) {
+    if (retry_len() == 0) {
+        if (msgsnd(msqid, resp, sizeof(*resp) - sizeof(long), IPC_NOWAIT) == 0) return;
+        if (errno != EAGAIN && errno != EINTR) { perror("[Operator] msgsnd grant failed"); return; }
+    }
+    defer_grant(resp);
+}
 
-    // Prba usunicia wolnych slotw - sprawdzamy ile jest pustych
-    int free_slots = get_hangar_free_slots();
-    // Moemy usun natychmiast tyle, ile jest wolnych, ale nie wicej ni planujemy
-    int immediate_remove = (free_slots >= remove_cnt) ? remove_cnt : free_slots;
-    // Reszta to "dug" - musimy poczeka a drony wylec
-    int deferred_remove = remove_cnt - immediate_remove;
-    
-    // Usuwamy co si da od razu (zmniejszamy semafor)
-    if (immediate_remove > 0) {
-        struct sembuf op = {0, -immediate_remove, IPC_NOWAIT};
-        if (safe_semop(semid, &op, 1) == -1) {
-            perror("[Operator] semop decrease failed");
+// Ponowienie odłożonych zgód (na początku każdego obiegu pętli). Zwraca liczbę wysłanych.
+int retry_grants() {
+    int sent = 0;
+    while (retry_len() > 0) {
+        struct msg_resp resp;
+        resp.mtype = RESPONSE_BASE + st.retry_id[st.r_head];
+        resp.channel_id = st.retry_ch[st.r_head];
+        if (msgsnd(msqid, &resp, sizeof(resp) - sizeof(long), IPC_NOWAIT) == -1) {
+            if (errno == EAGAIN || errno == EINTR) break;
+            perror("[Operator] msgsnd retry failed");
         }
+        st.r_head = (st.r_head + 1) % RETRY_CAP;
+        sent++;
     }
-    
-    // Reszta "wisi" do usunicia w funkcji free_hangar_spot()
-    pending_removal += deferred_remove;
+    if (sent > 0 && retry_len() == 0) olog(C_GREEN "[Operator] Queue drained - deferred grants delivered." C_RESET "\n");
+    return sent;
+}
 
-    olog(C_MAGENTA "[Operator] !!! BASE SHRINKING !!! New P=%d, Target N=%d. Removed now: %d, Pending: %d" C_RESET "\n", 
-         current_P, target_N, immediate_remove, pending_removal);
+// Wysłanie zebranych zgód. Najpierw punkt kontrolny (zgody są już w stanie), potem msgsnd.
+void flush_grants() {
+    checkpoint_commit();
+    if (grant_n == 0) return;
+    TRACE_BEGIN(TR_GRANT_SEND);
+    for (int i = 0; i < grant_n; i++) post_grant(&grant_buf[i]);
+    TRACE_END(TR_GRANT_SEND, grant_n);
+    grant_n = 0;
 }
 
-// --- LOGIKA TUNELI ---
-// Znajduje ID tunelu pasujcego do danego kierunku
-int find_available_channel(int needed_dir) {
-    // Priorytet 1: Szukamy tunelu, ktry ju dziaa w tym kierunku (efekt konwoju)
-    for (int i = 0; i < CHANNELS; i++) {
-        if (chan_dir[i] == needed_dir) return i; // Istniejcy kierunek
+// Odpowiedź do drona. W partii czeka w buforze do końca przejścia planisty; bez partii idzie od
+// razu, ale też dopiero po punkcie kontrolnym - zgoda wysłana przed zapisem stanu, który ją zawiera,
+// zostawiłaby następcy nieaktualne 'occupied' (i semafor hangaru z nadmiarem miejsc).
+void send_response(long mtype, int value) {
+    struct msg_resp resp;
+    resp.mtype = mtype;
+    resp.channel_id = value;
+    if (batching) {
+        if (grant_n == OP_BATCH_MAX) flush_grants();
+        grant_buf[grant_n++] = resp;
+        return;
     }
-    // Priorytet 2: Szukamy cakowicie wolnego tunelu
+    checkpoint_commit();
+    // Wysyłka nieblokująca - pełna kolejka nie zatrzymuje Operatora (patrz post_grant)
+    TRACE_BEGIN(TR_GRANT_SEND);
+    post_grant(&resp);
+    TRACE_END(TR_GRANT_SEND, 1);
+}
+
+// Wysłanie wiadomości "Grant" (Zgoda) do drona
+void send_grant(int id, int channel) {
+    if (shared_mem != NULL) shared_mem->op_stats.grants++;
+    send_response(RESPONSE_BASE + id, channel); // Typ wiadomości = unikalny kanał drona (np. 10005)
+}
+
+// Odpowiedź na rezerwację (RSV_RESPONSE_BASE + id) - jak zgoda: w partii buforowana, przy pełnej
+// kolejce odkładana. start_ms = początek okna za tyle ms albo RSV_NO_WINDOW.
+void send_window(int id, int start_ms) { send_response(RSV_RESPONSE_BASE + id, start_ms); }
+
+// Dron zgłasza z wyprzedzeniem, że za eta_ms osiągnie próg krytyczny
+void on_reserve(int did, int eta_ms) {
+    static const char *res_names[] = {"confirmed", "counter-offer", "rejected"};
+    if (did < 0 || did >= MAX_DRONE_ID) return;
+    if (!reserving) { send_window(did, RSV_NO_WINDOW); return; }
+    double now = mono_time(), start = now;
+    rsv_release(&st.rsv, did, now); // Nowa rezerwacja zastępuje poprzednią
+    int res = rsv_book(&st.rsv, did, now, eta_ms / 1000.0, st.current_P, &start);
+    send_window(did, res == RSV_REJECTED ? RSV_NO_WINDOW : (int)((start - now) * 1000.0));
+    if (shared_mem != NULL) {
+        shared_mem->op_stats.rsv_requests++;
+        shared_mem->op_stats.rsv_result[res]++;
+    }
+    if (res == RSV_REJECTED) olog(C_YELLOW "[Operator] RESERVE drone %d: no window before +%.1fs." C_RESET "\n", did, eta_ms / 1000.0);
+    else olog(C_BLUE "[Operator] RESERVE drone %d: window +%.1fs (%s, critical +%.1fs)." C_RESET "\n",
+              did, start - now, res_names[res], eta_ms / 1000.0);
+}
+
+// Cel ładowania z puli: kolejka przed bazą = szybkie ładowanie częściowe (krótszy postój pod ładowarką
+// i na miejscu postojowym), pusta kolejka = do pełna
+void update_charge_target() {
+    int32_t target = sch_queue_depth(&st, 0) > 0 ? CHARGE_PARTIAL : 100;
+    if (target == shared_mem->charge_target) return;
+    __atomic_store_n(&shared_mem->charge_target, target, __ATOMIC_RELAXED);
+    olog(C_BLUE "[Operator] Charge target %d%% (landing queue %s)." C_RESET "\n", target, target < 100 ? "waiting" : "empty");
+}
+
+// Obieg kalendarza: przesunięcie slotów i ustawienie tunelu na wlot przed zarezerwowanym oknem.
+// Najwyżej jeden tunel czeka pusty w kierunku IN - drugi zostaje dla startów.
+void rsv_tick(double now) {
+    rsv_advance(&st.rsv, now);
+    int due = rsv_due(&st.rsv, now, 1);
+    int in = -1, idle = -1;
     for (int i = 0; i < CHANNELS; i++) {
-        if (chan_dir[i] == DIR_NONE) return i; // Wolny kana
+        if (st.chan_dir[i] == DIR_IN) in = i;
+        else if (st.chan_dir[i] == DIR_NONE && idle == -1) idle = i;
     }
-    return -1; // Brak dostpnych tuneli
+    if (due > 0 && in == -1 && idle != -1) {
+        st.chan_dir[idle] = DIR_IN; // chan_users = 0: pierwszy wlot pójdzie tym tunelem
+        if (shared_mem != NULL) shared_mem->op_stats.rsv_prepositions++;
+        olog(C_BLUE "[Operator] Channel %d pre-positioned IN for %d reserved landing(s)." C_RESET "\n", idle, due);
+    } else if (due == 0 && in != -1 && st.chan_users[in] == 0) {
+        st.chan_dir[in] = DIR_NONE; // Okno minęło - tunel wraca do puli (mogą go wziąć starty)
+        if (sch_queue_depth(&st, 1) > 0) process_queues();
+    } else return;
+    checkpoint_commit();
 }
 
-// Wysanie wiadomoci "Grant" (Zgoda) do drona
-void send_grant(int id, int channel) {
-    struct msg_resp resp;
-    resp.mtype = RESPONSE_BASE + id; // Typ wiadomoci = unikalny kana drona (np. 10005)
-    resp.channel_id = channel;       // Przydzielony numer tunelu
-    // msgsnd wrzuca wiadomo do kolejki. Odejmujemy sizeof(long) bo mtype si nie liczy do rozmiaru danych.
-    if (msgsnd(msqid, &resp, sizeof(resp) - sizeof(long), 0) == -1) {
-        perror("[Operator] msgsnd grant failed");
-    }
-}
-
-// Przetwarzanie oczekujcych dronw (Scheduler)
-void process_queues() {
-    // 1. Obsuga wylotw (START) - maj priorytet, bo zwalniaj miejsca w hangarze
-    int cid_out = find_available_channel(DIR_OUT); // Szukamy tunelu na zewntrz
-    if (cid_out != -1) {
-        int id = dequeue(1); // Pobieramy drona z kolejki startowej
-        if (id != -1) {
-            // Aktualizujemy stan tunelu i wysyamy zgod
-            chan_dir[cid_out] = DIR_OUT; chan_users[cid_out]++; send_grant(id, cid_out);
-            olog(C_GREEN "[Operator] GRANT TAKEOFF drone %d via Channel %d" C_RESET "\n", id, cid_out);
-        }
+// Przetwarzanie oczekujących dronów (Scheduler). Zwraca liczbę wydanych zgód.
+int process_queues() {
+    int granted = sch_pass(&st, &so);
+    apply_actions();
+    return granted;
+}
+
+// Przejścia planisty, dopóki pojawiają się nowe zgody (koniec partii, zmiana P). Po wzroście P
+// wolne miejsca trafiają do czekających od razu, a nie przy najbliższym LANDED / DEPARTED.
+int drain_queues() {
+    TRACE_BEGIN(TR_SCHED_PASS);
+    int granted = 0, g;
+    while ((g = process_queues()) > 0) granted += g;
+    TRACE_END(TR_SCHED_PASS, granted);
+    return granted;
+}
+
+// --- OBSŁUGA ZDARZEŃ DRONÓW ---
+
+// Dron zgłasza śmierć (rdzeń usunął go już z kolejek i kalendarza)
+void on_dead(int did, int flags) {
+    if (flags & SCH_F_WAS_QUEUED) {
+        // Zginął w kolejce lądowania - sygnał dla autoskalera, że brakuje miejsc
+        if (autoscale) as_death_waiting(&as);
+        if (shared_mem != NULL) shared_mem->op_stats.deaths_waiting++;
     }
-    
-    // Jeli populacja jest za dua (trwa redukcja bazy), blokujemy ldowania
-    if (current_active > target_N) return; 
-
-    // 2. Obsuga wlotw (LDOWANIE) - Tylko jeli s fizyczne miejsca w hangarze
-    if (get_hangar_free_slots() > 0) {
-        int cid_in = find_available_channel(DIR_IN); // Szukamy tunelu do rodka
-        if (cid_in != -1) {
-            int id = dequeue(0); // Pobieramy drona z kolejki ldowania
-            if (id != -1) {
-                // Prba rezerwacji semafora (krytyczne!)
-                if (reserve_hangar_spot()) {
-                    // Sukces: mamy tunel I mamy miejsce. Wpuszczamy.
-                    chan_dir[cid_in] = DIR_IN; chan_users[cid_in]++; send_grant(id, cid_in);
-                    olog(C_GREEN "[Operator] GRANT LAND %d via Ch %d" C_RESET "\n", id, cid_in);
-                } else enqueue(0, id); // Powrt do kolejki jeli reserve_hangar_spot zawid (wycig)
-            }
-        }
+    if (did >= 0 && did < MAX_DRONE_ID) land_t[did] = 0.0;
+    if ((flags & SCH_F_RSV_FREED) && shared_mem != NULL) shared_mem->op_stats.rsv_released++;
+    if (flags & SCH_F_GRANT_FREED) olog(C_YELLOW "[Operator] Drone %d died holding a grant - channel and spot released." C_RESET "\n", did);
+    // Slot już pusty = śmierć rozliczona przy odtwarzaniu po awarii (nie liczymy drugi raz)
+    if (shared_mem == NULL || did < 0 || did >= MAX_DRONE_ID || shared_mem->drone_pids[did] != 0) {
+        st.current_active--; // Zmniejszamy licznik populacji
+    }
+    if (shared_mem != NULL && did >= 0 && did < MAX_DRONE_ID) shared_mem->drone_pids[did] = 0; // Czyścimy slot PID
+    olog(C_BLUE "[Operator] Active: %d/%d" C_RESET "\n", st.current_active, st.target_N);
+}
+
+// Zdarzenie drona przez rdzeń planisty, z logami i statystykami Operatora.
+// immediate = 1: prośby dostają zgodę od razu, jeśli mogą (tryb bez partii).
+void on_event(int type, int did, int arg, int immediate) {
+    if (type == MSG_DEAD) {
+        olog(C_RED "[Operator] RIP drone %d." C_RESET "\n", did);
+        if (shared_mem != NULL) shared_mem->op_stats.deaths++;
+    }
+    double now = type == MSG_DEAD ? mono_time() : 0.0;
+    int resend = (type == MSG_REQ_LAND || type == MSG_REQ_TAKEOFF) && arg == REQ_RESEND;
+    int flags = resend ? sch_resend(&st, type, did, immediate, now, &so) : sch_event(&st, type, did, immediate, now, &so);
+    if (flags & SCH_F_DUPLICATE) { // Dron już czeka albo ma zgodę - bez drugiej zgody i bez nowego czasu czekania
+        olog(C_YELLOW "[Operator] WARN: Duplicate %s request from %d ignored" C_RESET "\n",
+             type == MSG_REQ_LAND ? "LAND" : "TAKEOFF", did);
+        return;
+    }
+    if (type == MSG_REQ_LAND) note_land_request(did);
+    switch (type) {
+        case MSG_LANDED: // Dron wleciał do środka (zwolnił tunel, zajął hangar)
+            if (flags & SCH_F_NO_CHANNEL) olog(C_RED "[Operator] WARN: Unexpected LANDED from %d" C_RESET "\n", did);
+            else olog(C_CYAN "[Operator] Drone %d entered base." C_RESET "\n", did);
+            break;
+        case MSG_DEPARTED: // Dron wyleciał (zwolnił tunel i hangar)
+            if (flags & SCH_F_NO_CHANNEL) olog(C_RED "[Operator] WARN: Unexpected DEPARTED from %d" C_RESET "\n", did);
+            else olog(C_CYAN "[Operator] Drone %d left." C_RESET "\n", did);
+            break;
+        case MSG_DEAD:
+            on_dead(did, flags);
+            break;
+    }
+    apply_actions(); // Zgody i semafor po logach zdarzenia (jak dotąd: "left", potem demontaż)
+}
+
+// Obsługa pojedynczej wiadomości (tryb bez partii: zgoda wysyłana od razu)
+void handle_one(const struct msg_req *req) {
+    int did = req->drone_id;
+    if (req->mtype >= MSG_REQ_LAND && req->mtype <= MSG_DEAD) ts_ev[req->mtype - MSG_REQ_LAND]++;
+
+    // Maszyna stanów komunikatów - Reakcja na typ wiadomości
+    switch (req->mtype) {
+        case MSG_LANDED:   // Zwolnienie tunelu mogło odblokować innych - sprawdzamy kolejki
+        case MSG_DEPARTED: // Zwolnienie miejsca mogło odblokować lądujących - sprawdzamy kolejki
+        case MSG_DEAD:     // Spadek populacji do docelowego N odblokowuje wstrzymane lądowania
+            on_event(req->mtype, did, req->arg, 1);
+            drain_queues(); // Do wyczerpania - odblokowanych może być więcej niż jedno lądowanie
+            break;
+
+        case MSG_RESERVE: // Rezerwacja okna lądowania z wyprzedzeniem
+            on_reserve(did, req->arg);
+            break;
+
+        default: // Prośby o lądowanie / start (zgoda od razu albo kolejka)
+            on_event(req->mtype, did, req->arg, 1);
+            break;
+    }
+    checkpoint_commit(); // Każda obsłużona wiadomość kończy się spójnym punktem kontrolnym
+}
+
+// Obsługa partii: odbieramy do 'max' wiadomości, najpierw nanosimy wszystkie zmiany stanu,
+// potem jedno przejście planisty wydaje wszystkie możliwe zgody. Zwraca liczbę wiadomości.
+// Następna wiadomość partii: z wątku odbioru (tryb -M) albo prosto z kolejki IPC. 1 = jest.
+int next_msg(struct msg_req *req) {
+    if (threaded) {
+        struct OpMsg m;
+        if (!spsc_pop(&q_intake, &m)) return 0;
+        intake_popped++;
+        *req = m.req;
+        return 1;
     }
+    TRACE_BEGIN(TR_MSG_RECV);
+    ssize_t r = safe_msgrcv(msqid, req, sizeof(*req) - sizeof(long), -MSG_OP_MAX, IPC_NOWAIT);
+    TRACE_END(TR_MSG_RECV, r != -1);
+    if (r == -1) {
+        if (errno != ENOMSG && errno != EINTR) perror("[Operator] msgrcv failed");
+        return 0;
+    }
+    return 1;
+}
+
+int handle_batch(const struct msg_req *first, int max) {
+    batching = 1;
+    struct msg_req req = *first;
+    int n = 0;
+    for (;;) {
+        int did = req.drone_id;
+        if (req.mtype >= MSG_REQ_LAND && req.mtype <= MSG_DEAD) ts_ev[req.mtype - MSG_REQ_LAND]++;
+        // Prośby trafiają do kolejek FIFO - planista obsłuży je po kolei
+        if (req.mtype == MSG_RESERVE) on_reserve(did, req.arg);
+        else on_event(req.mtype, did, req.arg, 0);
+        if (++n >= max || !next_msg(&req)) break;
+    }
+
+    // Jedno przejście planisty - powtarzamy, dopóki pojawiają się nowe zgody
+    drain_queues();
+
+    flush_grants();
+    batching = 0;
+    flush_log();
+    return n;
 }
 
-// Tworzenie nowego drona (Wewntrz bazy) - Funkcja "Replenish"
+// Tworzenie nowego drona (Wewnątrz bazy) - Funkcja "Replenish"
 void spawn_new_drone() {
-    // Najpierw musimy zarezerwowa miejsce w hangarze dla nowego drona
+    // Najpierw musimy zarezerwować miejsce w hangarze dla nowego drona
     if (!reserve_hangar_spot()) {
         olog(C_RED "[Operator] ERROR: Tried to spawn drone inside base, but reserve failed!" C_RESET "\n");
         return; 
     }
 
-    // Szukamy pierwszego wolnego ID w "ksice adresowej" (Pami Dzielona)
-    // Recykling ID po zmarych dronach.
+    // Szukamy pierwszego wolnego ID w "książce adresowej" (Pamięć Dzielona)
+    // Recykling ID po zmarłych dronach.
     int new_id = -1;
     if (shared_mem != NULL) {
         for (int i = 0; i < MAX_DRONE_ID; i++) {
-            if (shared_mem->drone_pids[i] == 0) { // Slot wolny (0)
+            if (shared_mem->drone_pids[i] == 0 && !spawn_pending[i]) { // Slot wolny (0)
                 new_id = i;
                 break;
             }
         }
     }
 
-    // Zabezpieczenie na wypadek braku wolnych slotw ID (limit 1024)
+    // Zabezpieczenie na wypadek braku wolnych slotów ID (limit 1024)
     if (new_id == -1) {
         olog(C_RED "[Operator] CRITICAL: No free ID slots in Shared Memory (Limit %d reached)!" C_RESET "\n", MAX_DRONE_ID);
-        // Musimy odda semafor (Rollback), bo jednak nie tworzymy drona!
-        struct sembuf op = {0, 1, 0};
-        safe_semop(semid, &op, 1);
+        // Musimy oddać semafor (Rollback), bo jednak nie tworzymy drona!
+        rollback_hangar_spot();
         return;
     }
 
-    // Tworzenie procesu
-    pid_t pid = fork();
+    if (threaded) {
+        // fork/exec robi wątek pomocniczy - planista rezerwuje tylko miejsce i ID
+        struct SpawnReq sr = {new_id};
+        if (spsc_push(&q_spawn, &sr) == -1) {
+            olog(C_RED "[Operator] ERROR: spawn queue full, drone %d not created." C_RESET "\n", new_id);
+            rollback_hangar_spot();
+            return;
+        }
+        spawn_pending[new_id] = 1;
+        spawns_inflight++;
+        st.current_active++; // Liczony od razu - przegląd Replenish nie zleci go drugi raz
+        ts_ev[TS_SPAWNED]++;
+        return;
+    }
+
+    // Tworzenie procesu (rodzicem zostaje Commander - on nadzoruje i zbiera drony)
+    double t_fork = mono_time();
+    pid_t pid = fork_sibling();
     if (pid == -1) {
         perror("[Operator] fork failed");
-        // Rollback semafora w przypadku bdu fork
-        struct sembuf op = {0, 1, 0};
-        safe_semop(semid, &op, 1);
+        // Rollback semafora w przypadku błędu fork
+        rollback_hangar_spot();
         return;
     }
     
     if (pid == 0) { // Proces dziecka (Nowy Dron)
+        // Podwyższony priorytet należy się tylko Operatorowi (RT resetuje SCHED_RESET_ON_FORK, nice - my)
+        if (shared_mem != NULL && shared_mem->config.op_policy != PL_POLICY_DEFAULT) setpriority(PRIO_PROCESS, 0, 0);
         char idstr[16];
         snprintf(idstr, sizeof(idstr), "%d", new_id);
         // execl uruchamia program drona. Argument "1" oznacza "Startuj w bazie (tryb respawn)"
-        execl("./drone", "drone", idstr, "1", NULL); 
+        char path[PATH_MAX];
+        execl(swarm_bin("drone", path, sizeof(path)), "drone", idstr, "1", NULL);
         perror("[Operator] execl drone failed");
-        exit(1);
+        _exit(1); // Bez atexit - kopia Operatora nie może dopisać jego zużycia
     } else if (pid > 0) { // Proces rodzica (Operator)
+        double fork_ms = (mono_time() - t_fork) * 1000.0;
+        if (shared_mem != NULL && fork_ms > shared_mem->op_stats.spawn_ms_max) shared_mem->op_stats.spawn_ms_max = fork_ms;
         olog(C_BLUE "[Operator] REPLENISH: Spawned drone %d INSIDE BASE (pid %d). Slot recycled." C_RESET "\n", new_id, pid);
-        current_active++; // Aktualizacja licznika ywych dronw
+        st.current_active++; // Aktualizacja licznika żywych dronów
+        ts_ev[TS_SPAWNED]++;
         if (shared_mem != NULL) {
-            shared_mem->drone_pids[new_id] = pid; // Rejestracja PID w pamici dzielonej
+            shared_mem->drone_pids[new_id] = pid; // Rejestracja PID w pamięci dzielonej
+            shared_mem->op_stats.spawns++;
+        }
+    }
+}
+
+// --- WĄTKI TRYBU -M ---
+
+// Tekst logów do wątku pomocniczego. Pełna kolejka = utrata tekstu (planista nie czeka na dysk).
+void log_push(int kind, const char *text, size_t len) {
+    static struct LogChunk ch;
+    while (len > 0) {
+        size_t n = len < LOG_CHUNK ? len : LOG_CHUNK;
+        ch.kind = (uint16_t)kind;
+        ch.len = (uint16_t)n;
+        memcpy(ch.text, text, n);
+        if (spsc_push(&q_log, &ch) == -1) {
+            if (shared_mem != NULL) shared_mem->op_stats.log_dropped += len;
+            return;
+        }
+        text += n;
+        len -= n;
+    }
+}
+
+// Wyniki fork z wątku pomocniczego (PID jest już w pamięci dzielonej)
+void spawn_results() {
+    struct SpawnRes res;
+    while (spsc_pop(&q_spawned, &res)) {
+        spawn_pending[res.id] = 0;
+        spawns_inflight--;
+        if (shared_mem != NULL && res.fork_ms > shared_mem->op_stats.spawn_ms_max) shared_mem->op_stats.spawn_ms_max = res.fork_ms;
+        if (res.pid > 0) {
+            olog(C_BLUE "[Operator] REPLENISH: Spawned drone %d INSIDE BASE (pid %d, fork %.2f ms). Slot recycled." C_RESET "\n",
+                 res.id, res.pid, res.fork_ms);
+            if (shared_mem != NULL) shared_mem->op_stats.spawns++;
+        } else {
+            olog(C_RED "[Operator] SPAWN FAILED: fork for drone %d - slot returned." C_RESET "\n", res.id);
+            rollback_hangar_spot();
+            st.current_active--;
+        }
+    }
+}
+
+void intake_wake(int sig) { (void)sig; } // Tylko przerwanie msgrcv przy zamykaniu
+
+// Czekanie, aż planista zapisze punkt kontrolny obejmujący wcześniej odebrane wiadomości
+static void intake_wait_window() {
+    while (!__atomic_load_n(&threads_stop, __ATOMIC_ACQUIRE) &&
+           intake_taken - __atomic_load_n(&intake_committed, __ATOMIC_ACQUIRE) >= intake_window) {
+        spsc_arm(&w_intake);
+        if (intake_taken - __atomic_load_n(&intake_committed, __ATOMIC_SEQ_CST) >= intake_window)
+            spsc_sleep(&w_intake, mono_time() + OP_IDLE_WAIT);
+        else spsc_disarm(&w_intake);
+    }
+}
+
+// Wątek odbioru: blokujący msgrcv, potem opróżnienie kolejki bez czekania (w granicach okna)
+void *intake_main(void *arg) {
+    (void)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, INTAKE_SIGNAL);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+    struct OpMsg m;
+    while (!__atomic_load_n(&threads_stop, __ATOMIC_ACQUIRE)) {
+        intake_wait_window();
+        if (__atomic_load_n(&threads_stop, __ATOMIC_ACQUIRE)) break;
+        if (msgrcv(msqid, &m.req, sizeof(m.req) - sizeof(long), -MSG_OP_MAX, 0) == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EIDRM && errno != EINVAL) perror("[Operator] intake msgrcv failed");
+            break;
         }
+        do {
+            m.t_in = mono_time();
+            // Pełny bufor: planista nie nadąża - czekamy (dalsze wiadomości czekają w kolejce IPC)
+            while (spsc_push(&q_intake, &m) == -1 && !__atomic_load_n(&threads_stop, __ATOMIC_ACQUIRE)) {
+                struct timespec ts = {0, 100000L};
+                nanosleep(&ts, NULL);
+            }
+            intake_taken++;
+            intake_wait_window();
+        } while (!__atomic_load_n(&threads_stop, __ATOMIC_ACQUIRE) &&
+                 msgrcv(msqid, &m.req, sizeof(m.req) - sizeof(long), -MSG_OP_MAX, IPC_NOWAIT) != -1);
     }
+    __atomic_store_n(&intake_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Fork drona z wątku pomocniczego. Dziecko robi tylko setpriority i execl (ścieżka gotowa wcześniej).
+void aux_spawn(int id) {
+    char idstr[16];
+    snprintf(idstr, sizeof(idstr), "%d", id);
+    int reset_nice = shared_mem != NULL && shared_mem->config.op_policy != PL_POLICY_DEFAULT;
+    double t0 = mono_time();
+    pid_t pid = fork_sibling();
+    if (pid == 0) {
+        if (reset_nice) setpriority(PRIO_PROCESS, 0, 0);
+        execl(spawn_path, "drone", idstr, "1", NULL);
+        perror("[Operator] execl drone failed");
+        _exit(1);
+    }
+    if (pid == -1) perror("[Operator] fork failed");
+    else if (shared_mem != NULL) shared_mem->drone_pids[id] = pid; // Rejestracja przed raportem do planisty
+    struct SpawnRes res = {id, pid, (mono_time() - t0) * 1000.0};
+    while (spsc_push(&q_spawned, &res) == -1) {
+        struct timespec ts = {0, 1000000L};
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Wątek pomocniczy: fork dronów (pierwszeństwo) i zapis logów. Kończy po opróżnieniu kolejek.
+void *aux_main(void *arg) {
+    (void)arg;
+    static struct LogChunk ch;
+    FILE *lf = fopen("operator.txt", "a");
+    for (;;) {
+        struct SpawnReq sr;
+        int work = 0;
+        while (spsc_pop(&q_spawn, &sr)) { aux_spawn(sr.id); work = 1; }
+        if (spsc_pop(&q_log, &ch)) {
+            // Bez spanów TRACE - bufor śladu jest jeden na proces, a pary B/E dotyczą planisty
+            if (ch.kind == LOG_TO_CONSOLE) { fwrite(ch.text, 1, ch.len, stdout); fflush(stdout); }
+            else if (lf) { fwrite(ch.text, 1, ch.len, lf); fflush(lf); }
+            work = 1;
+        }
+        if (work) continue;
+        if (__atomic_load_n(&threads_stop, __ATOMIC_ACQUIRE)) break;
+        spsc_arm(&w_aux);
+        if (spsc_empty(&q_spawn) && spsc_empty(&q_log)) spsc_sleep(&w_aux, mono_time() + OP_IDLE_WAIT);
+        else spsc_disarm(&w_aux);
+    }
+    if (lf) fclose(lf);
+    return NULL;
+}
+
+// Start wątków. Niepowodzenie = praca jednowątkowa (komunikat w logu).
+int start_threads(int batch) {
+    intake_window = batch > 0 ? (uint32_t)batch : 1;
+    if (spsc_waker_init(&w_sched) == -1 || spsc_waker_init(&w_aux) == -1 || spsc_waker_init(&w_intake) == -1 ||
+        spsc_init(&q_intake, INTAKE_CAP, sizeof(struct OpMsg), &w_sched) == -1 ||
+        spsc_init(&q_spawned, MAX_DRONE_ID, sizeof(struct SpawnRes), &w_sched) == -1 ||
+        spsc_init(&q_spawn, MAX_DRONE_ID, sizeof(struct SpawnReq), &w_aux) == -1 ||
+        spsc_init(&q_log, 64, sizeof(struct LogChunk), &w_aux) == -1) {
+        perror("[Operator] thread queues");
+        return -1;
+    }
+    swarm_bin("drone", spawn_path, sizeof(spawn_path));
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = intake_wake; // Bez SA_RESTART - msgrcv wątku odbioru wraca z EINTR
+    if (sigaction(INTAKE_SIGNAL, &sa, NULL) == -1) { perror("[Operator] sigaction intake"); return -1; }
+
+    // Wątki dziedziczą maskę: sygnały Commandera trafiają wyłącznie do planisty (budzą go z poll)
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    int ok = pthread_create(&t_aux, NULL, aux_main, NULL) == 0;
+    if (ok && pthread_create(&t_intake, NULL, intake_main, NULL) != 0) {
+        __atomic_store_n(&threads_stop, 1, __ATOMIC_RELEASE);
+        spsc_waker_kick(&w_aux);
+        pthread_join(t_aux, NULL);
+        ok = 0;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (!ok) { perror("[Operator] pthread_create"); return -1; }
+    threaded = 1;
+    return 0;
+}
+
+void stop_threads() {
+    flush_log();
+    __atomic_store_n(&threads_stop, 1, __ATOMIC_RELEASE);
+    // msgrcv wątku odbioru mógł zacząć się tuż przed ustawieniem flagi - ponawiamy przerwanie
+    while (!__atomic_load_n(&intake_done, __ATOMIC_ACQUIRE)) {
+        pthread_kill(t_intake, INTAKE_SIGNAL);
+        struct timespec ts = {0, 10000000L};
+        nanosleep(&ts, NULL);
+    }
+    pthread_join(t_intake, NULL);
+    spsc_waker_kick(&w_aux);
+    pthread_join(t_aux, NULL); // Pomocniczy kończy po zapisaniu wszystkich logów i forków
+    threaded = 0;
+    spawn_results();
+    flush_log();
+}
+
+// Koniec snu pętli zdarzeń: przegląd, ponowienie odłożonych zgód albo próbka szeregu czasowego
+double idle_deadline(double next_ts) {
+    double deadline = mono_time() + (retry_len() > 0 ? OP_RETRY_WAIT : OP_IDLE_WAIT);
+    if (sampling && next_ts < deadline) deadline = next_ts; // Sen nie opóźnia próbki
+    return deadline;
+}
+
+// Opóźnienie od odbioru pierwszej wiadomości partii do wysłania jej zgód
+void note_grant_latency(double t_in) {
+    if (shared_mem == NULL) return;
+    struct OpStats *os = &shared_mem->op_stats;
+    int k = spawns_inflight > 0; // 1 = w trakcie trwał fork w wątku pomocniczym
+    double ms = (mono_time() - t_in) * 1000.0;
+    os->glat_n[k]++;
+    os->glat_sum[k] += ms;
+    if (ms > os->glat_max[k]) os->glat_max[k] = ms;
+    os->glat_hist[lat_bucket(ms * 1000.0)]++;
+}
+
+// --- PUNKT KONTROLNY I ODTWARZANIE PO AWARII ---
+
+// Zapis stanu do nieaktywnego slotu, potem publikacja numeru (crash-consistent)
+void checkpoint_commit() {
+    if (shared_mem == NULL) return;
+    struct OpCheckpoint *cp = &shared_mem->checkpoint;
+    uint32_t next = cp->seq + 1;
+    cp->slot[next % 2] = st;
+    __atomic_store_n(&cp->seq, next, __ATOMIC_RELEASE);
+    if (threaded) { // Pobrane wiadomości są już w stanie trwałym - wątek odbioru może pobrać kolejne
+        __atomic_store_n(&intake_committed, intake_popped, __ATOMIC_SEQ_CST);
+        spsc_wake(&w_intake);
+    }
+}
+
+// Ustawienie semafora hangaru na wartość wynikającą ze stanu logicznego
+void sync_hangar_semaphore() {
+    union semun { int val; struct semid_ds *buf; unsigned short *array; } arg;
+    arg.val = sch_free_slots(&st);
+    if (arg.val < 0) arg.val = 0;
+    if (semctl(semid, SEM_HANGAR, SETVAL, arg) == -1) perror("[Operator] semctl SETVAL recovery");
+}
+
+// Dron żyje, jeśli jego proces istnieje i nie jest zombie. kill(pid, 0) uznaje niepochowanego
+// zombie za żywego, a waitid działa tylko u rodzica (drony są dziećmi Commandera) - stan z /proc.
+int drone_alive(pid_t pid) {
+    char path[64], buf[256];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return kill(pid, 0) == 0 || errno != ESRCH; // Bez /proc zostaje sam sygnał 0
+    char *line = fgets(buf, sizeof(buf), f);
+    fclose(f);
+    if (line == NULL) return 0; // Proces zniknął w trakcie odczytu
+    char *p = strrchr(buf, ')'); // Nazwa procesu może zawierać spacje i nawiasy
+    return p == NULL || p[1] == '\0' || (p[2] != 'Z' && p[2] != 'X');
+}
+
+// Odtworzenie stanu poprzedniego Operatora. Zwraca 0 przy sukcesie, -1 gdy brak punktu kontrolnego.
+int recover_state() {
+    if (shared_mem == NULL) return -1;
+    struct OpCheckpoint *cp = &shared_mem->checkpoint;
+    uint32_t seq = __atomic_load_n(&cp->seq, __ATOMIC_ACQUIRE);
+    if (seq == 0) return -1; // Poprzednik zginął przed pierwszym zapisem
+    st = cp->slot[seq % 2];
+
+    // Uzgodnienie z żywym rojem: drony, które zginęły w trakcie awarii (ich MSG_DEAD mógł
+    // przepaść razem z poprzednikiem), rozliczamy jak MSG_DEAD i usuwamy z tablicy PID.
+    // Semafor hangaru liczymy niżej od nowa ze stanu, więc akcje SCH_SEM pomijamy.
+    int live = 0;
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        pid_t pid = shared_mem->drone_pids[i];
+        if (pid <= 0) continue;
+        if (!drone_alive(pid)) {
+            shared_mem->drone_pids[i] = 0;
+            sch_event(&st, MSG_DEAD, i, 0, mono_time(), &so);
+            so.n = 0;
+        } else live++;
+    }
+    if (live != st.current_active) {
+        olog(C_YELLOW "[Operator] Recovery: active drones %d -> %d (from PID table)." C_RESET "\n", st.current_active, live);
+        st.current_active = live;
+    }
+
+    // Odłożone zgody: nie wiadomo, które poprzednik zdążył wysłać, zanim zapisał r_head. Zostają
+    // tylko okna rezerwacji - zgodę, która nie dotarła, wyda ponownie sch_resend na prośbę drona.
+    int w = st.r_head;
+    for (int r = st.r_head; r != st.r_tail; r = (r + 1) % RETRY_CAP) {
+        if (st.retry_id[r] < MAX_DRONE_ID) continue; // RESPONSE_BASE + id
+        st.retry_id[w] = st.retry_id[r];
+        st.retry_ch[w] = st.retry_ch[r];
+        w = (w + 1) % RETRY_CAP;
+    }
+    st.r_tail = w;
+    int unsure = sch_recover(&st);
+    if (unsure > 0) olog(C_YELLOW "[Operator] Recovery: %d grants issued before the crash await confirmation." C_RESET "\n", unsure);
+
+    // Semafor mógł zostać zmieniony, zanim poprzednik zdążył zapisać stan - liczymy go od nowa
+    sync_hangar_semaphore();
+    return 0;
+}
+
+// Nowa epoka i GRANT_RESYNC do każdego żywego drona. Dron czekający na zgodę ponawia wtedy
+// prośbę, którą poprzednik mógł pobrać z kolejki i zginąć przed zapisem punktu kontrolnego.
+void announce_recovery() {
+    uint32_t epoch = __atomic_add_fetch(&shared_mem->checkpoint.epoch, 1, __ATOMIC_SEQ_CST);
+    struct msg_resp resp;
+    resp.channel_id = GRANT_RESYNC;
+    int n = 0;
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        if (shared_mem->drone_pids[i] <= 0) continue;
+        resp.mtype = RESPONSE_BASE + i;
+        post_grant(&resp);
+        n++;
+    }
+    olog(C_BLUE "[Operator] Recovery epoch %u announced to %d drones." C_RESET "\n", epoch, n);
 }
 
 // --- MAIN LOOP ---
 
 int main(int argc, char *argv[]) {
-    // Sprawdzenie argumentw (Pojemno, Liczba Dronw) przekazanych przez Commandera
-    if (argc < 3) return 1;
-    int P = atoi(argv[1]);
-    target_N = atoi(argv[2]);
-    
-    // Inicjalizacja zmiennych stanu
-    current_P = P;
-    current_active = target_N;
-    next_drone_id = target_N; 
+    // Opcje: -r (odtworzenie po awarii poprzedniego Operatora z punktu kontrolnego)
+    int recover = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "r")) != -1) {
+        if (opt == 'r') recover = 1;
+        else return 1;
+    }
+
+    // Sprawdzenie argumentów (Pojemność, Liczba Dronów) przekazanych przez Commandera
+    if (argc - optind < 2) return 1;
+    int P = atoi(argv[optind]);
+    sch_init(&st, P, atoi(argv[optind + 1])); // Inicjalizacja zmiennych stanu (tunele wolne, kolejki puste)
     
-    // Wyczyszczenie pliku logw operatora
-    FILE *f = fopen("operator.txt", "w"); if(f) fclose(f);
+    int batch = OP_BATCH_DEFAULT;
 
-    // Rejestracja sygnaw systemowych
-    if (signal(SIGINT, cleanup) == SIG_ERR) perror("signal SIGINT"); // Sprztanie
-    if (signal(SIGCHLD, sigchld_handler) == SIG_ERR) perror("signal SIGCHLD"); // Sprztanie zombie
-    if (signal(SIGUSR1, sigusr1_handler) == SIG_ERR) perror("signal SIGUSR1"); // Rozkaz Grow
+    // Wyczyszczenie pliku logów operatora (przy odtwarzaniu dopisujemy - to ten sam przebieg)
+    if (!recover) { FILE *f = fopen("operator.txt", "w"); if(f) fclose(f); }
+
+    // Rejestracja sygnałów systemowych
+    if (signal(SIGINT, cleanup) == SIG_ERR) perror("signal SIGINT"); // Sprzątanie
+    if (signal(SIGCHLD, sigchld_handler) == SIG_ERR) perror("signal SIGCHLD"); // Sprzątanie zombie
+    struct sigaction sa_usr1;
+    memset(&sa_usr1, 0, sizeof(sa_usr1));
+    sa_usr1.sa_sigaction = sigusr1_handler;
+    sa_usr1.sa_flags = SA_SIGINFO | SA_RESTART; // Jak signal(), ale z wartością (CTL_WAKE)
+    if (sigaction(SIGUSR1, &sa_usr1, NULL) == -1) perror("sigaction SIGUSR1"); // Rozkaz Grow / zlecenie sterujące
     if (signal(SIGUSR2, sigusr2_handler) == SIG_ERR) perror("signal SIGUSR2"); // Rozkaz Shrink
 
-    // Inicjalizacja IPC - Kolejka Komunikatw
-    msqid = msgget(MSGQ_KEY, IPC_CREAT | 0600);
+    // Inicjalizacja IPC - Kolejka Komunikatów
+    msqid = msgget(ipc_key(IPC_KEY_MSGQ), IPC_CREAT | 0600);
     if (msqid == -1) { perror("msgget failed"); return 1; }
 
     // Inicjalizacja IPC - Semafory
-    semid = semget(SEM_KEY, SEM_COUNT, IPC_CREAT | 0600);
+    semid = semget(ipc_key(IPC_KEY_SEM), SEM_COUNT, IPC_CREAT | 0600);
     if (semid == -1) { perror("semget failed"); return 1; }
 
-    // Inicjalizacja IPC - Pami Dzielona
-    shmid = shmget(SHM_KEY, sizeof(struct SharedState), 0600);
+    // Inicjalizacja IPC - Pamięć Dzielona
+    shmid = shmget(ipc_key(IPC_KEY_SHM), sizeof(struct SharedState), 0600);
     if (shmid != -1) {
-        shared_mem = (struct SharedState *)shmat(shmid, NULL, 0); // Podczenie pamici
+        shared_mem = (struct SharedState *)shmat(shmid, NULL, 0); // Podłączenie pamięci
         if (shared_mem == (void *)-1) {
              perror("shmat failed");
              shared_mem = NULL;
-        } else olog("[Operator] Attached to Shared Memory.\n");
+        } else {
+            olog("[Operator] Attached to Shared Memory.\n");
+            usage_at_exit(&shared_mem->usage[USAGE_OPERATOR]);
+        }
+    }
+    if (shared_mem != NULL && shared_mem->config.op_batch > 0) batch = shared_mem->config.op_batch;
+    if (shared_mem != NULL && shared_mem->config.trace) trace_open(TRACE_FILE, "operator", -1);
+    if (batch > OP_BATCH_MAX) batch = OP_BATCH_MAX;
+    if (shared_mem != NULL) apply_placement(&shared_mem->config, &shared_mem->op_stats);
+    if (shared_mem != NULL && shared_mem->config.sample_ms > 0 && ts_open(shared_mem->config.sample_fmt, shared_mem->config.sample_ms) == 0) {
+        sampling = 1;
+        ts_interval = (shared_mem->config.sample_ms < TS_MIN_MS ? TS_MIN_MS : shared_mem->config.sample_ms) / 1000.0;
+        // Po wznowieniu przyrosty liczymy od stanu poprzednika, nie od zera
+        ts_last_grants = shared_mem->op_stats.grants;
+        ts_last_deferred = shared_mem->op_stats.grants_deferred;
+    }
+    t_op_start = mono_time();
+    if (shared_mem != NULL && shared_mem->config.autoscale_max_p > 0) {
+        // P od 1 do limitu z Commandera, ale tak, by N = 2P + 1 mieściło się w tablicy PID
+        int p_max = shared_mem->config.autoscale_max_p;
+        if (p_max > (MAX_DRONE_ID - 1) / 2) p_max = (MAX_DRONE_ID - 1) / 2;
+        as_init(&as, 1, p_max, t_op_start);
+        autoscale = 1;
+        struct OpStats *os = &shared_mem->op_stats;
+        if (os->as_p_max == 0) os->as_p_min = os->as_p_max = P; // Po wznowieniu zachowujemy zakres
     }
     
-    // Ustawienie pocztkowej wartoci semafora na P (liczba miejsc)
+    // Rozmiar kolejki pod docelowy rój (z zapasem na jednorazowe podwojenie)
+    size_message_queue(st.target_N);
+
+    if (recover) {
+        // Kolejka i semafory przetrwały śmierć poprzednika - podpinamy się i odtwarzamy stan
+        if (recover_state() == 0) {
+            checkpoint_commit();
+            announce_recovery();
+            struct OpCheckpoint *cp = &shared_mem->checkpoint;
+            double ms = (mono_time() - cp->t_crash) * 1000.0;
+            cp->recoveries++;
+            cp->last_recovery_ms = ms;
+            if (ms > cp->max_recovery_ms) cp->max_recovery_ms = ms;
+            flag_ctl = 1; // Zlecenia z gniazda, których poprzednik mógł nie odczytać
+            olog(C_GREEN "[Operator] RECOVERED from checkpoint in %.1f ms. P=%d, Active=%d/%d, Occupied=%d, Queued L/T=%d/%d" C_RESET "\n",
+                 ms, st.current_P, st.current_active, st.target_N, st.occupied,
+                 (st.q_tail[0] - st.q_head[0] + WAITQ_CAP) % WAITQ_CAP, (st.q_tail[1] - st.q_head[1] + WAITQ_CAP) % WAITQ_CAP);
+            goto event_loop;
+        }
+        olog(C_YELLOW "[Operator] No checkpoint to recover from. Starting fresh." C_RESET "\n");
+    }
+
+    // Ustawienie początkowej wartości semafora na P (liczba miejsc)
     union semun { int val; struct semid_ds *buf; unsigned short *array; } arg;
     // 1. Semafor Hangar (Indeks 0) = P
     arg.val = P;
@@ -412,132 +1238,159 @@ int main(int argc, char *argv[]) {
     arg.val = 0;
     if (semctl(semid, SEM_TIMER, SETVAL, arg) == -1) { perror("semctl SETVAL TIMER"); return 1; }
 
-    // Wyzerowanie stanu tuneli
-    for(int i=0; i<CHANNELS; i++) { chan_dir[i]=DIR_NONE; chan_users[i]=0; }
+    // 3. Semafor Ładowarki (Indeks 2) = rozmiar puli (drony biorą go same, z SEM_UNDO)
+    arg.val = shared_mem != NULL ? shared_mem->config.chargers : 0;
+    if (semctl(semid, SEM_CHARGER, SETVAL, arg) == -1) { perror("semctl SETVAL CHARGER"); return 1; }
+    if (arg.val > 0) olog(C_BLUE "[Operator] Charger pool: %d chargers, power for %d, fast charge to %d%% under demand." C_RESET "\n",
+                          arg.val, shared_mem->config.charge_power > 0 ? shared_mem->config.charge_power : arg.val, CHARGE_PARTIAL);
+
+    olog(C_GREEN "[Operator] Ready. P=%d, Target N=%d, Batch=%d." C_RESET "\n", P, st.target_N, batch);
+    if (autoscale) olog(C_BLUE "[Operator] Autoscaling P in [%d, %d]." C_RESET "\n", as.p_min, as.p_max);
+    checkpoint_commit();
 
-    olog(C_GREEN "[Operator] Ready. P=%d, Target N=%d." C_RESET "\n", P, target_N);
+event_loop:;
+    if (shared_mem != NULL && shared_mem->config.rsv_lookahead_s > 0) {
+        reserving = 1;
+        // Nowy kalendarz, chyba że przejęty z punktu kontrolnego poprzednika
+        int t1 = shared_mem->config.charge_s > 0 ? shared_mem->config.charge_s : RSV_CHARGE_DEFAULT;
+        if (st.rsv.hold == 0) rsv_init(&st.rsv, t1 + 2 * RSV_CROSSING, mono_time());
+        olog(C_BLUE "[Operator] Landing reservations: look-ahead %d s, hangar hold %d s." C_RESET "\n",
+             shared_mem->config.rsv_lookahead_s, st.rsv.hold);
+    }
+    if (shared_mem != NULL && shared_mem->config.op_threads) {
+        if (start_threads(batch) == 0) olog(C_GREEN "[Operator] Threads: intake, scheduler, aux (spawn + logs)." C_RESET "\n");
+        else olog(C_YELLOW "[Operator] Threads unavailable - single-threaded event loop." C_RESET "\n");
+        shared_mem->op_stats.op_threads = threaded;
+    }
     time_t last_check = time(NULL);
+    double last_sample = 0.0;
+    double next_ts = mono_time(), last_ts_flush = next_ts;
 
-    // GWNA PTLA OPERATORA (EVENT LOOP)
+    // GŁÓWNA PĘTLA OPERATORA (EVENT LOOP)
     while (keep_running) {
-        // Obsuga flag sygnaw (Asynchroniczne zdarzenia od Commandera)
-        if (flag_sig1) { increase_base_capacity(); flag_sig1 = 0; }
-        if (flag_sig2) { decrease_base_capacity(); flag_sig2 = 0; }
+        // Obsługa flag sygnałów (Asynchroniczne zdarzenia od Commandera)
+        if (flag_sig1) { increase_base_capacity(); flag_sig1 = 0; checkpoint_commit(); }
+        if (flag_sig2) { decrease_base_capacity(); flag_sig2 = 0; checkpoint_commit(); }
+        if (flag_ctl) { flag_ctl = 0; apply_ctl_resize(); checkpoint_commit(); }
+
+        // Odłożone zgody mają pierwszeństwo przed nowymi (kolejność FIFO)
+        if (retry_len() > 0 && retry_grants() > 0) checkpoint_commit();
+
+        // Monitorowanie zajętości kolejki (co sekundę)
+        double now_m = mono_time();
+        if (now_m - last_sample >= 1.0) { sample_queue(); last_sample = now_m; }
+        if (autoscale && now_m - as.t_sample >= AS_SAMPLE_S) autoscale_tick(now_m);
+        if (reserving) rsv_tick(now_m);
+        if (shared_mem != NULL && shared_mem->config.chargers > 0) update_charge_target();
+        if (sampling && now_m >= next_ts) {
+            take_sample();
+            next_ts += ts_interval;
+            if (next_ts <= now_m) next_ts = now_m + ts_interval; // Po długiej przerwie bez nadrabiania
+            if (now_m - last_ts_flush >= 1.0) { ts_flush(); last_ts_flush = now_m; }
+        }
 
         // Okresowe sprawdzanie stanu (Replenish / Watchdog)
         time_t now = time(NULL);
         if (now - last_check >= CHECK_INTERVAL) {
             last_check = now;
             
-            // Watchdog: Fix na martwe semafory (reset jeli pusto i brak dugu)
-            // Zapobiega sytuacji, gdzie semafor "zgubi" warto przez bd drona
-            if (current_active == 0 && get_hangar_free_slots() < current_P && pending_removal == 0) {
-                union semun arg; arg.val = current_P; 
+            // Watchdog: reset zajętości, gdy roju nie ma, a miejsca wciąż są zajęte (np. dron
+            // zabity w hangarze nie zgłosił wylotu) - stan rdzenia i semafor wracają do P
+            if (st.current_active == 0 && sch_free_slots(&st) < st.current_P && st.pending_removal == 0) {
+                union semun arg; arg.val = st.current_P; 
                 if (semctl(semid, 0, SETVAL, arg) == -1) perror("semctl RESET failed");
-                else olog(C_YELLOW "[Operator] Reset semaphore to %d." C_RESET "\n", current_P);
+                else { st.occupied = 0; olog(C_YELLOW "[Operator] Reset semaphore to %d." C_RESET "\n", st.current_P); }
             }
-            // Logika Replenish: Spawnowanie nowych dronw, jeli populacja spada poniej celu
-            if (current_active < target_N) {
-                int needed = target_N - current_active; // Ilu brakuje
-                int free_slots = get_hangar_free_slots(); // Ile jest miejsca
+            // Logika Replenish: Spawnowanie nowych dronów, jeśli populacja spadła poniżej celu
+            if (st.current_active < st.target_N) {
+                int needed = st.target_N - st.current_active; // Ilu brakuje
+                int free_slots = sch_free_slots(&st); // Ile jest miejsca
                 if (free_slots > 0) {
                     olog(C_BLUE "[Operator] CHECK: Spawning inside base..." C_RESET "\n");
-                    // Tworzymy tyle ile brakuje, ale nie wicej ni jest miejsc w hangarze
+                    // Tworzymy tyle ile brakuje, ale nie więcej niż jest miejsc w hangarze
                     int to_spawn = (needed < free_slots) ? needed : free_slots;
                     for (int k=0; k<to_spawn; k++) spawn_new_drone();
                 } 
             }
+            checkpoint_commit();
         }
 
-        // Odbir wiadomoci z kolejki
+        // Tryb -M: wiadomości z wątku odbioru, sen na eventfd (budzi push albo sygnał Commandera)
         struct msg_req req;
-        // msgrcv z flag IPC_NOWAIT - nie blokuje ptli, jeli brak wiadomoci.
-        // -MSG_DEAD oznacza odbir priorytetowy: wiadomoci o typie <= MSG_DEAD (czyli 1..5)
-        ssize_t r = safe_msgrcv(msqid, &req, sizeof(req) - sizeof(long), -MSG_DEAD, IPC_NOWAIT);
+        double t_in;
+        if (threaded) {
+            spawn_results();
+            struct OpMsg m;
+            if (!spsc_pop(&q_intake, &m)) {
+                flush_log();
+                spsc_arm(&w_sched);
+                if (spsc_empty(&q_intake) && spsc_empty(&q_spawned)) spsc_sleep(&w_sched, idle_deadline(next_ts));
+                else spsc_disarm(&w_sched);
+                continue;
+            }
+            intake_popped++;
+            req = m.req;
+            t_in = m.t_in;
+            goto handle;
+        }
+
+        // Odbiór wiadomości z kolejki
+        // msgrcv z flagą IPC_NOWAIT - nie blokuje pętli, jeśli brak wiadomości.
+        // -MSG_OP_MAX oznacza odbiór priorytetowy: wiadomości o typie <= MSG_OP_MAX (czyli 1..6)
+        TRACE_BEGIN(TR_MSG_RECV);
+        ssize_t r = safe_msgrcv(msqid, &req, sizeof(req) - sizeof(long), -MSG_OP_MAX, IPC_NOWAIT);
+        TRACE_END(TR_MSG_RECV, r != -1);
         
+        if (r == -1 && errno == ENOMSG) {
+            // Pusta kolejka: śpimy w msgrcv do pierwszej wiadomości (bez opóźnienia odbioru),
+            // najdłużej do następnego przeglądu. Sygnały Commandera przerywają sen (EINTR).
+            r = timed_msgrcv(msqid, &req, sizeof(req) - sizeof(long), -MSG_OP_MAX, idle_deadline(next_ts));
+        }
         if (r == -1) {
-            // Jeli brak wiadomoci (ENOMSG), pimy chwil, eby nie obcia CPU (Busy Waiting prevention)
-            if (errno == ENOMSG) { custom_wait(semid, 0.05); continue; }
-            if (errno != EINTR) { perror("[Operator] msgrcv failed"); break; }
-            continue;
+            if (errno == ETIMEDOUT || errno == EINTR) continue;
+            perror("[Operator] msgrcv failed");
+            break;
         }
 
-        int did = req.drone_id;
+        t_in = mono_time();
 
-        // Maszyna stanw komunikatw - Reakcja na typ wiadomoci
-        switch (req.mtype) {
-            case MSG_REQ_LAND: // Dron prosi o ldowanie
-                if (current_active > target_N) { 
-                    // Jeli trwa redukcja populacji, blokujemy ldowanie (naturalne wygaszanie)
-                    enqueue(0, did); 
-                    olog(C_RED "[Operator] BLOCKED %d" C_RESET "\n", did); 
-                }
-                else if (get_hangar_free_slots() > 0) { // Czy jest miejsce w hangarze?
-                    int ch = find_available_channel(DIR_IN); // Czy jest wolny tunel?
-                    // Jeli mamy tunel ORAZ uda si zarezerwowa semafor
-                    if (ch != -1 && reserve_hangar_spot()) {
-                        chan_dir[ch] = DIR_IN; chan_users[ch]++; send_grant(did, ch);
-                        olog(C_GREEN "[Operator] GRANT LAND %d via Ch %d" C_RESET "\n", did, ch);
-                    } else enqueue(0, did); // Jak nie, do kolejki
-                } else enqueue(0, did); // Jak nie ma miejsca, do kolejki
-                break;
-                
-            case MSG_REQ_TAKEOFF: // Dron prosi o start
-                {
-                    int ch = find_available_channel(DIR_OUT); // Czy jest tunel na zewntrz?
-                    if (ch != -1) {
-                        chan_dir[ch] = DIR_OUT; chan_users[ch]++; send_grant(did, ch);
-                        olog(C_GREEN "[Operator] GRANT TAKEOFF %d via Ch %d" C_RESET "\n", did, ch);
-                    } else enqueue(1, did); // Jak nie, do kolejki startowej
-                }
-                break;
-                
-            case MSG_LANDED: // Dron wlecia do rodka (zwolni tunel, zaj hangar)
-                {
-                    int found = 0;
-                    // Szukamy, ktrym tunelem wlecia i zwalniamy licznik w tym tunelu
-                    for(int i=0; i<CHANNELS; i++) {
-                        if (chan_dir[i] == DIR_IN && chan_users[i] > 0) {
-                            chan_users[i]--; if (chan_users[i] == 0) chan_dir[i] = DIR_NONE;
-                            olog(C_CYAN "[Operator] Drone %d entered base." C_RESET "\n", did);
-                            found = 1; break;
-                        }
-                    }
-                    if (!found) olog(C_RED "[Operator] WARN: Unexpected LANDED from %d" C_RESET "\n", did);
-                    process_queues(); // Zwolnienie tunelu mogo odblokowa innych - sprawdzamy kolejki
-                }
-                break;
-                
-            case MSG_DEPARTED: // Dron wylecia (zwolni tunel i hangar)
-                {
-                    int found = 0;
-                    // Zwalniamy tunel
-                    for(int i=0; i<CHANNELS; i++) {
-                        if (chan_dir[i] == DIR_OUT && chan_users[i] > 0) {
-                            chan_users[i]--; if (chan_users[i] == 0) chan_dir[i] = DIR_NONE;
-                            olog(C_CYAN "[Operator] Drone %d left." C_RESET "\n", did);
-                            found = 1; break;
-                        }
-                    }
-                    if (!found) olog(C_RED "[Operator] ERROR: Got MSG_DEPARTED but no channel active OUT!" C_RESET "\n");
-                    free_hangar_spot(); // Zwolnienie semafora (lub obsuga pending removal)
-                    process_queues();   // Zwolnienie miejsca mogo odblokowa ldujcych - sprawdzamy kolejki
-                }
-                break;
-                
-            case MSG_DEAD: // Dron zgasza mier
-                olog(C_RED "[Operator] RIP drone %d." C_RESET "\n", did);
-                remove_dead(did); // Usuwamy go z kolejek oczekujcych (eby nie wywoywa duchw)
-                current_active--; // Zmniejszamy licznik populacji
-                if (shared_mem != NULL && did < MAX_DRONE_ID) shared_mem->drone_pids[did] = 0; // Czycimy slot PID
-                olog(C_BLUE "[Operator] Active: %d/%d" C_RESET "\n", current_active, target_N);
-                break;
+handle:;
+        double t_busy = mono_time();
+        uint64_t grants_before = shared_mem != NULL ? shared_mem->op_stats.grants : 0;
+        int handled = 1;
+        if (batch > 1 || threaded) {
+            handled = handle_batch(&req, batch);
+        } else {
+            handle_one(&req);
+        }
+
+        // Pomiar kosztu obsługi (porównanie trybu partii z obsługą po jednej wiadomości)
+        if (shared_mem != NULL) {
+            struct OpStats *os = &shared_mem->op_stats;
+            os->msgs += handled;
+            os->wakeups++;
+            os->busy_ns += (uint64_t)((mono_time() - t_busy) * 1e9);
+            if ((uint32_t)handled > os->max_batch) os->max_batch = handled;
+            if (os->grants > grants_before) note_grant_latency(t_in);
         }
     }
 
-    // Sprztanie po wyjciu z ptli (Ctrl+C)
-    if (shared_mem) shmdt(shared_mem); // Odczenie pamici
-    if (msqid != -1) msgctl(msqid, IPC_RMID, NULL); // Usunicie kolejki
-    if (semid != -1) semctl(semid, 0, IPC_RMID);    // Usunicie semaforw
+    if (shared_mem != NULL && shared_mem->op_stats.msgs > 0) {
+        struct OpStats *os = &shared_mem->op_stats;
+        olog(C_BLUE "[Operator] Event loop: %llu msgs in %llu wakeups (avg batch %.1f, max %u), %.2f us/msg, %llu grants." C_RESET "\n",
+             (unsigned long long)os->msgs, (unsigned long long)os->wakeups, (double)os->msgs / os->wakeups, os->max_batch,
+             os->busy_ns / 1000.0 / os->msgs, (unsigned long long)os->grants);
+    }
+
+    if (threaded) stop_threads();
+
+    // Sprzątanie po wyjściu z pętli (Ctrl+C)
+    if (sampling) { take_sample(); ts_close(); }
+    if (shared_mem) {
+        usage_detach(); // Zużycie zasobów zapisane, póki pamięć jest podłączona
+        shmdt(shared_mem); // Odłączenie pamięci
+    }
+    if (msqid != -1) msgctl(msqid, IPC_RMID, NULL); // Usunięcie kolejki
+    if (semid != -1) semctl(semid, 0, IPC_RMID);    // Usunięcie semaforów
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+/* src/physics.c
+ *
+ * Krok fizyki floty SoA. Pętla główna czyta tylko battery / rate / charge_end i pisze battery / ev:
+ * bez rozgałęzień (progi jako porównania i operacje bitowe, przycięcie jako wybór), tablice
+ * wyrównane i dopełnione do PH_LANES - kompilator zamienia ją na instrukcje wektorowe.
+ * Zdarzenia są rzadkie, więc zbieranie list pomija po 8 pustych bajtów ev naraz.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../include/physics.h"
+#include "../include/telemetry.h"
+
+static void *ph_alloc(int cap, size_t esize) {
+    void *p = NULL;
+    if (posix_memalign(&p, PH_ALIGN, (size_t)cap * esize) != 0) return NULL;
+    memset(p, 0, (size_t)cap * esize);
+    return p;
+}
+
+int ph_init(struct PhFleet *f, int n, float dt) {
+    memset(f, 0, sizeof(*f));
+    f->n = n;
+    f->dt = dt;
+    f->cap = (n + PH_LANES - 1) / PH_LANES * PH_LANES;
+    f->battery = ph_alloc(f->cap, sizeof(float));
+    f->rate = ph_alloc(f->cap, sizeof(float));
+    f->drain = ph_alloc(f->cap, sizeof(float));
+    f->charge_end = ph_alloc(f->cap, sizeof(int32_t));
+    f->phase = ph_alloc(f->cap, 1);
+    f->cycles = ph_alloc(f->cap, sizeof(uint16_t));
+    f->ev = ph_alloc(f->cap, 1);
+    f->critical = ph_alloc(f->cap, sizeof(int32_t));
+    f->dead = ph_alloc(f->cap, sizeof(int32_t));
+    f->full = ph_alloc(f->cap, sizeof(int32_t));
+    if (!f->battery || !f->rate || !f->drain || !f->charge_end || !f->phase || !f->cycles || !f->ev ||
+        !f->critical || !f->dead || !f->full) {
+        ph_free(f);
+        return -1;
+    }
+    // Dopełnienie (i >= n): pełna bateria, stan zamrożony - nigdy nie generuje zdarzeń
+    for (int i = 0; i < f->cap; i++) {
+        f->battery[i] = PH_FULL;
+        f->charge_end[i] = INT32_MAX;
+        f->phase[i] = i < n ? TM_FLYING : TM_EMPTY;
+    }
+    return 0;
+}
+
+void ph_free(struct PhFleet *f) {
+    free(f->battery); free(f->rate); free(f->drain); free(f->charge_end);
+    free(f->phase); free(f->cycles); free(f->ev);
+    free(f->critical); free(f->dead); free(f->full);
+    memset(f, 0, sizeof(*f));
+}
+
+int32_t ph_ticks(const struct PhFleet *f, float t1) {
+    int32_t k = (int32_t)(t1 / f->dt + 0.5f);
+    return k > 0 ? k : 1;
+}
+
+void ph_set_phase(struct PhFleet *f, int i, int phase, float t1) {
+    f->phase[i] = (uint8_t)phase;
+    f->charge_end[i] = INT32_MAX;
+    if (phase == TM_FLYING || phase == TM_QUEUED) {
+        f->rate[i] = -f->drain[i]; // W kolejce przed bazą paliwo dalej ubywa
+    } else if (phase == TM_CHARGING && t1 > 0) {
+        f->rate[i] = (PH_FULL - f->battery[i]) / t1;
+        f->charge_end[i] = f->tick + ph_ticks(f, t1);
+    } else {
+        f->rate[i] = 0.0f; // Tunel, hangar po ładowaniu, śmierć
+    }
+}
+
+void ph_step(struct PhFleet *f) {
+    float *restrict b = f->battery;
+    const float *restrict r = f->rate;
+    const int32_t *restrict ce = f->charge_end;
+    uint8_t *restrict ev = f->ev;
+    const int cap = f->cap;
+    const float dt = f->dt;
+    const int32_t t = f->tick + 1;
+
+    // Progi sprawdzane na wartości przed przycięciem (wynik ten sam), a przejście w dół zapisane
+    // jako porównanie liczb całkowitych: "a && b" na floatach GCC zamienia w skok i nie wektoryzuje.
+    for (int i = 0; i < cap; i++) {
+        float bo = b[i];
+        float bu = bo + r[i] * dt;
+        int32_t crit = (bo > PH_CRITICAL) > (bu > PH_CRITICAL);
+        int32_t dead = (bo > PH_DEAD) > (bu > PH_DEAD);
+        int32_t full = ce[i] <= t;
+        ev[i] = (uint8_t)(crit * PH_EV_CRITICAL | dead * PH_EV_DEAD | full * PH_EV_FULL);
+        float bn = bu < PH_DEAD ? PH_DEAD : bu;
+        b[i] = bn > PH_FULL ? PH_FULL : bn;
+    }
+    f->tick = t;
+
+    // Listy zdarzeń: słowo 8 bajtów == 0 oznacza osiem dronów bez zdarzeń
+    f->n_critical = f->n_dead = f->n_full = 0;
+    for (int i = 0; i < cap; i += 8) {
+        uint64_t w;
+        memcpy(&w, ev + i, sizeof(w));
+        if (w == 0) continue;
+        for (int k = i; k < i + 8; k++) {
+            uint8_t e = ev[k];
+            if (e & PH_EV_CRITICAL) f->critical[f->n_critical++] = k;
+            if (e & PH_EV_DEAD) f->dead[f->n_dead++] = k;
+            if (e & PH_EV_FULL) f->full[f->n_full++] = k;
+        }
+    }
+
+    for (int j = 0; j < f->n_dead; j++) ph_set_phase(f, f->dead[j], TM_DEAD, 0);
+    for (int j = 0; j < f->n_full; j++) {
+        int i = f->full[j];
+        b[i] = PH_FULL;
+        f->cycles[i]++;
+        ph_set_phase(f, i, TM_WAIT_TAKEOFF, 0);
+    }
+}
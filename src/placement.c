@@ -0,0 +1,162 @@
+/* src/placement.c
+ *
+ * Przypinanie procesów do CPU (sched_setaffinity) i polityka szeregowania Operatora
+ * (SCHED_FIFO/RR albo nice) z łagodnym zastępstwem przy braku uprawnień.
+ */
+
+// MUSI BYĆ PIERWSZE! (cpu_set_t, CPU_SET, SCHED_RESET_ON_FORK)
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+#include "../include/placement.h"
+
+#define PL_MAX_CPU (PL_CPU_WORDS * 64)
+
+int pl_parse_cpus(const char *s, uint64_t *mask) {
+    memset(mask, 0, PL_CPU_WORDS * sizeof(uint64_t));
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", s);
+    char *save;
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *end;
+        long a = strtol(tok, &end, 10), b = a;
+        if (*end == '-') b = strtol(end + 1, &end, 10);
+        if (end == tok || *end != '\0' || a < 0 || b < a || b >= PL_MAX_CPU) return -1;
+        for (long c = a; c <= b; c++) mask[c / 64] |= 1ULL << (c % 64);
+    }
+    int n = pl_mask_count(mask);
+    return n > 0 ? n : -1;
+}
+
+int pl_parse_policy(const char *s, int *policy, int *prio) {
+    const char *eq = strchr(s, '=');
+    if (!eq) return -1;
+    char *end;
+    long v = strtol(eq + 1, &end, 10);
+    if (end == eq + 1 || *end != '\0') return -1;
+    size_t n = (size_t)(eq - s);
+    if (n == 4 && strncasecmp(s, "nice", 4) == 0 && v >= -20 && v <= 19) *policy = PL_POLICY_NICE;
+    else if (n == 4 && strncasecmp(s, "fifo", 4) == 0 && v >= 1 && v <= 99) *policy = PL_POLICY_FIFO;
+    else if (n == 2 && strncasecmp(s, "rr", 2) == 0 && v >= 1 && v <= 99) *policy = PL_POLICY_RR;
+    else return -1;
+    *prio = (int)v;
+    return 0;
+}
+
+int pl_mask_count(const uint64_t *mask) {
+    int n = 0;
+    for (int i = 0; i < PL_CPU_WORDS; i++) n += __builtin_popcountll(mask[i]);
+    return n;
+}
+
+int pl_mask_online(uint64_t *mask) {
+    memset(mask, 0, PL_CPU_WORDS * sizeof(uint64_t));
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == -1) return -1;
+    for (int c = 0; c < PL_MAX_CPU && c < CPU_SETSIZE; c++)
+        if (CPU_ISSET(c, &set)) mask[c / 64] |= 1ULL << (c % 64);
+    return pl_mask_count(mask);
+}
+
+void pl_mask_format(const uint64_t *mask, char *buf, size_t len) {
+    size_t off = 0;
+    buf[0] = '\0';
+    for (int c = 0; c < PL_MAX_CPU && off + 1 < len; c++) {
+        if (!(mask[c / 64] & (1ULL << (c % 64)))) continue;
+        int e = c;
+        while (e + 1 < PL_MAX_CPU && (mask[(e + 1) / 64] & (1ULL << ((e + 1) % 64)))) e++;
+        int w = e > c ? snprintf(buf + off, len - off, "%s%d-%d", off ? "," : "", c, e)
+                      : snprintf(buf + off, len - off, "%s%d", off ? "," : "", c);
+        if (w < 0 || (size_t)w >= len - off) break;
+        off += (size_t)w;
+        c = e;
+    }
+}
+
+static int set_mask(const uint64_t *mask) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c = 0; c < PL_MAX_CPU && c < CPU_SETSIZE; c++)
+        if (mask[c / 64] & (1ULL << (c % 64))) CPU_SET(c, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+}
+
+int pl_pin_cpu(int cpu, char *msg, size_t len) {
+    uint64_t mask[PL_CPU_WORDS] = {0};
+    mask[cpu / 64] |= 1ULL << (cpu % 64);
+    if (set_mask(mask) == -1) {
+        snprintf(msg, len, "pin to CPU %d failed (%s), running unpinned", cpu, strerror(errno));
+        return -1;
+    }
+    snprintf(msg, len, "pinned to CPU %d", cpu);
+    return 0;
+}
+
+int pl_set_policy(int policy, int prio, int *applied_policy, int *applied_prio, char *msg, size_t len) {
+    *applied_policy = PL_POLICY_DEFAULT;
+    *applied_prio = 0;
+    if (policy == PL_POLICY_FIFO || policy == PL_POLICY_RR) {
+        struct sched_param sp = {.sched_priority = prio};
+        // RESET_ON_FORK: drony tworzone przez Operatora (Replenish) nie dziedziczą czasu rzeczywistego
+        int pol = (policy == PL_POLICY_FIFO ? SCHED_FIFO : SCHED_RR) | SCHED_RESET_ON_FORK;
+        if (sched_setscheduler(0, pol, &sp) == 0) {
+            *applied_policy = policy;
+            *applied_prio = prio;
+            snprintf(msg, len, "%s priority %d", policy == PL_POLICY_FIFO ? "SCHED_FIFO" : "SCHED_RR", prio);
+            return 0;
+        }
+        int err = errno;
+        // Zastępstwo: najwyższy nice, na jaki pozwala RLIMIT_NICE (root: -20)
+        if (setpriority(PRIO_PROCESS, 0, -10) == 0) {
+            *applied_policy = PL_POLICY_NICE;
+            *applied_prio = getpriority(PRIO_PROCESS, 0);
+            snprintf(msg, len, "%s denied (%s), fell back to nice %d",
+                     policy == PL_POLICY_FIFO ? "SCHED_FIFO" : "SCHED_RR", strerror(err), *applied_prio);
+            return 0;
+        }
+        snprintf(msg, len, "%s denied (%s), nice denied too (%s), default scheduling",
+                 policy == PL_POLICY_FIFO ? "SCHED_FIFO" : "SCHED_RR", strerror(err), strerror(errno));
+        return -1;
+    }
+    if (policy == PL_POLICY_NICE) {
+        if (setpriority(PRIO_PROCESS, 0, prio) == 0) {
+            *applied_policy = PL_POLICY_NICE;
+            *applied_prio = prio;
+            snprintf(msg, len, "nice %d", prio);
+            return 0;
+        }
+        snprintf(msg, len, "nice %d denied (%s), default scheduling", prio, strerror(errno));
+        return -1;
+    }
+    snprintf(msg, len, "default scheduling");
+    return 0;
+}
+
+int pl_apply_drone(int placement, const uint64_t *mask, int id, char *msg, size_t len) {
+    msg[0] = '\0';
+    if (!(placement & PL_DRONES)) return 0;
+    int n = pl_mask_count(mask);
+    if (n == 0) return 0;
+    uint64_t one[PL_CPU_WORDS] = {0};
+    const uint64_t *use = mask;
+    if (placement & PL_SPREAD) {
+        // k-ty CPU maski, k = ID modulo liczba CPU - sąsiednie ID na różnych rdzeniach
+        int k = id % n, c = 0;
+        for (; c < PL_MAX_CPU; c++) if ((mask[c / 64] & (1ULL << (c % 64))) && k-- == 0) break;
+        one[c / 64] |= 1ULL << (c % 64);
+        use = one;
+    }
+    if (set_mask(use) == -1) {
+        snprintf(msg, len, "CPU placement failed (%s)", strerror(errno));
+        return -1;
+    }
+    pl_mask_format(use, msg, len);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/* src/reserve.c
+ *
+ * Kalendarz rezerwacji okien lądowania (pierścień sekundowych slotów). Moduł nie dotyka IPC -
+ * odpowiedzi do dronów i ustawienie tuneli wykonuje Operator.
+ */
+
+#include <string.h>
+
+#include "../include/common.h"
+
+static int32_t slot_of(double t) { return (int32_t)(t / RSV_SLOT_S); }
+
+static int in_horizon(const struct RsvCalendar *c, int32_t s) { return s >= c->base && s < c->base + RSV_SLOTS; }
+
+void rsv_init(struct RsvCalendar *c, int hold_s, double now) {
+    memset(c, 0, sizeof(*c));
+    c->hold = (int32_t)(hold_s / RSV_SLOT_S + 0.999);
+    if (c->hold < 1) c->hold = 1;
+    if (c->hold > RSV_SLOTS / 2) c->hold = RSV_SLOTS / 2;
+    c->base = slot_of(now);
+}
+
+void rsv_advance(struct RsvCalendar *c, double now) {
+    int32_t cur = slot_of(now);
+    if (cur - c->base >= RSV_SLOTS) { // Długa przerwa - cały pierścień jest przeszłością
+        memset(c->occ, 0, sizeof(c->occ));
+        memset(c->starts, 0, sizeof(c->starts));
+        c->base = cur;
+        return;
+    }
+    for (; c->base < cur; c->base++) {
+        c->occ[c->base % RSV_SLOTS] = 0;
+        c->starts[c->base % RSV_SLOTS] = 0;
+    }
+}
+
+// Czy wlot w slocie s mieści się w limicie wlotów i w pojemności hangaru na cały postój
+static int fits(const struct RsvCalendar *c, int32_t s, int cap) {
+    if (c->starts[s % RSV_SLOTS] >= RSV_PER_SLOT) return 0;
+    for (int32_t k = 0; k < c->hold; k++) {
+        if (c->occ[(s + k) % RSV_SLOTS] >= cap) return 0;
+    }
+    return 1;
+}
+
+int rsv_book(struct RsvCalendar *c, int id, double now, double eta_s, int cap, double *start) {
+    if (id < 0 || id >= MAX_DRONE_ID || cap <= 0) return RSV_REJECTED;
+    rsv_advance(c, now);
+    if (eta_s < 0) eta_s = 0;
+    int32_t want = slot_of(now + eta_s);
+    int32_t last = c->base + RSV_SLOTS - c->hold; // Cały postój musi zmieścić się w horyzoncie
+    int32_t s = want < last ? want : last;
+
+    // Od slotu progu wstecz: najpóźniejsze wolne okno, czyli najmniej zmarnowanej baterii
+    for (; s >= c->base; s--) {
+        if (!fits(c, s, cap)) continue;
+        c->starts[s % RSV_SLOTS]++;
+        for (int32_t k = 0; k < c->hold; k++) c->occ[(s + k) % RSV_SLOTS]++;
+        c->booked[id] = s;
+        if (s == want) {
+            *start = now + eta_s;
+            return RSV_CONFIRMED;
+        }
+        *start = s * RSV_SLOT_S > now ? s * RSV_SLOT_S : now;
+        return RSV_COUNTERED;
+    }
+    return RSV_REJECTED;
+}
+
+void rsv_release(struct RsvCalendar *c, int id, double now) {
+    if (id < 0 || id >= MAX_DRONE_ID || c->booked[id] == 0) return;
+    int32_t s = c->booked[id];
+    c->booked[id] = 0;
+    rsv_advance(c, now);
+    if (in_horizon(c, s) && c->starts[s % RSV_SLOTS] > 0) c->starts[s % RSV_SLOTS]--;
+    for (int32_t k = 0; k < c->hold; k++) {
+        int32_t t = s + k;
+        if (in_horizon(c, t) && c->occ[t % RSV_SLOTS] > 0) c->occ[t % RSV_SLOTS]--;
+    }
+}
+
+int rsv_clear(struct RsvCalendar *c, int id) {
+    if (!rsv_has(c, id)) return 0;
+    c->booked[id] = 0;
+    return 1;
+}
+
+int rsv_has(const struct RsvCalendar *c, int id) {
+    return id >= 0 && id < MAX_DRONE_ID && c->booked[id] != 0;
+}
+
+int rsv_due(const struct RsvCalendar *c, double now, int slots) {
+    int32_t cur = slot_of(now);
+    int n = 0;
+    for (int32_t t = cur; t <= cur + slots; t++) {
+        if (in_horizon(c, t)) n += c->starts[t % RSV_SLOTS];
+    }
+    return n;
+}
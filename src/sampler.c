@@ -0,0 +1,76 @@
+/* src/sampler.c
+ *
+ * Szereg czasowy Operatora: zapis próbek TsSample do samples.csv / samples.bin.
+ * Plik otwierany w trybie dopisywania z własnym buforem stdio - pojedyncza próbka to
+ * kopiowanie do pamięci, a write() następuje przy pełnym buforze lub w ts_flush (co sekundę).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../include/sampler.h"
+
+const char *const ts_delta_names[TS_DELTAS] = {
+    "req_land", "req_takeoff", "landed", "departed", "dead", "grants", "deferred", "spawned"
+};
+
+static FILE *ts_f = NULL;
+static int ts_format = TS_NONE;
+static char ts_buf[TS_BUF * sizeof(struct TsSample) * 2]; // CSV jest dłuższe niż rekord binarny
+
+int ts_open(int format, int interval_ms) {
+    const char *path = format == TS_BIN ? TS_FILE_BIN : TS_FILE_CSV;
+    ts_f = fopen(path, format == TS_BIN ? "ab" : "a");
+    if (!ts_f) { perror("[Sampler] fopen"); return -1; }
+    setvbuf(ts_f, ts_buf, _IOFBF, sizeof(ts_buf));
+    ts_format = format;
+
+    struct stat sb;
+    if (fstat(fileno(ts_f), &sb) == 0 && sb.st_size > 0) return 0; // Dopisujemy za poprzednikiem
+    if (format == TS_BIN) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        struct TsHeader h = {TS_MAGIC, TS_VERSION, sizeof(struct TsSample), (uint32_t)interval_ms, CHANNELS,
+                             ts.tv_sec + ts.tv_nsec / 1e9};
+        fwrite(&h, sizeof(h), 1, ts_f);
+    } else {
+        ts_csv_header(ts_f);
+    }
+    fflush(ts_f);
+    return 0;
+}
+
+void ts_write(const struct TsSample *s) {
+    if (!ts_f) return;
+    if (ts_format == TS_BIN) fwrite(s, sizeof(*s), 1, ts_f);
+    else ts_csv_row(ts_f, s);
+}
+
+void ts_flush(void) {
+    if (ts_f) fflush(ts_f);
+}
+
+void ts_close(void) {
+    if (!ts_f) return;
+    fclose(ts_f);
+    ts_f = NULL;
+}
+
+void ts_csv_header(FILE *f) {
+    fprintf(f, "t,P,occupied,free,pending_removal,q_land,q_takeoff,active,target_N");
+    for (int i = 0; i < CHANNELS; i++) fprintf(f, ",ch%d_dir,ch%d_users", i, i);
+    for (int k = 0; k < TS_DELTAS; k++) fprintf(f, ",d_%s", ts_delta_names[k]);
+    fputc('\n', f);
+}
+
+void ts_csv_row(FILE *f, const struct TsSample *s) {
+    static const char *dir_names[] = {"-", "in", "out"};
+    fprintf(f, "%.3f,%u,%u,%u,%u,%u,%u,%u,%u", s->t, s->P, s->occupied, s->free_slots, s->pending_removal,
+            s->q_land, s->q_takeoff, s->active, s->target_N);
+    for (int i = 0; i < CHANNELS; i++)
+        fprintf(f, ",%s,%u", s->chan_dir[i] <= DIR_OUT ? dir_names[s->chan_dir[i]] : "?", s->chan_users[i]);
+    for (int k = 0; k < TS_DELTAS; k++) fprintf(f, ",%u", s->d[k]);
+    fputc('\n', f);
+}
@@ -0,0 +1,138 @@
+/* src/scenario.c
+ *
+ * Parser plików scenariusza dla trybu bezobsługowego Commandera.
+ * Format: jedna komenda na linię, '#' rozpoczyna komentarz.
+ *   seed <n>            - ziarno RNG (baterie dronów, losowanie celów)
+ *   wait <sekundy>      - odczekanie (ułamki dozwolone)
+ *   grow / shrink       - Sygnał 1 / Sygnał 2
+ *   attack <id> [id...] - Sygnał 3 do konkretnych dronów
+ *   attack_random <k>   - Sygnał 3 do k losowych aktywnych dronów
+ *   kill <ułamek>       - Sygnał 3 do części roju (np. 0.25)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+
+#include "../include/common.h"
+#include "../include/scenario.h"
+
+// Dopisanie kroku do dynamicznej tablicy (podwajanie pojemności)
+static struct ScenarioStep *push_step(struct Scenario *sc, int *cap) {
+    if (sc->n_steps == *cap) {
+        int new_cap = (*cap == 0) ? 16 : *cap * 2;
+        struct ScenarioStep *p = realloc(sc->steps, new_cap * sizeof(*p));
+        if (!p) return NULL;
+        sc->steps = p;
+        *cap = new_cap;
+    }
+    struct ScenarioStep *st = &sc->steps[sc->n_steps++];
+    memset(st, 0, sizeof(*st));
+    return st;
+}
+
+// Parsowanie liczby zmiennoprzecinkowej z walidacją (cała reszta tokenu musi być liczbą).
+// strtod przyjmuje też "nan" i "inf" - odrzucamy je: wait inf wstrzymałby scenariusz na zawsze,
+// a kill nan dałby niezdefiniowane rzutowanie na int przy liczeniu celów.
+static int parse_double(const char *tok, double *out) {
+    if (!tok) return -1;
+    char *end;
+    errno = 0;
+    double v = strtod(tok, &end);
+    if (errno != 0 || end == tok || *end != '\0' || !isfinite(v)) return -1;
+    *out = v;
+    return 0;
+}
+
+// Parsowanie liczby całkowitej (liczności, ID, seed) - ułamki typu "2.5" są odrzucane
+static int parse_long(const char *tok, long *out) {
+    if (!tok) return -1;
+    char *end;
+    errno = 0;
+    long v = strtol(tok, &end, 10);
+    if (errno != 0 || end == tok || *end != '\0') return -1;
+    *out = v;
+    return 0;
+}
+
+int scenario_load(const char *path, struct Scenario *sc) {
+    memset(sc, 0, sizeof(*sc));
+    FILE *f = fopen(path, "r");
+    if (!f) { perror("[Scenario] fopen"); return -1; }
+
+    int cap = 0;
+    int lineno = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0'; // Odcięcie komentarza
+
+        char *save = NULL;
+        char *cmd = strtok_r(line, " \t\r\n", &save);
+        if (!cmd) continue; // Pusta linia
+
+        char *arg = strtok_r(NULL, " \t\r\n", &save);
+        double v = 0.0;
+        long n = 0;
+
+        if (strcmp(cmd, "seed") == 0) {
+            if (parse_long(arg, &n) == -1 || n < 0 || (unsigned long)n > UINT_MAX) goto bad;
+            sc->seed = (unsigned int)n;
+            continue;
+        }
+
+        struct ScenarioStep *st = push_step(sc, &cap);
+        if (!st) { fprintf(stderr, "[Scenario] Out of memory.\n"); goto fail; }
+        st->line = lineno;
+
+        if (strcmp(cmd, "grow") == 0) {
+            st->action = SC_GROW;
+        } else if (strcmp(cmd, "shrink") == 0) {
+            st->action = SC_SHRINK;
+        } else if (strcmp(cmd, "wait") == 0) {
+            if (parse_double(arg, &v) == -1 || !(v >= 0.0)) goto bad;
+            st->action = SC_WAIT; st->value = v;
+        } else if (strcmp(cmd, "attack_random") == 0) {
+            if (parse_long(arg, &n) == -1 || n < 1 || n > MAX_DRONE_ID) goto bad;
+            st->action = SC_ATTACK_RANDOM; st->value = (double)n;
+        } else if (strcmp(cmd, "kill") == 0) {
+            if (parse_double(arg, &v) == -1 || !(v > 0.0 && v <= 1.0)) goto bad;
+            st->action = SC_KILL_FRACTION; st->value = v;
+        } else if (strcmp(cmd, "attack") == 0) {
+            st->action = SC_ATTACK;
+            // Zbieramy wszystkie ID z reszty linii
+            while (arg) {
+                if (parse_long(arg, &n) == -1 || n < 0 || n >= MAX_DRONE_ID) goto bad;
+                int *p = realloc(st->ids, (st->n_ids + 1) * sizeof(int));
+                if (!p) { fprintf(stderr, "[Scenario] Out of memory.\n"); goto fail; }
+                st->ids = p;
+                st->ids[st->n_ids++] = (int)n;
+                arg = strtok_r(NULL, " \t\r\n", &save);
+            }
+            if (st->n_ids == 0) goto bad;
+        } else {
+            fprintf(stderr, C_RED "[Scenario] %s:%d: Unknown command '%s'.\n" C_RESET, path, lineno, cmd);
+            goto fail;
+        }
+    }
+    fclose(f);
+    return 0;
+
+bad:
+    fprintf(stderr, C_RED "[Scenario] %s:%d: Invalid or missing argument.\n" C_RESET, path, lineno);
+fail:
+    fclose(f);
+    scenario_free(sc);
+    return -1;
+}
+
+void scenario_free(struct Scenario *sc) {
+    for (int i = 0; i < sc->n_steps; i++) free(sc->steps[i].ids);
+    free(sc->steps);
+    sc->steps = NULL;
+    sc->n_steps = 0;
+}
@@ -0,0 +1,444 @@
+/* src/scheduler.c
+ *
+ * Rdzeń planisty Operatora: kolejki oczekujących (bufory cykliczne), tunele, miejsca w hangarze
+ * i zmiany P. Funkcje zmieniają tylko przekazany stan i dopisują akcje do SchOut - wysłanie zgód,
+ * semop i logi należą do wywołującego (src/operator.c, bench/sched_bench.c).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/scheduler.h"
+
+static void emit(struct SchOut *out, int kind, int id, int ch, int arg) {
+    if (out->n >= SCH_OUT_CAP) return; // Nie zdarza się - jedno wywołanie daje najwyżej 3 akcje
+    struct SchAction *a = &out->a[out->n++];
+    a->kind = (int16_t)kind;
+    a->ch = (int16_t)ch;
+    a->id = id;
+    a->arg = arg;
+}
+
+void sch_init(struct OperatorState *s, int P, int N) {
+    memset(s, 0, sizeof(*s));
+    s->current_P = P;
+    s->target_N = N;
+    s->current_active = N;
+    s->next_drone_id = N;
+    for (int i = 0; i < CHANNELS; i++) s->chan_dir[i] = DIR_NONE;
+    memset(s->req_ch, -1, sizeof(s->req_ch));
+}
+
+// --- KOLEJKI (Circular Buffer) ---
+
+// Pełny bufor: usunięcie zamazanych martwych (-1) z zachowaniem kolejności. Przy częstych śmierciach
+// w zablokowanej kolejce same "groby" potrafią zapełnić bufor. Zwraca 1, jeśli zwolniło miejsce.
+static int compact(struct OperatorState *s, int type) {
+    int *q = s->waitq[type];
+    int w = s->q_head[type];
+    for (int r = s->q_head[type]; r != s->q_tail[type]; r = (r + 1) % WAITQ_CAP) {
+        if (q[r] == -1) continue;
+        q[w] = q[r];
+        w = (w + 1) % WAITQ_CAP;
+    }
+    int freed = w != s->q_tail[type];
+    s->q_tail[type] = w;
+    return freed;
+}
+
+// Dodanie drona do kolejki oczekujących
+int sch_enqueue(struct OperatorState *s, int type, int id) {
+    // Obliczamy nowy indeks ogona (modulo zapewnia cykliczność - powrót do 0 po osiągnięciu końca tablicy)
+    int next = (s->q_tail[type] + 1) % WAITQ_CAP;
+    if (next == s->q_head[type]) { // Ogon dogonił głowę -> kolejka pełna; odrzucamy, jeśli nie ma grobów
+        if (!compact(s, type)) return -1;
+        next = (s->q_tail[type] + 1) % WAITQ_CAP;
+    }
+    s->waitq[type][s->q_tail[type]] = id; // Zapisanie ID drona
+    s->q_tail[type] = next;               // Przesunięcie ogona
+    s->req[id] = type == 0 ? SCH_RQ_LAND : SCH_RQ_TAKEOFF;
+    return 0;
+}
+
+// Dron z rezerwacją staje na początku kolejki lądowania - jego okno zostało już uzgodnione
+static void enqueue_land(struct OperatorState *s, int id) {
+    if (!rsv_has(&s->rsv, id)) { sch_enqueue(s, 0, id); return; }
+    int prev = (s->q_head[0] - 1 + WAITQ_CAP) % WAITQ_CAP;
+    if (prev == s->q_tail[0]) { // Kolejka pełna
+        if (!compact(s, 0)) return;
+        prev = (s->q_head[0] - 1 + WAITQ_CAP) % WAITQ_CAP;
+    }
+    s->q_head[0] = prev;
+    s->waitq[0][prev] = id;
+    s->req[id] = SCH_RQ_LAND;
+}
+
+// Pobranie drona z kolejki
+int sch_dequeue(struct OperatorState *s, int type) {
+    // Dopóki kolejka nie jest pusta (głowa != ogon)
+    while (s->q_head[type] != s->q_tail[type]) {
+        int id = s->waitq[type][s->q_head[type]];              // Pobranie ID spod głowy
+        s->q_head[type] = (s->q_head[type] + 1) % WAITQ_CAP;  // Przesunięcie głowy
+        if (id != -1) return id; // Zwróć ID jeśli dron jest "żywy" (nie ma flagi -1)
+    }
+    return -1; // Kolejka pusta
+}
+
+// Zamazanie drona w kolejkach (Lazy Deletion). Zwraca 1, jeśli czekał na lądowanie.
+static int drop_queued(struct OperatorState *s, int id) {
+    int was_landing = 0;
+    for (int t = 0; t < 2; t++) { // Sprawdzamy obie kolejki (Start/Lądowanie)
+        // Zamazujemy ID "-1" - dequeue pominie te wartości. To szybsze niż przesuwanie całej tablicy.
+        for (int i = s->q_head[t]; i != s->q_tail[t]; i = (i + 1) % WAITQ_CAP) {
+            if (s->waitq[t][i] == id) { s->waitq[t][i] = -1; if (t == 0) was_landing = 1; }
+        }
+    }
+    return was_landing;
+}
+
+// Usuwanie martwego drona: kolejki i prośba w toku (ID może dostać nowy dron z Replenish)
+int sch_remove(struct OperatorState *s, int id) {
+    int was_landing = drop_queued(s, id);
+    s->req[id] = SCH_RQ_NONE;
+    s->req_ch[id] = -1;
+    s->grant_old[id] = 0;
+    return was_landing;
+}
+
+// Liczba dronów czekających w kolejce (0 = lądowanie, 1 = start; bez zamazanych martwych)
+int sch_queue_depth(const struct OperatorState *s, int type) {
+    int n = 0;
+    for (int i = s->q_head[type]; i != s->q_tail[type]; i = (i + 1) % WAITQ_CAP) {
+        if (s->waitq[type][i] != -1) n++;
+    }
+    return n;
+}
+
+// --- TUNELE ---
+
+// Znajduje ID tunelu pasującego do żądanego kierunku
+int sch_find_channel(const struct OperatorState *s, int dir) {
+    // Priorytet 1: Szukamy tunelu, który już działa w tym kierunku (efekt konwoju)
+    for (int i = 0; i < CHANNELS; i++) if (s->chan_dir[i] == dir) return i;
+    // Priorytet 2: Szukamy całkowicie wolnego tunelu
+    for (int i = 0; i < CHANNELS; i++) if (s->chan_dir[i] == DIR_NONE) return i;
+    return -1; // Brak dostępnych tuneli
+}
+
+// Zwolnienie tunelu po przelocie drona, który miał zgodę w stanie 'granted'. 0 = dron nie miał
+// takiej zgody (duch) - tunele innych dronów zostają nietknięte.
+static int leave_channel(struct OperatorState *s, int id, int granted) {
+    if (s->req[id] != granted) return 0;
+    int ch = s->req_ch[id];
+    s->req[id] = SCH_RQ_NONE;
+    s->req_ch[id] = -1;
+    s->grant_old[id] = 0;
+    if (ch >= 0 && ch < CHANNELS && s->chan_users[ch] > 0 && --s->chan_users[ch] == 0) s->chan_dir[ch] = DIR_NONE;
+    return 1;
+}
+
+// --- MIEJSCA W HANGARZE ---
+
+// Wolne = pojemność + miejsca czekające na demontaż - zajęte (tyle wynosi semafor hangaru)
+int sch_free_slots(const struct OperatorState *s) {
+    return s->current_P + s->pending_removal - s->occupied;
+}
+
+int sch_take_spot(struct OperatorState *s, struct SchOut *out) {
+    if (sch_free_slots(s) <= 0) return 0;
+    s->occupied++;
+    emit(out, SCH_SEM, -1, -1, -1);
+    return 1;
+}
+
+// Zwolnienie miejsca z obsługą "Pending Removal" (Sygnał 2)
+static void free_spot(struct OperatorState *s, struct SchOut *out) {
+    if (s->occupied > 0) s->occupied--;
+    if (s->pending_removal > 0) {
+        // Zamiast oddawać miejsce, niszczymy je (spłacamy dług) - semafor bez zmian
+        s->pending_removal--;
+        emit(out, SCH_DISMANTLED, -1, -1, s->pending_removal);
+    } else {
+        emit(out, SCH_SEM, -1, -1, 1);
+    }
+}
+
+// Cofnięcie rezerwacji, z której jednak nie skorzystano (np. nieudany fork). Jak wylot - spłaca
+// demontaż zlecony w międzyczasie, inaczej wolne miejsce współistniałoby z długiem.
+void sch_return_spot(struct OperatorState *s, struct SchOut *out) { free_spot(s, out); }
+
+// Zgoda na lądowanie: tunel do środka i miejsce w hangarze (wywołujący sprawdził oba)
+static void grant_land(struct OperatorState *s, int id, int ch, struct SchOut *out) {
+    s->chan_dir[ch] = DIR_IN;
+    s->chan_users[ch]++;
+    s->occupied++;
+    s->req[id] = SCH_RQ_LAND_GRANT;
+    s->req_ch[id] = (int8_t)ch;
+    s->grant_old[id] = 0;
+    emit(out, SCH_SEM, -1, -1, -1);
+    emit(out, SCH_GRANT_LAND, id, ch, rsv_clear(&s->rsv, id));
+}
+
+static void grant_takeoff(struct OperatorState *s, int id, int ch, struct SchOut *out) {
+    s->chan_dir[ch] = DIR_OUT;
+    s->chan_users[ch]++;
+    s->req[id] = SCH_RQ_TAKEOFF_GRANT;
+    s->req_ch[id] = (int8_t)ch;
+    s->grant_old[id] = 0;
+    emit(out, SCH_GRANT_TAKEOFF, id, ch, 0);
+}
+
+// --- PLANISTA ---
+
+int sch_pass(struct OperatorState *s, struct SchOut *out) {
+    int granted = 0;
+    // 1. Obsługa wylotów (START) - mają priorytet, bo zwalniają miejsca w hangarze
+    int cid_out = sch_find_channel(s, DIR_OUT);
+    if (cid_out != -1) {
+        int id = sch_dequeue(s, 1);
+        if (id != -1) { grant_takeoff(s, id, cid_out, out); granted++; }
+    }
+
+    // Jeśli populacja jest za duża (trwa redukcja bazy), blokujemy lądowania
+    if (s->current_active > s->target_N) return granted;
+
+    // 2. Obsługa wlotów (LĄDOWANIE) - Tylko jeśli są fizyczne miejsca w hangarze
+    if (sch_free_slots(s) > 0) {
+        int cid_in = sch_find_channel(s, DIR_IN);
+        if (cid_in != -1) {
+            int id = sch_dequeue(s, 0);
+            if (id != -1) { grant_land(s, id, cid_in, out); granted++; }
+        }
+    }
+    return granted;
+}
+
+int sch_event(struct OperatorState *s, int type, int id, int immediate, double now, struct SchOut *out) {
+    int flags = 0;
+    if (id < 0 || id >= MAX_DRONE_ID) return SCH_F_NO_CHANNEL;
+    switch (type) {
+        case MSG_REQ_LAND:
+            // Powtórzona prośba (dron już czeka albo ma zgodę) - druga zgoda byłaby dla nikogo
+            if (s->req[id] == SCH_RQ_LAND || s->req[id] == SCH_RQ_LAND_GRANT) { flags |= SCH_F_DUPLICATE; break; }
+            if (s->req[id] == SCH_RQ_TAKEOFF) drop_queued(s, id); // Nieaktualna prośba o start
+            if (s->current_active > s->target_N) {
+                // Trwa redukcja populacji - lądowanie czeka (naturalne wygaszanie)
+                emit(out, SCH_BLOCKED, id, -1, 0);
+                enqueue_land(s, id);
+                break;
+            }
+            if (immediate && sch_free_slots(s) > 0) { // Miejsce w hangarze i wolny tunel = zgoda od razu
+                int ch = sch_find_channel(s, DIR_IN);
+                if (ch != -1) { grant_land(s, id, ch, out); break; }
+            }
+            enqueue_land(s, id);
+            break;
+
+        case MSG_REQ_TAKEOFF:
+            if (s->req[id] == SCH_RQ_TAKEOFF || s->req[id] == SCH_RQ_TAKEOFF_GRANT) { flags |= SCH_F_DUPLICATE; break; }
+            if (s->req[id] == SCH_RQ_LAND) drop_queued(s, id);
+            // Prośba o start przy zgodzie na lądowanie: LANDED drona czeka jeszcze w kolejce IPC
+            // (msgrcv z -MSG_OP_MAX odbiera niższe typy pierwsze), np. gdy Kamikadze przerwał
+            // ładowanie - dron jest już w hangarze, tunel zwalniamy teraz
+            else if (s->req[id] == SCH_RQ_LAND_GRANT) leave_channel(s, id, SCH_RQ_LAND_GRANT);
+            if (immediate) {
+                int ch = sch_find_channel(s, DIR_OUT);
+                if (ch != -1) { grant_takeoff(s, id, ch, out); break; }
+            }
+            sch_enqueue(s, 1, id);
+            break;
+
+        case MSG_LANDED: // Zwolnił tunel, zajął hangar (miejsce liczone od zgody)
+            if (s->req[id] == SCH_RQ_TAKEOFF || s->req[id] == SCH_RQ_TAKEOFF_GRANT) break; // Wyprzedzone przez prośbę o start
+            if (!leave_channel(s, id, SCH_RQ_LAND_GRANT)) flags |= SCH_F_NO_CHANNEL;
+            break;
+
+        case MSG_DEPARTED: // Zwolnił tunel i hangar. Bez zgody na start to duch - miejsca nie oddajemy.
+            if (!leave_channel(s, id, SCH_RQ_TAKEOFF_GRANT)) flags |= SCH_F_NO_CHANNEL;
+            else free_spot(s, out);
+            break;
+
+        case MSG_DEAD: // Usuwamy go z kolejek (żeby nie wywoływać duchów), okno wraca do kalendarza
+            // Zginął ze zgodą (Kamikadze w tunelu do środka, śmierć w chwili wysłania zgody): tunel
+            // i miejsce wzięte przy zgodzie wracają jak przy wylocie - nikt inny ich nie odda
+            if (s->req[id] == SCH_RQ_LAND_GRANT || s->req[id] == SCH_RQ_TAKEOFF_GRANT) {
+                leave_channel(s, id, s->req[id]);
+                free_spot(s, out);
+                flags |= SCH_F_GRANT_FREED;
+            }
+            if (sch_remove(s, id)) flags |= SCH_F_WAS_QUEUED;
+            if (rsv_has(&s->rsv, id)) {
+                rsv_release(&s->rsv, id, now);
+                flags |= SCH_F_RSV_FREED;
+            }
+            break;
+    }
+    return flags;
+}
+
+// Kolejność wiadomości do drona (FIFO jednego mtype) rozstrzyga: zgoda wysłana przez poprzednika
+// dotarłaby przed GRANT_RESYNC, więc ponowienie oznacza, że jej nie było. Zgoda wydana już w tej
+// epoce jest jeszcze w drodze - ponowienie jest wtedy zwykłym duplikatem.
+int sch_resend(struct OperatorState *s, int type, int id, int immediate, double now, struct SchOut *out) {
+    if (id >= 0 && id < MAX_DRONE_ID && s->grant_old[id] &&
+        s->req[id] == (type == MSG_REQ_LAND ? SCH_RQ_LAND_GRANT : SCH_RQ_TAKEOFF_GRANT)) {
+        s->grant_old[id] = 0;
+        emit(out, SCH_REGRANT, id, s->req_ch[id], type);
+        return 0;
+    }
+    return sch_event(s, type, id, immediate, now, out);
+}
+
+int sch_recover(struct OperatorState *s) {
+    int n = 0;
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        s->grant_old[i] = s->req[i] == SCH_RQ_LAND_GRANT || s->req[i] == SCH_RQ_TAKEOFF_GRANT;
+        n += s->grant_old[i];
+    }
+    return n;
+}
+
+// --- DYNAMICZNE SKALOWANIE ---
+
+// Demontaż 'remove_cnt' miejsc: wolne znikają od razu, zajęte po wylocie drona
+// (pending_removal, spłacane w free_spot). Wolne liczymy przed zmianą P. Zwraca liczbę usuniętych od razu.
+static int remove_platforms(struct OperatorState *s, int remove_cnt, struct SchOut *out) {
+    int free_slots = sch_free_slots(s);
+    if (free_slots < 0) free_slots = 0;
+    s->current_P -= remove_cnt;
+    int immediate = free_slots >= remove_cnt ? remove_cnt : free_slots;
+    if (immediate > 0) emit(out, SCH_SEM, -1, -1, -immediate);
+    s->pending_removal += remove_cnt - immediate; // Reszta "wisi" do wylotu dronów
+    return immediate;
+}
+
+// Dodanie 'add' miejsc: najpierw anulujemy zaległy demontaż (te miejsca są jeszcze zajęte i wrócą
+// do puli po wylocie dronów), dopiero reszta trafia do semafora
+static void add_platforms(struct OperatorState *s, int add, struct SchOut *out) {
+    int cancel = add < s->pending_removal ? add : s->pending_removal;
+    s->pending_removal -= cancel;
+    if (add - cancel > 0) emit(out, SCH_SEM, -1, -1, add - cancel);
+    s->current_P += add;
+}
+
+// Rozkaz '1' - podwojenie bazy (jednorazowe)
+int sch_grow(struct OperatorState *s, struct SchOut *out) {
+    if (s->signal1_used) return SCH_IGNORED;
+    if (s->target_N * 2 > MAX_DRONE_ID) return SCH_DENIED; // Limit tablicy PID w pamięci dzielonej
+    add_platforms(s, s->current_P, out);
+    s->target_N *= 2;
+    s->signal1_used = 1;
+    return SCH_OK;
+}
+
+// Rozkaz '2' - pomniejszenie bazy o połowę
+int sch_shrink(struct OperatorState *s, struct SchOut *out, int *removed) {
+    *removed = 0;
+    if (s->current_P <= 1) return SCH_IGNORED; // Nie możemy zejść do 0 miejsc
+    s->target_N /= 2;
+    if (s->target_N < 1) s->target_N = 1;
+    *removed = remove_platforms(s, s->current_P / 2, out);
+    return SCH_OK;
+}
+
+// Zmiana P o dowolny krok. Wzrost najpierw anuluje zaległy demontaż, spadek korzysta z tego
+// samego odroczonego demontażu co Sygnał 2. Warunek P < N/2 utrzymujemy podnosząc docelowe N;
+// przy spadku N zostaje.
+int sch_resize(struct OperatorState *s, int new_P, struct SchOut *out) {
+    if (new_P > s->current_P) {
+        add_platforms(s, new_P - s->current_P, out);
+        if (2 * s->current_P >= s->target_N) {
+            s->target_N = 2 * s->current_P + 1 < MAX_DRONE_ID ? 2 * s->current_P + 1 : MAX_DRONE_ID;
+            return 1;
+        }
+    } else if (new_P < s->current_P) {
+        remove_platforms(s, s->current_P - new_P, out);
+    }
+    return 0;
+}
+
+// --- NIEZMIENNIKI ---
+
+int sch_check(const struct OperatorState *s, char *why, size_t len) {
+    static uint8_t seen[MAX_DRONE_ID];
+    int free_slots = sch_free_slots(s);
+    int in_users = 0, idle_in = 0;
+    int holders[CHANNELS] = {0};
+
+    if (s->current_P < 1) { snprintf(why, len, "P=%d < 1", s->current_P); return -1; }
+    if (s->target_N < 1) { snprintf(why, len, "target N=%d < 1", s->target_N); return -1; }
+    if (s->occupied < 0 || s->pending_removal < 0) {
+        snprintf(why, len, "negative occupied %d / pending %d", s->occupied, s->pending_removal);
+        return -1;
+    }
+    if (free_slots < 0) {
+        snprintf(why, len, "hangar over capacity: occupied %d > P %d + pending %d", s->occupied, s->current_P, s->pending_removal);
+        return -1;
+    }
+    // Dług demontażu powstaje tylko przy pełnym hangarze i jest spłacany zanim wróci wolne miejsce
+    if (s->pending_removal > 0 && free_slots != 0) {
+        snprintf(why, len, "pending removal %d with %d free slots", s->pending_removal, free_slots);
+        return -1;
+    }
+    for (int i = 0; i < CHANNELS; i++) {
+        int d = s->chan_dir[i], u = s->chan_users[i];
+        if (d != DIR_NONE && d != DIR_IN && d != DIR_OUT) { snprintf(why, len, "channel %d direction %d", i, d); return -1; }
+        if (u < 0 || (u > 0 && d == DIR_NONE)) { snprintf(why, len, "channel %d: %d users, direction %d", i, u, d); return -1; }
+        if (d == DIR_OUT && u == 0) { snprintf(why, len, "channel %d OUT without users", i); return -1; }
+        if (d == DIR_IN) in_users += u;
+        if (d == DIR_IN && u == 0) idle_in++;
+    }
+    // Pusty tunel w kierunku IN to tylko tunel ustawiony pod rezerwacje okien (rsv_tick) - najwyżej jeden
+    if (idle_in > (s->rsv.base != 0)) { snprintf(why, len, "%d channels IN without users", idle_in); return -1; }
+    // Użytkownicy tunelu = drony ze zgodą na tym tunelu (śmierć ze zgodą też go zwalnia)
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        if (s->req[i] != SCH_RQ_LAND_GRANT && s->req[i] != SCH_RQ_TAKEOFF_GRANT) continue;
+        int c = s->req_ch[i];
+        if (c < 0 || c >= CHANNELS || s->chan_dir[c] != (s->req[i] == SCH_RQ_LAND_GRANT ? DIR_IN : DIR_OUT)) {
+            snprintf(why, len, "drone %d granted on channel %d with direction %d", i, c, c >= 0 && c < CHANNELS ? s->chan_dir[c] : -1);
+            return -1;
+        }
+        holders[c]++;
+    }
+    for (int i = 0; i < CHANNELS; i++) {
+        if (s->chan_users[i] != holders[i]) {
+            snprintf(why, len, "channel %d: %d users, %d drones granted on it", i, s->chan_users[i], holders[i]);
+            return -1;
+        }
+    }
+    // Każdy dron w tunelu do środka ma już miejsce w hangarze
+    if (in_users > s->occupied) {
+        snprintf(why, len, "%d drones entering but only %d spots occupied", in_users, s->occupied);
+        return -1;
+    }
+    // Kolejki: indeksy w buforze, poprawne ID, żaden dron nie czeka dwa razy, stan prośby zgodny z kolejką
+    memset(seen, 0, sizeof(seen));
+    int queued = 0, waiting = 0;
+    for (int t = 0; t < 2; t++) {
+        if (s->q_head[t] < 0 || s->q_head[t] >= WAITQ_CAP || s->q_tail[t] < 0 || s->q_tail[t] >= WAITQ_CAP) {
+            snprintf(why, len, "queue %d indices %d/%d", t, s->q_head[t], s->q_tail[t]);
+            return -1;
+        }
+        for (int i = s->q_head[t]; i != s->q_tail[t]; i = (i + 1) % WAITQ_CAP) {
+            int id = s->waitq[t][i];
+            if (id == -1) continue;
+            if (id < 0 || id >= MAX_DRONE_ID) { snprintf(why, len, "queue %d holds id %d", t, id); return -1; }
+            if (seen[id]) { snprintf(why, len, "drone %d queued twice", id); return -1; }
+            if (s->req[id] != (t == 0 ? SCH_RQ_LAND : SCH_RQ_TAKEOFF)) {
+                snprintf(why, len, "drone %d queued with request state %d", id, s->req[id]);
+                return -1;
+            }
+            seen[id] = 1;
+            queued++;
+        }
+    }
+    for (int i = 0; i < MAX_DRONE_ID; i++) {
+        waiting += s->req[i] == SCH_RQ_LAND || s->req[i] == SCH_RQ_TAKEOFF;
+        if (s->grant_old[i] && s->req[i] != SCH_RQ_LAND_GRANT && s->req[i] != SCH_RQ_TAKEOFF_GRANT) {
+            snprintf(why, len, "drone %d: unconfirmed grant in request state %d", i, s->req[i]);
+            return -1;
+        }
+    }
+    if (waiting != queued) { snprintf(why, len, "%d drones waiting by request state, queues hold %d", waiting, queued); return -1; }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/* src/spsc.c
+ *
+ * Kolejka SPSC bez blokad i usypianie konsumenta przez eventfd.
+ * Producent: zapis slotu, publikacja 'head' (release). Konsument: odczyt 'head' (acquire),
+ * kopia slotu, publikacja 'tail' (release). Flaga 'waiting' i indeksy używają porządku
+ * sekwencyjnego - konsument zgłasza sen przed sprawdzeniem kolejek, producent sprawdza flagę
+ * po publikacji, więc co najmniej jedna strona zobaczy zapis drugiej.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include "../include/spsc.h"
+#include "../include/ipc_wrapper.h"
+
+int spsc_waker_init(struct SpscWaker *w) {
+    w->waiting = 0;
+    w->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return w->efd == -1 ? -1 : 0;
+}
+
+void spsc_waker_close(struct SpscWaker *w) {
+    if (w->efd != -1) close(w->efd);
+    w->efd = -1;
+}
+
+void spsc_waker_kick(struct SpscWaker *w) {
+    uint64_t one = 1;
+    if (write(w->efd, &one, sizeof(one)) == -1 && errno != EAGAIN) return;
+}
+
+void spsc_wake(struct SpscWaker *w) {
+    // exchange - z kilku równoczesnych budzących tylko jeden płaci wywołaniem systemowym
+    if (__atomic_load_n(&w->waiting, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&w->waiting, 0, __ATOMIC_SEQ_CST))
+        spsc_waker_kick(w);
+}
+
+void spsc_arm(struct SpscWaker *w) { __atomic_store_n(&w->waiting, 1, __ATOMIC_SEQ_CST); }
+
+void spsc_disarm(struct SpscWaker *w) { __atomic_store_n(&w->waiting, 0, __ATOMIC_SEQ_CST); }
+
+int spsc_sleep(struct SpscWaker *w, double deadline) {
+    int ms = (int)((deadline - mono_time()) * 1000.0 + 0.999);
+    if (ms < 0) ms = 0;
+    struct pollfd pfd = {w->efd, POLLIN, 0};
+    int r = poll(&pfd, 1, ms); // Sygnał przerywa sen (EINTR) - flagi sprawdza wywołujący
+    spsc_disarm(w);
+    if (r > 0) {
+        uint64_t v;
+        if (read(w->efd, &v, sizeof(v)) == -1) return 0;
+        return 1;
+    }
+    return 0;
+}
+
+int spsc_init(struct Spsc *q, uint32_t cap, uint32_t esize, struct SpscWaker *w) {
+    uint32_t n = 1;
+    while (n < cap) n <<= 1;
+    q->head = q->tail = 0;
+    q->mask = n - 1;
+    q->esize = esize;
+    q->waker = w;
+    q->buf = calloc(n, esize);
+    return q->buf ? 0 : -1;
+}
+
+void spsc_free(struct Spsc *q) {
+    free(q->buf);
+    q->buf = NULL;
+}
+
+int spsc_push(struct Spsc *q, const void *e) {
+    uint32_t h = q->head; // Własny indeks - czytany bez synchronizacji
+    if (h - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) > q->mask) return -1;
+    memcpy(q->buf + (size_t)(h & q->mask) * q->esize, e, q->esize);
+    __atomic_store_n(&q->head, h + 1, __ATOMIC_SEQ_CST);
+    if (q->waker) spsc_wake(q->waker); // Budzimy tylko śpiącego konsumenta
+    return 0;
+}
+
+int spsc_pop(struct Spsc *q, void *e) {
+    uint32_t t = q->tail;
+    if (t == __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) return 0;
+    memcpy(e, q->buf + (size_t)(t & q->mask) * q->esize, q->esize);
+    __atomic_store_n(&q->tail, t + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+int spsc_empty(struct Spsc *q) {
+    return __atomic_load_n(&q->head, __ATOMIC_SEQ_CST) == q->tail;
+}
+
+uint32_t spsc_len(struct Spsc *q) {
+    return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+}
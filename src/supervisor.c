@@ -0,0 +1,268 @@
+/* src/supervisor.c
+ *
+ * Nadzorca procesów potomnych Commandera oparty o pidfd i epoll.
+ * - pidfd_open: deskryptor staje się czytelny w chwili śmierci procesu (bez pętli waitpid)
+ * - waitid(P_PIDFD): zebranie konkretnego dziecka i jego kodu wyjścia
+ * - pidfd_send_signal: sygnał trafia zawsze w ten sam proces, nawet jeśli PID został ponownie użyty
+ */
+
+// MUSI BYĆ PIERWSZE!
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/wait.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+#include "../include/supervisor.h"
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+// Zakończony proces (historia do CSV)
+struct SupRecord {
+    pid_t pid;
+    int kind;
+    int drone_id;
+    int code;     // CLD_EXITED / CLD_KILLED / CLD_DUMPED
+    int status;   // Kod wyjścia lub numer sygnału
+    double life;  // Czas życia (s)
+};
+
+static int epfd = -1;
+static struct SupChild children[SUP_MAX_CHILDREN];
+static int by_id[MAX_DRONE_ID];      // ID drona -> uchwyt (-1 = brak)
+static int alive[SUP_KINDS];
+static struct SupKindStats stats[SUP_KINDS];
+
+static struct SupRecord *history = NULL;
+static int hist_n = 0, hist_cap = 0;
+
+static int pidfd_open_(pid_t pid) {
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+int sup_init(void) {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1) { perror("[Supervisor] epoll_create1"); return -1; }
+    for (int i = 0; i < SUP_MAX_CHILDREN; i++) children[i].pidfd = -1;
+    for (int i = 0; i < MAX_DRONE_ID; i++) by_id[i] = -1;
+    return 0;
+}
+
+int sup_fd(void) { return epfd; }
+
+int sup_watch(pid_t pid, int kind, int drone_id) {
+    int h = -1;
+    for (int i = 0; i < SUP_MAX_CHILDREN; i++) {
+        if (children[i].pidfd == -1) { h = i; break; }
+    }
+    if (h == -1) { fprintf(stderr, "[Supervisor] Child table full.\n"); return -1; }
+
+    int fd = pidfd_open_(pid);
+    if (fd == -1) return -1;
+
+    // Weryfikacja: tylko nasze dzieci (niezebrane dziecko nie może zmienić PID-u).
+    // WNOWAIT - sprawdzamy bez zbierania; ECHILD oznacza obcy proces (np. nieaktualny PID z pamięci).
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PIDFD, fd, &info, WEXITED | WNOHANG | WNOWAIT) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = (uint32_t)h;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        perror("[Supervisor] epoll_ctl");
+        close(fd);
+        return -1;
+    }
+
+    children[h].pid = pid;
+    children[h].pidfd = fd;
+    children[h].kind = kind;
+    children[h].drone_id = drone_id;
+    children[h].t_start = mono_time();
+    if (kind == SUP_DRONE && drone_id >= 0 && drone_id < MAX_DRONE_ID) by_id[drone_id] = h;
+    alive[kind]++;
+    stats[kind].started++;
+    return h;
+}
+
+int sup_find_drone(int drone_id) {
+    if (drone_id < 0 || drone_id >= MAX_DRONE_ID) return -1;
+    return by_id[drone_id];
+}
+
+pid_t sup_pid(int handle) {
+    if (handle < 0 || handle >= SUP_MAX_CHILDREN || children[handle].pidfd == -1) return -1;
+    return children[handle].pid;
+}
+
+int sup_signal(int handle, int sig) {
+    if (handle < 0 || handle >= SUP_MAX_CHILDREN || children[handle].pidfd == -1) {
+        errno = ESRCH;
+        return -1;
+    }
+    return (int)syscall(SYS_pidfd_send_signal, children[handle].pidfd, sig, NULL, 0);
+}
+
+int sup_signal_value(int handle, int sig, int value) {
+    if (handle < 0 || handle >= SUP_MAX_CHILDREN || children[handle].pidfd == -1) {
+        errno = ESRCH;
+        return -1;
+    }
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    info.si_signo = sig;
+    info.si_code = SI_QUEUE; // Jedyny kod, który jądro przyjmuje od innego procesu
+    info.si_pid = getpid();
+    info.si_uid = getuid();
+    info.si_value.sival_int = value;
+    return (int)syscall(SYS_pidfd_send_signal, children[handle].pidfd, sig, &info, 0);
+}
+
+static void record_exit(struct SupChild *c, const siginfo_t *info) {
+    struct SupKindStats *st = &stats[c->kind];
+    double life = mono_time() - c->t_start;
+    st->exited++;
+    st->life_sum += life;
+    if (life > st->life_max) st->life_max = life;
+    if (info->si_code == CLD_EXITED) {
+        if (info->si_status == 0) st->exit_zero++;
+        else st->exit_error++;
+    } else {
+        st->signaled++;
+        if (info->si_status > 0 && info->si_status < NSIG) st->by_signal[info->si_status]++;
+    }
+
+    if (hist_n == hist_cap) {
+        int cap = hist_cap ? hist_cap * 2 : 1024;
+        struct SupRecord *p = realloc(history, cap * sizeof(*p));
+        if (!p) return; // Brak pamięci - tracimy tylko wpis historii, liczniki są aktualne
+        history = p;
+        hist_cap = cap;
+    }
+    history[hist_n++] = (struct SupRecord){ c->pid, c->kind, c->drone_id, info->si_code, info->si_status, life };
+}
+
+// Zebranie jednego dziecka, którego pidfd zgłosił zakończenie
+static int reap(int h, sup_exit_cb cb) {
+    struct SupChild *c = &children[h];
+    siginfo_t info;
+    memset(&info, 0, sizeof(info));
+    if (waitid(P_PIDFD, c->pidfd, &info, WEXITED | WNOHANG) == -1) {
+        if (errno == EINTR) return 0;
+        // ECHILD: ktoś inny zebrał proces - traktujemy jak zakończenie bez kodu
+        info.si_code = CLD_EXITED;
+        info.si_status = -1;
+    } else if (info.si_pid == 0) {
+        return 0; // Jeszcze żyje (fałszywe wybudzenie)
+    }
+
+    record_exit(c, &info);
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->pidfd, NULL);
+    close(c->pidfd);
+    if (c->kind == SUP_DRONE && c->drone_id >= 0 && c->drone_id < MAX_DRONE_ID && by_id[c->drone_id] == h) {
+        by_id[c->drone_id] = -1;
+    }
+    alive[c->kind]--;
+
+    struct SupChild copy = *c;
+    c->pidfd = -1;
+    if (cb) cb(&copy, info.si_code, info.si_status);
+    return 1;
+}
+
+int sup_poll(int timeout_ms, sup_exit_cb cb) {
+    struct epoll_event evs[64];
+    int reaped = 0;
+    for (;;) {
+        int n = epoll_wait(epfd, evs, 64, timeout_ms);
+        if (n == -1) {
+            if (errno == EINTR) return reaped;
+            perror("[Supervisor] epoll_wait");
+            return reaped;
+        }
+        for (int i = 0; i < n; i++) reaped += reap((int)evs[i].data.u32, cb);
+        // Pełny bufor = mogą czekać kolejne zdarzenia; dobieramy je bez czekania
+        if (n < 64) return reaped;
+        timeout_ms = 0;
+    }
+}
+
+static int tracked(pid_t pid) {
+    for (int i = 0; i < SUP_MAX_CHILDREN; i++) if (children[i].pidfd != -1 && children[i].pid == pid) return 1;
+    return 0;
+}
+
+int sup_reap_untracked(void) {
+    int reaped = 0;
+    for (;;) {
+        // WNOWAIT: podgląd pierwszego zakończonego dziecka bez zbierania - nadzorowane zostawiamy
+        // sup_poll (potrzebuje ich kodu wyjścia), a tylko obce zbieramy od razu
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) == -1 || info.si_pid == 0) break;
+        if (tracked(info.si_pid)) break;
+        pid_t pid = info.si_pid;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOHANG) == -1 || info.si_pid == 0) break;
+        reaped++;
+    }
+    return reaped;
+}
+
+int sup_drain(double timeout_s, sup_exit_cb cb) {
+    double deadline = mono_time() + timeout_s;
+    while (alive[SUP_OPERATOR] + alive[SUP_DRONE] > 0) {
+        double left = deadline - mono_time();
+        if (left <= 0) break;
+        sup_poll((int)(left * 1000) + 1, cb);
+    }
+    return alive[SUP_OPERATOR] + alive[SUP_DRONE];
+}
+
+int sup_alive(int kind) { return alive[kind]; }
+
+const struct SupKindStats *sup_stats(int kind) { return &stats[kind]; }
+
+int sup_write_csv(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) { perror("[Supervisor] fopen"); return -1; }
+    fprintf(f, "pid,kind,drone_id,lifetime_s,how,status\n");
+    for (int i = 0; i < hist_n; i++) {
+        struct SupRecord *r = &history[i];
+        fprintf(f, "%d,%s,%d,%.3f,%s,%d\n", r->pid, r->kind == SUP_OPERATOR ? "operator" : "drone",
+                r->drone_id, r->life, r->code == CLD_EXITED ? "exit" : "signal", r->status);
+    }
+    fclose(f);
+    return 0;
+}
+
+int sup_pidfd(pid_t pid) {
+    if (pid <= 0) { errno = ESRCH; return -1; }
+    return pidfd_open_(pid); // pidfd ma zawsze FD_CLOEXEC
+}
+
+void sup_close(void) {
+    for (int i = 0; i < SUP_MAX_CHILDREN; i++) {
+        if (children[i].pidfd != -1) close(children[i].pidfd);
+        children[i].pidfd = -1;
+    }
+    if (epfd != -1) close(epfd);
+    epfd = -1;
+    free(history);
+    history = NULL;
+    hist_n = hist_cap = 0;
+}
@@ -0,0 +1,80 @@
+/* src/swarmctl.c
+ *
+ * Klient gniazda sterującego Commandera.
+ *   swarmctl [-S gniazdo] komenda [argumenty]   - jedna komenda (';' rozdziela kolejne)
+ *   swarmctl [-S gniazdo] < plik                - wszystkie linie wejścia jako jedna partia
+ * Odpowiedzi Commandera ("OK ..." / "ERR ...") trafiają na stdout, kod wyjścia 1 przy dowolnym ERR.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../include/control.h"
+
+// Zapis całego bufora (gniazdo może przyjąć mniej naraz)
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = CTL_SOCKET;
+    int opt;
+    while ((opt = getopt(argc, argv, "S:")) != -1) {
+        switch (opt) {
+            case 'S': path = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-S socket] [command args...]  (no command = read batch from stdin)\n", argv[0]);
+                return 2;
+        }
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) { perror("[swarmctl] socket"); return 2; }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        fprintf(stderr, "[swarmctl] connect %s: %s (is the commander running?)\n", path, strerror(errno));
+        return 2;
+    }
+
+    // Komenda z argumentów albo cała zawartość stdin - wysłana jednym zapisem (jedna partia)
+    static char req[CTL_BUF];
+    size_t len = 0;
+    if (optind < argc) {
+        for (int i = optind; i < argc && len < sizeof(req) - 2; i++)
+            len += snprintf(req + len, sizeof(req) - 1 - len, "%s%s", i > optind ? " " : "", argv[i]);
+        if (len > sizeof(req) - 2) len = sizeof(req) - 2;
+        req[len++] = '\n';
+    } else {
+        size_t n;
+        while (len < sizeof(req) - 1 && (n = fread(req + len, 1, sizeof(req) - 1 - len, stdin)) > 0) len += n;
+        if (len == sizeof(req) - 1) fprintf(stderr, "[swarmctl] Input truncated to %zu bytes.\n", len);
+        if (len > 0 && req[len - 1] != '\n') req[len++] = '\n';
+    }
+    if (write_all(fd, req, len) == -1) { perror("[swarmctl] write"); return 2; }
+    shutdown(fd, SHUT_WR); // Koniec partii - Commander odpowie i zamknie połączenie
+
+    int errors = 0;
+    FILE *in = fdopen(fd, "r");
+    char line[CTL_REPLY + 2];
+    while (in && fgets(line, sizeof(line), in)) {
+        fputs(line, stdout);
+        if (strncmp(line, "ERR", 3) == 0) errors++;
+    }
+    if (in) fclose(in);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+/* src/swarmexp.c
+ *
+ * Eksporter OpenMetrics: liczniki, wskaźniki i histogramy roju z pamięci dzielonej (tylko odczyt),
+ * podawane przez HTTP na lokalnym gnieździe TCP albo Unix.
+ *   swarmexp [-l port|ścieżka] [-R katalog] [-K klucz]
+ *   -l  port TCP na 127.0.0.1 (domyślnie EXP_PORT) albo ścieżka gniazda Unix
+ *   -R  klucze IPC z katalogu przebiegu (jak commander -R), -K - klucze jawnie (jak commander -K);
+ *       bez nich - SWARM_IPC_KEYS albo domyślne
+ * Zapytanie czyta stałą liczbę pól (statystyki Operatora, punkt kontrolny, sumy ładowania) -
+ * sloty telemetrii nie są przeglądane, więc koszt nie rośnie z liczbą dronów.
+ *   curl -s localhost:9464/metrics
+ *   curl -s --unix-socket swarm.metrics http://localhost/metrics
+ * Rój może się kończyć i startować od nowa pod tymi samymi kluczami - segment jest
+ * wyszukiwany przy każdym zapytaniu, a bez roju zostaje tylko swarm_up 0.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+
+#define EXP_PORT 9464
+#define EXP_BODY (64 * 1024) // Odpowiedź ma stałą liczbę linii - z dużym zapasem
+#define EXP_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+static volatile sig_atomic_t keep_running = 1;
+
+void sigint_handler(int sig) { (void)sig; keep_running = 0; }
+
+static int shmid = -1;
+static const struct SharedState *sh = NULL;
+
+static char body[EXP_BODY];
+static size_t blen = 0;
+
+static void emit(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(body + blen, sizeof(body) - blen, format, args);
+    va_end(args);
+    if (n > 0) blen += (size_t)n < sizeof(body) - blen ? (size_t)n : sizeof(body) - blen - 1;
+}
+
+static void family(const char *name, const char *type, const char *help) {
+    emit("# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+static void counter(const char *name, const char *help, unsigned long long v) {
+    family(name, "counter", help);
+    emit("%s_total %llu\n", name, v);
+}
+
+static void gauge(const char *name, const char *help, double v) {
+    family(name, "gauge", help);
+    emit("%s %.9g\n", name, v);
+}
+
+// Histogram log2 z OpStats: granica kubełka k to 2^k jednostek (unit_s = jednostka w sekundach).
+// _count to suma kubełków - odczyt bez blokad nie może dać licznika niezgodnego z +Inf.
+static void histogram(const char *name, const char *help, const uint64_t *hist, double unit_s, double sum_s) {
+    family(name, "histogram", help);
+    emit("# UNIT %s seconds\n", name);
+    unsigned long long cum = 0;
+    for (int k = 0; k < LAT_BUCKETS - 1; k++) {
+        cum += hist[k];
+        emit("%s_bucket{le=\"%.9g\"} %llu\n", name, (double)(1ULL << k) * unit_s, cum);
+    }
+    cum += hist[LAT_BUCKETS - 1];
+    emit("%s_bucket{le=\"+Inf\"} %llu\n%s_count %llu\n%s_sum %.6f\n", name, cum, name, cum, name, sum_s);
+}
+
+// Segment bieżącego roju (NULL = brak). Nowy rój pod tymi samymi kluczami = nowy identyfikator.
+static const struct SharedState *swarm(void) {
+    int id = shmget(ipc_key(IPC_KEY_SHM), 0, 0);
+    if (id != shmid && sh) {
+        shmdt(sh);
+        sh = NULL;
+    }
+    shmid = id;
+    if (id != -1 && !sh) {
+        sh = shmat(id, NULL, SHM_RDONLY);
+        if (sh == (void *)-1) { perror("[swarmexp] shmat"); sh = NULL; }
+    }
+    return sh;
+}
+
+static void build_metrics(void) {
+    blen = 0;
+    const struct SharedState *s = swarm();
+    pid_t cmd_pid = s ? s->session.commander_pid : 0;
+    int up = s && cmd_pid > 0 && (kill(cmd_pid, 0) == 0 || errno == EPERM);
+    gauge("swarm_up", "1 if a swarm with a live commander is attached to the IPC keys.", up);
+    if (!s) { emit("# EOF\n"); return; }
+
+    const struct OpStats *os = &s->op_stats;
+    const struct OpCheckpoint *cp = &s->checkpoint;
+    uint32_t seq = __atomic_load_n(&cp->seq, __ATOMIC_ACQUIRE);
+    const struct OperatorState *st = &cp->slot[seq % 2];
+
+    gauge("swarm_uptime_seconds", "Seconds since the commander launched the swarm.",
+          s->session.t_start > 0 ? mono_time() - s->session.t_start : 0.0);
+
+    family("swarm_grants", "counter", "Grants issued by the operator scheduler.");
+    emit("swarm_grants_total{direction=\"land\"} %llu\n", (unsigned long long)os->grants_dir[0]);
+    emit("swarm_grants_total{direction=\"takeoff\"} %llu\n", (unsigned long long)os->grants_dir[1]);
+    counter("swarm_deaths", "Drone deaths reported to the operator.", os->deaths);
+    counter("swarm_deaths_waiting", "Drones that died in the landing queue.", os->deaths_waiting);
+    counter("swarm_spawns", "Drones created by replenish.", os->spawns);
+    counter("swarm_blocked", "Requests held because the population exceeds the target N.", os->blocked);
+    counter("swarm_operator_messages", "Messages handled by the operator.", os->msgs);
+    counter("swarm_grants_deferred", "Grants deferred because the message queue was full.", os->grants_deferred);
+    counter("swarm_operator_recoveries", "Operator restarts resumed from the checkpoint.", (unsigned long long)cp->recoveries);
+    counter("swarm_charge_sessions", "Finished charging sessions in the charger pool.", s->charge.sessions);
+
+    // Stan planisty z ostatniego punktu kontrolnego (seq = 0: Operator jeszcze nic nie zapisał)
+    gauge("swarm_hangar_capacity", "Current hangar capacity P.", seq ? st->current_P : 0);
+    gauge("swarm_hangar_occupied", "Occupied hangar spots (drones inside plus reservations).", seq ? st->occupied : 0);
+    gauge("swarm_hangar_pending_removal", "Spots to dismantle once drones leave.", seq ? st->pending_removal : 0);
+    gauge("swarm_drones_target", "Target population N.", seq ? st->target_N : 0);
+    gauge("swarm_drones_active", "Live drones registered by the operator.", seq ? st->current_active : 0);
+    family("swarm_queue_depth", "gauge", "Drones waiting in the operator queues.");
+    for (int q = 0; q < 2; q++)
+        emit("swarm_queue_depth{queue=\"%s\"} %d\n", q ? "takeoff" : "land",
+             seq ? (st->q_tail[q] - st->q_head[q] + WAITQ_CAP) % WAITQ_CAP : 0);
+    family("swarm_channel_users", "gauge", "Drones currently inside each tunnel.");
+    for (int c = 0; c < CHANNELS; c++) emit("swarm_channel_users{channel=\"%d\"} %d\n", c, seq ? st->chan_users[c] : 0);
+    family("swarm_channel_direction", "gauge", "Tunnel direction: 0 idle, 1 in (landing), 2 out (takeoff).");
+    for (int c = 0; c < CHANNELS; c++) emit("swarm_channel_direction{channel=\"%d\"} %d\n", c, seq ? st->chan_dir[c] : DIR_NONE);
+
+    histogram("swarm_land_wait_seconds", "Time from landing request to landing grant.", os->land_wait_hist,
+              0.001, os->land_wait_sum);
+    histogram("swarm_grant_latency_seconds", "Time from receiving a batch to sending its grants.", os->glat_hist,
+              0.000001, (os->glat_sum[0] + os->glat_sum[1]) / 1000.0);
+    emit("# EOF\n");
+}
+
+// --- HTTP (jedno zapytanie na połączenie) ---
+
+static void send_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return; // Klient zniknął
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+static void serve(int fd) {
+    // Wolny klient nie może zatrzymać eksportera na dłużej niż sekundę
+    struct timeval tv = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    char req[2048];
+    size_t len = 0;
+    while (len < sizeof(req) - 1) {
+        ssize_t n = read(fd, req + len, sizeof(req) - 1 - len);
+        if (n <= 0) break;
+        len += (size_t)n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+    }
+    req[len] = '\0';
+
+    char head[256];
+    if (strncmp(req, "GET /metrics ", 13) == 0 || strncmp(req, "GET / ", 6) == 0) {
+        build_metrics();
+        int h = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: " EXP_CONTENT_TYPE "\r\n"
+                         "Content-Length: %zu\r\nConnection: close\r\n\r\n", blen);
+        send_all(fd, head, (size_t)h);
+        send_all(fd, body, blen);
+    } else {
+        const char *nf = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n"
+                         "Connection: close\r\n\r\nnot found\n";
+        send_all(fd, nf, strlen(nf));
+    }
+}
+
+static int listen_on(const char *where, int *is_unix) {
+    char *end;
+    long port = strtol(where, &end, 10);
+    int fd;
+    *is_unix = *end != '\0';
+    if (!*is_unix) {
+        if (port <= 0 || port > 65535) { fprintf(stderr, "Error: invalid port '%s'.\n", where); return -1; }
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) { perror("[swarmexp] socket"); return -1; }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Tylko lokalnie - bez uwierzytelniania
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) { perror("[swarmexp] bind"); close(fd); return -1; }
+    } else {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(where) >= sizeof(addr.sun_path)) { fprintf(stderr, "Error: socket path too long.\n"); return -1; }
+        strcpy(addr.sun_path, where);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) { perror("[swarmexp] socket"); return -1; }
+        unlink(where);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) { perror("[swarmexp] bind"); close(fd); return -1; }
+    }
+    if (listen(fd, 16) == -1) { perror("[swarmexp] listen"); close(fd); return -1; }
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    const char *where = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:R:K:")) != -1) {
+        switch (opt) {
+            case 'l': where = optarg; break;
+            case 'R':
+                if (ipc_keys_from_dir(optarg) == -1) return 1;
+                break;
+            case 'K': {
+                long base = strtol(optarg, NULL, 0);
+                if (base <= 0 || base > INT_MAX - 2) { fprintf(stderr, "Error: invalid key_base.\n"); return 1; }
+                ipc_keys_set((key_t)base, (key_t)(base + 1), (key_t)(base + 2));
+                break;
+            }
+            default:
+                fprintf(stderr, "Usage: %s [-l port|socket_path] [-R run_dir] [-K key_base]\n", argv[0]);
+                return 1;
+        }
+    }
+    char port[16];
+    if (!where) {
+        snprintf(port, sizeof(port), "%d", EXP_PORT);
+        where = port;
+    }
+
+    int is_unix;
+    int lfd = listen_on(where, &is_unix);
+    if (lfd == -1) return 1;
+
+    // Bez SA_RESTART: Ctrl+C przerywa accept
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigint_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (is_unix) printf("[swarmexp] Serving OpenMetrics on unix:%s (GET /metrics)\n", where);
+    else printf("[swarmexp] Serving OpenMetrics on http://127.0.0.1:%s/metrics\n", where);
+    fflush(stdout);
+    while (keep_running) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("[swarmexp] accept");
+            break;
+        }
+        serve(fd);
+        close(fd);
+    }
+
+    close(lfd);
+    if (is_unix) unlink(where);
+    if (sh) shmdt(sh);
+    return 0;
+}
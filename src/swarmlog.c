@@ -0,0 +1,225 @@
+/* src/swarmlog.c
+ *
+ * Przeglądarka wspólnego magazynu logów dronów (swarm_log.bin).
+ *   swarmlog <id> [generacja] - historia jednego drona (przejście po indeksie, bez skanowania)
+ *   swarmlog -s/-u ...        - bez ID: rekordy wszystkich dronów z przedziału czasu, chronologicznie
+ *   swarmlog -l               - podsumowanie indeksu (wcielenia, segmenty, bajty)
+ *   -f <plik>                 - inny plik magazynu
+ *   -s <czas> / -u <czas>     - tylko rekordy od / do chwili: sekundy Unix albo HH:MM[:SS] (czas
+ *                               lokalny, dzień pierwszego segmentu magazynu). Segmenty spoza
+ *                               przedziału są pomijane po t_start_ns z indeksu, bez czytania danych.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "../include/common.h"
+#include "../include/log_store.h"
+
+#define T_MIN INT64_MIN
+#define T_MAX INT64_MAX
+
+static int64_t t_since = T_MIN, t_until = T_MAX; // Przedział czasu rekordów (-s / -u, ns CLOCK_REALTIME)
+
+static void print_record(const struct LogSegment *s, const struct LogRecord *r, const char *text) {
+    time_t sec = (time_t)(r->ts_ns / 1000000000LL);
+    struct tm tmv;
+    localtime_r(&sec, &tmv);
+    char timebuf[32];
+    strftime(timebuf, sizeof(timebuf), "%H:%M:%S", &tmv);
+    printf("[%s.%03d] gen=%u pid=%d %.*s", timebuf, (int)((r->ts_ns / 1000000) % 1000),
+           s->generation, s->pid, (int)r->len, text);
+}
+
+// Segment może mieć rekordy z przedziału: zaczyna się nie później niż 'until', a następny segment
+// łańcucha (przydzielony po zapełnieniu tego) nie zaczyna się przed 'since'
+static int seg_overlaps(const struct LogStoreHeader *h, int seg) {
+    const struct LogSegment *s = &h->index[seg];
+    if (s->t_start_ns > t_until) return 0;
+    return s->next == -1 || h->index[s->next].t_start_ns >= t_since;
+}
+
+// Wypisanie rekordów jednego wcielenia z przedziału czasu (łańcuch segmentów od 'first')
+static void print_chain(const struct LogStoreHeader *h, int first) {
+    for (int seg = first; seg != -1; seg = h->index[seg].next) {
+        const struct LogSegment *s = &h->index[seg];
+        if (s->t_start_ns > t_until) break; // Dalsze segmenty łańcucha są jeszcze późniejsze
+        if (!seg_overlaps(h, seg)) continue;
+        uint32_t used = __atomic_load_n(&s->used, __ATOMIC_ACQUIRE);
+        const char *data = ls_segment_data(h, seg);
+        uint32_t off = 0;
+        while (off + sizeof(struct LogRecord) <= used) {
+            struct LogRecord r;
+            memcpy(&r, data + off, sizeof(r));
+            if (r.ts_ns >= t_since && r.ts_ns <= t_until) print_record(s, &r, data + off + sizeof(r));
+            off += (sizeof(r) + r.len + 7) & ~7u;
+        }
+    }
+}
+
+// Rekord do scalenia wielu łańcuchów (tryb bez ID)
+struct RecRef {
+    int64_t ts_ns;
+    int seg;
+    uint32_t off;
+};
+
+static int cmp_rec(const void *a, const void *b) {
+    const struct RecRef *x = a, *y = b;
+    if (x->ts_ns != y->ts_ns) return x->ts_ns < y->ts_ns ? -1 : 1;
+    return x->seg != y->seg ? (x->seg < y->seg ? -1 : 1) : (x->off < y->off ? -1 : x->off > y->off);
+}
+
+// Rekordy wszystkich dronów z przedziału: segmenty wybrane z indeksu, potem sortowanie po czasie
+static int print_range(const struct LogStoreHeader *h) {
+    uint32_t used_segs = h->next_segment < h->max_segments ? h->next_segment : h->max_segments;
+    struct RecRef *refs = NULL;
+    size_t n = 0, cap = 0;
+    int segs = 0;
+    for (uint32_t seg = 0; seg < used_segs; seg++) {
+        if (__atomic_load_n(&h->index[seg].drone_id, __ATOMIC_ACQUIRE) < 0 || !seg_overlaps(h, (int)seg)) continue;
+        segs++;
+        uint32_t used = __atomic_load_n(&h->index[seg].used, __ATOMIC_ACQUIRE);
+        const char *data = ls_segment_data(h, (int)seg);
+        uint32_t off = 0;
+        while (off + sizeof(struct LogRecord) <= used) {
+            struct LogRecord r;
+            memcpy(&r, data + off, sizeof(r));
+            if (r.ts_ns >= t_since && r.ts_ns <= t_until) {
+                if (n == cap) {
+                    cap = cap ? cap * 2 : 4096;
+                    struct RecRef *p = realloc(refs, cap * sizeof(*p));
+                    if (!p) { perror("realloc"); free(refs); return 1; }
+                    refs = p;
+                }
+                refs[n++] = (struct RecRef){r.ts_ns, (int)seg, off};
+            }
+            off += (sizeof(r) + r.len + 7) & ~7u;
+        }
+    }
+    qsort(refs, n, sizeof(*refs), cmp_rec);
+    for (size_t i = 0; i < n; i++) {
+        const char *data = ls_segment_data(h, refs[i].seg) + refs[i].off;
+        struct LogRecord r;
+        memcpy(&r, data, sizeof(r));
+        printf("[drone %d] ", h->index[refs[i].seg].drone_id);
+        print_record(&h->index[refs[i].seg], &r, data + sizeof(r));
+    }
+    if (n == 0) printf("No records in the time range (%d segments read of %u).\n", segs, used_segs);
+    free(refs);
+    return 0;
+}
+
+// Czas z -s / -u: sekundy Unix (ułamek dozwolony) albo HH:MM[:SS] w dniu 'day_ns' (czas lokalny).
+// -1 = niepoprawny zapis.
+static int parse_when(const char *arg, int64_t day_ns, int64_t *out) {
+    int hh, mm, ss = 0, used = 0;
+    if ((sscanf(arg, "%d:%d:%d%n", &hh, &mm, &ss, &used) == 3 || sscanf(arg, "%d:%d%n", &hh, &mm, &used) == 2) &&
+        arg[used] == '\0') {
+        if (hh < 0 || hh > 23 || mm < 0 || mm > 59 || ss < 0 || ss > 60) return -1;
+        time_t day = (time_t)(day_ns / 1000000000LL);
+        struct tm tmv;
+        localtime_r(&day, &tmv);
+        tmv.tm_hour = hh;
+        tmv.tm_min = mm;
+        tmv.tm_sec = ss;
+        tmv.tm_isdst = -1;
+        time_t t = mktime(&tmv);
+        if (t == (time_t)-1) return -1;
+        *out = (int64_t)t * 1000000000LL;
+        return 0;
+    }
+    char *end;
+    double v = strtod(arg, &end);
+    if (end == arg || *end != '\0' || !(v >= 0.0 && v < 9.2e9)) return -1;
+    *out = (int64_t)(v * 1e9);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = LOG_STORE_FILE;
+    const char *since = NULL, *until = NULL;
+    int list = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:ls:u:")) != -1) {
+        switch (opt) {
+            case 'f': path = optarg; break;
+            case 'l': list = 1; break;
+            case 's': since = optarg; break;
+            case 'u': until = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-f file] [-s since] [-u until] (-l | <drone_id> [generation])\n", argv[0]);
+                return 1;
+        }
+    }
+    if (!list && optind >= argc && !since && !until) {
+        fprintf(stderr, "Usage: %s [-f file] [-s since] [-u until] (-l | <drone_id> [generation])\n", argv[0]);
+        return 1;
+    }
+
+    size_t map_len = 0;
+    struct LogStoreHeader *h = ls_map_readonly(path, &map_len);
+    if (!h) return 1;
+
+    // HH:MM[:SS] liczymy od dnia pierwszego segmentu (przebieg), bez segmentów - od dziś
+    int64_t day_ns = h->next_segment > 0 ? h->index[0].t_start_ns : (int64_t)time(NULL) * 1000000000LL;
+    const char *bad = NULL;
+    if (since && parse_when(since, day_ns, &t_since) == -1) bad = since;
+    else if (until && parse_when(until, day_ns, &t_until) == -1) bad = until;
+    if (bad) {
+        fprintf(stderr, C_RED "Error: Invalid time '%s' (Unix seconds or HH:MM[:SS]).\n" C_RESET, bad);
+        munmap(h, map_len);
+        return 1;
+    }
+    if (!list && optind >= argc) {
+        int rc = print_range(h);
+        munmap(h, map_len);
+        return rc;
+    }
+
+    if (list) {
+        uint32_t used_segs = h->next_segment < h->max_segments ? h->next_segment : h->max_segments;
+        printf("segments used: %u/%u, dropped records: %u\n", used_segs, h->max_segments, h->dropped);
+        printf("%-6s %-12s %-10s %-10s\n", "id", "generations", "segments", "bytes");
+        for (int id = 0; id < MAX_DRONE_ID; id++) {
+            if (h->generation[id] == 0) continue;
+            int segs = 0;
+            unsigned long bytes = 0;
+            for (int head = h->last_head[id]; head != -1; head = h->index[head].prev_gen) {
+                for (int seg = head; seg != -1; seg = h->index[seg].next) {
+                    segs++;
+                    bytes += h->index[seg].used;
+                }
+            }
+            printf("%-6d %-12u %-10d %-10lu\n", id, h->generation[id], segs, bytes);
+        }
+        munmap(h, map_len);
+        return 0;
+    }
+
+    char *end;
+    long id = strtol(argv[optind], &end, 10); // parse_int odrzuca 0, a ID 0 jest poprawne
+    if (*end != '\0' || id < 0 || id >= MAX_DRONE_ID) {
+        fprintf(stderr, C_RED "Error: Invalid drone_id '%s'.\n" C_RESET, argv[optind]);
+        munmap(h, map_len);
+        return 1;
+    }
+    long want_gen = (optind + 1 < argc) ? atol(argv[optind + 1]) : -1;
+
+    // Lista generacji jest od najnowszej - zbieramy głowy i wypisujemy chronologicznie
+    int heads[4096]; // Limit wcieleń wypisywanych naraz
+    int n = 0;
+    for (int head = h->last_head[id]; head != -1 && n < (int)(sizeof(heads) / sizeof(heads[0]));
+         head = h->index[head].prev_gen) {
+        if (want_gen == -1 || h->index[head].generation == (uint32_t)want_gen) heads[n++] = head;
+    }
+    if (n == 0) printf("No records for drone %ld.\n", id);
+    for (int i = n - 1; i >= 0; i--) print_chain(h, heads[i]);
+
+    munmap(h, map_len);
+    return 0;
+}
@@ -0,0 +1,373 @@
+/* src/sweep.c
+ *
+ * Przegląd parametrów: wiele niezależnych rojów równolegle, jeden wiersz wyników na przebieg.
+ *   sweep -P 2,4,8 -N 20,40 [-C 10,20] [-r powtórzenia] [-t sekundy] [-j zadania] [-S ziarno]
+ *         [-d katalog] [-o wyniki.csv] [-- dodatkowe argumenty Commandera]
+ * Każdy przebieg = ./commander P N -R katalog -K klucz -s scenariusz -C czas w swoim katalogu
+ * (logi, raport, ślad) i z własnymi kluczami IPC, więc przebiegi nie widzą się nawzajem.
+ * Listy: "2,4,8" albo zakresy "2-8" (krok 1) i "2-16x2" (mnożnik).
+ * Sprzątanie po awarii: sweep jest "subreaperem" - sieroty roju (Operator, drony) trafiają do niego.
+ * Po końcu Commandera zabijana jest grupa roju zapisana w pamięci dzielonej przebiegu, a kolejka,
+ * semafory i pamięć o kluczach przebiegu są usuwane - także gdy Commander zginął od SIGKILL.
+ */
+
+// MUSI BYĆ PIERWSZE! (prctl, PR_SET_CHILD_SUBREAPER)
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/shm.h>
+#include <sys/prctl.h>
+
+#include "../include/common.h"
+#include "../include/ipc_wrapper.h"
+
+#define MAX_LIST    64
+#define MAX_RUNS    4096
+#define MAX_FIELDS  64
+#define KEY_SPACE   0x40000000 // Klucze przebiegów: KEY_SPACE + (PID sweepa << 16) + 4 * nr przebiegu
+#define GRACE_S     30.0       // Zapas ponad czas scenariusza na start i zamykanie roju
+#define KILL_AFTER_S 15.0      // Po SIGINT tyle czekamy na uporządkowane zamknięcie, potem SIGKILL
+
+// Stan przebiegu
+#define RUN_PENDING 0
+#define RUN_ACTIVE  1
+#define RUN_DONE    2
+
+struct Run {
+    int P, N, C, rep;
+    char dir[PATH_MAX + 64];
+    key_t key;
+    pid_t pid;          // Commander
+    int state;
+    int status;         // Status z waitpid
+    int timed_out;
+    double t_start, t_int; // Start i moment wysłania SIGINT (0 = nie wysłano)
+    int leaked;         // Obiekty IPC usunięte przez sweep (Commander nie posprzątał)
+    int nf;             // Pola liczbowe z report.json
+    char *field[MAX_FIELDS];
+    double value[MAX_FIELDS];
+};
+
+static struct Run *runs = NULL;
+static int n_runs = 0;
+static volatile sig_atomic_t stop_requested = 0;
+
+void sigint_handler(int sig) { (void)sig; stop_requested = 1; }
+
+// Lista wartości: "a,b,c", zakres "a-b" lub zakres geometryczny "a-bxk". Zwraca liczbę elementów lub -1.
+int parse_list(const char *s, int *out, const char *name) {
+    int n = 0;
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", s);
+    for (char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ",")) {
+        char *end;
+        long a = strtol(tok, &end, 10), b = a, mul = 0;
+        if (*end == '-') b = strtol(end + 1, &end, 10);
+        if (*end == 'x') mul = strtol(end + 1, &end, 10);
+        if (*end != '\0' || a <= 0 || b < a || (mul != 0 && mul < 2)) {
+            fprintf(stderr, C_RED "Error: invalid %s list element '%s'.\n" C_RESET, name, tok);
+            return -1;
+        }
+        for (long v = a; v <= b; v = mul ? v * mul : v + 1) {
+            if (n == MAX_LIST) { fprintf(stderr, C_RED "Error: %s list longer than %d.\n" C_RESET, name, MAX_LIST); return -1; }
+            out[n++] = (int)v;
+        }
+    }
+    return n;
+}
+
+// Pola liczbowe najwyższego poziomu z report.json (tablice i obiekty zagnieżdżone są pomijane)
+void read_report(struct Run *r) {
+    char path[PATH_MAX + 96];
+    snprintf(path, sizeof(path), "%s/report.json", r->dir);
+    FILE *f = fopen(path, "r");
+    if (!f) return;
+    static char text[1 << 16];
+    size_t len = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    text[len] = '\0';
+
+    int depth = 0;
+    for (char *p = text; *p && r->nf < MAX_FIELDS; p++) {
+        if (*p == '{' || *p == '[') { depth++; continue; }
+        if (*p == '}' || *p == ']') { depth--; continue; }
+        if (*p != '"' || depth != 1) continue;
+        char *name = p + 1, *q = strchr(name, '"');
+        if (!q) break;
+        char *v = q + 1;
+        while (*v == ' ' || *v == ':') v++;
+        char *end;
+        double val = strtod(v, &end);
+        if (end != v) {
+            r->field[r->nf] = strndup(name, q - name);
+            r->value[r->nf++] = val;
+            p = end - 1;
+        } else {
+            p = q; // Wartość nieliczbowa - dalej skanujemy od końca nazwy
+        }
+    }
+}
+
+// Grupa roju przebiegu (z pamięci dzielonej, jeśli jeszcze istnieje)
+pid_t run_swarm_pgid(key_t key) {
+    int id = shmget(key + IPC_KEY_SHM, 0, 0);
+    if (id == -1) return -1;
+    struct SharedState *sh = shmat(id, NULL, SHM_RDONLY);
+    if (sh == (void *)-1) return -1;
+    pid_t pg = sh->swarm_pgid;
+    shmdt(sh);
+    return pg;
+}
+
+// Sprzątanie po końcu Commandera: resztki roju i obiekty IPC przebiegu
+void cleanup_run(struct Run *r) {
+    pid_t pg = run_swarm_pgid(r->key);
+    if (pg > 0 && kill(-pg, SIGKILL) == 0)
+        fprintf(stderr, C_YELLOW "[sweep] %s: killed leftover swarm group %d." C_RESET "\n", r->dir, (int)pg);
+    ipc_keys_set(r->key + IPC_KEY_MSGQ, r->key + IPC_KEY_SEM, r->key + IPC_KEY_SHM);
+    r->leaked = ipc_remove_all();
+    unsetenv(SWARM_KEYS_ENV); // Commander dostaje klucze przez -K, nie przez otoczenie sweepa
+    if (r->leaked > 0)
+        fprintf(stderr, C_YELLOW "[sweep] %s: removed %d leftover IPC objects." C_RESET "\n", r->dir, r->leaked);
+}
+
+pid_t launch_run(struct Run *r, unsigned int seed, double wait_s, char **extra, int n_extra) {
+    if (mkdir(r->dir, 0755) == -1 && errno != EEXIST) { perror("[sweep] mkdir"); return -1; }
+    char scen[PATH_MAX + 96];
+    snprintf(scen, sizeof(scen), "%s/scenario.txt", r->dir);
+    FILE *f = fopen(scen, "w");
+    if (!f) { perror("[sweep] fopen scenario"); return -1; }
+    fprintf(f, "# sweep: P=%d N=%d C=%d rep=%d\nseed %u\nwait %g\n", r->P, r->N, r->C, r->rep, seed, wait_s);
+    fclose(f);
+
+    pid_t pid = fork();
+    if (pid == -1) { perror("[sweep] fork"); return -1; }
+    if (pid == 0) {
+        setpgid(0, 0); // Ctrl+C w terminalu trafia tylko do sweepa - on decyduje o zamykaniu
+        char con[PATH_MAX + 96];
+        snprintf(con, sizeof(con), "%s/console.txt", r->dir);
+        int in = open("/dev/null", O_RDONLY);
+        int out = open(con, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (in != -1) dup2(in, STDIN_FILENO);
+        if (out != -1) { dup2(out, STDOUT_FILENO); dup2(out, STDERR_FILENO); }
+
+        char sP[16], sN[16], sC[16], sK[16], path[PATH_MAX];
+        snprintf(sP, sizeof(sP), "%d", r->P);
+        snprintf(sN, sizeof(sN), "%d", r->N);
+        snprintf(sC, sizeof(sC), "%d", r->C);
+        snprintf(sK, sizeof(sK), "%d", (int)r->key);
+        char *argv[32 + MAX_LIST];
+        int a = 0;
+        argv[a++] = "commander"; argv[a++] = sP; argv[a++] = sN;
+        // Commander startuje już w katalogu przebiegu (scenariusz jest wczytywany przed chdir)
+        argv[a++] = "-R"; argv[a++] = "."; argv[a++] = "-K"; argv[a++] = sK;
+        argv[a++] = "-s"; argv[a++] = "scenario.txt";
+        if (r->C > 0) { argv[a++] = "-C"; argv[a++] = sC; }
+        for (int i = 0; i < n_extra && a < (int)(sizeof(argv) / sizeof(argv[0])) - 1; i++) argv[a++] = extra[i];
+        argv[a] = NULL;
+        if (chdir(r->dir) == -1) { perror("[sweep] chdir"); _exit(1); }
+        execv(swarm_bin("commander", path, sizeof(path)), argv);
+        perror("[sweep] execv commander");
+        _exit(127);
+    }
+    setpgid(pid, pid);
+    r->pid = pid;
+    r->state = RUN_ACTIVE;
+    r->t_start = mono_time();
+    return pid;
+}
+
+const char *run_status(const struct Run *r) {
+    if (r->state != RUN_DONE) return "skipped";
+    if (r->timed_out) return "timeout";
+    if (WIFSIGNALED(r->status)) return "crashed";
+    if (WIFEXITED(r->status) && WEXITSTATUS(r->status) == 0) return r->nf > 0 ? "ok" : "no_report";
+    return "failed";
+}
+
+// P i N z raportu powtarzałyby kolumny siatki
+int fixed_column(const char *name) { return strcmp(name, "P") == 0 || strcmp(name, "N") == 0; }
+
+void write_table(const char *path) {
+    // Kolumny = pola pierwszego raportu (kolejne raporty mają ten sam układ)
+    const struct Run *ref = NULL;
+    for (int i = 0; i < n_runs && !ref; i++) if (runs[i].nf > 0) ref = &runs[i];
+
+    FILE *f = fopen(path, "w");
+    if (!f) { perror("[sweep] fopen table"); return; }
+    fprintf(f, "run,dir,P,N,C,rep,status,exit,leaked_ipc");
+    if (ref) for (int k = 0; k < ref->nf; k++) if (!fixed_column(ref->field[k])) fprintf(f, ",%s", ref->field[k]);
+    fprintf(f, "\n");
+    for (int i = 0; i < n_runs; i++) {
+        const struct Run *r = &runs[i];
+        int code = WIFEXITED(r->status) ? WEXITSTATUS(r->status) : WIFSIGNALED(r->status) ? -WTERMSIG(r->status) : 0;
+        fprintf(f, "%d,%s,%d,%d,%d,%d,%s,%d,%d", i, r->dir, r->P, r->N, r->C, r->rep, run_status(r), code, r->leaked);
+        if (ref) {
+            for (int k = 0; k < ref->nf; k++) {
+                if (fixed_column(ref->field[k])) continue;
+                int j = 0;
+                while (j < r->nf && strcmp(r->field[j], ref->field[k]) != 0) j++;
+                if (j < r->nf) fprintf(f, ",%.6g", r->value[j]);
+                else fprintf(f, ",");
+            }
+        }
+        fprintf(f, "\n");
+    }
+    fclose(f);
+}
+
+double run_field(const struct Run *r, const char *name) {
+    for (int k = 0; k < r->nf; k++) if (strcmp(r->field[k], name) == 0) return r->value[k];
+    return 0.0;
+}
+
+void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s -P list -N list [-C list] [-r repeats] [-t seconds] [-j jobs] [-S seed] "
+                    "[-d out_dir] [-o table.csv] [-- commander args]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int Ps[MAX_LIST], Ns[MAX_LIST], Cs[MAX_LIST] = {0};
+    int nP = 0, nN = 0, nC = 1;
+    int repeats = 1, jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double wait_s = 60.0;
+    unsigned int seed = 1;
+    const char *out_dir = "sweep_out";
+    const char *table_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "P:N:C:r:t:j:S:d:o:")) != -1) {
+        switch (opt) {
+            case 'P': if ((nP = parse_list(optarg, Ps, "P")) <= 0) return 1; break;
+            case 'N': if ((nN = parse_list(optarg, Ns, "N")) <= 0) return 1; break;
+            case 'C': if ((nC = parse_list(optarg, Cs, "C")) <= 0) return 1; break;
+            case 'r': if ((repeats = parse_int(optarg, "repeats")) <= 0) return 1; break;
+            case 'j': if ((jobs = parse_int(optarg, "jobs")) <= 0) return 1; break;
+            case 'S': seed = (unsigned int)strtoul(optarg, NULL, 10); if (seed == 0) seed = 1; break;
+            case 't':
+                wait_s = strtod(optarg, NULL);
+                if (wait_s <= 0) { fprintf(stderr, "Error: seconds must be positive.\n"); return 1; }
+                break;
+            case 'd': out_dir = optarg; break;
+            case 'o': table_path = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (nP == 0 || nN == 0) { usage(argv[0]); return 1; }
+    if (jobs < 1) jobs = 1;
+    char **extra = argv + optind; // Wszystko po "--" trafia bez zmian do każdego Commandera
+    int n_extra = argc - optind;
+    if (n_extra > MAX_LIST) n_extra = MAX_LIST;
+
+    // Programy roju leżą obok sweepa (przebiegi pracują w swoich katalogach)
+    char exe[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (!getenv(SWARM_BIN_ENV) && len > 0) {
+        exe[len] = '\0';
+        char *slash = strrchr(exe, '/');
+        if (slash) *slash = '\0';
+        setenv(SWARM_BIN_ENV, exe, 1);
+    }
+    unsetenv(SWARM_KEYS_ENV);
+
+    if (mkdir(out_dir, 0755) == -1 && errno != EEXIST) { perror("[sweep] mkdir out_dir"); return 1; }
+    char out_abs[PATH_MAX];
+    if (!realpath(out_dir, out_abs)) { perror("[sweep] realpath"); return 1; }
+    static char table_buf[PATH_MAX + 16];
+    if (!table_path) { snprintf(table_buf, sizeof(table_buf), "%s/results.csv", out_abs); table_path = table_buf; }
+
+    // Siatka parametrów (kombinacje łamiące P < N/2 są pomijane z ostrzeżeniem)
+    runs = calloc(MAX_RUNS, sizeof(struct Run));
+    if (!runs) { perror("[sweep] calloc"); return 1; }
+    for (int a = 0; a < nP; a++)
+        for (int b = 0; b < nN; b++)
+            for (int c = 0; c < nC; c++)
+                for (int k = 0; k < repeats; k++) {
+                    if (2 * Ps[a] >= Ns[b] || Ns[b] > MAX_DRONE_ID) {
+                        if (k == 0 && c == 0) fprintf(stderr, C_YELLOW "[sweep] Skipping P=%d N=%d (needs P < N/2, N <= %d).\n" C_RESET, Ps[a], Ns[b], MAX_DRONE_ID);
+                        continue;
+                    }
+                    if (n_runs == MAX_RUNS) { fprintf(stderr, C_RED "Error: more than %d runs.\n" C_RESET, MAX_RUNS); return 1; }
+                    struct Run *r = &runs[n_runs];
+                    r->P = Ps[a]; r->N = Ns[b]; r->C = Cs[c]; r->rep = k;
+                    snprintf(r->dir, sizeof(r->dir), "%s/run_%03d_P%d_N%d_C%d_r%d", out_abs, n_runs, r->P, r->N, r->C, k);
+                    r->key = (key_t)(KEY_SPACE + ((getpid() & 0x3fff) << 16) + 4 * n_runs);
+                    n_runs++;
+                }
+    if (n_runs == 0) { fprintf(stderr, "Error: empty parameter grid.\n"); return 1; }
+
+    // Sieroty roju (Commander zginął) zostają pod nami - do zebrania i zabicia
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) == -1) perror("[sweep] prctl(PR_SET_CHILD_SUBREAPER)");
+    signal(SIGINT, sigint_handler);
+    signal(SIGTERM, sigint_handler);
+
+    fprintf(stderr, C_BLUE "[sweep] %d runs, %d in parallel, %.0fs each -> %s" C_RESET "\n", n_runs, jobs, wait_s, out_abs);
+    double t0 = mono_time();
+    int next = 0, active = 0, done = 0;
+    while (done < n_runs) {
+        // Uruchamianie kolejnych przebiegów do limitu równoległości
+        while (!stop_requested && active < jobs && next < n_runs) {
+            struct Run *r = &runs[next++];
+            if (launch_run(r, seed + (unsigned int)r->rep, wait_s, extra, n_extra) == -1) {
+                r->state = RUN_DONE; r->status = 1 << 8; done++;
+                continue;
+            }
+            active++;
+        }
+        if (stop_requested && next < n_runs) { done += n_runs - next; next = n_runs; } // Reszta: "skipped"
+        if (done >= n_runs) break;
+
+        // Zakończone procesy: Commandery przebiegów i osierocone procesy roju
+        int st;
+        pid_t pid;
+        while ((pid = waitpid(-1, &st, WNOHANG)) > 0) {
+            for (int i = 0; i < n_runs; i++) {
+                struct Run *r = &runs[i];
+                if (r->state != RUN_ACTIVE || r->pid != pid) continue;
+                r->state = RUN_DONE;
+                r->status = st;
+                cleanup_run(r);
+                read_report(r);
+                active--; done++;
+                fprintf(stderr, "[sweep] %3d/%d P=%-3d N=%-4d C=%-3d rep=%d %-9s landings=%-5.0f deaths=%-4.0f wait=%.2fs (%.0fs)\n",
+                        done, n_runs, r->P, r->N, r->C, r->rep, run_status(r), run_field(r, "landings"),
+                        run_field(r, "deaths"), run_field(r, "land_wait_avg_s"), mono_time() - r->t_start);
+                break;
+            }
+        }
+
+        // Limit czasu: SIGINT (uporządkowane zamknięcie z raportem), potem SIGKILL
+        double now = mono_time();
+        for (int i = 0; i < n_runs; i++) {
+            struct Run *r = &runs[i];
+            if (r->state != RUN_ACTIVE) continue;
+            if (r->t_int == 0 && (stop_requested || now - r->t_start > wait_s + GRACE_S)) {
+                if (!stop_requested) r->timed_out = 1;
+                r->t_int = now;
+                kill(r->pid, SIGINT);
+            } else if (r->t_int > 0 && now - r->t_int > KILL_AFTER_S) {
+                kill(r->pid, SIGKILL);
+            }
+        }
+        struct timespec ts = {0, 100 * 1000000L};
+        nanosleep(&ts, NULL);
+    }
+    while (waitpid(-1, NULL, WNOHANG) > 0); // Ostatnie sieroty
+
+    write_table(table_path);
+    int ok = 0;
+    for (int i = 0; i < n_runs; i++) if (strcmp(run_status(&runs[i]), "ok") == 0) ok++;
+    fprintf(stderr, C_GREEN "[sweep] %d/%d runs ok in %.0fs. Table: %s" C_RESET "\n", ok, n_runs, mono_time() - t0, table_path);
+    for (int i = 0; i < n_runs; i++) for (int k = 0; k < runs[i].nf; k++) free(runs[i].field[k]);
+    free(runs);
+    return ok == n_runs ? 0 : 2;
+}
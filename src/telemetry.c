@@ -0,0 +1,78 @@
+/* src/telemetry.c
+ *
+ * Sloty telemetrii dronów w pamięci dzielonej: zapis przez seqlock, odczyt bez blokad.
+ * Pola slotu są zapisywane zwykłymi przypisaniami między dwiema barierami - czytelnik
+ * może trafić na stan pośredni, ale wtedy licznik seq się nie zgadza i kopia jest ponawiana.
+ */
+
+#include <string.h>
+
+#include "../include/common.h"
+#include "../include/telemetry.h"
+
+const char *const tm_phase_names[TM_PHASES] = {
+    "empty", "flying", "queued", "cross_in", "charging", "wait_takeoff", "cross_out", "dead", "parked"
+};
+
+void tm_attach(struct TelemetrySlot *s, pid_t pid, int max_cycles) {
+    uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+    if (seq & 1) seq++; // Poprzednie wcielenie zginęło w trakcie zapisu (SIGKILL)
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->pid = pid;
+    s->max_cycles = (int16_t)max_cycles;
+    s->generation++;
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void tm_publish(struct TelemetrySlot *s, float battery, int location, int phase,
+                int kamikaze_pending, int cycles_flown, double now) {
+    uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE); // Nieparzysty seq widoczny przed polami
+    s->battery = battery;
+    s->location = (int8_t)location;
+    s->phase = (int8_t)phase;
+    s->kamikaze_pending = (int8_t)kamikaze_pending;
+    s->cycles_flown = (int16_t)cycles_flown;
+    s->t_update = now;
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE); // Pola widoczne przed parzystym seq
+}
+
+int tm_read(const struct TelemetrySlot *s, struct TelemetryView *v) {
+    for (int tries = 0; tries < TM_READ_TRIES; tries++) {
+        uint32_t s1 = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1) continue;
+        v->pid = s->pid;
+        v->battery = s->battery;
+        v->location = s->location;
+        v->phase = s->phase;
+        v->kamikaze_pending = s->kamikaze_pending;
+        v->cycles_flown = s->cycles_flown;
+        v->max_cycles = s->max_cycles;
+        v->generation = s->generation;
+        v->t_update = s->t_update;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE); // Kopia pól zakończona przed ponownym odczytem seq
+        if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == s1) return 0;
+    }
+    return -1;
+}
+
+void tm_fleet(const struct TelemetrySlot *slots, int n, double now, struct FleetSummary *fs) {
+    memset(fs, 0, sizeof(*fs));
+    double bat_sum = 0;
+    for (int i = 0; i < n; i++) {
+        struct TelemetryView v;
+        if (tm_read(&slots[i], &v) == -1) { fs->torn++; continue; }
+        if (v.phase <= TM_EMPTY || v.phase >= TM_PHASES) continue;
+        fs->by_phase[v.phase]++;
+        if (v.phase == TM_DEAD) continue;
+        if (fs->alive == 0 || v.battery < fs->battery_min) fs->battery_min = v.battery;
+        fs->alive++;
+        bat_sum += v.battery;
+        fs->inside += v.location == ST_INSIDE;
+        fs->kamikaze += v.kamikaze_pending;
+        if (now - v.t_update > fs->oldest_update_s) fs->oldest_update_s = now - v.t_update;
+    }
+    if (fs->alive > 0) fs->battery_avg = (float)(bat_sum / fs->alive);
+}
@@ -0,0 +1,135 @@
+/* src/trace.c
+ *
+ * Śledzenie spanów w buforach cyklicznych per proces (plik mapowany w pamięci).
+ * Przydział bufora to jedno fetch_add na nagłówku, zapis zdarzenia - fetch_add na
+ * liczniku bufora. Plik przeżywa procesy, więc ślad można zrzucić po przebiegu (tracedump).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/trace.h"
+
+int trace_on = 0;
+
+const char *const trace_names[TR_NAMES] = {
+    "msg_recv", "sched_pass", "grant_send", "crossing", "charging",
+    "log_flush", "wait_grant", "sup_poll", "scenario_step"
+};
+
+static struct TraceRing *ring = NULL; // Bufor bieżącego procesu
+static size_t ring_len = 0;
+
+static uint64_t page_round(uint64_t sz) {
+    long page = sysconf(_SC_PAGESIZE);
+    return (sz + page - 1) / page * page;
+}
+
+int trace_create(const char *path) {
+    if (unlink(path) == -1 && errno != ENOENT) perror("[Trace] unlink");
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1) { perror("[Trace] open"); return -1; }
+
+    uint64_t hsz = page_round(sizeof(struct TraceHeader));
+    uint64_t stride = page_round(sizeof(struct TraceRing));
+    // Plik rzadki - zajmuje tylko strony, do których ktoś faktycznie pisał
+    if (ftruncate(fd, (off_t)(hsz + stride * TRACE_MAX_RINGS)) == -1) {
+        perror("[Trace] ftruncate");
+        close(fd);
+        return -1;
+    }
+    struct TraceHeader *h = mmap(NULL, hsz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED) { perror("[Trace] mmap"); return -1; }
+    h->version = TRACE_VERSION;
+    h->max_rings = TRACE_MAX_RINGS;
+    h->ring_events = TRACE_RING_EVENTS;
+    h->ring_stride = stride;
+    h->data_offset = hsz;
+    __atomic_store_n(&h->magic, TRACE_MAGIC, __ATOMIC_RELEASE);
+    munmap(h, hsz);
+    return 0;
+}
+
+int trace_open(const char *path, const char *role, int id) {
+    int fd = open(path, O_RDWR);
+    if (fd == -1) { perror("[Trace] open"); return -1; }
+
+    uint64_t hsz = page_round(sizeof(struct TraceHeader));
+    struct TraceHeader *h = mmap(NULL, hsz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (h == MAP_FAILED) { perror("[Trace] mmap"); close(fd); return -1; }
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != TRACE_MAGIC || h->version != TRACE_VERSION) {
+        fprintf(stderr, "[Trace] %s: bad header.\n", path);
+        munmap(h, hsz); close(fd);
+        return -1;
+    }
+
+    uint32_t idx = __atomic_fetch_add(&h->next_ring, 1, __ATOMIC_RELAXED);
+    if (idx >= h->max_rings) {
+        __atomic_fetch_add(&h->dropped_rings, 1, __ATOMIC_RELAXED);
+        munmap(h, hsz); close(fd);
+        return -1;
+    }
+    uint64_t stride = h->ring_stride;
+    off_t off = (off_t)(h->data_offset + (uint64_t)idx * stride);
+    munmap(h, hsz);
+
+    struct TraceRing *r = mmap(NULL, stride, PROT_READ | PROT_WRITE, MAP_SHARED, fd, off);
+    close(fd); // Mapowanie pozostaje ważne po zamknięciu deskryptora
+    if (r == MAP_FAILED) { perror("[Trace] mmap ring"); return -1; }
+
+    r->id = id;
+    snprintf(r->role, sizeof(r->role), "%s", role);
+    // PID na końcu - od tej chwili tracedump uznaje bufor za opisany
+    __atomic_store_n(&r->pid, (int32_t)getpid(), __ATOMIC_RELEASE);
+
+    ring = r;
+    ring_len = stride;
+    trace_on = 1;
+    return 0;
+}
+
+void trace_emit(int name, char ph, int arg) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    // Rezerwacja slotu atomowo - handler sygnału może przerwać zapis w pętli głównej
+    uint64_t i = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+    struct TraceEvent *e = &ring->ev[i & (TRACE_RING_EVENTS - 1)];
+    e->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    e->name = (uint16_t)name;
+    e->ph = (uint8_t)ph;
+    e->arg = arg;
+}
+
+void trace_close(void) {
+    trace_on = 0;
+    if (ring) munmap(ring, ring_len);
+    ring = NULL;
+}
+
+struct TraceHeader *trace_map_readonly(const char *path, size_t *map_len) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) { perror("[Trace] open"); return NULL; }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct TraceHeader)) {
+        fprintf(stderr, "[Trace] %s: file too small.\n", path);
+        close(fd);
+        return NULL;
+    }
+    struct TraceHeader *h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED) { perror("[Trace] mmap"); return NULL; }
+    if (h->magic != TRACE_MAGIC || h->version != TRACE_VERSION) {
+        fprintf(stderr, "[Trace] %s: bad header.\n", path);
+        munmap(h, st.st_size);
+        return NULL;
+    }
+    *map_len = st.st_size;
+    return h;
+}
@@ -0,0 +1,96 @@
+/* src/tracedump.c
+ *
+ * Zrzut śladu (swarm_trace.bin) do formatu Chrome Trace Event / Perfetto (JSON).
+ *   tracedump [-f swarm_trace.bin] [-o trace.json]
+ * Każdy proces roju to osobny wiersz osi czasu (pid), spany B/E zagnieżdżają się w nim.
+ * Plik otwiera chrome://tracing lub ui.perfetto.dev.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../include/trace.h"
+
+int main(int argc, char *argv[]) {
+    const char *path = TRACE_FILE;
+    const char *out_path = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:")) != -1) {
+        switch (opt) {
+            case 'f': path = optarg; break;
+            case 'o': out_path = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-f file] [-o trace.json]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    size_t map_len;
+    struct TraceHeader *h = trace_map_readonly(path, &map_len);
+    if (!h) return 1;
+
+    FILE *out = stdout;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) { perror("fopen"); munmap(h, map_len); return 1; }
+    }
+
+    uint32_t rings = h->next_ring < h->max_rings ? h->next_ring : h->max_rings;
+    uint32_t cap = h->ring_events;
+
+    // Początek osi czasu = najwcześniejsze zachowane zdarzenie (czytelne wartości ts)
+    uint64_t t0 = UINT64_MAX;
+    for (uint32_t i = 0; i < rings; i++) {
+        const struct TraceRing *r = trace_ring(h, i);
+        if (r->pid == 0) continue;
+        uint64_t head = r->head;
+        uint64_t first = head > cap ? head - cap : 0;
+        if (head > first && r->ev[first & (cap - 1)].ts_ns < t0) t0 = r->ev[first & (cap - 1)].ts_ns;
+    }
+    if (t0 == UINT64_MAX) t0 = 0;
+
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    int first_ev = 1;
+    long total = 0, wrapped = 0;
+    for (uint32_t i = 0; i < rings; i++) {
+        const struct TraceRing *r = trace_ring(h, i);
+        if (r->pid == 0) continue; // Proces zginął przed opisaniem bufora
+
+        char pname[48];
+        if (r->id >= 0) snprintf(pname, sizeof(pname), "%.16s %d", r->role, r->id);
+        else snprintf(pname, sizeof(pname), "%.16s", r->role);
+        fprintf(out, "%s{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                first_ev ? "" : ",\n", r->pid, r->pid, pname);
+        first_ev = 0;
+
+        uint64_t head = r->head;
+        uint64_t first = head > cap ? head - cap : 0;
+        if (first > 0) wrapped++;
+        int depth = 0; // Po nadpisaniu bufora pierwsze 'E' mogą nie mieć pary - pomijamy je
+        for (uint64_t k = first; k < head; k++) {
+            const struct TraceEvent *e = &r->ev[k & (cap - 1)];
+            if (e->name >= TR_NAMES) continue;
+            if (e->ph == 'E') {
+                if (depth == 0) continue;
+                depth--;
+            } else if (e->ph == 'B') depth++;
+            double ts = (e->ts_ns >= t0 ? e->ts_ns - t0 : 0) / 1000.0;
+            fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"%.16s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d",
+                    trace_names[e->name], r->role, e->ph, ts, r->pid, r->pid);
+            if (e->ph == 'i') fprintf(out, ", \"s\": \"t\"");
+            if (e->ph != 'B') fprintf(out, ", \"args\": {\"arg\": %d}", e->arg);
+            fprintf(out, "}");
+            total++;
+        }
+    }
+    fprintf(out, "\n]}\n");
+    if (out_path) fclose(out);
+
+    fprintf(stderr, "[tracedump] %u processes, %ld events, %ld wrapped rings, %u processes without a ring.\n",
+            rings, total, wrapped, h->dropped_rings);
+    munmap(h, map_len);
+    return 0;
+}
@@ -0,0 +1,76 @@
+/* src/tsdump.c
+ *
+ * Odczyt binarnego szeregu czasowego Operatora (samples.bin).
+ *   tsdump [-s] [plik]
+ *   bez -s  - CSV na stdout (kolumny jak samples.csv)
+ *   -s      - podsumowanie: pierwsze nasycenie hangaru, szczyty kolejek, sumy zdarzeń
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/sampler.h"
+
+int main(int argc, char *argv[]) {
+    int summary = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s")) != -1) {
+        if (opt == 's') summary = 1;
+        else { fprintf(stderr, "Usage: %s [-s] [%s]\n", argv[0], TS_FILE_BIN); return 1; }
+    }
+    const char *path = optind < argc ? argv[optind] : TS_FILE_BIN;
+    FILE *f = fopen(path, "rb");
+    if (!f) { perror("[tsdump] fopen"); return 1; }
+
+    struct TsHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != TS_MAGIC) {
+        fprintf(stderr, "[tsdump] %s: not a sample file.\n", path);
+        fclose(f);
+        return 1;
+    }
+    if (h.version != TS_VERSION || h.record_size != sizeof(struct TsSample) || h.channels != CHANNELS) {
+        fprintf(stderr, "[tsdump] %s: version %u, record %u B, %u channels - this build expects %d, %zu B, %d.\n",
+                path, h.version, h.record_size, h.channels, TS_VERSION, sizeof(struct TsSample), CHANNELS);
+        fclose(f);
+        return 1;
+    }
+
+    struct TsSample s;
+    long n = 0;
+    double t_first = 0, t_last = 0, t_sat = -1, t_qmax = 0;
+    int occ_max = 0, ql_max = 0, qt_max = 0, pend_max = 0, p_min = 0, p_max = 0;
+    uint64_t tot[TS_DELTAS] = {0};
+    if (!summary) ts_csv_header(stdout);
+    while (fread(&s, sizeof(s), 1, f) == 1) {
+        if (!summary) { ts_csv_row(stdout, &s); continue; }
+        if (n == 0) { t_first = s.t; p_min = p_max = s.P; }
+        t_last = s.t;
+        n++;
+        // Nasycenie: brak wolnych miejsc, a ktoś czeka na lądowanie
+        if (t_sat < 0 && s.free_slots == 0 && s.q_land > 0) t_sat = s.t;
+        if (s.occupied > occ_max) occ_max = s.occupied;
+        if (s.q_land > ql_max) { ql_max = s.q_land; t_qmax = s.t; }
+        if (s.q_takeoff > qt_max) qt_max = s.q_takeoff;
+        if (s.pending_removal > pend_max) pend_max = s.pending_removal;
+        if (s.P < p_min) p_min = s.P;
+        if (s.P > p_max) p_max = s.P;
+        for (int k = 0; k < TS_DELTAS; k++) tot[k] += s.d[k];
+    }
+    fclose(f);
+    if (!summary) return 0;
+
+    printf("%s: %ld samples every %u ms, %.1f s\n", path, n, h.interval_ms, n ? t_last - t_first : 0.0);
+    if (n == 0) return 0;
+    printf(" P range:              %d - %d (pending removal max %d)\n", p_min, p_max, pend_max);
+    printf(" occupied max:         %d\n", occ_max);
+    if (t_sat >= 0) printf(" first saturation:     +%.2f s\n", t_sat - t_first);
+    else printf(" first saturation:     never\n");
+    printf(" land queue max:       %d at +%.2f s\n", ql_max, t_qmax - t_first);
+    printf(" takeoff queue max:    %d\n", qt_max);
+    printf(" events:");
+    for (int k = 0; k < TS_DELTAS; k++) printf(" %s %llu", ts_delta_names[k], (unsigned long long)tot[k]);
+    printf("\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+/* src/usage.c
+ *
+ * Zapis zużycia zasobów procesu do sum klasy w pamięci dzielonej (wywoływany z atexit).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "../include/usage.h"
+
+static struct UsageClass *exit_class = NULL;
+
+static int bucket(uint64_t v) {
+    int k = 0;
+    while (v > 0 && k < USAGE_BUCKETS - 1) { v >>= 1; k++; }
+    return k;
+}
+
+static void add(uint64_t *sum, uint64_t v) { __atomic_add_fetch(sum, v, __ATOMIC_RELAXED); }
+
+static void set_max(uint64_t *max, uint64_t v) {
+    uint64_t cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (v > cur && !__atomic_compare_exchange_n(max, &cur, v, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// syscr / syscw z /proc/self/io. 0 = OK, -1 = niedostępne (np. brak uprawnień do procfs)
+static int read_io(uint64_t *syscr, uint64_t *syscw) {
+    FILE *f = fopen("/proc/self/io", "r");
+    if (!f) return -1;
+    char line[96];
+    int got = 0;
+    unsigned long long v;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "syscr: %llu", &v) == 1) { *syscr = v; got++; }
+        else if (sscanf(line, "syscw: %llu", &v) == 1) { *syscw = v; got++; }
+    }
+    fclose(f);
+    return got == 2 ? 0 : -1;
+}
+
+void usage_record(struct UsageClass *c) {
+    struct rusage ru;
+    if (!c || getrusage(RUSAGE_SELF, &ru) == -1) return;
+    uint64_t ut = (uint64_t)ru.ru_utime.tv_sec * 1000000 + ru.ru_utime.tv_usec;
+    uint64_t st = (uint64_t)ru.ru_stime.tv_sec * 1000000 + ru.ru_stime.tv_usec;
+    uint64_t csw = (uint64_t)ru.ru_nvcsw + (uint64_t)ru.ru_nivcsw;
+    uint64_t rss = (uint64_t)ru.ru_maxrss; // Linux: KB
+    uint64_t syscr = 0, syscw = 0;
+
+    if (read_io(&syscr, &syscw) == 0) {
+        add(&c->syscr, syscr);
+        add(&c->syscw, syscw);
+    } else {
+        __atomic_add_fetch(&c->io_missing, 1, __ATOMIC_RELAXED);
+    }
+    add(&c->utime_us, ut);
+    add(&c->stime_us, st);
+    add(&c->nvcsw, (uint64_t)ru.ru_nvcsw);
+    add(&c->nivcsw, (uint64_t)ru.ru_nivcsw);
+    add(&c->minflt, (uint64_t)ru.ru_minflt);
+    add(&c->majflt, (uint64_t)ru.ru_majflt);
+    add(&c->maxrss_kb, rss);
+    set_max(&c->cpu_us_max, ut + st);
+    set_max(&c->csw_max, csw);
+    set_max(&c->rss_kb_max, rss);
+    __atomic_add_fetch(&c->cpu_hist[bucket(ut + st)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->csw_hist[bucket(csw)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->rss_hist[bucket(rss)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->n, 1, __ATOMIC_RELEASE); // Ostatnie - czytelnik widzi komplet sum
+}
+
+static void record_at_exit(void) { usage_record(exit_class); }
+
+void usage_at_exit(struct UsageClass *c) {
+    if (exit_class == NULL) atexit(record_at_exit);
+    exit_class = c;
+}
+
+void usage_detach(void) {
+    usage_record(exit_class);
+    exit_class = NULL;
+}
+
+uint64_t usage_pct(const uint32_t *hist, uint32_t n, double p, uint64_t max) {
+    if (n == 0) return 0;
+    uint64_t need = (uint64_t)(p / 100.0 * n + 0.5), seen = 0;
+    if (need == 0) need = 1;
+    for (int k = 0; k < USAGE_BUCKETS; k++) {
+        seen += hist[k];
+        if (seen >= need) {
+            uint64_t top = k == 0 ? 0 : (1ULL << k) - 1;
+            return top < max ? top : max;
+        }
+    }
+    return max;
+}